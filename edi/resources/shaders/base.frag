@@ -14,6 +14,9 @@
 
 #define SOFT_SHADOW_PROPS_BINDING ${SOFT_SHADOW_PROPS_BINDING}
 
+#define MATERIALS_BINDING ${MATERIALS_BINDING}
+#define MAX_TEXTURE_ARRAYS ${MAX_TEXTURE_ARRAYS}
+
 in VS_OUT {
     vec3 world_space_position;
     vec3 view_space_position;
@@ -23,6 +26,7 @@ in VS_OUT {
     vec3 tangent_view_position;
     vec2 texture_uv;
     flat float ent_id;
+    flat float material_index;
 } fs_in;
 
 layout(location = 0) out vec4 final_color;
@@ -101,13 +105,42 @@ struct Material {
 
     float roughness;
     float metallic;
+
+    ivec4 texture_layers;
 };
 
-uniform Material u_material;
+layout (std430, binding = MATERIALS_BINDING) readonly buffer Materials {
+    Material materials[];
+} u_materials;
+
 uniform sampler2D u_albedo;
 uniform sampler2D u_normal;
 uniform sampler2D u_orm;
 uniform sampler2D u_emission_map;
+uniform sampler2DArray u_texture_arrays[MAX_TEXTURE_ARRAYS];
+
+/* Packed textures are read from their array, see TextureArrays::layer_ref().
+ * Array index has to be a constant expression, hence the switch. Gradients
+ * come from outside, branches may not be taken uniformly. */
+vec4 sample_material_map(int layer_ref, sampler2D fallback, vec2 uv,
+                         vec2 dx, vec2 dy) {
+    if (layer_ref < 0)
+        return textureGrad(fallback, uv, dx, dy);
+
+    vec3 layer_uv = vec3(uv, float(layer_ref & 0xFFFF));
+    switch (layer_ref >> 16) {
+    case 0: return textureGrad(u_texture_arrays[0], layer_uv, dx, dy);
+    case 1: return textureGrad(u_texture_arrays[1], layer_uv, dx, dy);
+    case 2: return textureGrad(u_texture_arrays[2], layer_uv, dx, dy);
+    case 3: return textureGrad(u_texture_arrays[3], layer_uv, dx, dy);
+    case 4: return textureGrad(u_texture_arrays[4], layer_uv, dx, dy);
+    case 5: return textureGrad(u_texture_arrays[5], layer_uv, dx, dy);
+    case 6: return textureGrad(u_texture_arrays[6], layer_uv, dx, dy);
+    case 7: return textureGrad(u_texture_arrays[7], layer_uv, dx, dy);
+    }
+
+    return vec4(0.0);
+}
 
 uniform samplerCube u_irradiance_map;
 uniform samplerCube u_prefilter_map;
@@ -280,6 +313,8 @@ vec3 berley_brdf(vec3 N, vec3 V, vec3 L, vec3 albedo, float metallic, float roug
 }
 
 void main() {
+    Material material = u_materials.materials[int(fs_in.material_index)];
+
     int ent_id = int(fs_in.ent_id);
     int r_int = int(mod(int(ent_id / 65025.0), 255));
     int g_int = int(mod(int(ent_id / 255.0), 255));
@@ -290,15 +325,20 @@ void main() {
     picker_id = vec4(r, g, b, 1.0);
 
     vec2 tex_coords
-        = fs_in.texture_uv * u_material.tiling_factor + u_material.texture_offset;
+        = fs_in.texture_uv * material.tiling_factor + material.texture_offset;
+
+    vec2 dx = dFdx(tex_coords);
+    vec2 dy = dFdy(tex_coords);
+    ivec4 layers = material.texture_layers;
 
-    vec4 diffuse = texture(u_albedo, tex_coords);
-    vec3 N = texture(u_normal, tex_coords).rgb;
+    vec4 diffuse = sample_material_map(layers.x, u_albedo, tex_coords, dx, dy);
+    vec3 N = sample_material_map(layers.y, u_normal, tex_coords, dx, dy).rgb;
     N = N * 2.0 - 1.0;
 
-    float ao = texture(u_orm, tex_coords).r * u_material.emission_and_ao.w;
-    float roughness = texture(u_orm, tex_coords).g * u_material.roughness;
-    float metallic = texture(u_orm, tex_coords).b * u_material.metallic;
+    vec3 orm = sample_material_map(layers.z, u_orm, tex_coords, dx, dy).rgb;
+    float ao = orm.r * material.emission_and_ao.w;
+    float roughness = orm.g * material.roughness;
+    float metallic = orm.b * material.metallic;
     roughness = clamp(roughness, 0.045, 1.0 - 0.045);
     metallic = clamp(metallic, 0.045, 1.0 - 0.045);
 
@@ -450,9 +490,10 @@ void main() {
 
     vec3 irradiance = texture(u_irradiance_map, N).rgb;
     vec3 ambient = (kD * irradiance * diffuse.rgb + specular) * ao;
-    vec3 emission = texture(u_emission_map, tex_coords).rgb
-        * u_material.emission_and_ao.rgb;
+    vec3 emission
+        = sample_material_map(layers.w, u_emission_map, tex_coords, dx, dy).rgb
+        * material.emission_and_ao.rgb;
 
-    final_color.rgb = (ambient + Lo) * u_material.color.rgb + emission;
-    final_color.a = diffuse.a * u_material.color.a;
+    final_color.rgb = (ambient + Lo) * material.color.rgb + emission;
+    final_color.a = diffuse.a * material.color.a;
 }
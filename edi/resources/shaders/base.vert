@@ -9,6 +9,7 @@ layout (location = 3) in vec3 a_bitangent;
 layout (location = 4) in vec2 a_texture_uv;
 layout (location = 5) in mat4 a_transform;
 layout (location = 9) in float a_ent_id;
+layout (location = 10) in float a_material_index;
 
 layout (std140, binding = CAMERA_BINDING) uniform Camera {
     mat4 view_projection;
@@ -36,6 +37,7 @@ out VS_OUT {
     vec3 tangent_view_position;
     vec2 texture_uv;
     flat float ent_id;
+    flat float material_index;
 } vs_out;
 
 void main() {
@@ -53,6 +55,7 @@ void main() {
     vs_out.tangent_view_position = TBN * vs_out.eye_position;
     vs_out.texture_uv = a_texture_uv;
     vs_out.ent_id = a_ent_id;
+    vs_out.material_index = a_material_index;
 
     gl_Position = u_camera.view_projection * a_transform * vec4(a_pos, 1.0);
 }
@@ -1,5 +1,8 @@
 #version 430 core
 
+#define MATERIALS_BINDING ${MATERIALS_BINDING}
+#define MAX_TEXTURE_ARRAYS ${MAX_TEXTURE_ARRAYS}
+
 in VS_OUT {
     vec3 world_space_position;
     vec3 view_space_position;
@@ -7,6 +10,7 @@ in VS_OUT {
     vec3 normal;
     vec2 texture_uv;
     flat float ent_id;
+    flat float material_index;
 } fs_in;
 
 layout(location = 0) out vec4 final_color;
@@ -20,13 +24,44 @@ struct Material {
 
     float roughness;
     float metallic;
+
+    ivec4 texture_layers;
 };
 
-uniform Material u_material;
+layout (std430, binding = MATERIALS_BINDING) readonly buffer Materials {
+    Material materials[];
+} u_materials;
+
 uniform sampler2D u_albedo;
 uniform sampler2D u_emission_map;
+uniform sampler2DArray u_texture_arrays[MAX_TEXTURE_ARRAYS];
+
+/* Packed textures are read from their array, see TextureArrays::layer_ref().
+ * Array index has to be a constant expression, hence the switch. Gradients
+ * come from outside, branches may not be taken uniformly. */
+vec4 sample_material_map(int layer_ref, sampler2D fallback, vec2 uv,
+                         vec2 dx, vec2 dy) {
+    if (layer_ref < 0)
+        return textureGrad(fallback, uv, dx, dy);
+
+    vec3 layer_uv = vec3(uv, float(layer_ref & 0xFFFF));
+    switch (layer_ref >> 16) {
+    case 0: return textureGrad(u_texture_arrays[0], layer_uv, dx, dy);
+    case 1: return textureGrad(u_texture_arrays[1], layer_uv, dx, dy);
+    case 2: return textureGrad(u_texture_arrays[2], layer_uv, dx, dy);
+    case 3: return textureGrad(u_texture_arrays[3], layer_uv, dx, dy);
+    case 4: return textureGrad(u_texture_arrays[4], layer_uv, dx, dy);
+    case 5: return textureGrad(u_texture_arrays[5], layer_uv, dx, dy);
+    case 6: return textureGrad(u_texture_arrays[6], layer_uv, dx, dy);
+    case 7: return textureGrad(u_texture_arrays[7], layer_uv, dx, dy);
+    }
+
+    return vec4(0.0);
+}
 
 void main() {
+    Material material = u_materials.materials[int(fs_in.material_index)];
+
     int ent_id = int(fs_in.ent_id);
     int r_int = int(mod(int(ent_id / 65025.0), 255));
     int g_int = int(mod(int(ent_id / 255.0), 255));
@@ -37,10 +72,16 @@ void main() {
     picker_id = vec4(r, g, b, 1.0);
 
     vec2 tex_coords
-        = fs_in.texture_uv * u_material.tiling_factor + u_material.texture_offset;
-    vec4 albedo = texture(u_albedo, tex_coords) * u_material.color;
-    vec3 emission = texture(u_emission_map, tex_coords).rgb
-        * u_material.emission_and_ao.rgb;
+        = fs_in.texture_uv * material.tiling_factor + material.texture_offset;
+    vec2 dx = dFdx(tex_coords);
+    vec2 dy = dFdy(tex_coords);
+    ivec4 layers = material.texture_layers;
+
+    vec4 albedo = sample_material_map(layers.x, u_albedo, tex_coords, dx, dy)
+        * material.color;
+    vec3 emission
+        = sample_material_map(layers.w, u_emission_map, tex_coords, dx, dy).rgb
+        * material.emission_and_ao.rgb;
 
     final_color = albedo + vec4(emission, 0.0);
 }
@@ -1,4 +1,6 @@
 #include "context.hpp"
+#include "eng/frame_memory.hpp"
+#include "eng/jobs.hpp"
 #include "GLFW/glfw3.h"
 #include "imgui/ImGuizmo.h"
 
@@ -96,6 +98,9 @@ Result<Context *, ContextError> Context::create() {
         return {.error = ContextError::RENDERER_FAIL};
     }
 
+    eng::jobs::init();
+    eng::frame_memory::init();
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui::StyleColorsDark();
@@ -120,6 +125,8 @@ void Context::cleanup() {
 
     eng::renderer::shutdown();
     eng::Window::terminate();
+    eng::jobs::shutdown();
+    eng::frame_memory::shutdown();
 }
 
 uint32_t Context::fps() {
@@ -131,6 +138,8 @@ void Context::run_loop() {
     float curr_time = 0.0f;
 
     while (main_window.is_open()) {
+        eng::frame_memory::next_frame();
+
         if (s_pop_layer) {
             s_pop_layer = false;
             layers.top()->on_detach();
@@ -142,8 +151,10 @@ void Context::run_loop() {
             layers.top()->on_attach();
         }
 
+        /* Long stalls (window dragged, debugger break) shouldn't be
+         * simulated as if the time actually passed. */
         curr_time = (float)glfwGetTime();
-        timestep = std::min(curr_time - prev_time, 1.0f / 60.0f);
+        timestep = std::min(curr_time - prev_time, 0.25f);
         prev_time = curr_time;
 
         ImGui_ImplOpenGL3_NewFrame();
@@ -158,6 +169,10 @@ void Context::run_loop() {
             layers.top()->on_event(event);
         }
 
+        ticks_last_frame = fixed_timestep.advance(timestep);
+        for (int32_t i = 0; i < ticks_last_frame; i++)
+            layers.top()->on_tick(fixed_timestep.tickrate);
+
         layers.top()->on_update(timestep);
         layers.top()->on_render();
 
@@ -1,6 +1,7 @@
 #ifndef CONTEXT_HPP
 #define CONTEXT_HPP
 
+#include "eng/fixed_timestep.hpp"
 #include "eng/random_utils.hpp"
 #include "eng/window.hpp"
 #include "layers.hpp"
@@ -29,7 +30,13 @@ struct Context {
     std::stack<std::unique_ptr<Layer>> layers;
 
     eng::Window main_window;
+
+    /* Real duration of the last frame. */
     float timestep = 1.0f / 60.0f;
+
+    /* Layers' on_tick runs at this rate, no matter the frame rate. */
+    FixedTimestep fixed_timestep = FixedTimestep::create(60);
+    int32_t ticks_last_frame = 0;
 };
 
 [[nodiscard]] Context *context();
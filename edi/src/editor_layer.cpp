@@ -2,15 +2,20 @@
 #include "context.hpp"
 #include "eng/containers/registry.hpp"
 #include "eng/event.hpp"
+#include "eng/frame_memory.hpp"
 #include "eng/input.hpp"
 #include "eng/random_utils.hpp"
 #include "eng/renderer/camera.hpp"
+#include "eng/renderer/gpu_culling.hpp"
+#include "eng/renderer/lod.hpp"
 #include "eng/renderer/opengl.hpp"
 #include "eng/renderer/renderer.hpp"
+#include "eng/renderer/scene_submission.hpp"
 #include "eng/scene/assets.hpp"
 #include "eng/scene/components.hpp"
 #include "eng/scene/entity.hpp"
 #include "eng/scene/scene.hpp"
+#include "eng/scene/scene_file.hpp"
 #include "glm/fwd.hpp"
 #include "glm/gtc/constants.hpp"
 #include "glm/trigonometric.hpp"
@@ -18,10 +23,21 @@
 #include "imgui/imgui_internal.h"
 #include "imgui/ImGuizmo.h"
 #include "layers.hpp"
+#include <algorithm>
 #include <cfloat>
+#include <chrono>
+#include <filesystem>
 #include <string>
+#include <tuple>
 #include <signal.h>
 
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+static constexpr const char *SCENE_PATH = "resources/main.scene";
+static constexpr const char *CELLS_DIR = "resources/cells";
+static constexpr float CELL_SIZE = 32.0f;
+
 std::unique_ptr<Layer> EditorLayer::create(const eng::WindowSpec &win_spec) {
     glm::ivec2 window_size = glm::ivec2(win_spec.width, win_spec.height);
 
@@ -59,6 +75,7 @@ std::unique_ptr<Layer> EditorLayer::create(const eng::WindowSpec &win_spec) {
 
     layer->asset_pack = eng::AssetPack::create("default");
     layer->scene = eng::Scene::create("New scene");
+    layer->gpu_scene = eng::GpuScene::create();
 
     eng::Material mat;
     mat.name = "Outline";
@@ -77,6 +94,10 @@ std::unique_ptr<Layer> EditorLayer::create(const eng::WindowSpec &win_spec) {
     layer->envmap_id = layer->asset_pack.add_env_map(env_map);
     eng::renderer::use_envmap(layer->asset_pack.env_maps.at(layer->envmap_id));
 
+    if (std::filesystem::exists(SCENE_PATH) &&
+        eng::load_scene(layer->scene, layer->asset_pack, SCENE_PATH))
+        return layer;
+
     eng::Entity ent = layer->scene.spawn_entity("xdd");
     ent.add_component<eng::MeshComp>().id = eng::AssetPack::CUBE_ID;
     ent.add_component<eng::MaterialComp>().id =
@@ -104,6 +125,14 @@ std::unique_ptr<Layer> EditorLayer::create(const eng::WindowSpec &win_spec) {
 }
 
 void EditorLayer::destroy() {
+    for (PendingLodChain &pending : pending_lod_chains)
+        pending.levels.wait();
+
+    if (streamer.has_value())
+        streamer.value().destroy();
+
+    static_batches.destroy(asset_pack.geometry);
+    gpu_scene.destroy();
     scene.destroy();
     asset_pack.destroy();
     main_fbo.destroy();
@@ -140,6 +169,7 @@ void EditorLayer::on_event(eng::Event &event) {
             if (selected_entity.has_value()) {
                 scene.destroy_entity(selected_entity.value().handle);
                 selected_entity = std::nullopt;
+                static_dirty = true;
                 return;
             }
 
@@ -148,6 +178,7 @@ void EditorLayer::on_event(eng::Event &event) {
         case eng::Key::D:
             if (event.key.ctrl && selected_entity.has_value()) {
                 selected_entity = scene.duplicate(selected_entity.value());
+                static_dirty = true;
                 return;
             }
 
@@ -202,18 +233,20 @@ void EditorLayer::on_event(eng::Event &event) {
             viewport_hovered && !lock_focus) {
             glm::vec2 mouse_pos = eng::get_mouse_position();
             glm::vec2 local_mouse_pos = mouse_pos - viewport_pos;
-            glm::u8vec4 pixel = main_fbo.pixel_at(local_mouse_pos, 1);
+            if (pixel_exact_picking) {
+                main_fbo.request_pick(local_mouse_pos, 1);
+                return;
+            }
 
-            if (pixel == glm::u8vec4(0)) {
+            std::optional<eng::RayHit> hit =
+                scene.raycast(camera.screen_ray(local_mouse_pos), asset_pack);
+
+            if (!hit.has_value()) {
                 selected_entity = std::nullopt;
                 return;
             }
 
-            uint32_t red_contrib = pixel.r * 65025;
-            uint32_t green_contrib = pixel.g * 255;
-            uint32_t blue_contrib = pixel.b;
-            uint32_t id = red_contrib + green_contrib + blue_contrib;
-            selected_entity = scene.entities[scene.id_to_index.at(id)];
+            selected_entity = scene.entity(hit.value().ent_id);
         }
 
         break;
@@ -227,62 +260,134 @@ void EditorLayer::on_event(eng::Event &event) {
 }
 
 void EditorLayer::on_update(float ts) {
-    scene.update_global_transforms();
+    std::erase_if(pending_lod_chains, [this](PendingLodChain &pending) {
+        if (pending.levels.wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready)
+            return false;
+
+        /* Previous chain, if any, beats none at all. */
+        std::vector<eng::SimplifiedMesh> levels = pending.levels.get();
+        if (levels.empty()) {
+            unsimplifiable_meshes.insert(pending.mesh_id);
+            return true;
+        }
 
-    camera.on_update(ts);
-}
+        unsimplifiable_meshes.erase(pending.mesh_id);
+
+        /* Old levels get erased, entities with one of them picked directly
+         * go back to full detail. */
+        std::vector<eng::AssetID> old_levels;
+        const eng::Mesh &mesh = asset_pack.meshes.at(pending.mesh_id);
+        for (const eng::MeshLod &lod : mesh.lods)
+            old_levels.push_back(lod.mesh_id);
+
+        asset_pack.set_lod_chain(pending.mesh_id, levels);
+
+        eng::ecs::RegistryView rview = scene.registry.view<eng::MeshComp>();
+        for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
+            eng::MeshComp &comp = rview.get<eng::MeshComp>(entry);
+            if (std::find(old_levels.begin(), old_levels.end(), comp.id) !=
+                old_levels.end()) {
+                comp.id = pending.mesh_id;
+                scene.entity(entry.entity_id).mesh_changed();
+                static_dirty = true;
+            }
+        }
 
-void EditorLayer::on_tick(uint32_t tickrate) {}
+        return true;
+    });
 
-static void setup_dockspace();
-static void render_control_panel(EditorLayer &layer);
-static void render_entity_panel(EditorLayer &layer);
-static void render_gizmo(EditorLayer &layer);
+    /* Rendered state sits somewhere between the last two ticks. */
+    scene.update_global_transforms(context()->fixed_timestep.alpha());
+    for (eng::ecs::EntityID id : scene.moved_ids) {
+        if (scene.contains(id) &&
+            scene.entity(id).has_component<eng::Static>()) {
+            static_dirty = true;
+            break;
+        }
+    }
 
-static void on_shadow_pass(EditorLayer &layer) {
-    eng::Scene &scene = layer.scene;
+    /* Kept up to date even with GPU culling off, so toggling it is free. */
+    gpu_scene.update(scene, asset_pack);
+    scene.update_spatial_index(asset_pack);
 
-    eng::renderer::shadow_pass_begin(layer.camera.render_data(),
-                                     layer.asset_pack);
+    if (static_dirty) {
+        static_batches.destroy(asset_pack.geometry);
+        static_batches = eng::StaticBatches::bake(scene, asset_pack);
+        static_dirty = false;
+    }
 
-    eng::ecs::RegistryView rview =
-        scene.registry.view<eng::GlobalTransform, eng::DirLight>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::DirLight &light = rview.get<eng::DirLight>(entry);
+    std::optional<glm::u8vec4> pixel = main_fbo.poll_pick();
+    if (pixel.has_value()) {
+        uint32_t red_contrib = pixel.value().r * 65025;
+        uint32_t green_contrib = pixel.value().g * 255;
+        uint32_t blue_contrib = pixel.value().b;
+        uint32_t id = red_contrib + green_contrib + blue_contrib;
 
-        eng::renderer::submit_dir_light(transform.rotation, light);
+        if (id != 0 && scene.contains(id))
+            selected_entity = scene.entity(id);
+        else
+            selected_entity = std::nullopt;
     }
 
-    rview = scene.registry.view<eng::GlobalTransform, eng::PointLight>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::PointLight &light = rview.get<eng::PointLight>(entry);
+    /* CPU picking is cheap enough to do every frame for hover feedback. */
+    hovered_entity = std::nullopt;
+    if (viewport_hovered && !lock_focus && camera.viewport.x > 0.0f) {
+        glm::vec2 local_mouse_pos = eng::get_mouse_position() - viewport_pos;
+        std::optional<eng::RayHit> hit =
+            scene.raycast(camera.screen_ray(local_mouse_pos), asset_pack);
 
-        eng::renderer::submit_point_light(transform.position, light);
+        if (hit.has_value())
+            hovered_entity = hit.value().ent_id;
     }
 
-    rview = scene.registry.view<eng::GlobalTransform, eng::SpotLight>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::SpotLight &light = rview.get<eng::SpotLight>(entry);
+    camera.on_update(ts);
+}
 
-        eng::renderer::submit_spot_light(transform, light);
+void EditorLayer::on_tick(uint32_t tickrate) {
+    scene.store_previous_transforms();
+
+    /* Streaming follows the camera at the tick rate - no need to query
+     * cells more often, no matter how fast frames go. */
+    if (streamer.has_value()) {
+        size_t alive_count = scene.entities.size() - scene.free_slots.size();
+        streamer.value().update(scene, asset_pack, camera.position);
+
+        /* Merged or evicted cells might've carried static geometry. */
+        if (scene.entities.size() - scene.free_slots.size() != alive_count)
+            static_dirty = true;
+
+        if (selected_entity.has_value() &&
+            !scene.contains(selected_entity.value().handle))
+            selected_entity = std::nullopt;
     }
+}
 
-    rview = scene.registry.view<eng::GlobalTransform, eng::MeshComp,
-                                eng::MaterialComp>(
-        eng::ecs::exclude<eng::PointLight, eng::DirLight, eng::SpotLight>);
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::MeshComp &mesh = rview.get<eng::MeshComp>(entry);
+static void setup_dockspace();
+static void render_control_panel(EditorLayer &layer);
+static void render_entity_panel(EditorLayer &layer);
+static void render_gizmo(EditorLayer &layer);
 
-        eng::renderer::submit_shadow_mesh(transform.to_mat4(), mesh.id);
+static void on_shadow_pass(EditorLayer &layer) {
+    eng::Scene &scene = layer.scene;
+
+    eng::renderer::CameraData camera_data = layer.camera.render_data();
+    eng::renderer::shadow_pass_begin(camera_data, layer.asset_pack);
+    eng::renderer::submit_scene_lights(scene);
+
+    if (layer.gpu_culling) {
+        eng::renderer::submit_gpu_scene(layer.gpu_scene);
+    } else {
+        /* Only meshes in range of lights visible to the camera cast
+         * shadows. */
+        eng::renderer::cull_shadow_casters(
+            scene, eng::extract_frustum_planes(camera_data.view_projection),
+            layer.visible_proxies);
+        eng::renderer::select_shadow_lods(scene, layer.asset_pack,
+                                          camera_data, layer.visible_proxies);
+        eng::renderer::submit_shadow_casters(scene, layer.visible_proxies);
     }
+    eng::renderer::submit_static_shadow_batches(layer.static_batches);
 
     eng::renderer::shadow_pass_end();
 }
@@ -309,6 +414,13 @@ void EditorLayer::on_render() {
                  {0.0f, 1.0f}, {1.0f, 0.0f});
     render_gizmo(*this);
     ImGui::PopStyleVar();
+
+    if (hovered_entity.has_value() && scene.contains(hovered_entity.value()) &&
+        !ImGuizmo::IsUsing()) {
+        eng::Entity &hovered = scene.entity(hovered_entity.value());
+        const std::string &name = hovered.get_component<eng::Name>().name;
+        ImGui::SetTooltip("%s", name.c_str());
+    }
     ImGui::End();
 
     ImGui::Begin("Entity panel");
@@ -327,48 +439,20 @@ void EditorLayer::on_render() {
 
     glStencilFunc(GL_ALWAYS, 0, 0xFF);
     glStencilMask(0x00);
-    eng::renderer::scene_begin(camera.render_data(), asset_pack, main_fbo);
-
-    eng::ecs::RegistryView rview =
-        scene.registry.view<eng::GlobalTransform, eng::DirLight>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::DirLight &light = rview.get<eng::DirLight>(entry);
-
-        eng::renderer::submit_dir_light(transform.rotation, light);
-    }
-
-    rview = scene.registry.view<eng::GlobalTransform, eng::PointLight>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::PointLight &light = rview.get<eng::PointLight>(entry);
-
-        eng::renderer::submit_point_light(transform.position, light);
-    }
-
-    rview = scene.registry.view<eng::GlobalTransform, eng::SpotLight>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::SpotLight &light = rview.get<eng::SpotLight>(entry);
-
-        eng::renderer::submit_spot_light(transform, light);
-    }
-
-    rview = scene.registry
-                .view<eng::GlobalTransform, eng::MeshComp, eng::MaterialComp>();
-    for (eng::ecs::RegistryView::Entry &entry : rview.entity_entries) {
-        eng::GlobalTransform &transform =
-            rview.get<eng::GlobalTransform>(entry);
-        eng::MeshComp &mesh = rview.get<eng::MeshComp>(entry);
-        eng::MaterialComp &mat = rview.get<eng::MaterialComp>(entry);
-
-        eng::renderer::submit_mesh(transform.to_mat4(), mesh.id, mat.id,
-                                   entry.entity_id);
+    eng::renderer::CameraData camera_data = camera.render_data();
+    eng::renderer::scene_begin(camera_data, asset_pack, main_fbo);
+    eng::renderer::submit_scene_lights(scene);
+    if (gpu_culling) {
+        eng::renderer::submit_gpu_scene(gpu_scene);
+    } else {
+        eng::renderer::cull_visible_meshes(
+            scene, eng::extract_frustum_planes(camera_data.view_projection),
+            visible_proxies);
+        eng::renderer::select_lods(scene, asset_pack, camera_data,
+                                   visible_proxies);
+        eng::renderer::submit_visible_meshes(scene, visible_proxies);
     }
-
+    eng::renderer::submit_static_batches(static_batches);
     eng::renderer::scene_end();
     eng::renderer::skybox(envmap_id);
 
@@ -445,10 +529,17 @@ static void render_entity_node(EditorLayer &layer, eng::Entity &ent,
     if (ent.children_ids.empty())
         flags |= ImGuiTreeNodeFlags_Leaf;
 
+    bool hovered = layer.hovered_entity.value_or(0) == ent.handle;
+    if (hovered)
+        ImGui::PushStyleColor(ImGuiCol_Text, {1.0f, 0.8f, 0.3f, 1.0f});
+
     bool opened =
         ImGui::TreeNodeEx((void *)(intptr_t)ent.handle, flags, "%s",
                           ent.get_component<eng::Name>().name.c_str());
 
+    if (hovered)
+        ImGui::PopStyleColor();
+
     if (ImGui::BeginDragDropSource()) {
         ImGui::SetDragDropPayload("ENT_ID", &ent.handle,
                                   sizeof(eng::ecs::EntityID));
@@ -462,8 +553,7 @@ static void render_entity_node(EditorLayer &layer, eng::Entity &ent,
             eng::ecs::EntityID dropped_id =
                 *(const eng::ecs::EntityID *)payload->Data;
 
-            int32_t dropped_idx = layer.scene.id_to_index[dropped_id];
-            eng::Entity &dropped = layer.scene.entities[dropped_idx];
+            eng::Entity &dropped = layer.scene.entity(dropped_id);
 
             if (!layer.scene.is_ascendant_of(ent, dropped))
                 out_new_link = {ent.handle, dropped.handle};
@@ -477,11 +567,9 @@ static void render_entity_node(EditorLayer &layer, eng::Entity &ent,
         layer.selected_entity = ent;
 
     if (opened) {
-        for (eng::ecs::EntityID child_id : ent.children_ids) {
-            int32_t child_idx = layer.scene.id_to_index[child_id];
-            render_entity_node(layer, layer.scene.entities[child_idx],
+        for (eng::ecs::EntityID child_id : ent.children_ids)
+            render_entity_node(layer, layer.scene.entity(child_id),
                                out_new_link);
-        }
 
         ImGui::TreePop();
     }
@@ -501,23 +589,19 @@ static void render_control_panel(EditorLayer &layer) {
     ImGui::BeginChild("Entities", {av_space.x, av_space.y / 2.0f});
 
     LinkedEntitiesOpt new_link;
-    for (eng::Entity &ent : layer.scene.entities) {
-        if (!ent.parent_id.has_value())
-            render_entity_node(layer, ent, new_link);
-    }
+    for (eng::ecs::EntityID root_id : layer.scene.root_ids)
+        render_entity_node(layer, layer.scene.entity(root_id), new_link);
 
     if (new_link.has_value()) {
-        eng::Entity &parent =
-            layer.scene.entities[layer.scene.id_to_index[new_link.value()[0]]];
-        eng::Entity &child =
-            layer.scene.entities[layer.scene.id_to_index[new_link.value()[1]]];
+        eng::Entity &parent = layer.scene.entity(new_link.value()[0]);
+        eng::Entity &child = layer.scene.entity(new_link.value()[1]);
         layer.scene.link_relation(parent, child);
 
-        /* In case selected one moved. */
+        /* Refresh the copy, its relations might have changed. */
         if (layer.selected_entity.has_value()) {
-            int32_t selected_idx =
-                layer.scene.id_to_index[layer.selected_entity.value().handle];
-            layer.selected_entity = layer.scene.entities[selected_idx];
+            eng::ecs::EntityID selected_id =
+                layer.selected_entity.value().handle;
+            layer.selected_entity = layer.scene.entity(selected_id);
         }
     }
 
@@ -579,6 +663,58 @@ static void render_control_panel(EditorLayer &layer) {
         ImGui::EndPopup();
     }
 
+    if (ImGui::PrettyButton("Save scene"))
+        eng::save_scene(layer.scene, layer.asset_pack, SCENE_PATH);
+
+    ImGui::SameLine();
+    if (ImGui::PrettyButton("Load scene") &&
+        std::filesystem::exists(SCENE_PATH)) {
+        if (layer.streamer.has_value()) {
+            layer.streamer.value().destroy();
+            layer.streamer = std::nullopt;
+        }
+
+        layer.selected_entity = std::nullopt;
+        layer.hovered_entity = std::nullopt;
+
+        layer.scene.destroy();
+        layer.scene = eng::Scene::create("New scene");
+        layer.gpu_scene.clear();
+        (void)eng::load_scene(layer.scene, layer.asset_pack, SCENE_PATH);
+        layer.static_dirty = true;
+    }
+
+    if (ImGui::PrettyButton("Export cells"))
+        eng::save_scene_cells(layer.scene, layer.asset_pack, CELLS_DIR,
+                              CELL_SIZE);
+
+    /* Streamed scene starts empty, cells come in around the camera. */
+    ImGui::SameLine();
+    bool streaming = layer.streamer.has_value();
+    if (ImGui::Checkbox("Stream cells", &streaming)) {
+        layer.selected_entity = std::nullopt;
+        layer.hovered_entity = std::nullopt;
+        layer.static_dirty = true;
+
+        if (streaming) {
+            layer.scene.destroy();
+            layer.scene = eng::Scene::create("Streamed scene");
+            layer.gpu_scene.clear();
+
+            eng::CellStreamingSpec spec;
+            spec.dir = CELLS_DIR;
+            spec.cell_size = CELL_SIZE;
+            layer.streamer = eng::CellStreamer::create(spec);
+        } else {
+            layer.streamer.value().evict_all(layer.scene);
+            layer.streamer.value().destroy();
+            layer.streamer = std::nullopt;
+        }
+    }
+
+    ImGui::Checkbox("Pixel exact picking", &layer.pixel_exact_picking);
+    ImGui::Checkbox("GPU culling", &layer.gpu_culling);
+
     if (ImGui::CollapsingHeader("Environment"),
         ImGuiTreeNodeFlags_DefaultOpen) {
         eng::EnvMap &envmap = layer.asset_pack.env_maps.at(layer.envmap_id);
@@ -709,10 +845,32 @@ static void render_control_panel(EditorLayer &layer) {
         ImGui::Unindent(8.0f);
     }
 
+    if (ImGui::CollapsingHeader("Simulation")) {
+        FixedTimestep &fixed_timestep = context()->fixed_timestep;
+
+        float horizontal_size = ImGui::CalcTextSize("Max ticks/frame").x;
+        ImGui::Indent(8.0f);
+
+        int32_t tickrate = fixed_timestep.tickrate;
+        ImGui::PrettyDragInt("Tickrate", &tickrate, 1, 1000, horizontal_size);
+        if (tickrate != (int32_t)fixed_timestep.tickrate)
+            fixed_timestep.set_tickrate(tickrate);
+
+        ImGui::PrettyDragInt("Max ticks/frame",
+                             &fixed_timestep.max_ticks_per_frame, 1, 64,
+                             horizontal_size);
+
+        ImGui::Text("Ticks last frame: %d", context()->ticks_last_frame);
+        ImGui::Text("Dropped ticks: %lu",
+                    (unsigned long)fixed_timestep.dropped_ticks);
+        ImGui::Unindent(8.0f);
+    }
+
     if (ImGui::CollapsingHeader("Render stats")) {
         eng::renderer::RenderStats stats = eng::renderer::stats();
 
-        float horizontal_size = ImGui::CalcTextSize("Accepted point lights").x;
+        float horizontal_size =
+            ImGui::CalcTextSize("Submitted static clusters").x;
         ImGui::Indent(8.0f);
 
         if (ImGui::BeginTable("#Stats", 2)) {
@@ -741,7 +899,7 @@ static void render_control_panel(EditorLayer &layer) {
             {
                 /* Lights divided by 2 because they're submitted for shadow AND
                  * base pass. */
-                std::array<int32_t, 9> values = {
+                std::array<int32_t, 18> values = {
                     stats.dir_lights / 2,
                     stats.submitted_point_lights / 2,
                     stats.accepted_point_lights / 2,
@@ -750,16 +908,35 @@ static void render_control_panel(EditorLayer &layer) {
                     stats.shadow_meshes_rendered,
                     stats.submitted_instances,
                     stats.accepted_instances,
-                    stats.draw_calls};
-                std::array<const char *, 9> labels = {"Dir lights",
-                                                      "Submitted point lights",
-                                                      "Accepted point lights",
-                                                      "Submitted spot lights",
-                                                      "Accepted spot lights",
-                                                      "Meshes shadowed",
-                                                      "Submitted instances",
-                                                      "Accepted instances",
-                                                      "Draw calls"};
+                    stats.gpu_cull_candidates,
+                    stats.patched_candidates,
+                    stats.uploaded_instances,
+                    stats.instance_ring_capacity,
+                    stats.instanced_draws,
+                    stats.submitted_static_clusters,
+                    stats.accepted_static_clusters,
+                    stats.draw_commands,
+                    stats.draw_calls,
+                    stats.uploaded_materials};
+                std::array<const char *, 18> labels = {
+                    "Dir lights",
+                    "Submitted point lights",
+                    "Accepted point lights",
+                    "Submitted spot lights",
+                    "Accepted spot lights",
+                    "Meshes shadowed",
+                    "Submitted instances",
+                    "Accepted instances",
+                    "GPU cull candidates",
+                    "Patched candidates",
+                    "Uploaded instances",
+                    "Instance ring capacity",
+                    "Instanced draws",
+                    "Submitted static clusters",
+                    "Accepted static clusters",
+                    "Draw commands",
+                    "Draw calls",
+                    "Uploaded materials"};
 
                 for (int32_t i = 0; i < labels.size(); i++) {
                     ImGui::TableNextColumn();
@@ -773,6 +950,26 @@ static void render_control_panel(EditorLayer &layer) {
                 }
             }
 
+            {
+                eng::frame_memory::FrameMemoryStats mem =
+                    eng::frame_memory::stats();
+                std::array<size_t, 2> values = {mem.used, mem.peak};
+                std::array<const char *, 2> labels = {"Frame memory",
+                                                      "Frame memory peak"};
+
+                for (int32_t i = 0; i < labels.size(); i++) {
+                    ImGui::TableNextColumn();
+                    ImGui::AlignTextToFramePadding();
+                    ImGui::Text("%s", labels[i]);
+                    ImGui::TableNextColumn();
+                    ImGui::AlignTextToFramePadding();
+                    ImGui::Text("%.1fKB / %.1fKB", values[i] / 1024.0f,
+                                mem.capacity / 1024.0f);
+
+                    ImGui::TableNextRow();
+                }
+            }
+
             ImGui::EndTable();
         }
 
@@ -880,10 +1077,37 @@ bool material_texture_widget(const char *label, Texture &texture,
     return pressed;
 }
 
+/* Key of everything the static batches depend on, besides transforms. */
+static std::tuple<bool, eng::AssetID, eng::AssetID>
+static_state(eng::Entity &ent) {
+    if (!ent.has_component<eng::Static>())
+        return {false, 0, 0};
+
+    eng::AssetID mesh_id = ent.has_component<eng::MeshComp>()
+                               ? ent.get_component<eng::MeshComp>().id
+                               : 0;
+    eng::AssetID material_id = ent.has_component<eng::MaterialComp>()
+                                   ? ent.get_component<eng::MaterialComp>().id
+                                   : 0;
+
+    return {true, mesh_id, material_id};
+}
+
+static void render_entity_panel_components(EditorLayer &layer);
+
 static void render_entity_panel(EditorLayer &layer) {
     if (!layer.selected_entity.has_value())
         return;
 
+    eng::Entity &ent = layer.selected_entity.value();
+    auto state_before = static_state(ent);
+    render_entity_panel_components(layer);
+
+    if (static_state(ent) != state_before)
+        layer.static_dirty = true;
+}
+
+static void render_entity_panel_components(EditorLayer &layer) {
     eng::Entity ent = layer.selected_entity.value();
 
     eng::Name &name = ent.get_component<eng::Name>();
@@ -912,6 +1136,19 @@ static void render_entity_panel(EditorLayer &layer) {
 
         ImGui::PrettyDragFloat3("Scale", &transform.scale[0], 0.05f, 0.0f, 0.0f,
                                 "%.3f", horizontal_size);
+
+        /* Smooths out movement done in ticks when frames outpace them. */
+        bool interpolated = ent.has_component<eng::PreviousTransform>();
+        if (ImGui::Checkbox("Interpolate between ticks", &interpolated)) {
+            if (interpolated) {
+                /* Adding moves components around, TRANSFORM dangles. */
+                eng::PreviousTransform prev = {
+                    transform.position, transform.rotation, transform.scale};
+                ent.add_component<eng::PreviousTransform>() = prev;
+            } else {
+                ent.remove_component<eng::PreviousTransform>();
+            }
+        }
         ImGui::Unindent(8.0f);
     }
     ImGui::PopID();
@@ -924,7 +1161,7 @@ static void render_entity_panel(EditorLayer &layer) {
             ImGui::Indent(8.0f);
             ImGui::BeginPrettyCombo(
                 "Mesh", layer.asset_pack.meshes.at(mesh_comp.id).name.c_str(),
-                [&layer, &mesh_comp]() {
+                [&layer, &ent, &mesh_comp]() {
                     const std::map<eng::AssetID, eng::Mesh> &meshes =
                         layer.asset_pack.meshes;
 
@@ -932,10 +1169,45 @@ static void render_entity_panel(EditorLayer &layer) {
                         if (ImGui::Selectable(meshData.name.c_str(),
                                               id == mesh_comp.id)) {
                             mesh_comp.id = id;
+                            ent.mesh_changed();
                         }
                     }
                 });
 
+            const eng::Mesh &mesh = layer.asset_pack.meshes.at(mesh_comp.id);
+            bool pending = std::any_of(
+                layer.pending_lod_chains.begin(),
+                layer.pending_lod_chains.end(),
+                [&](const PendingLodChain &chain) {
+                    return chain.mesh_id == mesh_comp.id;
+                });
+
+            if (pending) {
+                ImGui::Text("Generating LODs...");
+            } else if (ImGui::PrettyButton(mesh.lods.empty()
+                                               ? "Generate LODs"
+                                               : "Regenerate LODs")) {
+                PendingLodChain &chain =
+                    layer.pending_lod_chains.emplace_back();
+                chain.mesh_id = mesh_comp.id;
+                chain.levels = eng::simplify_lod_chain_async(
+                    eng::read_vertex_data(mesh, layer.asset_pack.geometry),
+                    std::vector<float>(std::begin(eng::DEFAULT_LOD_RATIOS),
+                                       std::end(eng::DEFAULT_LOD_RATIOS)));
+
+                if (!ent.has_component<eng::LodComp>())
+                    ent.add_component<eng::LodComp>();
+            }
+
+            if (!mesh.lods.empty()) {
+                ImGui::SameLine();
+                ImGui::Text("%zu levels", mesh.lods.size());
+            }
+
+            if (!pending && layer.unsimplifiable_meshes.contains(mesh_comp.id))
+                ImGui::TextWrapped("Can't simplify, every vertex is on a seam "
+                                   "or a border");
+
             if (ImGui::PrettyButton("Remove component"))
                 ent.remove_component<eng::MeshComp>();
 
@@ -949,6 +1221,9 @@ static void render_entity_panel(EditorLayer &layer) {
         eng::MaterialComp &mat_comp = ent.get_component<eng::MaterialComp>();
         eng::Material &mat = layer.asset_pack.materials.at(mat_comp.id);
 
+        /* Erased once the panel is done with MAT. */
+        std::optional<eng::AssetID> deleted_material;
+
         if (ImGui::CollapsingHeader("Material",
                                     ImGuiTreeNodeFlags_DefaultOpen)) {
 
@@ -960,6 +1235,7 @@ static void render_entity_panel(EditorLayer &layer) {
                 new_mat.shader_id = eng::AssetPack::DEFAULT_BASE_MATERIAL;
 
                 mat_comp.id = layer.asset_pack.add_material(new_mat);
+                ent.mesh_changed();
             }
 
             if (mat_comp.id > eng::AssetPack::DEFAULT_FLAT_MATERIAL &&
@@ -967,7 +1243,7 @@ static void render_entity_panel(EditorLayer &layer) {
                 ImGui::SameLine();
 
                 if (ImGui::PrettyButton("Delete material")) {
-                    layer.asset_pack.materials.erase(mat_comp.id);
+                    deleted_material = mat_comp.id;
 
                     eng::ecs::RegistryView rview =
                         layer.scene.registry.view<eng::MaterialComp>();
@@ -976,23 +1252,30 @@ static void render_entity_panel(EditorLayer &layer) {
                         eng::MaterialComp &comp =
                             rview.get<eng::MaterialComp>(entry);
 
-                        if (comp.id == mat_comp.id)
+                        if (comp.id == deleted_material.value()) {
                             comp.id = eng::AssetPack::DEFAULT_BASE_MATERIAL;
+                            layer.scene.entity(entry.entity_id).mesh_changed();
+                        }
                     }
+
+                    /* Static entities anywhere might've used it. */
+                    layer.static_dirty = true;
                 }
             }
 
             float horizontal_size = ImGui::CalcTextSize("Emission factor").x;
 
             ImGui::BeginPrettyCombo(
-                "Material", mat.name.c_str(), [&layer, &mat_comp]() {
+                "Material", mat.name.c_str(), [&layer, &ent, &mat_comp]() {
                     const std::map<eng::AssetID, eng::Material> &materials =
                         layer.asset_pack.materials;
 
                     for (const auto &[id, material] : materials) {
                         if (ImGui::Selectable(material.name.c_str(),
-                                              id == mat_comp.id))
+                                              id == mat_comp.id)) {
                             mat_comp.id = id;
+                            ent.mesh_changed();
+                        }
                     }
                 }, horizontal_size);
 
@@ -1001,7 +1284,10 @@ static void render_entity_panel(EditorLayer &layer) {
                 char buf[128] = {0};
                 strncpy(buf, mat.name.c_str(), 128);
                 ImGui::PrettyInputText("Name", buf, horizontal_size);
-                mat.name = buf;
+                if (mat.name != buf) {
+                    mat.name = buf;
+                    layer.asset_pack.generation++;
+                }
             }
 
             Shader &shader = layer.asset_pack.shaders.at(mat.shader_id);
@@ -1138,6 +1424,11 @@ static void render_entity_panel(EditorLayer &layer) {
 
             ImGui::Unindent(8.0f);
         }
+
+        if (deleted_material.has_value()) {
+            layer.asset_pack.materials.erase(deleted_material.value());
+            layer.asset_pack.generation++;
+        }
     }
     ImGui::PopID();
 
@@ -1213,6 +1504,42 @@ static void render_entity_panel(EditorLayer &layer) {
     }
     ImGui::PopID();
 
+    ImGui::PushID(7);
+    if (ent.has_component<eng::Static>()) {
+        if (ImGui::CollapsingHeader("Static", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ImGui::Indent(8.0f);
+            if (ImGui::PrettyButton("Remove component"))
+                ent.remove_component<eng::Static>();
+
+            ImGui::Unindent(8.0f);
+        }
+    }
+    ImGui::PopID();
+
+    ImGui::PushID(8);
+    if (ent.has_component<eng::LodComp>()) {
+        eng::LodComp &lod = ent.get_component<eng::LodComp>();
+
+        if (ImGui::CollapsingHeader("LOD", ImGuiTreeNodeFlags_DefaultOpen)) {
+            float width = ImGui::CalcTextSize("Bias").x;
+
+            ImGui::Indent(8.0f);
+            float bias = lod.bias;
+            ImGui::PrettyDragFloat("Bias", &lod.bias, 0.01f, 0.0f, FLT_MAX,
+                                   "%.2f", width);
+            if (lod.bias != bias)
+                ent.mesh_changed();
+            ImGui::Text("Level: %d, shadow level: %d", lod.level,
+                        lod.shadow_level);
+
+            if (ImGui::PrettyButton("Remove component"))
+                ent.remove_component<eng::LodComp>();
+
+            ImGui::Unindent(8.0f);
+        }
+    }
+    ImGui::PopID();
+
     if (ImGui::PrettyButton("Add component")) {
         ImVec2 pos = ImGui::GetItemRectMin();
         ImVec2 size = ImGui::GetItemRectSize();
@@ -1232,7 +1559,9 @@ static void render_entity_panel(EditorLayer &layer) {
     COMP_ADDER(entity, eng::MaterialComp, "Material")                          \
     COMP_ADDER(entity, eng::PointLight, "Point light")                         \
     COMP_ADDER(entity, eng::DirLight, "Directional light")                     \
-    COMP_ADDER(entity, eng::SpotLight, "Spot light")
+    COMP_ADDER(entity, eng::SpotLight, "Spot light")                           \
+    COMP_ADDER(entity, eng::Static, "Static")                                  \
+    COMP_ADDER(entity, eng::LodComp, "LOD")
 
     if (ImGui::BeginPopup("new_comp_group")) {
         GEN_COMP_ADDERS(ent);
@@ -1274,9 +1603,7 @@ static void render_gizmo(EditorLayer &layer) {
 
     if (ImGuizmo::IsUsing()) {
         if (ent.parent_id.has_value()) {
-            int32_t parent_index =
-                layer.scene.id_to_index[ent.parent_id.value()];
-            eng::Entity &parent = layer.scene.entities[parent_index];
+            eng::Entity &parent = layer.scene.entity(ent.parent_id.value());
             eng::GlobalTransform &pgt =
                 parent.get_component<eng::GlobalTransform>();
 
@@ -3,13 +3,18 @@
 
 #include "eng/event.hpp"
 #include "eng/renderer/camera.hpp"
+#include "eng/renderer/gpu_culling.hpp"
+#include "eng/renderer/mesh_simplify.hpp"
 #include "eng/renderer/opengl.hpp"
+#include "eng/renderer/static_batch.hpp"
 #include "eng/scene/assets.hpp"
 #include "eng/scene/entity.hpp"
 #include "eng/scene/scene.hpp"
+#include "eng/scene/streaming.hpp"
 #include "eng/window.hpp"
 #include "imgui/ImGuizmo.h"
 #include <memory>
+#include <set>
 
 struct Layer {
     virtual ~Layer() = default;
@@ -25,6 +30,12 @@ struct Layer {
     virtual void on_render() = 0;
 };
 
+/* LOD chain being simplified on a thread of its own. */
+struct PendingLodChain {
+    eng::AssetID mesh_id;
+    std::future<std::vector<eng::SimplifiedMesh>> levels;
+};
+
 struct EditorLayer : public Layer {
     virtual ~EditorLayer() = default;
 
@@ -48,7 +59,36 @@ struct EditorLayer : public Layer {
 
     eng::SpectatorCamera camera;
 
+    /* Present while the scene is streamed in from exported cells. */
+    std::optional<eng::CellStreamer> streamer;
+
+    /* Scratch for spatial index queries, reused between frames. */
+    std::vector<int32_t> visible_proxies;
+
+    /* Baked Static entities. Rebaked at the start of a frame whenever any of
+     * them moved, got added, removed or changed its mesh or material. */
+    eng::StaticBatches static_batches;
+    bool static_dirty = true;
+
+    /* Uploaded to the asset pack once done, GL calls stay on this thread. */
+    std::vector<PendingLodChain> pending_lod_chains;
+
+    /* Meshes whose last simplification gave no levels - every vertex sits
+     * on a seam or a border, so nothing can collapse. */
+    std::set<eng::AssetID> unsimplifiable_meshes;
+
     std::optional<eng::Entity> selected_entity;
+
+    /* Entity under the cursor in the viewport, found with a ray cast. */
+    std::optional<eng::ecs::EntityID> hovered_entity;
+
+    /* Selects by reading back the picker ID attachment instead of ray cast.
+     * Readback is asynchronous, so selection lands a frame or two later. */
+    bool pixel_exact_picking = false;
+
+    /* Dynamic meshes get culled by a compute shader instead of the BVH. */
+    eng::GpuScene gpu_scene;
+    bool gpu_culling = false;
     eng::AssetID outline_material;
 
     ImGuizmo::OPERATION gizmo_op = ImGuizmo::TRANSLATE;
@@ -0,0 +1,86 @@
+#include "eng/scene/bvh.hpp"
+#include "eng/timer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+/* Culls randomly placed, rotated and scaled boxes against a camera frustum,
+ * one at a time with transform_aabb() and aabb_vs_frustum() - the way
+ * renderer::submit_mesh() used to - and batched with cull_aabbs().
+ * Usage: cull_bench [boxes_count] [repeats] */
+
+using namespace eng;
+
+int main(int argc, char **argv) {
+    int32_t boxes_count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int32_t repeats = argc > 2 ? std::atoi(argv[2]) : 50;
+
+    std::default_random_engine eng{42};
+    std::uniform_real_distribution<float> pos(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+    std::uniform_real_distribution<float> scale(0.2f, 4.0f);
+
+    std::vector<glm::mat4> transforms(boxes_count);
+    std::vector<MeshAABB> local_bbs(boxes_count);
+    for (int32_t i = 0; i < boxes_count; i++) {
+        glm::mat4 transform =
+            glm::translate(glm::mat4(1.0f), {pos(eng), pos(eng), pos(eng)});
+        transform = glm::rotate(transform, angle(eng),
+                                glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f)));
+        transforms[i] = glm::scale(transform, glm::vec3(scale(eng)));
+
+        local_bbs[i] = {glm::vec3(-0.5f, -1.0f, -0.5f),
+                        glm::vec3(0.5f, 1.0f, 0.5f)};
+    }
+
+    glm::mat4 proj =
+        glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 250.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 150.0f),
+                                 glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = extract_frustum_planes(proj * view);
+
+    std::vector<uint8_t> scalar_visible(boxes_count);
+    std::vector<uint8_t> batched_visible(boxes_count);
+
+    Timer timer;
+    timer.start();
+    for (int32_t r = 0; r < repeats; r++) {
+        for (int32_t i = 0; i < boxes_count; i++) {
+            MeshAABB world_bb = transform_aabb(local_bbs[i], transforms[i]);
+            scalar_visible[i] = aabb_vs_frustum(world_bb, frustum);
+        }
+    }
+    timer.stop();
+    float scalar_ms = timer.elapsed_time_ms() / repeats;
+
+    timer.start();
+    for (int32_t r = 0; r < repeats; r++)
+        cull_aabbs(transforms, local_bbs, frustum, batched_visible);
+    timer.stop();
+    float batched_ms = timer.elapsed_time_ms() / repeats;
+
+    int32_t visible_count = 0;
+    int32_t mismatches = 0;
+    for (int32_t i = 0; i < boxes_count; i++) {
+        visible_count += batched_visible[i];
+        mismatches += scalar_visible[i] != batched_visible[i];
+    }
+
+    printf("Boxes: %d, visible: %d, repeats: %d\r\n", boxes_count,
+           visible_count, repeats);
+    printf("  scalar:  %.3f ms (%.2f ns per box)\r\n", scalar_ms,
+           scalar_ms * 1e6f / boxes_count);
+    printf("  batched: %.3f ms (%.2f ns per box)\r\n", batched_ms,
+           batched_ms * 1e6f / boxes_count);
+    printf("  speedup: %.2fx\r\n", scalar_ms / batched_ms);
+
+    if (mismatches > 0) {
+        fprintf(stderr, "%d boxes culled differently\r\n", mismatches);
+        return 1;
+    }
+
+    return 0;
+}
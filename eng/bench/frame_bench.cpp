@@ -0,0 +1,499 @@
+#include "eng/frame_memory.hpp"
+#include "eng/headless_context.hpp"
+#include "eng/jobs.hpp"
+#include "eng/renderer/camera.hpp"
+#include "eng/renderer/gpu_culling.hpp"
+#include "eng/renderer/lod.hpp"
+#include "eng/renderer/mesh_simplify.hpp"
+#include "eng/renderer/primitives.hpp"
+#include "eng/renderer/scene_submission.hpp"
+#include "eng/renderer/static_batch.hpp"
+#include "eng/scene/stress_scene.hpp"
+#include "eng/timer.hpp"
+#include <atomic>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <vector>
+
+/* Generates a stress scene and runs it for a number of frames without a
+ * window, printing how long each phase of the frame took and renderer
+ * stats. Renderer loads shaders from resources/, so run it from the editor
+ * directory or point --dir at it. With no OpenGL device available (or
+ * with --cpu-only) only the CPU phases run. Some shaders need GLSL 4.60,
+ * with Mesa's llvmpipe set MESA_GL_VERSION_OVERRIDE=4.6 and
+ * MESA_GLSL_VERSION_OVERRIDE=460.
+ *
+ * Usage: frame_bench [--entities=N] [--depth=N] [--children=N]
+ *                    [--meshes=N] [--materials=N] [--point-lights=N]
+ *                    [--spot-lights=N] [--dir-lights=N] [--extent=F]
+ *                    [--static=F] [--lods] [--moving=F] [--frames=N]
+ *                    [--width=N] [--height=N] [--dir=PATH] [--cpu-only]
+ *                    [--threads=N] [--gpu-culling]
+ *
+ * With --lods meshes get simplified LOD chains (GPU runs only) and every
+ * mesh entity gets LodComp. --threads sets job system threads, 0 (default)
+ * picks available CPUs, 1 runs everything on the main thread. With
+ * --gpu-culling dynamic meshes are kept in a GpuScene and culled by the
+ * renderer's compute shader, culling phase only patches candidates of
+ * meshes that moved or changed. Heap allocations are counted for every frame after the first
+ * two - frame data should come from frame memory, so it's expected to stay
+ * at zero. */
+
+using namespace eng;
+
+static std::atomic<int64_t> s_heap_allocs = 0;
+
+void *operator new(size_t size) {
+    s_heap_allocs++;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t size) noexcept { std::free(ptr); }
+
+struct BenchSpec {
+    StressSceneSpec scene;
+
+    /* Fraction of dynamic roots moved every frame. */
+    float moving = 0.1f;
+
+    int32_t frames = 100;
+    glm::ivec2 viewport = glm::ivec2(1280, 720);
+    std::string dir = ".";
+    bool cpu_only = false;
+    bool gpu_culling = false;
+    int32_t threads = 0;
+};
+
+enum Phase {
+    PHASE_TRANSFORMS,
+    PHASE_SPATIAL_INDEX,
+    PHASE_CULLING,
+    PHASE_SUBMISSION,
+    PHASE_DRAW,
+    PHASES_COUNT
+};
+
+static constexpr const char *PHASE_NAMES[PHASES_COUNT] = {
+    "transforms", "spatial index", "culling", "submission", "draw"};
+
+struct PhaseTimings {
+    float total_ms = 0.0f;
+    float max_ms = 0.0f;
+    float min_ms = FLT_MAX;
+};
+
+static bool parse_arg(const char *arg, BenchSpec &spec) {
+    StressSceneSpec &scene = spec.scene;
+    const char *value = strchr(arg, '=');
+    value = value ? value + 1 : "";
+
+    if (strncmp(arg, "--entities=", 11) == 0)
+        scene.entities_count = std::atoi(value);
+    else if (strncmp(arg, "--depth=", 8) == 0)
+        scene.hierarchy_depth = std::atoi(value);
+    else if (strncmp(arg, "--children=", 11) == 0)
+        scene.children_per_node = std::atoi(value);
+    else if (strncmp(arg, "--meshes=", 9) == 0)
+        scene.meshes_count = std::atoi(value);
+    else if (strncmp(arg, "--materials=", 12) == 0)
+        scene.materials_count = std::atoi(value);
+    else if (strncmp(arg, "--point-lights=", 15) == 0)
+        scene.point_lights_count = std::atoi(value);
+    else if (strncmp(arg, "--spot-lights=", 14) == 0)
+        scene.spot_lights_count = std::atoi(value);
+    else if (strncmp(arg, "--dir-lights=", 13) == 0)
+        scene.dir_lights_count = std::atoi(value);
+    else if (strncmp(arg, "--extent=", 9) == 0)
+        scene.extent = std::atof(value);
+    else if (strncmp(arg, "--static=", 9) == 0)
+        scene.static_ratio = std::atof(value);
+    else if (strcmp(arg, "--lods") == 0)
+        scene.lods = true;
+    else if (strncmp(arg, "--moving=", 9) == 0)
+        spec.moving = std::atof(value);
+    else if (strncmp(arg, "--frames=", 9) == 0)
+        spec.frames = std::atoi(value);
+    else if (strncmp(arg, "--width=", 8) == 0)
+        spec.viewport.x = std::atoi(value);
+    else if (strncmp(arg, "--height=", 9) == 0)
+        spec.viewport.y = std::atoi(value);
+    else if (strncmp(arg, "--dir=", 6) == 0)
+        spec.dir = value;
+    else if (strcmp(arg, "--cpu-only") == 0)
+        spec.cpu_only = true;
+    else if (strcmp(arg, "--gpu-culling") == 0)
+        spec.gpu_culling = true;
+    else if (strncmp(arg, "--threads=", 10) == 0)
+        spec.threads = std::atoi(value);
+    else
+        return false;
+
+    return true;
+}
+
+/* Just the bounds of built-in meshes, enough for culling. */
+static AssetPack cpu_asset_pack() {
+    AssetPack pack;
+    std::vector<VertexData> meshes = {
+        quad_vertex_data(), cube_vertex_data(), uv_sphere_vertex_data()};
+
+    for (VertexData &data : meshes) {
+        Mesh mesh;
+        mesh.local_bb.min = glm::vec3(FLT_MAX);
+        mesh.local_bb.max = glm::vec3(-FLT_MAX);
+        for (const Vertex &v : data.vertices) {
+            mesh.local_bb.min = glm::min(mesh.local_bb.min, v.position);
+            mesh.local_bb.max = glm::max(mesh.local_bb.max, v.position);
+        }
+
+        (void)pack.add_mesh(mesh);
+    }
+
+    return pack;
+}
+
+static Framebuffer create_target(const glm::ivec2 &size) {
+    Framebuffer fbo = Framebuffer::create();
+    fbo.add_depth_attachment({.type = DepthAttachmentType::DEPTH_STENCIL,
+                              .tex_type = TextureType::TEX_2D,
+                              .size = size});
+
+    ColorAttachmentSpec spec;
+    spec.type = TextureType::TEX_2D;
+    spec.format = TextureFormat::RGBA16F;
+    spec.wrap = GL_CLAMP_TO_EDGE;
+    spec.min_filter = spec.mag_filter = GL_NEAREST;
+    spec.size = size;
+    spec.gen_minmaps = false;
+    fbo.add_color_attachment(spec);
+
+    spec.format = TextureFormat::RGBA8;
+    fbo.add_color_attachment(spec);
+
+    fbo.draw_to_depth_attachment(0);
+    fbo.draw_to_color_attachment(0, 0);
+    assert(fbo.is_complete() && "Incomplete benchmark framebuffer");
+
+    return fbo;
+}
+
+/* Flat black environment, image based lighting doesn't matter here. */
+static EnvMap create_blank_envmap() {
+    TextureSpec spec;
+    spec.format = TextureFormat::RGBA16F;
+    spec.size = {64, 32};
+    spec.min_filter = spec.mag_filter = GL_LINEAR;
+    spec.wrap = GL_REPEAT;
+    spec.gen_mipmaps = false;
+
+    return renderer::create_envmap(Texture::create_storage(spec));
+}
+
+static void move_roots(Scene &scene, const std::vector<ecs::EntityID> &roots,
+                       size_t count, int32_t frame) {
+    for (size_t i = 0; i < count; i++) {
+        Entity &ent = scene.entity(roots[(frame * count + i) % roots.size()]);
+        Transform &transform = ent.get_component<Transform>();
+        transform.position.y = glm::sin(frame * 0.1f + i) * 2.0f;
+        transform.rotation.y += 0.05f;
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchSpec spec;
+    for (int32_t i = 1; i < argc; i++) {
+        if (!parse_arg(argv[i], spec)) {
+            fprintf(stderr, "Unknown argument '%s'\r\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::error_code err;
+    std::filesystem::current_path(spec.dir, err);
+    if (err) {
+        fprintf(stderr, "Can't enter '%s'\r\n", spec.dir.c_str());
+        return 1;
+    }
+
+    jobs::init({.threads = spec.threads});
+    frame_memory::init();
+    printf("Job threads: %d\r\n", jobs::threads_count());
+
+    std::optional<HeadlessContext> context;
+    if (!spec.cpu_only) {
+        context = HeadlessContext::create();
+        if (!context.has_value() ||
+            !renderer::init(HeadlessContext::get_proc_address)) {
+            fprintf(stderr, "No usable OpenGL, running CPU phases only\r\n");
+            spec.cpu_only = true;
+        }
+    }
+
+    bool gpu = !spec.cpu_only;
+    bool gpu_culling = gpu && spec.gpu_culling;
+    AssetPack pack = gpu ? AssetPack::create("bench") : cpu_asset_pack();
+
+    Framebuffer target_fbo;
+    AssetID envmap_id = 0;
+    if (gpu) {
+        target_fbo = create_target(spec.viewport);
+        EnvMap envmap = create_blank_envmap();
+        envmap_id = pack.add_env_map(envmap);
+        renderer::use_envmap(pack.env_maps.at(envmap_id));
+    }
+
+    Timer timer;
+    if (gpu && spec.scene.lods) {
+        std::vector<AssetID> mesh_ids;
+        for (auto &[id, mesh] : pack.meshes) {
+            if (mesh_ids.size() < (size_t)spec.scene.meshes_count)
+                mesh_ids.push_back(id);
+        }
+
+        timer.start();
+        std::vector<float> ratios(std::begin(DEFAULT_LOD_RATIOS),
+                                  std::end(DEFAULT_LOD_RATIOS));
+        std::vector<std::future<std::vector<SimplifiedMesh>>> chains;
+        for (AssetID id : mesh_ids)
+            chains.push_back(simplify_lod_chain_async(
+                read_vertex_data(pack.meshes.at(id), pack.geometry), ratios));
+
+        for (int32_t i = 0; i < (int32_t)mesh_ids.size(); i++)
+            pack.set_lod_chain(mesh_ids[i], chains[i].get());
+        timer.stop();
+
+        printf("LOD chains for %zu meshes built in %.2f ms\r\n",
+               mesh_ids.size(), timer.elapsed_time_ms());
+    }
+
+    timer.start();
+    Scene scene = Scene::create("stress");
+    std::vector<ecs::EntityID> roots =
+        generate_stress_scene(scene, pack, spec.scene);
+    timer.stop();
+
+    printf("Entities: %zu (%zu trees), generated in %.2f ms\r\n",
+           scene.entities.size(), roots.size(), timer.elapsed_time_ms());
+
+    /* Static trees stay where they are. */
+    std::erase_if(roots, [&](ecs::EntityID root_id) {
+        return scene.entity(root_id).has_component<Static>();
+    });
+
+    StaticBatches static_batches;
+    GpuScene gpu_scene;
+    if (gpu_culling)
+        gpu_scene = GpuScene::create();
+
+    if (gpu) {
+        scene.update_global_transforms();
+
+        timer.start();
+        static_batches = StaticBatches::bake(scene, pack);
+        timer.stop();
+
+        printf("Static entities: %d in %zu batches, baked in %.2f ms\r\n",
+               static_batches.baked_entities, static_batches.batches.size(),
+               timer.elapsed_time_ms());
+    }
+
+    /* Looking at the center from the edge of the scene. */
+    SpectatorCamera camera;
+    camera.position = glm::vec3(0.0f, 40.0f, spec.scene.extent * 0.5f);
+    camera.pitch = 25.0f;
+    camera.viewport = spec.viewport;
+    camera.far_clip = spec.scene.extent * 2.0f;
+    renderer::CameraData camera_data = camera.render_data();
+    Frustum frustum = extract_frustum_planes(camera_data.view_projection);
+
+    size_t moving_count = roots.size() * glm::clamp(spec.moving, 0.0f, 1.0f);
+    std::vector<int32_t> shadow_proxies;
+    std::vector<int32_t> visible_proxies;
+    std::array<PhaseTimings, PHASES_COUNT> phases{};
+    renderer::RenderStats stats_total{};
+
+    /* First frames grow frame memory and containers kept across frames. */
+    static constexpr int32_t WARMUP_FRAMES = 2;
+    int64_t heap_allocs = 0;
+
+    for (int32_t frame = 0; frame < spec.frames; frame++) {
+        std::array<float, PHASES_COUNT> frame_ms{};
+        int64_t allocs_before = s_heap_allocs.load();
+        frame_memory::next_frame();
+
+        timer.start();
+        move_roots(scene, roots, moving_count, frame);
+        scene.update_global_transforms();
+        timer.stop();
+        frame_ms[PHASE_TRANSFORMS] = timer.elapsed_time_ms();
+
+        /* GPU scene reads events update_spatial_index() clears. */
+        if (gpu_culling) {
+            timer.start();
+            gpu_scene.update(scene, pack);
+            timer.stop();
+            frame_ms[PHASE_CULLING] = timer.elapsed_time_ms();
+        }
+
+        timer.start();
+        scene.update_spatial_index(pack);
+        timer.stop();
+        frame_ms[PHASE_SPATIAL_INDEX] = timer.elapsed_time_ms();
+
+        if (!gpu_culling) {
+            timer.start();
+            renderer::cull_shadow_casters(scene, frustum, shadow_proxies);
+            renderer::cull_visible_meshes(scene, frustum, visible_proxies);
+            timer.stop();
+            frame_ms[PHASE_CULLING] = timer.elapsed_time_ms();
+        }
+
+        if (gpu) {
+            renderer::reset_stats();
+
+            Timer draw_timer;
+            timer.start();
+            renderer::shadow_pass_begin(camera_data, pack);
+            renderer::submit_scene_lights(scene);
+            if (gpu_culling) {
+                renderer::submit_gpu_scene(gpu_scene);
+            } else {
+                renderer::select_shadow_lods(scene, pack, camera_data,
+                                             shadow_proxies);
+                renderer::submit_shadow_casters(scene, shadow_proxies);
+            }
+            renderer::submit_static_shadow_batches(static_batches);
+            timer.stop();
+
+            draw_timer.start();
+            renderer::shadow_pass_end();
+            draw_timer.stop();
+
+            timer.resume();
+            renderer::scene_begin(camera_data, pack, target_fbo);
+            renderer::submit_scene_lights(scene);
+            if (gpu_culling) {
+                renderer::submit_gpu_scene(gpu_scene);
+            } else {
+                renderer::select_lods(scene, pack, camera_data,
+                                      visible_proxies);
+                renderer::submit_visible_meshes(scene, visible_proxies);
+            }
+            renderer::submit_static_batches(static_batches);
+            timer.stop();
+
+            draw_timer.resume();
+            renderer::scene_end();
+            draw_timer.stop();
+
+            frame_ms[PHASE_SUBMISSION] = timer.elapsed_time_ms();
+            frame_ms[PHASE_DRAW] = draw_timer.elapsed_time_ms();
+
+            renderer::RenderStats stats = renderer::stats();
+            stats_total.shadow_pass_ms += stats.shadow_pass_ms;
+            stats_total.base_pass_ms += stats.base_pass_ms;
+        }
+
+        for (int32_t i = 0; i < PHASES_COUNT; i++) {
+            phases[i].total_ms += frame_ms[i];
+            phases[i].max_ms = glm::max(phases[i].max_ms, frame_ms[i]);
+            phases[i].min_ms = glm::min(phases[i].min_ms, frame_ms[i]);
+        }
+
+        if (frame >= WARMUP_FRAMES)
+            heap_allocs += s_heap_allocs.load() - allocs_before;
+    }
+
+    printf("Frames: %d, moving trees per frame: %zu\r\n", spec.frames,
+           moving_count);
+    printf("%-14s %10s %10s %10s\r\n", "phase", "avg ms", "min ms", "max ms");
+    for (int32_t i = 0; i < PHASES_COUNT; i++) {
+        if (!gpu && (i == PHASE_SUBMISSION || i == PHASE_DRAW))
+            continue;
+
+        printf("%-14s %10.3f %10.3f %10.3f\r\n", PHASE_NAMES[i],
+               phases[i].total_ms / spec.frames, phases[i].min_ms,
+               phases[i].max_ms);
+    }
+
+    /* GPU culled meshes never come back to the CPU. */
+    if (!gpu_culling) {
+        printf("Visible meshes: %zu, shadow casters: %zu\r\n",
+               visible_proxies.size(), shadow_proxies.size());
+    }
+
+    frame_memory::FrameMemoryStats mem = frame_memory::stats();
+    printf("Frame memory peak: %.1f KB of %.1f KB\r\n", mem.peak / 1024.0f,
+           mem.capacity / 1024.0f);
+    if (spec.frames > WARMUP_FRAMES) {
+        printf("Heap allocations per frame: %.2f\r\n",
+               (double)heap_allocs / (spec.frames - WARMUP_FRAMES));
+    }
+
+    if (gpu && !gpu_culling && spec.scene.lods) {
+        std::array<int32_t, 8> levels{};
+        for (int32_t proxy : visible_proxies) {
+            Entity &ent = scene.entity(scene.spatial_index.nodes[proxy].ent_id);
+            int32_t level = ent.get_component<LodComp>().level;
+            levels[glm::min(level, (int32_t)levels.size() - 1)]++;
+        }
+
+        printf("Visible meshes per LOD level:");
+        for (int32_t count : levels)
+            printf(" %d", count);
+        printf("\r\n");
+    }
+
+    if (gpu) {
+        /* Counters are from the last frame, pass times are averages. */
+        renderer::RenderStats stats = renderer::stats();
+        printf("Render stats:\r\n");
+        printf("  shadow pass: %.3f ms, base pass: %.3f ms\r\n",
+               stats_total.shadow_pass_ms / spec.frames,
+               stats_total.base_pass_ms / spec.frames);
+        printf("  dir lights: %d\r\n", stats.dir_lights);
+        printf("  point lights: %d / %d\r\n", stats.accepted_point_lights,
+               stats.submitted_point_lights);
+        printf("  spot lights: %d / %d\r\n", stats.accepted_spot_lights,
+               stats.submitted_spot_lights);
+        printf("  shadow meshes: %d\r\n", stats.shadow_meshes_rendered);
+        printf("  instances: %d / %d, uploaded: %d\r\n",
+               stats.accepted_instances, stats.submitted_instances,
+               stats.uploaded_instances);
+        printf("  gpu cull candidates: %d, patched: %d\r\n",
+               stats.gpu_cull_candidates, stats.patched_candidates);
+        printf("  instanced draws: %d, instance ring capacity: %d\r\n",
+               stats.instanced_draws, stats.instance_ring_capacity);
+        printf("  static clusters: %d / %d\r\n",
+               stats.accepted_static_clusters,
+               stats.submitted_static_clusters);
+        printf("  draw commands: %d, draw calls: %d\r\n",
+               stats.draw_commands, stats.draw_calls);
+        printf("  uploaded materials: %d\r\n", stats.uploaded_materials);
+    }
+
+    if (gpu_culling)
+        gpu_scene.destroy();
+
+    scene.destroy();
+    if (gpu) {
+        static_batches.destroy(pack.geometry);
+        target_fbo.destroy();
+        pack.destroy();
+        renderer::shutdown();
+        context.value().destroy();
+    }
+
+    jobs::shutdown();
+    frame_memory::shutdown();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "eng/scene/prefab.hpp"
+#include "eng/timer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* Scatters copies of a small tree prefab and compares bulk instantiation to
+ * duplicating the subtree one copy at a time.
+ * Usage: prefab_bench [copies_count] */
+
+using namespace eng;
+
+/* Root with a trunk and a crown, crown has three leaves. */
+static ecs::EntityID build_tree(Scene &scene) {
+    Entity tree = scene.spawn_entity("tree");
+    Entity trunk = scene.spawn_entity("trunk");
+    Entity crown = scene.spawn_entity("crown");
+
+    trunk.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    trunk.add_component<MaterialComp>().id = AssetPack::DEFAULT_BASE_MATERIAL;
+    crown.add_component<MeshComp>().id = AssetPack::SPHERE_ID;
+    crown.add_component<MaterialComp>().id = AssetPack::DEFAULT_BASE_MATERIAL;
+    scene.link_relation(tree, trunk);
+    scene.link_relation(tree, crown);
+
+    for (int32_t i = 0; i < 3; i++) {
+        Entity leaf = scene.spawn_entity("leaf");
+        leaf.add_component<MeshComp>().id = AssetPack::QUAD_ID;
+        scene.link_relation(crown, leaf);
+    }
+
+    return tree.handle;
+}
+
+int main(int argc, char **argv) {
+    uint32_t copies_count = argc > 1 ? std::atoi(argv[1]) : 10000;
+
+    std::vector<Transform> transforms(copies_count);
+    for (uint32_t i = 0; i < copies_count; i++)
+        transforms[i].position = {(float)(i % 100), 0.0f, (float)(i / 100)};
+
+    Timer timer;
+    Scene scene = Scene::create("instantiate");
+    Prefab prefab = Prefab::create(scene, build_tree(scene));
+
+    timer.start();
+    std::vector<ecs::EntityID> roots =
+        scene.instantiate(prefab, copies_count, transforms.data());
+    timer.stop();
+    float instantiate_ms = timer.elapsed_time_ms();
+
+    Scene dup_scene = Scene::create("duplicate");
+    Entity original = dup_scene.entity(build_tree(dup_scene));
+
+    timer.start();
+    for (uint32_t i = 0; i < copies_count; i++) {
+        Entity &copy = dup_scene.duplicate(original);
+        copy.get_component<Transform>() = transforms[i];
+    }
+    timer.stop();
+    float duplicate_ms = timer.elapsed_time_ms();
+
+    printf("Copies: %u (%zu entities each)\r\n", copies_count,
+           prefab.nodes.size());
+    printf("Instantiate: %.2f ms, duplicate: %.2f ms\r\n", instantiate_ms,
+           duplicate_ms);
+
+    prefab.destroy();
+    scene.destroy();
+    dup_scene.destroy();
+
+    return 0;
+}
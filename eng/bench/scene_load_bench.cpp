@@ -0,0 +1,105 @@
+#include "eng/scene/scene_file.hpp"
+#include "eng/timer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+/* Saves a generated scene and measures how long loading it takes compared
+ * to just reading the file, which is the lower bound.
+ * Usage: scene_load_bench [entities_count] [runs] */
+
+using namespace eng;
+
+static void build_scene(Scene &scene, uint32_t entities_count) {
+    Entity root;
+    for (uint32_t i = 0; i < entities_count; i++) {
+        Entity ent = scene.spawn_entity("entity_" + std::to_string(i));
+        Transform &transform = ent.get_component<Transform>();
+        transform.position = {(float)(i % 100), 0.0f, (float)(i / 100)};
+
+        if (i % 50 == 0)
+            ent.add_component<PointLight>().radius = 4.0f;
+
+        ent.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+        ent.add_component<MaterialComp>().id =
+            AssetPack::DEFAULT_BASE_MATERIAL;
+
+        /* Groups of ten - a root with nine children. */
+        if (i % 10 == 0)
+            root = ent;
+        else
+            scene.link_relation(root, ent);
+    }
+
+    scene.update_global_transforms();
+}
+
+static float read_file_ms(const std::string &path) {
+    Timer timer;
+    timer.start();
+
+    FILE *file = fopen(path.c_str(), "rb");
+    std::vector<uint8_t> buffer(std::filesystem::file_size(path));
+    size_t read = fread(buffer.data(), 1, buffer.size(), file);
+    fclose(file);
+
+    timer.stop();
+    if (read != buffer.size())
+        fprintf(stderr, "Short read of '%s'\r\n", path.c_str());
+
+    return timer.elapsed_time_ms();
+}
+
+int main(int argc, char **argv) {
+    uint32_t entities_count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    uint32_t runs = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    AssetPack pack;
+    pack.meshes[AssetPack::CUBE_ID].name = "Cube";
+    pack.materials[AssetPack::DEFAULT_BASE_MATERIAL].name = "Base material";
+
+    Scene scene = Scene::create("bench");
+    build_scene(scene, entities_count);
+
+    std::string path =
+        (std::filesystem::temp_directory_path() / "eng_bench.scene").string();
+
+    Timer timer;
+    timer.start();
+    if (!save_scene(scene, pack, path))
+        return 1;
+
+    timer.stop();
+    printf("Entities: %u, file size: %.2f MB, save: %.2f ms\r\n",
+           entities_count,
+           std::filesystem::file_size(path) / (1024.0f * 1024.0f),
+           timer.elapsed_time_ms());
+
+    float read_total_ms = 0.0f;
+    float load_total_ms = 0.0f;
+    for (uint32_t i = 0; i < runs; i++) {
+        read_total_ms += read_file_ms(path);
+
+        Scene loaded = Scene::create("loaded");
+        timer.start();
+        bool success = load_scene(loaded, pack, path);
+        timer.stop();
+
+        if (!success || loaded.entities.size() != entities_count) {
+            fprintf(stderr, "Loading failed\r\n");
+            return 1;
+        }
+
+        load_total_ms += timer.elapsed_time_ms();
+        loaded.destroy();
+    }
+
+    printf("Read: %.2f ms, load: %.2f ms (average of %u runs)\r\n",
+           read_total_ms / runs, load_total_ms / runs, runs);
+
+    std::filesystem::remove(path);
+    scene.destroy();
+
+    return 0;
+}
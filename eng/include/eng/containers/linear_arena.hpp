@@ -0,0 +1,53 @@
+#ifndef LINEAR_ARENA_HPP
+#define LINEAR_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace eng::cont {
+
+/*  Bump allocator - allocating is moving an offset forward, memory is only
+    given back all at once by reset(). Not thread safe. */
+struct LinearArena {
+    [[nodiscard]] static LinearArena create(size_t capacity);
+    void destroy();
+
+    /*  Never fails - when the block is full, allocation gets its own heap
+        block, freed by the next reset(). */
+    [[nodiscard]] void *allocate(size_t size, size_t alignment);
+
+    /*  Invalidates everything allocated so far. If anything didn't fit since
+        the last reset, the block grows to fit it all, so a steady workload
+        settles on a single block and stops touching the heap. */
+    void reset();
+
+    [[nodiscard]] size_t used() const;
+
+    uint8_t *memory = nullptr;
+    size_t capacity = 0;
+    size_t offset = 0;
+
+    /*  Allocations that didn't fit into MEMORY. */
+    std::vector<void *> overflow_blocks;
+    size_t overflow_bytes = 0;
+
+    /*  Most bytes used between two resets, so far. */
+    size_t peak = 0;
+};
+
+/*  std::pmr adapter, so standard containers can live in an arena.
+    Deallocation does nothing, memory comes back on arena's reset(). */
+struct ArenaResource : public std::pmr::memory_resource {
+    LinearArena *arena = nullptr;
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other)
+        const noexcept override;
+};
+
+} // namespace eng::cont
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef RANGE_ALLOCATOR_HPP
+#define RANGE_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace eng::cont {
+
+/*  Hands out ranges of [0, capacity), counted in whatever units the owner
+    uses - vertices, indices, array elements. First fit over free ranges
+    kept sorted by offset, freed ranges merge with their free neighbours.
+    Nothing is stored in the managed memory itself, so it works just as
+    well for GPU buffers. */
+struct RangeAllocator {
+    [[nodiscard]] static RangeAllocator create(uint32_t capacity);
+
+    /*  Offset of COUNT elements, none if no free range is big enough. Empty
+        ranges start at 0 and take no space. */
+    [[nodiscard]] std::optional<uint32_t> allocate(uint32_t count);
+    void free(uint32_t offset, uint32_t count);
+
+    /*  Adds [capacity, NEW_CAPACITY) to the free ranges. */
+    void grow(uint32_t new_capacity);
+
+    struct Range {
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    std::vector<Range> free_ranges;
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+};
+
+} // namespace eng::cont
+
+#endif
@@ -2,12 +2,13 @@
 #define REGISTRY_HPP
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <map>
+#include <memory_resource>
 #include <typeinfo>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "vector_wrapper.hpp"
@@ -104,11 +105,12 @@ struct ComponentView {
     }
 
     ComponentHash component_hash = 0x00;
-    std::vector<cont::GenericVectorWrapper *> combined_view;
+    std::pmr::vector<cont::GenericVectorWrapper *> combined_view;
 };
 
 /*  View into registry components, based on a query provided from
-    Registry::view(). */
+    Registry::view(). Containers come from the memory resource given to
+    view(), so views made from frame memory can't outlive the frame. */
 struct RegistryView {
     struct Entry {
         EntityID entity_id;
@@ -118,15 +120,19 @@ struct RegistryView {
     template <typename T>
     [[nodiscard]] T &get(Entry entry) {
         const ComponentHash hash = typeid(T).hash_code();
-        assert(queried_components.contains(hash));
+        for (ComponentView &view : comp_view) {
+            if (view.component_hash == hash)
+                return view.at<T>(entry.idx);
+        }
 
-        ComponentView &view = comp_view.at(hash);
-        return view.at<T>(entry.idx);
+        assert(false && "Component not queried by this view");
+        __builtin_unreachable();
     }
 
-    std::vector<Entry> entity_entries;
-    std::unordered_map<ComponentHash, ComponentView> comp_view;
-    std::unordered_set<ComponentHash> queried_components;
+    std::pmr::vector<Entry> entity_entries;
+
+    /*  One per queried component, there are only a few. */
+    std::pmr::vector<ComponentView> comp_view;
 };
 
 struct Registry;
@@ -168,6 +174,50 @@ struct Registry {
 
     void destroy_entity(EntityID entity_id);
 
+    /*  Registers COUNT entities straight in ATYPE, with default constructed
+        components, skipping moves through intermediate archetypes. IDs and
+        rows are contiguous, first ID is returned. Meant for bulk loading -
+        fill the data through ATYPE's columns afterwards. */
+    [[nodiscard]] EntityID create_entities(Archetype &atype, size_t count);
+
+    /*  Moves every entity of STAGING into this registry. Archetypes are
+        matched by type (and created if missing) and each column is
+        appended as a whole, so cost depends on archetypes count rather
+        than entities count. Returns translation table indexed by staging's
+        entity IDs, with 0 for IDs not in use. STAGING ends up destroyed. */
+    [[nodiscard]] std::vector<EntityID> merge(Registry &&staging);
+
+    /*  Copies entity of ENTITY_ID id from another registry, returns its ID
+        in this one. */
+    [[nodiscard]] EntityID copy_from(Registry &source, EntityID entity_id);
+
+    /*  Appends COUNT copies of every entity in SOURCE, with one column
+        append per archetype. Returns translation table - ID of I-th copy
+        of source's entity E sits at [I * source.entity_id_counter + E],
+        unused IDs map to 0. SOURCE stays untouched. */
+    [[nodiscard]] std::vector<EntityID> instantiate(Registry &source,
+                                                    size_t count);
+
+    /*  Archetype with the same type as SOURCE, which might come from another
+        registry. Created if it doesn't exist yet. */
+    [[nodiscard]] Archetype &matching_archetype(const Archetype &source);
+
+    /*  Archetype with an empty type, where every entity starts. */
+    [[nodiscard]] Archetype &empty_archetype() {
+        return archetype_index.at(Type{});
+    }
+
+    /*  Archetype with SOURCE's type plus component T. Created if it doesn't
+        exist yet. */
+    template <typename T>
+    [[nodiscard]] Archetype &extended(Archetype &source) {
+        Archetype *next_atype = source.edges[typeid(T).hash_code()].add;
+        if (!next_atype)
+            next_atype = extended_archetype<T>(*this, source);
+
+        return *next_atype;
+    }
+
     /*  Add component of type T to an entity of ENTITY_ID id. Entity must exist
         and it mustn't have component T already. */
     template <typename T, typename... Args>
@@ -265,10 +315,20 @@ struct Registry {
         the template arguments. */
     template <typename... Components>
     [[nodiscard]] RegistryView view(exclude_fn excl_fn = exclude<>) {
-        std::vector<ComponentHash> comp_hashes;
-        ((comp_hashes.push_back(typeid(Components).hash_code())), ...);
+        return view<Components...>(std::pmr::get_default_resource(), excl_fn);
+    }
 
-        RegistryView rview;
+    /*  Same, with view's containers allocated from MEMORY. */
+    template <typename... Components>
+    [[nodiscard]] RegistryView view(std::pmr::memory_resource *memory,
+                                    exclude_fn excl_fn = exclude<>) {
+        const std::array<ComponentHash, sizeof...(Components)> comp_hashes = {
+            typeid(Components).hash_code()...};
+
+        /*  Constructed in place - pmr containers keep their resource on move
+            construction, but not on assignment. */
+        RegistryView rview{std::pmr::vector<RegistryView::Entry>(memory),
+                           std::pmr::vector<ComponentView>(memory)};
         if (comp_hashes.empty())
             return rview;
 
@@ -276,9 +336,6 @@ struct Registry {
         if (!component_index.contains(first_comp_hash))
             return rview;
 
-        for (ComponentHash comp_hash : comp_hashes)
-            rview.queried_components.insert(comp_hash);
-
         /*  Get first component's archetype map to access IDs of archetypes
             who have this component. */
         ArchetypeMap &amap = component_index.at(first_comp_hash);
@@ -314,7 +371,18 @@ struct Registry {
             return true;
         };
 
-        std::vector<ArchetypeID> relevant_aids;
+        auto component_view = [&](ComponentHash type) -> ComponentView & {
+            for (ComponentView &cview : rview.comp_view) {
+                if (cview.component_hash == type)
+                    return cview;
+            }
+
+            return rview.comp_view.emplace_back(ComponentView{
+                type, std::pmr::vector<cont::GenericVectorWrapper *>(memory)});
+        };
+
+        rview.comp_view.reserve(comp_hashes.size());
+
         size_t ent_entry_idx = 0;
         /*  Iterate over every archetype ID and check if it also has all the
             other components this call requires. */
@@ -331,9 +399,8 @@ struct Registry {
                               type) != excluded_comp_hashes.end())
                     continue;
 
-                ComponentView &cview = rview.comp_view[type];
-                cview.combined_view.push_back(atype->components[column]);
-                cview.component_hash = type;
+                component_view(type).combined_view.push_back(
+                    atype->components[column]);
             }
 
             EntitySet &eset = arch_entity_index[aid];
@@ -35,6 +35,16 @@ struct GenericVectorWrapper {
 
     virtual void pop_back() = 0;
 
+    /*  Default constructs new elements when growing. */
+    virtual void resize(size_t size) = 0;
+
+    /*  Moves all of OTHER's elements to the back of this container, leaving
+        OTHER empty. */
+    virtual void append(GenericVectorWrapper *other) = 0;
+
+    /*  Appends COUNT copies of OTHER's whole contents, one after another. */
+    virtual void append_copies(GenericVectorWrapper *other, size_t count) = 0;
+
     /*  Transfers element from this container to the other's back (hence no
         dst_idx). */
     [[nodiscard]] virtual size_t transfer_element(GenericVectorWrapper *other,
@@ -89,6 +99,30 @@ struct VectorWrapper : public GenericVectorWrapper {
 
     virtual void pop_back() { storage.pop_back(); }
 
+    virtual void resize(size_t size) { storage.resize(size); }
+
+    virtual void append(GenericVectorWrapper *other) {
+        assert(other->type_hash == type_hash &&
+               "Trying to append container of different type");
+
+        std::vector<T> &other_storage = other->as_vec<T>().storage;
+        storage.insert(storage.end(),
+                       std::make_move_iterator(other_storage.begin()),
+                       std::make_move_iterator(other_storage.end()));
+        other_storage.clear();
+    }
+
+    virtual void append_copies(GenericVectorWrapper *other, size_t count) {
+        assert(other->type_hash == type_hash &&
+               "Trying to append container of different type");
+
+        std::vector<T> &other_storage = other->as_vec<T>().storage;
+        storage.reserve(storage.size() + other_storage.size() * count);
+        for (size_t i = 0; i < count; i++)
+            storage.insert(storage.end(), other_storage.begin(),
+                           other_storage.end());
+    }
+
     virtual void erase(size_t idx) { storage.erase(storage.begin() + idx); }
 
     /*  Transfers element from this container to the other's back (hence no
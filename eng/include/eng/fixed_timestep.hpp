@@ -0,0 +1,38 @@
+#ifndef FIXED_TIMESTEP_HPP
+#define FIXED_TIMESTEP_HPP
+
+#include <cstdint>
+
+/* Accumulator for simulation running at a fixed rate, independent of the
+ * frame rate. Every frame adds its duration and gets back how many ticks
+ * are due, leftover time carries over to the next frame. */
+struct FixedTimestep {
+    [[nodiscard]] static FixedTimestep create(uint32_t tickrate,
+                                              int32_t max_ticks_per_frame = 8);
+
+    /* Adds FRAME_TIME seconds, returns how many ticks to run now. When more
+     * than MAX_TICKS_PER_FRAME are due, the backlog is dropped - otherwise
+     * slow ticks would make every next frame longer and the simulation
+     * would never catch up. */
+    [[nodiscard]] int32_t advance(float frame_time);
+
+    /* Keeps the accumulated fraction of a tick. */
+    void set_tickrate(uint32_t new_tickrate);
+
+    /* Seconds. */
+    [[nodiscard]] float tick_duration() const;
+
+    /* How far between the last two ticks the current frame is, [0, 1). */
+    [[nodiscard]] float alpha() const;
+
+    uint32_t tickrate = 60;
+    int32_t max_ticks_per_frame = 8;
+
+    /* Seconds not yet consumed by ticks. */
+    double accumulator = 0.0;
+
+    uint64_t total_ticks = 0;
+    uint64_t dropped_ticks = 0;
+};
+
+#endif
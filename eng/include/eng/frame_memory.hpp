@@ -0,0 +1,44 @@
+#ifndef FRAME_MEMORY_HPP
+#define FRAME_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+/* Memory for data living no longer than a frame - render lists, registry
+ * views, culling scratch. Two arenas take turns, each reset as a whole when
+ * its frame comes again, so whatever was allocated last frame stays valid
+ * through the current one. Main thread only. */
+namespace eng::frame_memory {
+
+static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+struct FrameMemoryStats {
+    /* Current frame's arena. */
+    size_t used = 0;
+    size_t capacity = 0;
+
+    /* Most bytes any frame used so far. */
+    size_t peak = 0;
+};
+
+/* Until init() (and after shutdown()) resource() hands out the default heap
+ * resource, so code using it works the same outside of a frame loop. */
+void init(size_t capacity = DEFAULT_CAPACITY);
+void shutdown();
+
+/* Call once at the start of every frame. Resets and switches to the arena
+ * used two frames ago. */
+void next_frame();
+
+[[nodiscard]] std::pmr::memory_resource *resource();
+
+/* True for arenas' resources, memory of which doesn't need to be freed one
+ * allocation at a time - it might not even be there anymore. */
+[[nodiscard]] bool is_frame_resource(const std::pmr::memory_resource *memory);
+
+[[nodiscard]] FrameMemoryStats stats();
+
+} // namespace eng::frame_memory
+
+#endif
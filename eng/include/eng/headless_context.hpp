@@ -0,0 +1,27 @@
+#ifndef HEADLESS_CONTEXT_HPP
+#define HEADLESS_CONTEXT_HPP
+
+#include <optional>
+
+namespace eng {
+
+/* OpenGL context with no window and no display server, created through EGL.
+ * For tools and tests that only render offscreen, e.g. on build servers.
+ * Default framebuffer doesn't exist, render to framebuffer objects. */
+struct HeadlessContext {
+    /* Makes the context current on the calling thread. Returns nullopt if
+     * there's no EGL device able to provide OpenGL 4.5 core. */
+    [[nodiscard]] static std::optional<HeadlessContext> create();
+
+    /* For renderer::init(). */
+    [[nodiscard]] static void *get_proc_address(const char *name);
+
+    void destroy();
+
+    void *display = nullptr;
+    void *context = nullptr;
+};
+
+} // namespace eng
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace eng::jobs {
+
+using Job = std::function<void()>;
+
+struct Counter;
+
+struct QueuedJob {
+    Job fn;
+    Counter *counter = nullptr;
+};
+
+/* Counts unfinished jobs started with it. Has to outlive them - wait() on
+ * it before it goes out of scope. */
+struct Counter {
+    [[nodiscard]] bool done() const;
+
+    std::atomic<int32_t> pending = 0;
+
+    /* Jobs started with run_after(), queued once PENDING drops to zero. */
+    std::mutex mutex;
+    std::vector<QueuedJob> continuations;
+};
+
+struct JobSystemSpec {
+    /* Threads doing jobs, the calling one included. 0 picks
+     * available_cpus(). 1 spawns no workers and runs every job right away on
+     * the submitting thread, in submission order - deterministic, for
+     * debugging. */
+    int32_t threads = 0;
+};
+
+/* Each thread owns a queue - it pushes and pops at the back, idle threads
+ * steal from the front of others'. Until init() (and after shutdown()) it
+ * behaves as if initialized with a single thread. The calling thread becomes
+ * the main one. */
+void init(const JobSystemSpec &spec = {});
+void shutdown();
+
+/* Threads taking part in jobs, the main one included. */
+[[nodiscard]] int32_t threads_count();
+
+/* Calling thread's index in [0, threads_count()), main thread's is 0 - for
+ * picking per-thread data without locking. Threads outside the system get
+ * -1. */
+[[nodiscard]] int32_t thread_index();
+
+/* CPUs this process can actually use - affinity mask and cgroup CPU quota
+ * included, so containers don't get oversubscribed. At least 1. */
+[[nodiscard]] int32_t available_cpus();
+
+/* COUNTER, if given, stays above zero until the job finishes. */
+void run(Job job, Counter *counter = nullptr);
+
+/* Queues the job once DEPENDENCY drops to zero, right away if it already
+ * did. Jobs added to DEPENDENCY later on don't delay it anymore. */
+void run_after(Counter &dependency, Job job, Counter *counter = nullptr);
+
+/* Runs queued jobs on the calling thread until COUNTER drops to zero,
+ * instead of blocking. */
+void wait(Counter &counter);
+
+/* Non-owning reference to a parallel_for() body. Wrapping it in a
+ * std::function would allocate for most lambdas, every call. */
+struct RangeBody {
+    void operator()(int32_t first, int32_t last) const {
+        call(ctx, first, last);
+    }
+
+    void *ctx = nullptr;
+    void (*call)(void *ctx, int32_t first, int32_t last) = nullptr;
+};
+
+/* Splits [0, COUNT) into ranges of GRAIN indices (picked from thread count
+ * when 0) and calls BODY(first, last) for each, last exclusive. Calling
+ * thread takes part, returns once all ranges are done. Ranges run
+ * concurrently, so BODY must only write to its own range's data. */
+void parallel_for(int32_t count, int32_t grain, RangeBody body);
+
+template <typename Fn>
+void parallel_for(int32_t count, int32_t grain, Fn &&body) {
+    using Body = std::remove_reference_t<Fn>;
+    parallel_for(count, grain,
+                 RangeBody{.ctx = (void *)&body,
+                           .call = [](void *ctx, int32_t first, int32_t last) {
+                               (*(Body *)ctx)(first, last);
+                           }});
+}
+
+} // namespace eng::jobs
+
+#endif
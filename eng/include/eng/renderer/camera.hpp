@@ -3,6 +3,7 @@
 
 #include "eng/event.hpp"
 #include "eng/renderer/renderer.hpp"
+#include "eng/scene/bvh.hpp"
 #include <memory>
 
 namespace eng {
@@ -48,6 +49,11 @@ struct SpectatorCamera {
 
     [[nodiscard]] renderer::CameraData render_data() const;
 
+    /* World space ray going through a point on the viewport. Coordinates
+     * are in pixels, with origin in the bottom-left corner (like in
+     * framebuffers). */
+    [[nodiscard]] Ray screen_ray(const glm::vec2 &viewport_coords) const;
+
     void on_event(Event &ev);
     void on_update(float timestep);
 
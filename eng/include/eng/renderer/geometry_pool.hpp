@@ -0,0 +1,52 @@
+#ifndef GEOMETRY_POOL_HPP
+#define GEOMETRY_POOL_HPP
+
+#include "eng/containers/range_allocator.hpp"
+#include "eng/renderer/opengl.hpp"
+#include "eng/renderer/primitives.hpp"
+
+namespace eng {
+
+/* Where a mesh's geometry lives in a GeometryPool, ready to go into a
+ * DrawElementsIndirectCommand as is. */
+struct GeometryRange {
+    uint32_t base_vertex = 0;
+    uint32_t vertices_count = 0;
+    uint32_t first_index = 0;
+    uint32_t indices_count = 0;
+};
+
+/* One vertex and one index buffer shared by all meshes of the standard
+ * vertex format, behind a single vertex array - so a whole pass can be
+ * drawn without rebinding anything, with one multi-draw. Buffers grow when
+ * full, moving what's in them on the GPU, ranges handed out stay valid. */
+struct GeometryPool {
+    static constexpr uint32_t DEFAULT_VERTICES_CAPACITY = 1 << 16;
+    static constexpr uint32_t DEFAULT_INDICES_CAPACITY = 1 << 18;
+
+    [[nodiscard]] static GeometryPool
+    create(uint32_t vertices_capacity = DEFAULT_VERTICES_CAPACITY,
+           uint32_t indices_capacity = DEFAULT_INDICES_CAPACITY);
+    void destroy();
+
+    /* Indices stay relative to the mesh's own vertices, draws offset them
+     * with the range's base vertex. */
+    [[nodiscard]] GeometryRange allocate(const VertexData &vertex_data);
+    void free(const GeometryRange &range);
+
+    /* Reads RANGE's vertices back from the GPU. */
+    [[nodiscard]] std::vector<Vertex>
+    read_vertices(const GeometryRange &range) const;
+
+    /* Per instance attributes start at 5, buffer attached by the
+     * renderer. */
+    VertexArray vao;
+    cont::RangeAllocator vertices;
+    cont::RangeAllocator indices;
+
+    uint64_t grows = 0;
+};
+
+} // namespace eng
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef GPU_CULLING_HPP
+#define GPU_CULLING_HPP
+
+#include "eng/renderer/lod.hpp"
+#include "eng/scene/scene.hpp"
+#include <map>
+#include <span>
+
+namespace eng {
+
+/* Candidates left out of a pass, groups a pass doesn't draw. */
+constexpr uint32_t NO_CULL_GROUP = UINT32_MAX;
+
+/* One entity, laid out the way the culling shader reads it (std430).
+ * Bounds are those of its full detail mesh, in mesh space. GROUP and
+ * SHADOW_GROUP pick commands it's drawn by in base and shadow passes. */
+struct CullCandidate {
+    glm::mat4 transform;
+    glm::vec3 bb_min;
+    float entity_id = 0.0f;
+    glm::vec3 bb_max;
+    uint32_t group = NO_CULL_GROUP;
+
+    /* Copied into the instance along with the transform. */
+    float material_index = 0.0f;
+    uint32_t shadow_group = NO_CULL_GROUP;
+
+    /* LodComp's bias, negative without one - always full detail then. */
+    float lod_bias = -1.0f;
+    float padding = 0.0f;
+};
+
+static_assert(sizeof(CullCandidate) == 112 && "Doesn't match std430 layout");
+
+/* Candidates sharing a material and mesh, drawn by the same commands - one
+ * per LOD level. Shadow groups all have material 0. */
+struct GpuSceneGroup {
+    AssetID material_id = 0;
+    AssetID mesh_id = 0;
+    int32_t members = 0;
+};
+
+/* Groups of one pass. Indices stay put while a group has members, emptied
+ * ones get reused. */
+struct GpuSceneGroups {
+    [[nodiscard]] uint32_t acquire(AssetID material_id, AssetID mesh_id);
+    void release(uint32_t group);
+
+    std::vector<GpuSceneGroup> groups;
+    std::map<std::pair<AssetID, AssetID>, uint32_t> ids;
+    std::vector<uint32_t> free_groups;
+};
+
+/* Dynamic meshes of a scene, kept on the GPU for GpuCuller - static ones
+ * are left to StaticBatches. Follows the scene through its moved_ids and
+ * mesh_changed_ids, only what changed gets written and uploaded, so per
+ * frame CPU cost doesn't depend on how many meshes there are. LOD levels
+ * are picked on the GPU as well, LodComp's selection state isn't touched. */
+struct GpuScene {
+    [[nodiscard]] static GpuScene create();
+    void destroy();
+
+    /* Call after update_global_transforms() and before
+     * update_spatial_index(), which clears what this reads. */
+    void update(Scene &scene, const AssetPack &asset_pack);
+
+    /* Forgets every entity, for when the scene gets replaced. */
+    void clear();
+
+    /* Slots are packed, removing one moves the last one into it. */
+    std::vector<CullCandidate> candidates;
+    std::vector<ecs::EntityID> slot_ids;
+
+    /* Flat EntityID -> slot, -1 for entities not in here. */
+    std::vector<int32_t> id_to_slot;
+
+    GpuSceneGroups groups;
+    GpuSceneGroups shadow_groups;
+
+    /* Slots written since GpuCuller last uploaded them. */
+    std::vector<uint32_t> dirty_slots;
+    std::vector<uint8_t> dirty;
+
+    /* Candidates, and LOD levels picked for them last time - base pass' in
+     * the low 16 bits, shadow pass' in the high ones. Levels only live on
+     * the GPU, a candidate moved to another slot starts from the level that
+     * was there. CAPACITY is in slots. */
+    ShaderStorage candidates_storage;
+    ShaderStorage lod_levels_storage;
+    uint32_t capacity = 0;
+
+    renderer::LodSettings lod_settings;
+};
+
+/* Where a pass draws one group, indexed like the pass' GpuSceneGroups.
+ * LEVELS commands past FIRST_COMMAND draw LOD levels, screen sizes of
+ * those start at FIRST_LOD_SIZE of the pass' sizes, see Mesh::lods. */
+struct CullGroup {
+    uint32_t first_command = NO_CULL_GROUP;
+    uint32_t levels = 0;
+    uint32_t first_lod_size = 0;
+    uint32_t padding = 0;
+};
+
+/* Commands a pass draws a GPU scene with, and how it picks LOD levels. */
+struct CullPass {
+    std::span<const CullGroup> groups;
+    std::span<const float> lod_sizes;
+
+    glm::vec3 camera_position = glm::vec3(0.0f);
+
+    /* cot(fov / 2), see renderer::projected_size(). */
+    float projection_scale = 1.0f;
+};
+
+/* Culls GPU scenes with a compute shader, nothing gets read back.
+ * Survivors are written to the instance buffer, compacted per command
+ * starting at its base instance, and counted in its instance count - so
+ * commands have to come in with the count zeroed and room for all of their
+ * group's members. Same tests as the CPU side ones, so both agree on what's
+ * visible. */
+struct GpuCuller {
+    /* Empty if either shader can't be built. */
+    [[nodiscard]] static std::optional<GpuCuller>
+    create(const std::string &cull_shader_path,
+           const std::string &scatter_shader_path);
+    void destroy();
+
+    /* Uploads candidates written since last time, every one of them if the
+     * scene's storage had to grow. Returns how many got uploaded. Culling
+     * does it on its own. */
+    int32_t sync(GpuScene &scene);
+
+    /* Keeps candidates of PASS' groups inside FRUSTUM. */
+    void cull(GpuScene &scene, const CullPass &pass, const Frustum &frustum,
+              const IndirectBuffer &commands, const VertexBuffer &instances);
+
+    /* Keeps candidates of PASS' groups touching any of SPHERES - center and
+     * radius, like ranges of lights for shadow passes. Picks LOD levels
+     * with the scene's shadow scale. */
+    void cull(GpuScene &scene, const CullPass &pass,
+              std::span<const glm::vec4> spheres,
+              const IndirectBuffer &commands, const VertexBuffer &instances);
+
+    Shader shader;
+    Shader scatter_shader;
+
+    /* Rewritten by every cull or sync, grow as needed. */
+    ShaderStorage groups;
+    uint32_t groups_capacity = 0;
+    ShaderStorage lod_sizes;
+    uint32_t lod_sizes_capacity = 0;
+    ShaderStorage spheres;
+    uint32_t spheres_capacity = 0;
+    ShaderStorage patches;
+    uint32_t patches_capacity = 0;
+};
+
+} // namespace eng
+
+#endif
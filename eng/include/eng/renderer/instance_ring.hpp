@@ -0,0 +1,62 @@
+#ifndef INSTANCE_RING_HPP
+#define INSTANCE_RING_HPP
+
+#include "eng/scene/assets.hpp"
+#include <array>
+#include <span>
+
+namespace eng {
+
+/* Instance data of whole frames, written straight into a persistently
+ * mapped buffer. Frames take turns in REGIONS_COUNT regions of it, each
+ * fenced once its frame is queued, so writing only waits for the GPU if it
+ * falls that many frames behind. Draws pick their instances with base
+ * instance, the buffer itself stays attached to vertex arrays. */
+struct InstanceRing {
+    static constexpr int32_t REGIONS_COUNT = 3;
+
+    /* REGION_CAPACITY in instances, per frame. */
+    [[nodiscard]] static InstanceRing create(int32_t region_capacity);
+    void destroy();
+
+    /* Makes sure COUNT more instances fit into current frame's region,
+     * growing the whole ring if they don't. Growing starts over in a new
+     * buffer, so it's only safe when instances pushed so far don't need to
+     * be drawn anymore - call it before pushing a pass' instances. */
+    void reserve(int32_t count);
+
+    /* Copies INSTANCES into current frame's region, they have to fit.
+     * Returns the index of the first one, for draws' base instance. */
+    [[nodiscard]] uint32_t push(std::span<const MeshInstance> instances);
+
+    /* Same as push(), but leaves the room for the GPU to write into, see
+     * GpuCuller. */
+    [[nodiscard]] uint32_t claim(int32_t count);
+
+    /* Fences current frame's region and moves to the next one, waiting for
+     * the GPU to be done with it first. */
+    void next_frame();
+
+    /* Points VAO's instance attributes at the buffer. */
+    void attach(const VertexArray &vao) const;
+
+    /* Very first instance is an identity one, never overwritten - for draws
+     * with no instance data of their own. */
+    static constexpr uint32_t IDENTITY_INSTANCE = 0;
+
+    VertexBuffer buffer;
+    MeshInstance *mapped = nullptr;
+
+    int32_t region_capacity = 0;
+    int32_t region = 0;
+    int32_t region_used = 0;
+    std::array<GLsync, REGIONS_COUNT> fences{};
+
+    /* Times next_frame() actually had to wait. */
+    uint64_t stalls = 0;
+    uint64_t grows = 0;
+};
+
+} // namespace eng
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include "eng/renderer/renderer.hpp"
+#include "eng/scene/scene.hpp"
+
+namespace eng::renderer {
+
+struct LodSettings {
+    /* Relative margin around each switch point. A level is left only once
+     * the size gets this much past its threshold, so meshes sitting right
+     * at the threshold don't flicker between levels. */
+    float hysteresis = 0.15f;
+
+    /* Scales projected size for shadow passes, below 1 makes shadows use
+     * coarser levels than the color pass. */
+    float shadow_scale = 0.5f;
+};
+
+/* Fraction of the viewport height covered by a sphere of RADIUS at CENTER,
+ * clamped to 1 when the camera is inside it. */
+[[nodiscard]] float projected_size(const CameraData &camera,
+                                   const glm::vec3 &center, float radius);
+
+/* Level of MESH's LOD chain for SIZE, starting from CURRENT level. */
+[[nodiscard]] int32_t select_lod_level(const Mesh &mesh, int32_t current,
+                                       float size, float hysteresis);
+
+/* Updates LodComp of culled PROXIES, call after culling and before
+ * submission. Entities without LodComp always use full detail meshes. */
+void select_lods(Scene &scene, const AssetPack &asset_pack,
+                 const CameraData &camera, const std::vector<int32_t> &proxies,
+                 const LodSettings &settings = {});
+void select_shadow_lods(Scene &scene, const AssetPack &asset_pack,
+                        const CameraData &camera,
+                        const std::vector<int32_t> &proxies,
+                        const LodSettings &settings = {});
+
+} // namespace eng::renderer
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef MATERIAL_TABLE_HPP
+#define MATERIAL_TABLE_HPP
+
+#include "eng/renderer/texture_arrays.hpp"
+#include "eng/scene/assets.hpp"
+#include <array>
+#include <map>
+#include <vector>
+
+namespace eng {
+
+/* Material parameters the way shaders read them (std430). */
+struct alignas(16) MaterialData {
+    glm::vec4 color;
+    glm::vec2 tiling_factor;
+    glm::vec2 texture_offset;
+    glm::vec4 emission_and_ao;
+
+    float roughness;
+    float metallic;
+
+    /* Spelled out, so packed materials compare byte by byte. */
+    float padding[2];
+
+    /* Albedo, normal, ORM and emission, see TextureArrays::layer_ref(). */
+    glm::ivec4 texture_layers;
+};
+
+static_assert(sizeof(MaterialData) == 80 && "Doesn't match std430 layout");
+
+[[nodiscard]] MaterialData pack_material(const Material &material,
+                                         const TextureArrays &arrays);
+
+/* IDs FIRST to FIRST + COUNT, exclusive. */
+struct MaterialRange {
+    AssetID first = 0;
+    int32_t count = 0;
+};
+
+/* CPU side copy of the materials buffer, indexed by material ID - instances
+ * carry the index, shaders look parameters up in it. Materials get edited in
+ * place with no telling when, so sync() compares everything against what it
+ * packed last time, which is cheap next to uploading what didn't change. */
+struct MaterialTable {
+    /* Repacks MATERIALS, with their textures' layers in ARRAYS. Returns the
+     * range of IDs that changed. Gaps left by removed materials keep their
+     * old data, nothing refers to them - texture sets get rebuilt, so none
+     * is represented by a removed one. */
+    MaterialRange sync(const std::map<AssetID, Material> &materials,
+                       const TextureArrays &arrays);
+
+    std::vector<MaterialData> data;
+
+    /* Albedo, normal, ORM and emission to bind, per ID. All zeros for
+     * materials with every one of them packed, nothing to bind there. */
+    std::vector<std::array<AssetID, 4>> textures;
+
+    /* Per ID, ID of the first material with the same textures to bind, 0
+     * for packed ones. Materials of a set differ only in what's read from
+     * the materials buffer, so they can share draws. */
+    std::vector<AssetID> texture_sets;
+};
+
+} // namespace eng
+
+#endif
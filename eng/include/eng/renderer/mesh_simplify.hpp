@@ -0,0 +1,40 @@
+#ifndef MESH_SIMPLIFY_HPP
+#define MESH_SIMPLIFY_HPP
+
+#include "eng/renderer/primitives.hpp"
+#include <future>
+
+namespace eng {
+
+struct SimplifiedMesh {
+    VertexData vertex_data;
+
+    /* Triangles left, relative to the source mesh. */
+    float ratio = 1.0f;
+
+    /* Estimated distance from the source surface, in mesh units. */
+    float error = 0.0f;
+};
+
+/* Default targets, fraction of source triangles for each level. */
+static constexpr float DEFAULT_LOD_RATIOS[] = {0.5f, 0.25f, 0.125f, 0.0625f};
+
+/* Quadric error edge collapse. Vertices on UV or normal seams (same
+ * position, different attributes) and on open borders never move, so seams
+ * and silhouettes of open meshes stay intact, and every kept vertex keeps
+ * its attributes. Each level continues from the previous one, RATIOS have
+ * to be decreasing. Levels that couldn't get any simpler than the previous
+ * one are left out, so fewer levels than ratios might come back. */
+[[nodiscard]] std::vector<SimplifiedMesh>
+simplify_lod_chain(const VertexData &vertex_data,
+                   const std::vector<float> &ratios);
+
+/* Same on a thread of its own, so callers on the main thread don't block.
+ * Not a job - jobs::wait() on the main thread could pick it up and stall the
+ * frame for as long as it takes. */
+[[nodiscard]] std::future<std::vector<SimplifiedMesh>>
+simplify_lod_chain_async(VertexData vertex_data, std::vector<float> ratios);
+
+} // namespace eng
+
+#endif
@@ -2,10 +2,13 @@
 #define OPENGL_HPP
 
 #include <glad/glad.h>
+#include <array>
 #include <glm/glm.hpp>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #define GL_CALL(f)                                                             \
     gl_clear_errors();                                                         \
@@ -39,10 +42,40 @@ struct IndexBuffer {
     void bind() const;
     void unbind() const;
 
+    /* OFFSET and COUNT in indices. */
+    void set_data(const uint32_t *data, uint32_t count,
+                  uint32_t offset = 0) const;
+
     GLuint id = 0;
     uint32_t indices_count = 0;
 };
 
+/* Layout glMultiDrawElementsIndirect() reads commands in. */
+struct DrawElementsIndirectCommand {
+    uint32_t count = 0;
+    uint32_t instance_count = 0;
+    uint32_t first_index = 0;
+    int32_t base_vertex = 0;
+    uint32_t base_instance = 0;
+};
+
+/* Commands of multi-draws, rewritten as a whole every time. */
+struct IndirectBuffer {
+    [[nodiscard]] static IndirectBuffer create();
+
+    void destroy();
+
+    void bind() const;
+    void unbind() const;
+
+    /* Orphans the old storage, so draws still reading it don't stall. */
+    void set_commands(const DrawElementsIndirectCommand *commands,
+                      uint32_t count);
+
+    GLuint id = 0;
+    uint32_t commands_count = 0;
+};
+
 struct StringReplacement {
     std::string pattern;
     std::string target;
@@ -59,6 +92,16 @@ struct ShaderSpec {
     std::optional<ShaderDescriptor> geometry_shader;
 };
 
+/* Lets the uniform cache be looked up with a string_view, no temporary
+ * std::string for every uniform set. */
+struct UniformNameHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view name) const {
+        return std::hash<std::string_view>{}(name);
+    }
+};
+
 struct Shader {
     [[nodiscard]] static Shader create();
     [[nodiscard]] static GLuint compile(GLenum type, const std::string &src);
@@ -73,29 +116,31 @@ struct Shader {
     void dispatch_compute(const glm::ivec3 &group);
 
     [[nodiscard]] std::optional<GLint>
-    get_uniform_location(const std::string &name);
+    get_uniform_location(std::string_view name);
 
-    void set_uniform_1i(const std::string &name, int32_t val);
-    void try_set_uniform_1i(const std::string &name, int32_t val);
+    void set_uniform_1i(std::string_view name, int32_t val);
+    void try_set_uniform_1i(std::string_view name, int32_t val);
 
-    void set_uniform_1f(const std::string &name, float val);
-    void try_set_uniform_1f(const std::string &name, float val);
+    void set_uniform_1f(std::string_view name, float val);
+    void try_set_uniform_1f(std::string_view name, float val);
 
-    void set_uniform_2f(const std::string &name, const glm::vec2 &val);
-    void try_set_uniform_2f(const std::string &name, const glm::vec2 &val);
+    void set_uniform_2f(std::string_view name, const glm::vec2 &val);
+    void try_set_uniform_2f(std::string_view name, const glm::vec2 &val);
 
-    void set_uniform_3f(const std::string &name, const glm::vec3 &val);
-    void try_set_uniform_3f(const std::string &name, const glm::vec3 &val);
+    void set_uniform_3f(std::string_view name, const glm::vec3 &val);
+    void try_set_uniform_3f(std::string_view name, const glm::vec3 &val);
 
-    void set_uniform_4f(const std::string &name, const glm::vec4 &val);
-    void try_set_uniform_4f(const std::string &name, const glm::vec4 &val);
+    void set_uniform_4f(std::string_view name, const glm::vec4 &val);
+    void try_set_uniform_4f(std::string_view name, const glm::vec4 &val);
 
-    void set_uniform_mat4(const std::string &name, const glm::mat4 &val);
-    void try_set_uniform_mat4(const std::string &name, const glm::mat4 &val);
+    void set_uniform_mat4(std::string_view name, const glm::mat4 &val);
+    void try_set_uniform_mat4(std::string_view name, const glm::mat4 &val);
 
     std::string name;
     GLuint id = 0;
-    std::unordered_map<std::string, std::optional<GLint>> uniform_cache;
+    std::unordered_map<std::string, std::optional<GLint>, UniformNameHash,
+                       std::equal_to<>>
+        uniform_cache;
 };
 
 struct VertexBufferElement {
@@ -125,17 +170,29 @@ struct VertexArray {
     void add_vertex_buffer(const VertexBuffer &vbo,
                            const VertexBufferLayout &layout,
                            uint32_t attrib_offset = 0);
-    void add_instanced_vertex_buffer(const VertexBuffer &vbo,
-                                     const VertexBufferLayout &layout,
-                                     uint32_t attrib_offset = 0);
+
+    /* Per vertex attributes read from binding point 0, with buffers
+     * attached by attach_buffers() - they can be swapped for others of the
+     * same layout later on. */
+    void add_vertex_layout(const VertexBufferLayout &layout);
+    void attach_buffers(const VertexBuffer &vbo, const IndexBuffer &ibo,
+                        uint32_t stride);
+
+    /* Per instance attributes, with no buffer of their own - it's attached
+     * with bind_instance_buffer(), so a single buffer can feed instances of
+     * any number of vertex arrays. */
+    void add_instance_layout(const VertexBufferLayout &layout,
+                             uint32_t attrib_offset);
+    void bind_instance_buffer(const VertexBuffer &vbo, uint64_t offset,
+                              uint32_t stride) const;
 
     void bind() const;
     void unbind() const;
 
     GLuint id = 0;
     VertexBuffer vbo;
-    VertexBuffer vbo_instanced;
     IndexBuffer ibo;
+    uint32_t instance_binding = UINT32_MAX;
 };
 
 enum class TextureFormat {
@@ -294,6 +351,42 @@ struct ColorAttachment {
     ColorAttachmentSpec spec;
 };
 
+/* Non-blocking GPU -> CPU transfer. Requests copy into a ring of pixel pack
+ * buffers and put a fence after the copy, poll() hands out the oldest result
+ * once GPU got past its fence - usually a frame or two later - so reading
+ * back never drains the pipeline. */
+struct AsyncReadback {
+    static constexpr int32_t RING_SIZE = 3;
+
+    [[nodiscard]] static AsyncReadback create(uint32_t max_size);
+
+    void destroy();
+
+    /* Reads from the currently bound read framebuffer and read buffer, rows
+     * laid out by GL_PACK_ALIGNMENT. Returns false if every slot is still
+     * waiting for the GPU, or the pixels don't fit the buffers. */
+    bool request_pixels(const glm::ivec2 &coords, const glm::ivec2 &size,
+                        GLenum format, GLenum type);
+
+    /* Copies a range of any buffer object, e.g. SSBO with reduced scene
+     * luminance. */
+    bool request_buffer(GLuint buffer, uint32_t offset, uint32_t size);
+
+    /* Writes the oldest finished request into DST. Returns false if there's
+     * nothing ready yet. */
+    bool poll(void *dst);
+
+    [[nodiscard]] bool has_pending() const { return pending > 0; }
+
+    std::array<GLuint, RING_SIZE> buffers{};
+    std::array<GLsync, RING_SIZE> fences{};
+    std::array<uint32_t, RING_SIZE> sizes{};
+
+    int32_t head = 0;
+    int32_t pending = 0;
+    uint32_t capacity = 0;
+};
+
 struct Framebuffer {
     [[nodiscard]] static Framebuffer create();
 
@@ -332,13 +425,23 @@ struct Framebuffer {
 
     void fill_color_draw_buffers();
 
+    /* Blocking - waits for everything queued before it to finish. Prefer
+     * request_pick() and poll_pick(). */
     glm::u8vec4 pixel_at(const glm::vec2 &coords, int32_t attachment_idx) const;
 
+    /* Asynchronous version of pixel_at(). Result shows up in poll_pick()
+     * after GPU is done with the frame, usually one or two frames later. */
+    bool request_pick(const glm::vec2 &coords, int32_t attachment_idx);
+    [[nodiscard]] std::optional<glm::u8vec4> poll_pick();
+
     [[nodiscard]] bool is_complete() const;
 
     GLuint id = 0;
     std::vector<DepthAttachment> depth_attachments;
     std::vector<ColorAttachment> color_attachments;
+
+    /* Created on first request_pick(). */
+    AsyncReadback pick_readback;
 };
 
 struct UniformBuffer {
@@ -0,0 +1,138 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include "eng/scene/assets.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace eng {
+
+/* What a queued item's payload refers to. */
+enum class RenderItemKind : uint8_t {
+    INSTANCE,
+    STATIC_DRAW
+};
+
+/* Fields packed into a 64-bit sort key, most significant first: pass,
+ * shader, texture set, mesh, kind, depth. Items needing the same state end
+ * up next to each other, binding as little as possible when walked in
+ * order, and instances of the same mesh come front to back for early
+ * depth rejection. Material parameters are read per instance, so they
+ * don't split draws - only textures do, see MaterialTable::texture_sets.
+ * Assets go in as indices from SortKeyIndices, their IDs could outgrow the
+ * fields. */
+struct SortKey {
+    static constexpr int32_t PASS_BITS = 2;
+    static constexpr int32_t SHADER_BITS = 10;
+    static constexpr int32_t TEXTURE_SET_BITS = 16;
+    static constexpr int32_t MESH_BITS = 18;
+    static constexpr int32_t KIND_BITS = 2;
+    static constexpr int32_t DEPTH_BITS = 16;
+
+    /* Everything but depth - items sharing it go into the same draw. */
+    static constexpr uint64_t STATE_MASK = ~((1ull << DEPTH_BITS) - 1);
+
+    uint32_t pass = 0;
+    int32_t shader_index = 0;
+    int32_t texture_set_index = 0;
+    int32_t mesh_index = 0;
+    RenderItemKind kind = RenderItemKind::INSTANCE;
+    uint16_t depth = 0;
+};
+
+static_assert(SortKey::PASS_BITS + SortKey::SHADER_BITS +
+                      SortKey::TEXTURE_SET_BITS + SortKey::MESH_BITS +
+                      SortKey::KIND_BITS + SortKey::DEPTH_BITS ==
+                  64 &&
+              "Sort key fields don't add up to 64 bits");
+
+/* Fields too big for their bits assert, in release builds they get cut
+ * short instead of spilling into the neighbouring ones. */
+[[nodiscard]] uint64_t pack_sort_key(const SortKey &key);
+[[nodiscard]] SortKey unpack_sort_key(uint64_t key);
+
+/* DISTANCE from the camera in [0, FAR_CLIP], mapped to the depth field.
+ * Anything further clamps to the far end. */
+[[nodiscard]] uint16_t quantize_depth(float distance, float far_clip);
+
+/* Dense indices of asset IDs, for sort key fields. IDs only ever grow as
+ * assets get created and deleted, indices stay below the count of assets
+ * there are right now. ID 0 is always index 0, for "none". */
+struct SortKeyIndices {
+    /* Indexes every ID of ASSETS, in order. Returns false if some didn't fit
+     * into BITS, those get no index. Keeps capacity, rebuilding every frame
+     * doesn't allocate once warmed up. */
+    template <typename T>
+    bool assign(const std::map<AssetID, T> &assets, int32_t bits);
+
+    /* -1 if ID has no index. */
+    [[nodiscard]] int32_t index_of(AssetID id) const {
+        return id >= 0 && id < (AssetID)indices.size() ? indices[id] : -1;
+    }
+
+    [[nodiscard]] AssetID id_at(int32_t index) const { return ids[index]; }
+
+    /* By ID and by index. */
+    std::vector<int32_t> indices;
+    std::vector<AssetID> ids;
+};
+
+template <typename T>
+bool SortKeyIndices::assign(const std::map<AssetID, T> &assets,
+                            int32_t bits) {
+    AssetID max_id = assets.empty() ? 0 : assets.rbegin()->first;
+    indices.assign(std::max(max_id, 0) + 1, -1);
+    ids.clear();
+
+    indices[0] = 0;
+    ids.push_back(0);
+
+    size_t capacity = 1ull << bits;
+    for (const auto &[id, asset] : assets) {
+        if (id <= 0)
+            continue;
+
+        if (ids.size() == capacity)
+            return false;
+
+        indices[id] = ids.size();
+        ids.push_back(id);
+    }
+
+    return true;
+}
+
+struct RenderItem {
+    uint64_t key = 0;
+
+    /* Index into whatever KIND in the key says it is, kept by the queue's
+     * owner - in its SOURCE array, if it keeps more than one. */
+    uint32_t payload = 0;
+    uint32_t source = 0;
+};
+
+/* Flat list of a pass' items, sorted by key once everything's in. Vectors
+ * keep their capacity across clear(), so a warmed up queue doesn't
+ * allocate. */
+struct RenderQueue {
+    void push(uint64_t key, uint32_t payload, uint32_t source = 0);
+    void clear();
+
+    /* Makes room for COUNT items, sort scratch included. Grows with
+     * headroom, so counts creeping up frame after frame - as they do while
+     * the camera moves - don't reallocate every time they peak. */
+    void reserve(size_t count);
+
+    /* Stable LSD radix sort, 8 bits a pass. Passes where every key has the
+     * same byte - pass and shader, mostly - are skipped. */
+    void sort();
+
+    std::vector<RenderItem> items;
+    std::vector<RenderItem> scratch;
+};
+
+} // namespace eng
+
+#endif
@@ -5,6 +5,12 @@
 #include "eng/scene/assets.hpp"
 #include "eng/scene/components.hpp"
 #include <glm/glm.hpp>
+#include <span>
+
+namespace eng {
+struct StaticBatches;
+struct GpuScene;
+} // namespace eng
 
 namespace eng::renderer {
 
@@ -14,8 +20,15 @@ constexpr int32_t POINT_LIGHTS_BINDING = 2;
 constexpr int32_t SPOT_LIGHTS_BINDING = 3;
 constexpr int32_t SOFT_SHADOW_PROPS_BINDING = 4;
 constexpr int32_t VISIBLE_INDICES_BINDING = 5;
-
-constexpr int32_t MAX_MESH_INSTANCES = 256;
+constexpr int32_t CULL_CANDIDATES_BINDING = 6;
+constexpr int32_t CULL_COMMANDS_BINDING = 7;
+constexpr int32_t CULL_INSTANCES_BINDING = 8;
+constexpr int32_t CULL_SPHERES_BINDING = 9;
+constexpr int32_t MATERIALS_BINDING = 10;
+constexpr int32_t CULL_GROUPS_BINDING = 11;
+constexpr int32_t CULL_LOD_SIZES_BINDING = 12;
+constexpr int32_t CULL_LOD_LEVELS_BINDING = 13;
+constexpr int32_t CULL_PATCHES_BINDING = 14;
 
 constexpr int32_t MAX_DIR_LIGHTS = 8;
 constexpr int32_t MIN_DIR_LIGHTS_STORAGE = 2;
@@ -41,6 +54,11 @@ struct TextureSlots {
     int32_t point_lights_shadowmaps{};
     int32_t spot_lights_shadowmaps{};
     int32_t random_offsets_texture{};
+
+    /* First of TEXTURE_ARRAYS_COUNT consecutive units - as many as fit
+     * below the shadow map units, up to TextureArrays::MAX_ARRAYS. */
+    int32_t texture_arrays{};
+    int32_t texture_arrays_count{};
 };
 
 struct alignas(16) CameraData {
@@ -103,14 +121,38 @@ struct RenderStats {
     int32_t submitted_instances{};
     int32_t accepted_instances{};
 
+    /* Candidates of GPU scenes culled in every pass, what survives stays
+     * on the GPU. Only patched ones are uploaded, after changing. */
+    int32_t gpu_cull_candidates{};
+    int32_t patched_candidates{};
+
+    /* Written to the instance ring, once per pass. */
+    int32_t uploaded_instances{};
+    int32_t instance_ring_capacity{};
+
+    /* Commands drawing instances, big batches take more than one. */
+    int32_t instanced_draws{};
+
+    int32_t submitted_static_clusters{};
+    int32_t accepted_static_clusters{};
+
+    /* Indirect commands of all passes, what used to be separate draws. */
+    int32_t draw_commands{};
+
+    /* Multi-draws of the base pass, one per texture set. */
     int32_t draw_calls{};
+
+    /* Materials written to the materials buffer, only after changing. */
+    int32_t uploaded_materials{};
 };
 
 void opengl_msg_cb(unsigned source, unsigned type, unsigned id,
                    unsigned severity, int length, const char *msg,
                    const void *user_param);
 
-[[nodiscard]] bool init();
+/* GL_LOADER resolves OpenGL functions of the current context. GLFW's one is
+ * used if null, for contexts created along with a window. */
+[[nodiscard]] bool init(GLADloadproc gl_loader = nullptr);
 
 void shutdown();
 
@@ -121,10 +163,41 @@ void scene_end();
 void shadow_pass_begin(const CameraData &camera, AssetPack &asset_pack);
 void shadow_pass_end();
 
+/* Between a pass' begin and end, meshes can be submitted from any job
+ * thread at once - each fills a bucket of its own, merged and sorted when
+ * the pass ends. Lights and static batches go on the main thread, lights
+ * before meshes tested against them. */
+
+/* Culled against the camera 4 instances at a time, see cull_aabbs().
+ * Element I of every span describes instance I. */
+void submit_meshes(std::span<const glm::mat4> transforms,
+                   std::span<const AssetID> mesh_ids,
+                   std::span<const AssetID> material_ids,
+                   std::span<const int32_t> ent_ids);
 void submit_mesh(const glm::mat4 &transform, AssetID mesh_id,
                  AssetID material_id, int32_t ent_id);
 void submit_shadow_mesh(const glm::mat4 &transform, AssetID mesh_id);
 
+/* Same as above, but skip visibility tests - for callers that already culled
+ * instances (e.g. with scene's spatial index). */
+void submit_visible_mesh(const glm::mat4 &transform, AssetID mesh_id,
+                         AssetID material_id, int32_t ent_id);
+void submit_visible_shadow_mesh(const glm::mat4 &transform, AssetID mesh_id);
+
+/* Culled by a compute shader at the end of the pass, against the camera -
+ * or light ranges in shadow passes. Candidates stay on the GPU, only what
+ * changed since last frame gets uploaded, and survivors never come back to
+ * the CPU. At most one per pass. */
+void submit_gpu_scene(GpuScene &gpu_scene);
+
+/* Culls clusters of static batches against the camera, visible ones get
+ * drawn with one multi-draw per batch. */
+void submit_static_batches(const StaticBatches &static_batches);
+
+/* Queues clusters in range of point and spot lights, so submit lights
+ * first. */
+void submit_static_shadow_batches(const StaticBatches &static_batches);
+
 void submit_dir_light(const glm::vec3 &rotation, const DirLight &light);
 void submit_point_light(const glm::vec3 &position, const PointLight &light);
 void submit_spot_light(const GlobalTransform &transform,
@@ -149,7 +222,8 @@ void draw_arrays_instanced(const Shader &shader, const VertexArray &vao,
                            uint32_t vertices_count, uint32_t instances_count);
 void draw_elements(const Shader &shader, const VertexArray &vao);
 void draw_elements_instanced(const Shader &shader, const VertexArray &vao,
-                             uint32_t instances_count);
+                             uint32_t instances_count,
+                             uint32_t base_instance = 0);
 
 } // namespace eng
 
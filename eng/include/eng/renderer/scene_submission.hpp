@@ -0,0 +1,34 @@
+#ifndef SCENE_SUBMISSION_HPP
+#define SCENE_SUBMISSION_HPP
+
+#include "eng/renderer/renderer.hpp"
+#include "eng/scene/scene.hpp"
+
+namespace eng::renderer {
+
+/* Glue between scene and renderer. Culling only reads the scene's spatial
+ * index, so it needs update_spatial_index() to be called first. Culled
+ * proxies are kept apart from submission, so callers can time and reuse
+ * them separately. Static meshes are left out, they're drawn from
+ * StaticBatches. */
+
+/* Meshes in range of point and spot lights that are visible to the camera -
+ * only those cast shadows. Sorted, without duplicates. */
+void cull_shadow_casters(Scene &scene, const Frustum &frustum,
+                         std::vector<int32_t> &out_proxies);
+
+/* Meshes with a material inside the frustum. */
+void cull_visible_meshes(Scene &scene, const Frustum &frustum,
+                         std::vector<int32_t> &out_proxies);
+
+/* Goes between scene_begin()/scene_end() or shadow pass equivalents. */
+void submit_scene_lights(Scene &scene);
+
+/* Entities with LodComp are submitted with meshes picked by select_lods()
+ * and select_shadow_lods(). Proxies are submitted from job threads. */
+void submit_shadow_casters(Scene &scene, const std::vector<int32_t> &proxies);
+void submit_visible_meshes(Scene &scene, const std::vector<int32_t> &proxies);
+
+} // namespace eng::renderer
+
+#endif
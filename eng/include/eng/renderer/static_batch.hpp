@@ -0,0 +1,47 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include "eng/scene/scene.hpp"
+
+namespace eng {
+
+/* Range of a batch's index buffer, culled as a whole. */
+struct StaticCluster {
+    MeshAABB bb;
+    uint32_t first_index = 0;
+    uint32_t indices_count = 0;
+};
+
+/* Static meshes sharing a material, pre-transformed to world space and
+ * merged into one range of the asset pack's geometry pool. Drawn with the
+ * identity instance of the renderer's instance ring, so the usual shaders
+ * draw it as is. */
+struct StaticBatch {
+    AssetID material_id = 0;
+    MeshAABB bb;
+
+    /* Geometry only, no CPU side copies. */
+    Mesh mesh;
+    std::vector<StaticCluster> clusters;
+};
+
+struct StaticBatches {
+    /* Bakes every entity with Static, MeshComp and MaterialComp, using their
+     * current global transforms. Meshes inside a batch are clustered by
+     * cells of CLUSTER_SIZE on the XZ plane. Needs a current OpenGL context,
+     * source geometry is read back from the GPU. Batches go into ASSET_PACK's
+     * geometry pool. */
+    [[nodiscard]] static StaticBatches bake(Scene &scene,
+                                            AssetPack &asset_pack,
+                                            float cluster_size = 32.0f);
+
+    /* GEOMETRY is the pool batches were baked into. */
+    void destroy(GeometryPool &geometry);
+
+    std::vector<StaticBatch> batches;
+    int32_t baked_entities = 0;
+};
+
+} // namespace eng
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef TEXTURE_ARRAYS_HPP
+#define TEXTURE_ARRAYS_HPP
+
+#include "eng/renderer/opengl.hpp"
+#include "eng/scene/asset_id.hpp"
+#include <array>
+#include <map>
+#include <vector>
+
+namespace eng {
+
+/* Where a packed texture lives, ARRAY is negative for ones that aren't. */
+struct TextureLayer {
+    int32_t array = -1;
+    int32_t layer = 0;
+};
+
+/* Packs 2D textures into GL_TEXTURE_2D_ARRAYs, one per format, size, mip
+ * count and sampling - so shaders can pick textures per material instead of
+ * having them bound per draw. Layers are GPU side copies, textures keep
+ * their own objects for everything else. At most max_arrays of them, since
+ * all get bound at once. Textures fitting none stay unpacked, drawn the old
+ * way. Arrays grow when full, moving their layers on the GPU. */
+struct TextureArrays {
+    static constexpr int32_t MAX_ARRAYS = 8;
+
+    /* Layers and layer refs share an int, see layer_ref(). */
+    static constexpr int32_t MAX_LAYERS = 1 << 16;
+
+    struct Array {
+        GLuint id = 0;
+        TextureSpec spec;
+        std::array<GLint, 4> swizzle{};
+
+        int32_t capacity = 0;
+        int32_t used = 0;
+        std::vector<int32_t> free_layers;
+    };
+
+    /* Where a texture went and what it looked like then. */
+    struct Packed {
+        TextureLayer where;
+        GLuint texture_id = 0;
+        TextureSpec spec;
+    };
+
+    void destroy();
+
+    /* Packs textures not packed yet, and repacks ones that changed since -
+     * textures get edited in place, sampling included. Layers of textures
+     * that are gone get freed. Returns true if anything moved. */
+    bool sync(const std::map<AssetID, Texture> &textures);
+
+    /* Binds arrays to consecutive units, from FIRST_SLOT on. */
+    void bind(int32_t first_slot) const;
+
+    [[nodiscard]] TextureLayer layer_of(AssetID texture_id) const;
+
+    /* ARRAY << 16 | LAYER, the way shaders read it, -1 if not packed. */
+    [[nodiscard]] int32_t layer_ref(AssetID texture_id) const;
+
+    std::array<Array, MAX_ARRAYS> arrays;
+    int32_t arrays_count = 0;
+
+    /* Lower on GPUs without texture units for all of them. */
+    int32_t max_arrays = MAX_ARRAYS;
+    std::map<AssetID, Packed> packed;
+
+    uint64_t grows = 0;
+};
+
+} // namespace eng
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef ASSET_ID_HPP
+#define ASSET_ID_HPP
+
+#include <cstdint>
+
+namespace eng {
+
+/* Key of assets in AssetPack's maps. */
+using AssetID = int32_t;
+
+} // namespace eng
+
+#endif
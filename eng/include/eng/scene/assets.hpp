@@ -1,7 +1,11 @@
 #ifndef ASSETS_HPP
 #define ASSETS_HPP
 
+#include "eng/renderer/geometry_pool.hpp"
 #include "eng/renderer/opengl.hpp"
+#include "eng/renderer/primitives.hpp"
+#include "eng/renderer/texture_arrays.hpp"
+#include "eng/scene/asset_id.hpp"
 #include <map>
 
 namespace eng {
@@ -9,21 +13,51 @@ namespace eng {
 struct MeshInstance {
     glm::mat4 transform;
     float entity_id = 0.0f;
+
+    /* Index into the renderer's materials buffer, the material's ID. */
+    float material_index = 0.0f;
 };
 
-using AssetID = int32_t;
+struct SimplifiedMesh;
 
 struct MeshAABB {
     glm::vec3 min;
     glm::vec3 max;
 };
 
+/* Coarser version of a mesh, used once the mesh covers less than
+ * SCREEN_SIZE of the viewport height. */
+struct MeshLod {
+    AssetID mesh_id = 0;
+    float screen_size = 0.0f;
+
+    /* Distance from the full detail surface, in mesh units. */
+    float error = 0.0f;
+};
+
 struct Mesh {
     std::string name;
-    VertexArray vao;
+    GeometryRange geometry;
     MeshAABB local_bb;
+
+    /* Levels past the full detail one, from finest to coarsest, with
+     * decreasing screen sizes. Used by entities with LodComp. */
+    std::vector<MeshLod> lods;
+
+    /* CPU side copy of the geometry for queries like ray picking. */
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
 };
 
+/* Uploads geometry into GEOMETRY, CPU side copies of positions and indices
+ * are kept. */
+[[nodiscard]] Mesh create_mesh(VertexData vertex_data, GeometryPool &geometry);
+
+/* Full vertices are read back from the GPU, needs a current OpenGL context
+ * and the mesh's CPU side indices. */
+[[nodiscard]] VertexData read_vertex_data(const Mesh &mesh,
+                                          const GeometryPool &geometry);
+
 struct Material {
     std::string name;
 
@@ -73,17 +107,36 @@ struct AssetPack {
     void destroy();
 
     [[nodiscard]] AssetID add_mesh(Mesh mesh);
+
+    /* Uploads LEVELS from simplify_lod_chain() as meshes of their own and
+     * makes them MESH_ID's LOD chain. Meshes of a previous chain get erased,
+     * their geometry freed. Levels switch in once their error, projected to
+     * the screen, gets below MAX_SCREEN_ERROR of the viewport height. */
+    void set_lod_chain(AssetID mesh_id,
+                       const std::vector<SimplifiedMesh> &levels,
+                       float max_screen_error = 0.002f);
     [[nodiscard]] AssetID add_texture(Texture &texture);
     [[nodiscard]] AssetID add_env_map(EnvMap &env_map);
     [[nodiscard]] AssetID add_material(Material &material);
     [[nodiscard]] AssetID add_shader(Shader &shader);
 
     std::string name;
+
+    /* Holds geometry of all the meshes. */
+    GeometryPool geometry;
     std::map<AssetID, Mesh> meshes;
     std::map<AssetID, Texture> textures;
     std::map<AssetID, EnvMap> env_maps;
     std::map<AssetID, Material> materials;
     std::map<AssetID, Shader> shaders;
+
+    /* Copies of TEXTURES, so materials can be drawn without binding them. */
+    TextureArrays texture_arrays;
+
+    /* Bumped on every asset added, removed or renamed, so copies taken off
+     * the pack know they're stale. Code editing the maps directly has to
+     * bump it too. */
+    uint64_t generation = 0;
 };
 
 } // namespace eng
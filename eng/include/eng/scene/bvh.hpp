@@ -0,0 +1,170 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "eng/containers/registry.hpp"
+#include "eng/scene/assets.hpp"
+#include <array>
+#include <span>
+
+namespace eng {
+
+struct Plane {
+    glm::vec3 normal;
+    float d;
+};
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 dir;
+};
+
+/* Left, right, bottom, top, near, far - normals pointing inwards. */
+using Frustum = std::array<Plane, 6>;
+
+[[nodiscard]] Frustum extract_frustum_planes(const glm::mat4 &mat);
+
+/* World space AABB of a transformed local one. */
+[[nodiscard]] MeshAABB transform_aabb(const MeshAABB &local,
+                                      const glm::mat4 &transform);
+
+[[nodiscard]] bool sphere_vs_frustum(const glm::vec3 &center, float radius,
+                                     const Frustum &frustum);
+
+[[nodiscard]] bool aabb_contains(const MeshAABB &outer, const MeshAABB &inner);
+[[nodiscard]] bool aabb_vs_frustum(const MeshAABB &bb, const Frustum &frustum);
+
+/* transform_aabb() and aabb_vs_frustum() for many boxes at once, 4 at a
+ * time with SSE where it's available - results are the same either way.
+ * OUT_VISIBLE gets 1 for boxes inside FRUSTUM, 0 for the rest. */
+void cull_aabbs(std::span<const glm::mat4> transforms,
+                std::span<const MeshAABB> local_bbs, const Frustum &frustum,
+                std::span<uint8_t> out_visible);
+[[nodiscard]] bool aabb_vs_sphere(const MeshAABB &bb, const glm::vec3 &center,
+                                  float radius);
+
+/* Cone is described by its apex, normalized direction, half angle (in
+ * radians) and range. Conservative - tests AABB's bounding sphere. */
+[[nodiscard]] bool aabb_vs_cone(const MeshAABB &bb, const glm::vec3 &apex,
+                                const glm::vec3 &dir, float half_angle,
+                                float range);
+
+/* Slab test. Returns distance along the ray to the entry point, or negative
+ * value if the ray misses the box within MAX_DIST. INV_DIR is 1 / dir. */
+[[nodiscard]] float aabb_vs_ray(const MeshAABB &bb, const glm::vec3 &origin,
+                                const glm::vec3 &inv_dir, float max_dist);
+
+/* Moller-Trumbore, two sided. Returns distance along the ray (in units of
+ * DIR's length) or negative value on miss. */
+[[nodiscard]] float ray_vs_triangle(const Ray &ray, const glm::vec3 &v0,
+                                    const glm::vec3 &v1, const glm::vec3 &v2);
+
+struct BVHNode {
+    /* Fattened for leaves, so small movements don't need reinsertion. */
+    MeshAABB bb;
+
+    /* Parent for nodes in use, next free node otherwise. */
+    int32_t parent = -1;
+    int32_t left = -1;
+    int32_t right = -1;
+
+    /* Leaf is 0, free node is -1. */
+    int32_t height = -1;
+
+    ecs::EntityID ent_id = 0;
+    AssetID mesh_id = 0;
+
+    [[nodiscard]] bool is_leaf() const { return left == -1; }
+};
+
+/* Dynamic AABB tree - leaves are inserted by a surface area heuristic and
+ * the tree is kept balanced with rotations on the way up, so queries stay
+ * logarithmic while objects get added, removed and moved every frame.
+ * Node indices (proxies) stay valid until removed. */
+struct DynamicBVH {
+    static constexpr int32_t NULL_NODE = -1;
+    static constexpr int32_t MAX_QUERY_DEPTH = 128;
+
+    [[nodiscard]] static DynamicBVH create(float fat_margin = 0.1f);
+    void destroy();
+
+    [[nodiscard]] int32_t insert(const MeshAABB &bb, ecs::EntityID ent_id,
+                                 AssetID mesh_id);
+    void remove(int32_t proxy);
+
+    /* Returns true if the proxy had to be reinserted - tight BB left the
+     * fattened one. */
+    bool move(int32_t proxy, const MeshAABB &bb);
+
+    void query_frustum(const Frustum &frustum,
+                       std::vector<int32_t> &out_proxies) const;
+    void query_sphere(const glm::vec3 &center, float radius,
+                      std::vector<int32_t> &out_proxies) const;
+    void query_cone(const glm::vec3 &apex, const glm::vec3 &dir,
+                    float half_angle, float range,
+                    std::vector<int32_t> &out_proxies) const;
+
+    /* Calls FN(proxy, entry_dist) for every leaf hit by the ray, nearest
+     * subtrees first. FN returns new max distance, which allows early outs
+     * when looking for closest hit. */
+    template <typename Fn>
+    void query_ray(const glm::vec3 &origin, const glm::vec3 &dir,
+                   float max_dist, Fn &&fn) const;
+
+    [[nodiscard]] int32_t height() const;
+    [[nodiscard]] int32_t leaves_count() const { return leaves; }
+
+    std::vector<BVHNode> nodes;
+    int32_t root = NULL_NODE;
+    int32_t free_list = NULL_NODE;
+    int32_t leaves = 0;
+
+    float margin = 0.1f;
+};
+
+template <typename Fn>
+void DynamicBVH::query_ray(const glm::vec3 &origin, const glm::vec3 &dir,
+                           float max_dist, Fn &&fn) const {
+    if (root == NULL_NODE)
+        return;
+
+    glm::vec3 inv_dir = 1.0f / dir;
+    if (aabb_vs_ray(nodes[root].bb, origin, inv_dir, max_dist) < 0.0f)
+        return;
+
+    std::array<int32_t, MAX_QUERY_DEPTH> stack;
+    int32_t top = 0;
+    stack[top++] = root;
+
+    while (top > 0) {
+        int32_t node_idx = stack[--top];
+        const BVHNode &node = nodes[node_idx];
+        if (node.is_leaf()) {
+            float dist = aabb_vs_ray(node.bb, origin, inv_dir, max_dist);
+            if (dist >= 0.0f)
+                max_dist = fn(node_idx, dist);
+
+            continue;
+        }
+
+        float dl = aabb_vs_ray(nodes[node.left].bb, origin, inv_dir, max_dist);
+        float dr =
+            aabb_vs_ray(nodes[node.right].bb, origin, inv_dir, max_dist);
+
+        assert(top + 2 <= MAX_QUERY_DEPTH && "BVH query stack overflow");
+
+        /* Push farther one first, so the nearer gets visited next. */
+        if (dl >= 0.0f && dr >= 0.0f) {
+            bool left_first = dl <= dr;
+            stack[top++] = left_first ? node.right : node.left;
+            stack[top++] = left_first ? node.left : node.right;
+        } else if (dl >= 0.0f) {
+            stack[top++] = node.left;
+        } else if (dr >= 0.0f) {
+            stack[top++] = node.right;
+        }
+    }
+}
+
+} // namespace eng
+
+#endif
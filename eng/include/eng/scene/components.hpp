@@ -20,6 +20,15 @@ struct Transform {
     glm::mat4 to_mat4() const;
 };
 
+/* Transform as of the previous simulation tick. Entities having it get
+ * their global transform interpolated between the two ticks, see
+ * Scene::update_global_transforms(). */
+struct PreviousTransform {
+    glm::vec3 position{0.0f, 0.0f, 0.0f};
+    glm::vec3 rotation{0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f, 1.0f, 1.0f};
+};
+
 struct GlobalTransform {
     glm::vec3 position{0.0f, 0.0f, 0.0f};
     glm::vec3 rotation{0.0f, 0.0f, 0.0f};
@@ -32,6 +41,20 @@ struct MeshComp {
     AssetID id = 1;
 };
 
+/* Picks a level of the mesh's LOD chain every frame, see
+ * renderer::select_lods(). */
+struct LodComp {
+    /* Scales projected size, lower values switch to coarser levels sooner. */
+    float bias = 1.0f;
+
+    /* Selection state, level 0 being the MeshComp's mesh. Color and shadow
+     * passes select separately. */
+    int32_t level = 0;
+    int32_t shadow_level = 0;
+    AssetID mesh_id = 0;
+    AssetID shadow_mesh_id = 0;
+};
+
 struct MaterialComp {
     AssetID id = 1;
 };
@@ -56,6 +79,10 @@ struct SpotLight {
     float edge_smoothness = 0.0f;
 };
 
+/* Mesh that never moves. Such meshes get baked into static batches (see
+ * StaticBatches) and skip per-instance submission. */
+struct Static {};
+
 } // namespace eng
 
 #endif
@@ -6,14 +6,28 @@
 
 namespace eng {
 
+/* Components deciding whether and how an entity's mesh gets drawn. */
+template <typename T>
+constexpr bool DRAWS_MESH =
+    std::is_same_v<T, MeshComp> || std::is_same_v<T, MaterialComp> ||
+    std::is_same_v<T, Static> || std::is_same_v<T, LodComp> ||
+    std::is_same_v<T, PointLight> || std::is_same_v<T, DirLight> ||
+    std::is_same_v<T, SpotLight>;
+
 struct Entity {
     template <typename T>
     T &add_component() {
+        if constexpr (DRAWS_MESH<T>)
+            mesh_changed();
+
         return owning_reg->add_component<T>(handle);
     }
 
     template <typename T>
     void remove_component() {
+        if constexpr (DRAWS_MESH<T>)
+            mesh_changed();
+
         owning_reg->remove_component<T>(handle);
     }
 
@@ -42,9 +56,21 @@ struct Entity {
         return owning_reg->has_component<T>(handle);
     }
 
+    /* Records a change of MeshComp, or of components in DRAWS_MESH, for
+     * owning scene's spatial index and GPU scenes following it. Adding and
+     * removing them does it already, call it after swapping the mesh or
+     * material in place, or changing LOD bias. */
+    void mesh_changed() {
+        if (mesh_changed_ids != nullptr)
+            mesh_changed_ids->push_back(handle);
+    }
+
     ecs::EntityID handle;
     ecs::Registry *owning_reg = nullptr;
 
+    /* Owning scene's Scene::mesh_changed_ids, null outside of a scene. */
+    std::vector<ecs::EntityID> *mesh_changed_ids = nullptr;
+
     std::optional<ecs::EntityID> parent_id = std::nullopt;
     std::vector<ecs::EntityID> children_ids;
 };
@@ -0,0 +1,38 @@
+#ifndef PREFAB_HPP
+#define PREFAB_HPP
+
+#include "eng/scene/scene.hpp"
+#include <string>
+
+namespace eng {
+
+struct PrefabNode {
+    /* Index of the parent node, -1 for the root. */
+    int32_t parent = -1;
+
+    /* Entity inside prefab's own registry. */
+    ecs::EntityID ent_id = 0;
+};
+
+/* Subtree captured in its own registry, so its components sit in compact
+ * columns per archetype. Scene::instantiate() stamps out copies of it with
+ * one column append per archetype. */
+struct Prefab {
+    /* Copies subtree of ROOT_ID, later changes to the scene don't affect
+     * the prefab. */
+    [[nodiscard]] static Prefab create(Scene &scene, ecs::EntityID root_id);
+
+    void destroy();
+
+    std::string name;
+
+    /* Depth-first order, parents come before their children and siblings
+     * keep their order. Root is the first one. */
+    std::vector<PrefabNode> nodes;
+
+    ecs::Registry registry;
+};
+
+} // namespace eng
+
+#endif
@@ -1,11 +1,21 @@
 #ifndef SCENE_HPP
 #define SCENE_HPP
 
+#include "eng/scene/bvh.hpp"
 #include "eng/scene/entity.hpp"
+#include <cfloat>
 #include <string>
 
 namespace eng {
 
+struct Prefab;
+
+struct RayHit {
+    ecs::EntityID ent_id;
+    glm::vec3 point;
+    float distance;
+};
+
 struct Scene {
     [[nodiscard]] static Scene create(const std::string &name);
 
@@ -16,30 +26,86 @@ struct Scene {
 
     void destroy_entity(ecs::EntityID ent_id);
 
+    /* Moves every entity of STAGING into this scene, in bulk - see
+     * Registry::merge(). Staging roots are appended as roots here. Returns
+     * staging -> live entity ID table. STAGING ends up destroyed. */
+    [[nodiscard]] std::vector<ecs::EntityID> merge(Scene &&staging);
+
+    /* Spawns COUNT copies of the prefab as new roots. Root of the I-th copy
+     * gets TRANSFORMS[I], or prefab's own transform if TRANSFORMS is null.
+     * Returns root IDs of the copies. */
+    std::vector<ecs::EntityID> instantiate(Prefab &prefab, uint32_t count,
+                                           const Transform *transforms =
+                                               nullptr);
+
     void link_relation(Entity parent, Entity child);
 
     bool is_ascendant_of(Entity &child, Entity &ascendant);
     bool is_descendant_of(Entity &parent, Entity &descendant);
 
-    void update_global_transforms();
+    /* ALPHA in [0, 1] blends local transforms of entities with
+     * PreviousTransform, from previous (0) to current (1) tick state. Others
+     * always use their current transform. */
+    void update_global_transforms(float alpha = 1.0f);
+
+    /* Snapshots Transform into PreviousTransform. Call at the start of every
+     * simulation tick, before anything moves. */
+    void store_previous_transforms();
+
+    /* Keeps spatial index in sync with world bounds of entities with a mesh.
+     * Only entities in moved_ids and mesh_changed_ids are touched, cost
+     * doesn't depend on scene size. Call after update_global_transforms(). */
+    void update_spatial_index(const AssetPack &asset_pack);
+
+    /* Closest mesh hit by the ray - bounds from spatial index narrow down
+     * candidates, then their triangles are tested exactly. */
+    [[nodiscard]] std::optional<RayHit>
+    raycast(const Ray &ray, const AssetPack &asset_pack,
+            float max_dist = FLT_MAX);
+
+    /* Returns entity record for given ID. Reference stays valid until next
+     * spawn (vector might grow), hierarchy edits don't move records. */
+    [[nodiscard]] Entity &entity(ecs::EntityID ent_id);
+    [[nodiscard]] bool contains(ecs::EntityID ent_id) const;
+
+    /* Depth-first traversal order of entity slots, rebuilt lazily after
+     * hierarchy changes. Parents always come before their children. */
+    [[nodiscard]] const std::vector<int32_t> &hierarchy_order();
 
     std::string name;
     ecs::Registry registry;
 
-    /* Entities are sorted in a hierarchical order - in other words,
-     * they are ordered in a way that we would encounter them if they were
-     * stored in a tree and we traversed it by depth.
-     * The reason to make it a vector instead of a tree is to optimize the most
-     * common use case: iterating over all of them (for UI rendering and
-     * updating global transforms). That way we iterate in hierarchical order
-     * and we get cache benefits. The price for that is more expensive
-     * hierarchy-changing operations (like changing parent), but it's not done
-     * every frame. */
+    /* Entities live in stable slots - spawning reuses free slots and
+     * destroying or reparenting never moves other entities around, so their
+     * indices stay valid. Free slots have null owning_reg.
+     * Hierarchical (depth-first) order is kept separately and rebuilt only
+     * when needed, see hierarchy_order(). */
     std::vector<Entity> entities;
+    std::vector<int32_t> free_slots;
+
+    /* Flat EntityID -> slot lookup, -1 for IDs not present in this scene. */
+    std::vector<int32_t> id_to_index;
+
+    /* Top-level entities, in outliner order. */
+    std::vector<ecs::EntityID> root_ids;
+
+    std::vector<int32_t> traversal_order;
+    bool hierarchy_dirty = false;
+
+    /* World space bounds of all meshes. Leaves store entity and mesh IDs. */
+    DynamicBVH spatial_index;
+
+    /* Flat EntityID -> BVH proxy, -1 for entities without a mesh. */
+    std::vector<int32_t> id_to_proxy;
+
+    /* Entities whose global transform changed since last index update. */
+    std::vector<ecs::EntityID> moved_ids;
 
-    /* For fast entity access. Be aware that changing the hierarchy might
-     * change indices, so you might need to fetch it again. */
-    std::map<ecs::EntityID, int32_t> id_to_index;
+    /* Entities that got, lost or swapped their MeshComp - or components
+     * deciding how it's drawn - since last index update, see
+     * Entity::mesh_changed(). Might hold duplicates and IDs of entities
+     * destroyed since, destroying ones with a mesh records them too. */
+    std::vector<ecs::EntityID> mesh_changed_ids;
 };
 
 } // namespace eng
@@ -0,0 +1,111 @@
+#ifndef SCENE_FILE_HPP
+#define SCENE_FILE_HPP
+
+#include "eng/scene/scene.hpp"
+#include <string>
+
+namespace eng {
+
+/* Binary .scene layout. Everything is stored the way it sits in memory, so
+ * loading maps the file and copies whole sections into registry columns,
+ * the only per-entity work being names, hierarchy links and asset ID fixups.
+ *
+ * File is a header followed by sections, each 16 byte aligned:
+ *  - NAMES - UTF-8 blob, scene and entity names, not null terminated.
+ *  - ENTITIES - SceneFileEntity for each entity.
+ *  - ORDER - uint32_t file indices of entities, in depth-first hierarchy
+ *    order. Parents come before children, siblings keep their order.
+ *  - ASSETS - SceneFileAssetRef table. MeshComp and MaterialComp columns
+ *    store indices into it instead of AssetIDs, which differ between runs.
+ *  - GROUPS - SceneFileGroup for each distinct component set. Entities are
+ *    sorted by group, each group stores its columns back to back: Transform,
+ *    GlobalTransform and then components from SceneFileComponent in order
+ *    of their bits. */
+
+static constexpr char SCENE_FILE_MAGIC[4] = {'D', 'S', 'C', 'N'};
+/* 1 - initial layout. 2 - Static and LodComp columns. Older versions load
+ * as long as their groups only use components they knew about. */
+static constexpr uint32_t SCENE_FILE_VERSION = 2;
+static constexpr uint32_t SCENE_FILE_MIN_VERSION = 1;
+static constexpr uint32_t SCENE_FILE_NO_PARENT = UINT32_MAX;
+
+enum SceneFileComponent : uint32_t {
+    SCENE_FILE_MESH = 1 << 0,
+    SCENE_FILE_MATERIAL = 1 << 1,
+    SCENE_FILE_POINT_LIGHT = 1 << 2,
+    SCENE_FILE_DIR_LIGHT = 1 << 3,
+    SCENE_FILE_SPOT_LIGHT = 1 << 4,
+    SCENE_FILE_STATIC = 1 << 5,
+    SCENE_FILE_LOD = 1 << 6
+};
+
+struct SceneFileSection {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct SceneFileHeader {
+    char magic[4];
+    uint32_t version = SCENE_FILE_VERSION;
+
+    uint32_t entities_count = 0;
+    uint32_t groups_count = 0;
+    uint32_t assets_count = 0;
+
+    uint32_t name_offset = 0;
+    uint32_t name_size = 0;
+    uint32_t padding = 0;
+
+    SceneFileSection names;
+    SceneFileSection entities;
+    SceneFileSection order;
+    SceneFileSection assets;
+    SceneFileSection groups;
+};
+
+struct SceneFileEntity {
+    uint32_t parent = SCENE_FILE_NO_PARENT;
+    uint32_t name_offset = 0;
+    uint32_t name_size = 0;
+    uint32_t group = 0;
+};
+
+enum class SceneFileAssetType : uint32_t { MESH, MATERIAL };
+
+struct SceneFileAssetRef {
+    SceneFileAssetType type;
+
+    /* ID at the time of saving, used if no asset matches the name. */
+    AssetID id = 0;
+
+    uint32_t name_offset = 0;
+    uint32_t name_size = 0;
+};
+
+struct SceneFileGroup {
+    uint32_t components = 0;
+    uint32_t first_entity = 0;
+    uint32_t entities_count = 0;
+    uint32_t padding = 0;
+
+    SceneFileSection columns;
+};
+
+/* Returns false if the file couldn't be written. */
+bool save_scene(Scene &scene, const AssetPack &asset_pack,
+                const std::string &path);
+
+/* Saves only subtrees of given entities, they become roots in the file. */
+bool save_subtrees(Scene &scene, const AssetPack &asset_pack,
+                   const std::vector<ecs::EntityID> &root_ids,
+                   const std::string &path);
+
+/* Loads into a freshly created, empty SCENE. Assets are matched by name
+ * within ASSET_PACK. Returns false, leaving SCENE empty, if the file
+ * couldn't be mapped or isn't a valid scene file of supported version. */
+[[nodiscard]] bool load_scene(Scene &scene, const AssetPack &asset_pack,
+                              const std::string &path);
+
+} // namespace eng
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+
+#include "eng/scene/scene.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace eng {
+
+/* World is split into square cells on the XZ plane. Every root entity goes
+ * into the cell containing its global position, with its whole subtree.
+ * Each cell is a separate scene file named cell_<x>_<z>.scene in DIR.
+ * Cell files left from previous exports are removed. */
+bool save_scene_cells(Scene &scene, const AssetPack &asset_pack,
+                      const std::string &dir, float cell_size);
+
+struct CellStreamingSpec {
+    std::string dir;
+    float cell_size = 32.0f;
+
+    /* Cells closer than LOAD_RADIUS get loaded, farther than UNLOAD_RADIUS
+     * get evicted. The gap between them stops cells at the border from
+     * reloading over and over. */
+    float load_radius = 64.0f;
+    float unload_radius = 96.0f;
+
+    /* Upper bound on cells held in memory, loading ones included. */
+    int32_t max_resident_cells = 64;
+
+    /* Caps work done in one update(), keeps frame time flat. */
+    int32_t max_merges_per_update = 1;
+    int32_t max_evictions_per_update = 2;
+
+    int32_t workers_count = 2;
+};
+
+enum class CellState { LOADING, CANCELLED, RESIDENT };
+
+struct StreamedCell {
+    glm::ivec2 coords;
+    CellState state = CellState::LOADING;
+
+    /* Roots in the live scene, for eviction. */
+    std::vector<ecs::EntityID> root_ids;
+};
+
+struct CellRequest {
+    glm::ivec2 coords;
+    std::string path;
+
+    /* Asset names snapshot - workers can't touch the live asset pack. */
+    std::shared_ptr<const AssetPack> assets;
+};
+
+struct LoadedCell {
+    glm::ivec2 coords;
+
+    /* Snapshot the cell's asset IDs were resolved against. */
+    std::shared_ptr<const AssetPack> assets;
+
+    /* Null if the load failed. Heap allocated, since entities point to the
+     * registry and the scene can't move. */
+    std::unique_ptr<Scene> staging;
+};
+
+/* Shared between the streamer and its worker threads. */
+struct CellLoader {
+    std::mutex mutex;
+    std::condition_variable has_requests;
+
+    std::deque<CellRequest> requests;
+    std::vector<LoadedCell> loaded;
+    std::vector<std::thread> workers;
+
+    bool quit = false;
+};
+
+/* Streams cells saved with save_scene_cells() around a focus point. Files
+ * are loaded into staging scenes on worker threads, then merged into the
+ * live scene in update(), which should be called at frame boundary. */
+struct CellStreamer {
+    [[nodiscard]] static CellStreamer create(const CellStreamingSpec &spec);
+
+    /* Waits for workers. Streamed entities stay in the scene, use
+     * evict_all() to get rid of them. */
+    void destroy();
+
+    void update(Scene &scene, const AssetPack &asset_pack,
+                const glm::vec3 &focus);
+
+    void evict_all(Scene &scene);
+
+    [[nodiscard]] int32_t resident_count() const;
+    [[nodiscard]] bool has_pending() const;
+
+    CellStreamingSpec spec;
+
+    /* Cells found in the directory, keyed by cell_key(). */
+    std::unordered_map<uint64_t, glm::ivec2> available_cells;
+    std::unordered_map<uint64_t, StreamedCell> cells;
+
+    std::shared_ptr<const AssetPack> assets_snapshot;
+    std::unique_ptr<CellLoader> loader;
+};
+
+[[nodiscard]] uint64_t cell_key(const glm::ivec2 &coords);
+[[nodiscard]] glm::ivec2 cell_coords(const glm::vec3 &position,
+                                     float cell_size);
+
+} // namespace eng
+
+#endif
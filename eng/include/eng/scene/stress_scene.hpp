@@ -0,0 +1,48 @@
+#ifndef STRESS_SCENE_HPP
+#define STRESS_SCENE_HPP
+
+#include "eng/scene/scene.hpp"
+
+namespace eng {
+
+/* Procedural scene for benchmarks, built the same way for the same spec. */
+struct StressSceneSpec {
+    /* Entities with a mesh, lights come on top of that. */
+    uint32_t entities_count = 10000;
+
+    /* Meshes are grouped into trees of given depth, 1 means roots only.
+     * Every node has CHILDREN_PER_NODE children, offset from the parent,
+     * so transforms propagate through all the levels. */
+    int32_t hierarchy_depth = 3;
+    int32_t children_per_node = 2;
+
+    /* First MESHES_COUNT meshes of the pack are used, MATERIALS_COUNT
+     * materials with different colors get added to the pack. */
+    int32_t meshes_count = 3;
+    int32_t materials_count = 16;
+
+    /* Fraction of trees marked Static, whole trees at once. */
+    float static_ratio = 0.0f;
+
+    /* Gives every mesh entity LodComp. */
+    bool lods = false;
+
+    int32_t point_lights_count = 64;
+    int32_t spot_lights_count = 16;
+    int32_t dir_lights_count = 1;
+
+    /* Trees and lights are scattered over a square of this size on the XZ
+     * plane, centered at the origin. */
+    float extent = 256.0f;
+
+    uint32_t seed = 1;
+};
+
+/* Returns IDs of the tree roots, lights not included. */
+std::vector<ecs::EntityID> generate_stress_scene(Scene &scene,
+                                                 AssetPack &asset_pack,
+                                                 const StressSceneSpec &spec);
+
+} // namespace eng
+
+#endif
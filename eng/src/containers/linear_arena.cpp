@@ -0,0 +1,90 @@
+#include "eng/containers/linear_arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+namespace eng::cont {
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+LinearArena LinearArena::create(size_t capacity) {
+    assert(capacity > 0 && "Empty arena");
+
+    LinearArena arena;
+    arena.memory = (uint8_t *)std::malloc(capacity);
+    arena.capacity = capacity;
+    assert(arena.memory && "Out of memory");
+
+    return arena;
+}
+
+void LinearArena::destroy() {
+    for (void *block : overflow_blocks)
+        std::free(block);
+
+    std::free(memory);
+
+    memory = nullptr;
+    capacity = 0;
+    offset = 0;
+    overflow_bytes = 0;
+    peak = 0;
+    overflow_blocks = std::vector<void *>();
+}
+
+void *LinearArena::allocate(size_t size, size_t alignment) {
+    assert((alignment & (alignment - 1)) == 0 && "Alignment not a power of 2");
+
+    /*  Aligning the address, not the offset - malloc only guarantees
+        max_align_t. */
+    uintptr_t base = (uintptr_t)memory;
+    size_t aligned = align_up(base + offset, alignment) - base;
+    if (memory && aligned + size <= capacity) {
+        offset = aligned + size;
+        return memory + aligned;
+    }
+
+    void *block = std::aligned_alloc(alignment, align_up(size, alignment));
+    assert(block && "Out of memory");
+
+    overflow_blocks.push_back(block);
+    overflow_bytes += size;
+    return block;
+}
+
+void LinearArena::reset() {
+    peak = std::max(peak, used());
+
+    if (!overflow_blocks.empty()) {
+        for (void *block : overflow_blocks)
+            std::free(block);
+
+        overflow_blocks.clear();
+
+        /*  Some headroom, alignment padding adds up. */
+        capacity = std::max(capacity * 2, peak + peak / 4);
+        std::free(memory);
+        memory = (uint8_t *)std::malloc(capacity);
+        assert(memory && "Out of memory");
+    }
+
+    offset = 0;
+    overflow_bytes = 0;
+}
+
+size_t LinearArena::used() const { return offset + overflow_bytes; }
+
+void *ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+    return arena->allocate(bytes, alignment);
+}
+
+void ArenaResource::do_deallocate(void *ptr, size_t bytes, size_t alignment) {}
+
+bool ArenaResource::do_is_equal(
+    const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
+
+} // namespace eng::cont
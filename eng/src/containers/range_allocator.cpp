@@ -0,0 +1,82 @@
+#include "eng/containers/range_allocator.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace eng::cont {
+
+RangeAllocator RangeAllocator::create(uint32_t capacity) {
+    RangeAllocator allocator;
+    allocator.grow(capacity);
+
+    return allocator;
+}
+
+std::optional<uint32_t> RangeAllocator::allocate(uint32_t count) {
+    if (count == 0)
+        return 0;
+
+    for (size_t i = 0; i < free_ranges.size(); i++) {
+        Range &range = free_ranges[i];
+        if (range.count < count)
+            continue;
+
+        uint32_t offset = range.offset;
+        range.offset += count;
+        range.count -= count;
+        if (range.count == 0)
+            free_ranges.erase(free_ranges.begin() + i);
+
+        used += count;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t count) {
+    if (count == 0)
+        return;
+
+    assert(offset + count <= capacity && "Range out of bounds");
+    assert(used >= count && "Freeing more than was allocated");
+
+    auto next = std::lower_bound(
+        free_ranges.begin(), free_ranges.end(), offset,
+        [](const Range &range, uint32_t value) { return range.offset < value; });
+    assert((next == free_ranges.end() || offset + count <= next->offset) &&
+           "Freeing a free range");
+
+    used -= count;
+
+    bool merges_prev = next != free_ranges.begin() &&
+                       std::prev(next)->offset + std::prev(next)->count ==
+                           offset;
+    bool merges_next = next != free_ranges.end() &&
+                       offset + count == next->offset;
+
+    if (merges_prev && merges_next) {
+        std::prev(next)->count += count + next->count;
+        free_ranges.erase(next);
+    } else if (merges_prev) {
+        std::prev(next)->count += count;
+    } else if (merges_next) {
+        next->offset = offset;
+        next->count += count;
+    } else {
+        free_ranges.insert(next, {offset, count});
+    }
+}
+
+void RangeAllocator::grow(uint32_t new_capacity) {
+    assert(new_capacity >= capacity && "Ranges can't shrink");
+
+    uint32_t added = new_capacity - capacity;
+    uint32_t old_capacity = capacity;
+    capacity = new_capacity;
+
+    /*  Counted as used for a moment, free() takes it back. */
+    used += added;
+    free(old_capacity, added);
+}
+
+} // namespace eng::cont
@@ -68,6 +68,169 @@ EntityID Registry::duplicate(EntityID entity_id) {
     return id;
 }
 
+EntityID Registry::create_entities(Archetype &atype, size_t count) {
+    EntitySet &eset = arch_entity_index[atype.id];
+    size_t first_row = eset.size();
+
+    for (cont::GenericVectorWrapper *cont : atype.components)
+        cont->resize(first_row + count);
+
+    EntityID first_id = entity_id_counter;
+    entity_index.reserve(entity_index.size() + count);
+    eset.reserve(first_row + count);
+    for (size_t i = 0; i < count; i++) {
+        EntityID id = entity_id_counter++;
+        EntityRecord record;
+        record.archetype = &atype;
+        record.row = first_row + i;
+
+        entity_index.insert(std::make_pair(id, record));
+        eset.push_back(id);
+    }
+
+    return first_id;
+}
+
+Archetype &Registry::matching_archetype(const Archetype &source) {
+    auto atype_itr = archetype_index.find(source.type);
+    if (atype_itr != archetype_index.end())
+        return atype_itr->second;
+
+    /*  Columns of SOURCE are already sorted by type, same as the type
+        vector, so clones keep the same column indices. */
+    Archetype new_archetype;
+    new_archetype.id = arch_id_counter++;
+    new_archetype.type = source.type;
+    new_archetype.column_index = source.column_index;
+    for (cont::GenericVectorWrapper *cont : source.components)
+        new_archetype.components.push_back(cont->clone_empty());
+
+    archetype_index.insert(std::make_pair(source.type, new_archetype));
+    Archetype *inserted_atype = &archetype_index.at(source.type);
+
+    for (auto &[hash, column] : inserted_atype->column_index) {
+        ArchetypeRecord new_arecord;
+        new_arecord.atype = inserted_atype;
+        new_arecord.column = column;
+
+        component_index[hash].insert(
+            std::make_pair(inserted_atype->id, new_arecord));
+    }
+
+    return *inserted_atype;
+}
+
+std::vector<EntityID> Registry::merge(Registry &&staging) {
+    std::vector<EntityID> id_map(staging.entity_id_counter, 0);
+
+    for (auto &[type, src_atype] : staging.archetype_index) {
+        EntitySet &src_eset = staging.arch_entity_index[src_atype.id];
+        if (src_eset.empty())
+            continue;
+
+        Archetype &dst_atype = matching_archetype(src_atype);
+        EntitySet &dst_eset = arch_entity_index[dst_atype.id];
+        size_t first_row = dst_eset.size();
+
+        for (auto &[hash, index] : src_atype.column_index) {
+            size_t dst_idx = dst_atype.column_index.at(hash);
+            dst_atype.components[dst_idx]->append(src_atype.components[index]);
+        }
+
+        /*  Entity sets follow row order, keep it that way. Rows mean
+            nothing without columns though (empty type). */
+        dst_eset.resize(first_row + src_eset.size());
+        for (size_t i = 0; i < src_eset.size(); i++) {
+            EntityID src_id = src_eset[i];
+            size_t row = src_atype.components.empty()
+                             ? first_row + i
+                             : first_row + staging.entity_index.at(src_id).row;
+
+            EntityID id = entity_id_counter++;
+            EntityRecord record;
+            record.archetype = &dst_atype;
+            record.row = row;
+
+            entity_index.insert(std::make_pair(id, record));
+            dst_eset[row] = id;
+            id_map[src_id] = id;
+        }
+    }
+
+    staging.destroy();
+    return id_map;
+}
+
+EntityID Registry::copy_from(Registry &source, EntityID entity_id) {
+    auto src_itr = source.entity_index.find(entity_id);
+    assert(src_itr != source.entity_index.end() &&
+           "Trying to copy non-registered entity");
+
+    auto &[src_atype, src_row] = src_itr->second;
+    Archetype &dst_atype = matching_archetype(*src_atype);
+
+    EntityID id = entity_id_counter++;
+    EntityRecord record;
+    record.archetype = &dst_atype;
+    record.row = arch_entity_index[dst_atype.id].size();
+
+    for (auto &[hash, index] : src_atype->column_index) {
+        cont::GenericVectorWrapper *dst_cont =
+            dst_atype.components[dst_atype.column_index.at(hash)];
+        record.row = src_atype->components[index]->copy_element(dst_cont,
+                                                                src_row);
+    }
+
+    entity_index.insert(std::make_pair(id, record));
+    arch_entity_index[dst_atype.id].push_back(id);
+
+    return id;
+}
+
+std::vector<EntityID> Registry::instantiate(Registry &source, size_t count) {
+    size_t stride = source.entity_id_counter;
+    std::vector<EntityID> id_map(stride * count, 0);
+
+    for (auto &[type, src_atype] : source.archetype_index) {
+        EntitySet &src_eset = source.arch_entity_index[src_atype.id];
+        if (src_eset.empty())
+            continue;
+
+        Archetype &dst_atype = matching_archetype(src_atype);
+        EntitySet &dst_eset = arch_entity_index[dst_atype.id];
+        size_t first_row = dst_eset.size();
+        size_t rows = src_eset.size();
+
+        for (auto &[hash, index] : src_atype.column_index) {
+            size_t dst_idx = dst_atype.column_index.at(hash);
+            dst_atype.components[dst_idx]->append_copies(
+                src_atype.components[index], count);
+        }
+
+        dst_eset.resize(first_row + rows * count);
+        for (size_t copy = 0; copy < count; copy++) {
+            for (size_t i = 0; i < rows; i++) {
+                EntityID src_id = src_eset[i];
+                size_t src_row = src_atype.components.empty()
+                                     ? i
+                                     : source.entity_index.at(src_id).row;
+                size_t row = first_row + copy * rows + src_row;
+
+                EntityID id = entity_id_counter++;
+                EntityRecord record;
+                record.archetype = &dst_atype;
+                record.row = row;
+
+                entity_index.insert(std::make_pair(id, record));
+                dst_eset[row] = id;
+                id_map[copy * stride + src_id] = id;
+            }
+        }
+    }
+
+    return id_map;
+}
+
 void Registry::destroy_entity(EntityID entity_id) {
     auto ent_itr = entity_index.find(entity_id);
     assert(ent_itr != entity_index.end() &&
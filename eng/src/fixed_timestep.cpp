@@ -0,0 +1,50 @@
+#include "eng/fixed_timestep.hpp"
+#include <cassert>
+#include <cmath>
+
+FixedTimestep FixedTimestep::create(uint32_t tickrate,
+                                    int32_t max_ticks_per_frame) {
+    assert(tickrate > 0 && "Tickrate has to be positive");
+    assert(max_ticks_per_frame > 0 && "At least one tick per frame needed");
+
+    FixedTimestep timestep;
+    timestep.tickrate = tickrate;
+    timestep.max_ticks_per_frame = max_ticks_per_frame;
+
+    return timestep;
+}
+
+int32_t FixedTimestep::advance(float frame_time) {
+    accumulator += frame_time > 0.0f ? frame_time : 0.0f;
+
+    double duration = 1.0 / tickrate;
+    int32_t ticks = 0;
+    while (accumulator >= duration && ticks < max_ticks_per_frame) {
+        accumulator -= duration;
+        ticks++;
+    }
+
+    if (accumulator >= duration) {
+        uint64_t backlog = (uint64_t)(accumulator / duration);
+        dropped_ticks += backlog;
+        accumulator -= backlog * duration;
+    }
+
+    total_ticks += ticks;
+    return ticks;
+}
+
+void FixedTimestep::set_tickrate(uint32_t new_tickrate) {
+    assert(new_tickrate > 0 && "Tickrate has to be positive");
+
+    accumulator = accumulator * tickrate / new_tickrate;
+    tickrate = new_tickrate;
+}
+
+float FixedTimestep::tick_duration() const { return 1.0f / tickrate; }
+
+float FixedTimestep::alpha() const {
+    /* Accumulator is below a tick, but might round up to it. */
+    float result = (float)(accumulator * tickrate);
+    return result < 1.0f ? result : std::nextafter(1.0f, 0.0f);
+}
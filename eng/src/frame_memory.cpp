@@ -0,0 +1,78 @@
+#include "eng/frame_memory.hpp"
+#include "eng/containers/linear_arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace eng::frame_memory {
+
+struct FrameMemory {
+    cont::LinearArena arenas[2];
+    cont::ArenaResource resources[2];
+    int32_t current = 0;
+
+    std::thread::id owner;
+    bool initialized = false;
+};
+
+static FrameMemory s_frame;
+
+void init(size_t capacity) {
+    assert(!s_frame.initialized && "Frame memory already initialized");
+
+    for (int32_t i = 0; i < 2; i++) {
+        s_frame.arenas[i] = cont::LinearArena::create(capacity);
+        s_frame.resources[i].arena = &s_frame.arenas[i];
+    }
+
+    s_frame.current = 0;
+    s_frame.owner = std::this_thread::get_id();
+    s_frame.initialized = true;
+}
+
+void shutdown() {
+    if (!s_frame.initialized)
+        return;
+
+    for (cont::LinearArena &arena : s_frame.arenas)
+        arena.destroy();
+
+    s_frame.initialized = false;
+}
+
+void next_frame() {
+    if (!s_frame.initialized)
+        return;
+
+    assert(std::this_thread::get_id() == s_frame.owner &&
+           "Frame memory used outside of the main thread");
+
+    s_frame.current = 1 - s_frame.current;
+    s_frame.arenas[s_frame.current].reset();
+}
+
+std::pmr::memory_resource *resource() {
+    if (!s_frame.initialized)
+        return std::pmr::get_default_resource();
+
+    assert(std::this_thread::get_id() == s_frame.owner &&
+           "Frame memory used outside of the main thread");
+
+    return &s_frame.resources[s_frame.current];
+}
+
+bool is_frame_resource(const std::pmr::memory_resource *memory) {
+    return memory == &s_frame.resources[0] || memory == &s_frame.resources[1];
+}
+
+FrameMemoryStats stats() {
+    if (!s_frame.initialized)
+        return {};
+
+    const cont::LinearArena &arena = s_frame.arenas[s_frame.current];
+    return {.used = arena.used(),
+            .capacity = arena.capacity,
+            .peak = std::max(s_frame.arenas[0].peak, s_frame.arenas[1].peak)};
+}
+
+} // namespace eng::frame_memory
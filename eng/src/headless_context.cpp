@@ -0,0 +1,89 @@
+#include "eng/headless_context.hpp"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cassert>
+#include <cstdio>
+
+namespace eng {
+
+/* Surfaceless platform (Mesa) needs neither a display nor a GPU, falls
+ * back to the default display, which is a device one with NVIDIA. */
+static EGLDisplay headless_display() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+
+    if (get_platform_display != nullptr) {
+        EGLDisplay display = get_platform_display(
+            EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, 0, 0))
+            return display;
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, 0, 0))
+        return display;
+
+    return EGL_NO_DISPLAY;
+}
+
+std::optional<HeadlessContext> HeadlessContext::create() {
+    EGLDisplay display = headless_display();
+    if (display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "No EGL display for headless context\r\n");
+        return std::nullopt;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL display doesn't support OpenGL\r\n");
+        eglTerminate(display);
+        return std::nullopt;
+    }
+
+    /* Same version as windows get. */
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      4,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      5,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+
+    /* Nothing gets presented, so there's no need for a config. */
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR,
+                                          EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "Failed to create headless OpenGL context: 0x%x\r\n",
+                eglGetError());
+
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+
+        eglTerminate(display);
+        return std::nullopt;
+    }
+
+    HeadlessContext headless;
+    headless.display = display;
+    headless.context = context;
+
+    return headless;
+}
+
+void *HeadlessContext::get_proc_address(const char *name) {
+    return (void *)eglGetProcAddress(name);
+}
+
+void HeadlessContext::destroy() {
+    assert(context != nullptr && "Trying to destroy invalid context");
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+
+    display = nullptr;
+    context = nullptr;
+}
+
+} // namespace eng
@@ -0,0 +1,340 @@
+#include "eng/jobs.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace eng::jobs {
+
+/* Ring buffer - unlike std::deque it stops allocating once it's grown to
+ * the most jobs it ever held. */
+struct WorkQueue {
+    void push_back(QueuedJob &&job);
+    [[nodiscard]] QueuedJob pop_back();
+    [[nodiscard]] QueuedJob pop_front();
+
+    std::mutex mutex;
+    std::vector<QueuedJob> ring;
+    int32_t head = 0;
+    int32_t size = 0;
+};
+
+struct JobSystem {
+    /* One per thread, main thread's first. */
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    /* Jobs sitting in any of the queues. Idle workers sleep while zero. */
+    std::atomic<int32_t> queued = 0;
+    std::atomic<bool> quit = false;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    /* Spreads jobs coming from threads outside the system. */
+    std::atomic<uint32_t> outside_cursor = 0;
+};
+
+static JobSystem s_jobs;
+static thread_local int32_t t_queue_idx = -1;
+
+bool Counter::done() const { return pending.load() == 0; }
+
+void WorkQueue::push_back(QueuedJob &&job) {
+    int32_t capacity = ring.size();
+    if (size == capacity) {
+        std::vector<QueuedJob> grown(std::max(capacity * 2, 64));
+        for (int32_t i = 0; i < size; i++)
+            grown[i] = std::move(ring[(head + i) % capacity]);
+
+        ring.swap(grown);
+        head = 0;
+        capacity = ring.size();
+    }
+
+    ring[(head + size) % capacity] = std::move(job);
+    size++;
+}
+
+QueuedJob WorkQueue::pop_back() {
+    assert(size > 0 && "Popping from an empty queue");
+
+    size--;
+    return std::move(ring[(head + size) % ring.size()]);
+}
+
+QueuedJob WorkQueue::pop_front() {
+    assert(size > 0 && "Popping from an empty queue");
+
+    QueuedJob job = std::move(ring[head]);
+    head = (head + 1) % ring.size();
+    size--;
+    return job;
+}
+
+static bool is_running() { return !s_jobs.queues.empty(); }
+
+static void execute(QueuedJob &job);
+
+static void push(QueuedJob &&job) {
+    if (s_jobs.queues.size() <= 1) {
+        execute(job);
+        return;
+    }
+
+    int32_t idx = t_queue_idx;
+    if (idx < 0)
+        idx = s_jobs.outside_cursor++ % s_jobs.queues.size();
+
+    WorkQueue &queue = *s_jobs.queues[idx];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.push_back(std::move(job));
+    }
+    s_jobs.queued++;
+
+    /* Sleeping worker checks QUEUED under this mutex, taking it here means
+     * it either sees the new job or is already waiting for the notify. */
+    { std::lock_guard<std::mutex> lock(s_jobs.sleep_mutex); }
+    s_jobs.wake.notify_one();
+}
+
+/* Own queue from the back (most recent, likely still in cache), others'
+ * from the front. */
+static bool try_pop(int32_t idx, QueuedJob &out_job) {
+    if (s_jobs.queued.load() == 0)
+        return false;
+
+    int32_t count = s_jobs.queues.size();
+    for (int32_t i = 0; i < count; i++) {
+        WorkQueue &queue = *s_jobs.queues[(idx + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.size == 0)
+            continue;
+
+        out_job = i == 0 ? queue.pop_back() : queue.pop_front();
+
+        s_jobs.queued--;
+        return true;
+    }
+
+    return false;
+}
+
+static void finish(Counter *counter) {
+    if (!counter)
+        return;
+
+    /* Decremented under the lock - wait() takes it before returning, so the
+     * counter can't go away while it's still held here. */
+    std::vector<QueuedJob> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->pending.fetch_sub(1) == 1)
+            ready.swap(counter->continuations);
+    }
+
+    for (QueuedJob &job : ready)
+        push(std::move(job));
+}
+
+static void execute(QueuedJob &job) {
+    job.fn();
+    finish(job.counter);
+}
+
+static void worker_loop(int32_t idx) {
+    t_queue_idx = idx;
+
+    while (true) {
+        QueuedJob job;
+        if (try_pop(idx, job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(s_jobs.sleep_mutex);
+        s_jobs.wake.wait(lock, []() {
+            return s_jobs.quit.load() || s_jobs.queued.load() > 0;
+        });
+
+        if (s_jobs.quit.load())
+            return;
+    }
+}
+
+void init(const JobSystemSpec &spec) {
+    assert(!is_running() && "Job system already initialized");
+    assert(spec.threads >= 0 && "Negative thread count");
+
+    int32_t threads = spec.threads > 0 ? spec.threads : available_cpus();
+    s_jobs.quit = false;
+    s_jobs.queued = 0;
+    t_queue_idx = 0;
+
+    for (int32_t i = 0; i < threads; i++)
+        s_jobs.queues.push_back(std::make_unique<WorkQueue>());
+
+    for (int32_t i = 1; i < threads; i++)
+        s_jobs.workers.emplace_back(worker_loop, i);
+}
+
+void shutdown() {
+    if (!is_running())
+        return;
+
+    assert(s_jobs.queued.load() == 0 && "Shutting down with queued jobs");
+
+    {
+        std::lock_guard<std::mutex> lock(s_jobs.sleep_mutex);
+        s_jobs.quit = true;
+    }
+    s_jobs.wake.notify_all();
+
+    for (std::thread &worker : s_jobs.workers)
+        worker.join();
+
+    s_jobs.workers.clear();
+    s_jobs.queues.clear();
+    t_queue_idx = -1;
+}
+
+int32_t threads_count() {
+    return is_running() ? (int32_t)s_jobs.queues.size() : 1;
+}
+
+int32_t thread_index() {
+    return is_running() ? t_queue_idx : 0;
+}
+
+#ifdef __linux__
+/* CPUs worth of quota, 0 if unlimited or unknown. */
+static int32_t cgroup_cpu_limit() {
+    int64_t quota = -1;
+    int64_t period = 0;
+
+    /* cgroup v2 - "max 100000" or "<quota> <period>". */
+    if (FILE *file = fopen("/sys/fs/cgroup/cpu.max", "r")) {
+        char quota_str[32] = {};
+        long long period_ll = 0;
+        if (fscanf(file, "%31s %lld", quota_str, &period_ll) == 2 &&
+            strcmp(quota_str, "max") != 0) {
+            quota = atoll(quota_str);
+            period = period_ll;
+        }
+        fclose(file);
+    } else {
+        FILE *quota_file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+        FILE *period_file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+        long long quota_ll = -1;
+        long long period_ll = 0;
+        if (quota_file && period_file &&
+            fscanf(quota_file, "%lld", &quota_ll) == 1 &&
+            fscanf(period_file, "%lld", &period_ll) == 1) {
+            quota = quota_ll;
+            period = period_ll;
+        }
+
+        if (quota_file)
+            fclose(quota_file);
+        if (period_file)
+            fclose(period_file);
+    }
+
+    if (quota <= 0 || period <= 0)
+        return 0;
+
+    return (int32_t)std::ceil((double)quota / period);
+}
+#endif
+
+int32_t available_cpus() {
+    int32_t cpus = std::thread::hardware_concurrency();
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        cpus = CPU_COUNT(&set);
+
+    int32_t limit = cgroup_cpu_limit();
+    if (limit > 0)
+        cpus = std::min(cpus, limit);
+#endif
+
+    return std::max(cpus, 1);
+}
+
+void run(Job job, Counter *counter) {
+    if (counter)
+        counter->pending++;
+
+    push({std::move(job), counter});
+}
+
+void run_after(Counter &dependency, Job job, Counter *counter) {
+    if (counter)
+        counter->pending++;
+
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (dependency.pending.load() > 0) {
+            dependency.continuations.push_back({std::move(job), counter});
+            return;
+        }
+    }
+
+    push({std::move(job), counter});
+}
+
+void wait(Counter &counter) {
+    int32_t idx = std::max(t_queue_idx, 0);
+    while (counter.pending.load() > 0) {
+        QueuedJob job;
+        if (is_running() && try_pop(idx, job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+
+    /* Last finish() might still hold it. */
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void parallel_for(int32_t count, int32_t grain, RangeBody body) {
+    if (count <= 0)
+        return;
+
+    int32_t threads = threads_count();
+    if (grain <= 0)
+        grain = std::max((count + threads * 4 - 1) / (threads * 4), 1);
+
+    int32_t ranges = (count + grain - 1) / grain;
+    if (threads == 1 || ranges == 1) {
+        for (int32_t first = 0; first < count; first += grain)
+            body(first, std::min(first + grain, count));
+
+        return;
+    }
+
+    Counter counter;
+    for (int32_t i = 1; i < ranges; i++) {
+        int32_t first = i * grain;
+        int32_t last = std::min(first + grain, count);
+        /* Fits std::function's small buffer - no allocation per range. */
+        run([&body, first, last]() { body(first, last); }, &counter);
+    }
+
+    body(0, std::min(grain, count));
+    wait(counter);
+}
+
+} // namespace eng::jobs
@@ -142,6 +142,22 @@ renderer::CameraData SpectatorCamera::render_data() const {
     return cdata;
 }
 
+Ray SpectatorCamera::screen_ray(const glm::vec2 &viewport_coords) const {
+    glm::vec2 ndc = (viewport_coords / viewport) * 2.0f - 1.0f;
+    glm::mat4 inv_view_proj = glm::inverse(projection() * view());
+
+    glm::vec4 near_pt = inv_view_proj * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 far_pt = inv_view_proj * glm::vec4(ndc, 1.0f, 1.0f);
+    near_pt /= near_pt.w;
+    far_pt /= far_pt.w;
+
+    Ray ray;
+    ray.origin = glm::vec3(near_pt);
+    ray.dir = glm::normalize(glm::vec3(far_pt - near_pt));
+
+    return ray;
+}
+
 void SpectatorCamera::on_event(Event &ev) {
     cam_control->on_event(ev);
 }
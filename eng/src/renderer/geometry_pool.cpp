@@ -0,0 +1,158 @@
+#include "eng/renderer/geometry_pool.hpp"
+#include <cassert>
+
+namespace eng {
+
+/* Doubles CAPACITY until COUNT fits, counting the free range at the end,
+ * which grows along. */
+static uint32_t grown_capacity(const cont::RangeAllocator &ranges,
+                               uint32_t count) {
+    uint32_t tail_free = 0;
+    if (!ranges.free_ranges.empty()) {
+        const cont::RangeAllocator::Range &last = ranges.free_ranges.back();
+        if (last.offset + last.count == ranges.capacity)
+            tail_free = last.count;
+    }
+
+    uint32_t capacity = ranges.capacity;
+    while (capacity - ranges.capacity + tail_free < count)
+        capacity *= 2;
+
+    return capacity;
+}
+
+static void grow_vertices(GeometryPool &pool, uint32_t count) {
+    uint32_t capacity = grown_capacity(pool.vertices, count);
+
+    VertexBuffer vbo = VertexBuffer::create();
+    vbo.allocate(nullptr, (uint64_t)capacity * sizeof(Vertex), capacity);
+    GL_CALL(glCopyNamedBufferSubData(
+        pool.vao.vbo.id, vbo.id, 0, 0,
+        (uint64_t)pool.vertices.capacity * sizeof(Vertex)));
+
+    /* Draws still reading the old one keep it alive until they're done. */
+    pool.vao.vbo.destroy();
+    pool.vao.attach_buffers(vbo, pool.vao.ibo, sizeof(Vertex));
+    pool.vertices.grow(capacity);
+    pool.grows++;
+}
+
+static void grow_indices(GeometryPool &pool, uint32_t count) {
+    uint32_t capacity = grown_capacity(pool.indices, count);
+
+    /* Allocating binds it to the bound vertex array, this way it's the
+     * pool's one. */
+    pool.vao.bind();
+    IndexBuffer ibo = IndexBuffer::create();
+    ibo.allocate(nullptr, capacity);
+    GL_CALL(glCopyNamedBufferSubData(
+        pool.vao.ibo.id, ibo.id, 0, 0,
+        (uint64_t)pool.indices.capacity * sizeof(uint32_t)));
+
+    pool.vao.ibo.destroy();
+    pool.vao.attach_buffers(pool.vao.vbo, ibo, sizeof(Vertex));
+    pool.vao.unbind();
+    pool.indices.grow(capacity);
+    pool.grows++;
+}
+
+GeometryPool GeometryPool::create(uint32_t vertices_capacity,
+                                  uint32_t indices_capacity) {
+    assert(vertices_capacity > 0 && indices_capacity > 0 &&
+           "Empty geometry pool");
+
+    GeometryPool pool;
+    pool.vertices = cont::RangeAllocator::create(vertices_capacity);
+    pool.indices = cont::RangeAllocator::create(indices_capacity);
+
+    pool.vao = VertexArray::create();
+    pool.vao.bind();
+
+    VertexBuffer vbo = VertexBuffer::create();
+    vbo.allocate(nullptr, (uint64_t)vertices_capacity * sizeof(Vertex),
+                 vertices_capacity);
+
+    IndexBuffer ibo = IndexBuffer::create();
+    ibo.allocate(nullptr, indices_capacity);
+
+    VertexBufferLayout layout;
+    layout.push_float(3); // 0 - position
+    layout.push_float(3); // 1 - normal
+    layout.push_float(3); // 2 - tangent
+    layout.push_float(3); // 3 - bitangent
+    layout.push_float(2); // 4 - texture uv
+
+    pool.vao.add_vertex_layout(layout);
+    pool.vao.attach_buffers(vbo, ibo, sizeof(Vertex));
+
+    layout.clear();
+    layout.push_float(4); // 5 - transform
+    layout.push_float(4); // 6 - transform
+    layout.push_float(4); // 7 - transform
+    layout.push_float(4); // 8 - transform
+    layout.push_float(1); // 9 - entity id
+    layout.push_float(1); // 10 - material index
+
+    pool.vao.add_instance_layout(layout, 5);
+    pool.vao.unbind();
+
+    return pool;
+}
+
+void GeometryPool::destroy() {
+    vao.destroy();
+    vertices = {};
+    indices = {};
+}
+
+GeometryRange GeometryPool::allocate(const VertexData &vertex_data) {
+    const auto &[mesh_vertices, mesh_indices] = vertex_data;
+
+    GeometryRange range;
+    range.vertices_count = mesh_vertices.size();
+    range.indices_count = mesh_indices.size();
+
+    std::optional<uint32_t> base_vertex =
+        vertices.allocate(range.vertices_count);
+    if (!base_vertex.has_value()) {
+        grow_vertices(*this, range.vertices_count);
+        base_vertex = vertices.allocate(range.vertices_count);
+    }
+
+    std::optional<uint32_t> first_index =
+        indices.allocate(range.indices_count);
+    if (!first_index.has_value()) {
+        grow_indices(*this, range.indices_count);
+        first_index = indices.allocate(range.indices_count);
+    }
+
+    assert(base_vertex.has_value() && first_index.has_value() &&
+           "Geometry doesn't fit after growing");
+    range.base_vertex = base_vertex.value();
+    range.first_index = first_index.value();
+
+    vao.vbo.set_data(mesh_vertices.data(),
+                     mesh_vertices.size() * sizeof(Vertex),
+                     (uint64_t)range.base_vertex * sizeof(Vertex));
+    vao.ibo.set_data(mesh_indices.data(), range.indices_count,
+                     range.first_index);
+
+    return range;
+}
+
+void GeometryPool::free(const GeometryRange &range) {
+    vertices.free(range.base_vertex, range.vertices_count);
+    indices.free(range.first_index, range.indices_count);
+}
+
+std::vector<Vertex>
+GeometryPool::read_vertices(const GeometryRange &range) const {
+    std::vector<Vertex> data(range.vertices_count);
+    GL_CALL(glGetNamedBufferSubData(
+        vao.vbo.id, (GLintptr)range.base_vertex * sizeof(Vertex),
+        data.size() * sizeof(Vertex), data.data()));
+
+    return data;
+}
+
+} // namespace eng
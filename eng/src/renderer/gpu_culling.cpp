@@ -0,0 +1,460 @@
+#include "eng/renderer/gpu_culling.hpp"
+#include "eng/frame_memory.hpp"
+#include "eng/renderer/renderer.hpp"
+#include <array>
+#include <cstdio>
+#include <filesystem>
+
+namespace eng {
+
+static constexpr int32_t CULL_GROUP_SIZE = 64;
+
+static constexpr int32_t CULL_FRUSTUM = 0;
+static constexpr int32_t CULL_SPHERES = 1;
+
+/* Starting size of GPU scenes' storage, in candidates. */
+static constexpr uint32_t MIN_GPU_SCENE_CAPACITY = 1024;
+
+static constexpr std::array<const char *, 6> PLANE_UNIFORMS = {
+    "u_planes[0]", "u_planes[1]", "u_planes[2]",
+    "u_planes[3]", "u_planes[4]", "u_planes[5]"};
+
+/* Candidate going into SLOT of a scene's storage, laid out the way the
+ * scatter shader reads it (std430). */
+struct CandidatePatch {
+    uint32_t slot = 0;
+    uint32_t padding[3]{};
+    CullCandidate candidate;
+};
+
+static_assert(sizeof(CandidatePatch) == 128 && "Doesn't match std430 layout");
+
+uint32_t GpuSceneGroups::acquire(AssetID material_id, AssetID mesh_id) {
+    auto [itr, inserted] = ids.try_emplace({material_id, mesh_id}, 0);
+    if (inserted) {
+        if (free_groups.empty()) {
+            itr->second = groups.size();
+            groups.emplace_back();
+        } else {
+            itr->second = free_groups.back();
+            free_groups.pop_back();
+        }
+
+        GpuSceneGroup &group = groups[itr->second];
+        group.material_id = material_id;
+        group.mesh_id = mesh_id;
+        group.members = 0;
+    }
+
+    groups[itr->second].members++;
+    return itr->second;
+}
+
+void GpuSceneGroups::release(uint32_t group_idx) {
+    GpuSceneGroup &group = groups[group_idx];
+    assert(group.members > 0 && "Releasing an empty group");
+
+    if (--group.members > 0)
+        return;
+
+    ids.erase({group.material_id, group.mesh_id});
+    free_groups.push_back(group_idx);
+}
+
+GpuScene GpuScene::create() {
+    GpuScene scene;
+    scene.capacity = MIN_GPU_SCENE_CAPACITY;
+    scene.candidates_storage = ShaderStorage::create(
+        nullptr, scene.capacity * sizeof(CullCandidate));
+
+    std::vector<uint32_t> levels(scene.capacity, 0);
+    scene.lod_levels_storage = ShaderStorage::create(
+        levels.data(), levels.size() * sizeof(uint32_t));
+
+    return scene;
+}
+
+void GpuScene::destroy() {
+    clear();
+    candidates_storage.destroy();
+    lod_levels_storage.destroy();
+    capacity = 0;
+}
+
+void GpuScene::clear() {
+    candidates.clear();
+    slot_ids.clear();
+    id_to_slot.clear();
+    groups = {};
+    shadow_groups = {};
+    dirty_slots.clear();
+    dirty.clear();
+}
+
+static int32_t slot_of(const GpuScene &gpu_scene, ecs::EntityID ent_id) {
+    return ent_id < gpu_scene.id_to_slot.size() ? gpu_scene.id_to_slot[ent_id]
+                                                 : -1;
+}
+
+static void mark_dirty(GpuScene &gpu_scene, uint32_t slot) {
+    if (gpu_scene.dirty[slot])
+        return;
+
+    gpu_scene.dirty[slot] = 1;
+    gpu_scene.dirty_slots.push_back(slot);
+}
+
+static void release_groups(GpuScene &gpu_scene, uint32_t slot) {
+    const CullCandidate &candidate = gpu_scene.candidates[slot];
+    gpu_scene.groups.release(candidate.group);
+    if (candidate.shadow_group != NO_CULL_GROUP)
+        gpu_scene.shadow_groups.release(candidate.shadow_group);
+}
+
+/* Last slot takes the place of SLOT. Stale dirty slots past the end are
+ * skipped when uploading. */
+static void remove_slot(GpuScene &gpu_scene, uint32_t slot) {
+    release_groups(gpu_scene, slot);
+    gpu_scene.id_to_slot[gpu_scene.slot_ids[slot]] = -1;
+
+    uint32_t last = gpu_scene.candidates.size() - 1;
+    if (slot != last) {
+        gpu_scene.candidates[slot] = gpu_scene.candidates[last];
+        gpu_scene.slot_ids[slot] = gpu_scene.slot_ids[last];
+        gpu_scene.id_to_slot[gpu_scene.slot_ids[slot]] = slot;
+        mark_dirty(gpu_scene, slot);
+    }
+
+    gpu_scene.candidates.pop_back();
+    gpu_scene.slot_ids.pop_back();
+    gpu_scene.dirty.pop_back();
+}
+
+/* Same split as culling on the CPU - static meshes go through their
+ * batches, lights don't cast shadows. */
+static bool is_drawn(Entity &ent) {
+    return ent.has_component<MeshComp>() && ent.has_component<MaterialComp>() &&
+           !ent.has_component<Static>();
+}
+
+static bool is_shadow_caster(Entity &ent) {
+    return !ent.has_component<PointLight>() &&
+           !ent.has_component<DirLight>() && !ent.has_component<SpotLight>();
+}
+
+/* Rewrites the entity's slot from its components, adding or removing it as
+ * needed. */
+static void refresh(GpuScene &gpu_scene, Scene &scene,
+                    const AssetPack &asset_pack, ecs::EntityID ent_id) {
+    int32_t slot = slot_of(gpu_scene, ent_id);
+    if (!scene.contains(ent_id) || !is_drawn(scene.entity(ent_id))) {
+        if (slot != -1)
+            remove_slot(gpu_scene, slot);
+
+        return;
+    }
+
+    if (slot == -1) {
+        slot = gpu_scene.candidates.size();
+        gpu_scene.candidates.emplace_back();
+        gpu_scene.slot_ids.push_back(ent_id);
+        gpu_scene.dirty.push_back(0);
+
+        if (gpu_scene.id_to_slot.size() <= ent_id)
+            gpu_scene.id_to_slot.resize(ent_id + 1, -1);
+        gpu_scene.id_to_slot[ent_id] = slot;
+    } else {
+        release_groups(gpu_scene, slot);
+    }
+
+    Entity &ent = scene.entity(ent_id);
+    AssetID mesh_id = ent.get_component<MeshComp>().id;
+    AssetID material_id = ent.get_component<MaterialComp>().id;
+    const MeshAABB &local_bb = asset_pack.meshes.at(mesh_id).local_bb;
+
+    CullCandidate &candidate = gpu_scene.candidates[slot];
+    candidate.transform = ent.get_component<GlobalTransform>().to_mat4();
+    candidate.bb_min = local_bb.min;
+    candidate.bb_max = local_bb.max;
+    candidate.entity_id = ent_id;
+    candidate.material_index = material_id;
+    candidate.group = gpu_scene.groups.acquire(material_id, mesh_id);
+    candidate.shadow_group =
+        is_shadow_caster(ent) ? gpu_scene.shadow_groups.acquire(0, mesh_id)
+                              : NO_CULL_GROUP;
+    candidate.lod_bias = ent.has_component<LodComp>()
+                             ? ent.get_component<LodComp>().bias
+                             : -1.0f;
+
+    mark_dirty(gpu_scene, slot);
+}
+
+void GpuScene::update(Scene &scene, const AssetPack &asset_pack) {
+    for (ecs::EntityID ent_id : scene.mesh_changed_ids)
+        refresh(*this, scene, asset_pack, ent_id);
+
+    for (ecs::EntityID ent_id : scene.moved_ids) {
+        int32_t slot = slot_of(*this, ent_id);
+        if (slot == -1 || !scene.contains(ent_id))
+            continue;
+
+        Entity &ent = scene.entity(ent_id);
+        candidates[slot].transform =
+            ent.get_component<GlobalTransform>().to_mat4();
+        mark_dirty(*this, slot);
+    }
+}
+
+/* Orphans STORAGE before writing, so a cull still reading the old contents
+ * doesn't stall this one. */
+static void upload(ShaderStorage &storage, uint32_t &capacity,
+                   const void *data, uint32_t size) {
+    while (capacity < size)
+        capacity *= 2;
+
+    storage.bind();
+    storage.realloc(capacity);
+    storage.set_data(data, size);
+}
+
+/* Whole storage is rewritten, LOD levels start over from full detail. */
+static void grow(GpuScene &scene) {
+    while (scene.capacity < scene.candidates.size())
+        scene.capacity *= 2;
+
+    scene.candidates_storage.bind();
+    scene.candidates_storage.realloc(scene.capacity * sizeof(CullCandidate));
+    scene.candidates_storage.set_data(
+        scene.candidates.data(),
+        scene.candidates.size() * sizeof(CullCandidate));
+
+    std::vector<uint32_t> levels(scene.capacity, 0);
+    scene.lod_levels_storage.bind();
+    scene.lod_levels_storage.realloc(levels.size() * sizeof(uint32_t));
+    scene.lod_levels_storage.set_data(levels.data(),
+                                      levels.size() * sizeof(uint32_t));
+
+    for (uint32_t slot : scene.dirty_slots) {
+        if (slot < scene.dirty.size())
+            scene.dirty[slot] = 0;
+    }
+
+    scene.dirty_slots.clear();
+}
+
+int32_t GpuCuller::sync(GpuScene &scene) {
+    if (scene.candidates.size() > scene.capacity) {
+        grow(scene);
+        return scene.candidates.size();
+    }
+
+    std::pmr::vector<CandidatePatch> patches(frame_memory::resource());
+    patches.reserve(scene.dirty_slots.size());
+    for (uint32_t slot : scene.dirty_slots) {
+        /* Removed since, or listed twice. */
+        if (slot >= scene.candidates.size() || !scene.dirty[slot])
+            continue;
+
+        scene.dirty[slot] = 0;
+        CandidatePatch &patch = patches.emplace_back();
+        patch.slot = slot;
+        patch.candidate = scene.candidates[slot];
+    }
+
+    scene.dirty_slots.clear();
+    if (patches.empty())
+        return 0;
+
+    upload(this->patches, patches_capacity, patches.data(),
+           patches.size() * sizeof(CandidatePatch));
+
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_CANDIDATES_BINDING,
+                             scene.candidates_storage.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_PATCHES_BINDING,
+                             this->patches.id));
+
+    scatter_shader.bind();
+    scatter_shader.set_uniform_1i("u_patches_count", patches.size());
+
+    int32_t groups = (patches.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+    scatter_shader.dispatch_compute({groups, 1, 1});
+
+    GL_CALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    return patches.size();
+}
+
+static void dispatch(GpuCuller &culler, int32_t mode, float lod_scale,
+                     GpuScene &scene, const CullPass &pass,
+                     const IndirectBuffer &commands,
+                     const VertexBuffer &instances) {
+    upload(culler.groups, culler.groups_capacity, pass.groups.data(),
+           pass.groups.size_bytes());
+    upload(culler.lod_sizes, culler.lod_sizes_capacity, pass.lod_sizes.data(),
+           pass.lod_sizes.size_bytes());
+
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_CANDIDATES_BINDING,
+                             scene.candidates_storage.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_LOD_LEVELS_BINDING,
+                             scene.lod_levels_storage.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_GROUPS_BINDING,
+                             culler.groups.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_LOD_SIZES_BINDING,
+                             culler.lod_sizes.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_COMMANDS_BINDING, commands.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_INSTANCES_BINDING, instances.id));
+    GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                             renderer::CULL_SPHERES_BINDING,
+                             culler.spheres.id));
+
+    culler.shader.bind();
+    culler.shader.set_uniform_1i("u_candidates_count",
+                                 scene.candidates.size());
+    culler.shader.set_uniform_1i("u_mode", mode);
+    culler.shader.set_uniform_3f("u_camera_position", pass.camera_position);
+    culler.shader.set_uniform_1f("u_projection_scale", pass.projection_scale);
+    culler.shader.set_uniform_1f("u_lod_scale", lod_scale);
+    culler.shader.set_uniform_1f("u_lod_hysteresis",
+                                 scene.lod_settings.hysteresis);
+
+    int32_t groups =
+        (scene.candidates.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+    culler.shader.dispatch_compute({groups, 1, 1});
+
+    /* Survivors are read as draw commands and instance attributes. */
+    GL_CALL(glMemoryBarrier(GL_COMMAND_BARRIER_BIT |
+                            GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                            GL_SHADER_STORAGE_BARRIER_BIT |
+                            GL_BUFFER_UPDATE_BARRIER_BIT));
+}
+
+static std::optional<Shader> build_shader(const std::string &path) {
+    if (!std::filesystem::exists(path)) {
+        fprintf(stderr, "Culling shader %s not found\r\n", path.c_str());
+        return std::nullopt;
+    }
+
+    Shader shader = Shader::create();
+    bool success = shader.build_compute(
+        {.path = path,
+         .replacements = {
+             {
+                 "${CULL_CANDIDATES_BINDING}",
+                 std::to_string(renderer::CULL_CANDIDATES_BINDING)
+             },
+             {
+                 "${CULL_COMMANDS_BINDING}",
+                 std::to_string(renderer::CULL_COMMANDS_BINDING)
+             },
+             {
+                 "${CULL_INSTANCES_BINDING}",
+                 std::to_string(renderer::CULL_INSTANCES_BINDING)
+             },
+             {
+                 "${CULL_SPHERES_BINDING}",
+                 std::to_string(renderer::CULL_SPHERES_BINDING)
+             },
+             {
+                 "${CULL_GROUPS_BINDING}",
+                 std::to_string(renderer::CULL_GROUPS_BINDING)
+             },
+             {
+                 "${CULL_LOD_SIZES_BINDING}",
+                 std::to_string(renderer::CULL_LOD_SIZES_BINDING)
+             },
+             {
+                 "${CULL_LOD_LEVELS_BINDING}",
+                 std::to_string(renderer::CULL_LOD_LEVELS_BINDING)
+             },
+             {
+                 "${CULL_PATCHES_BINDING}",
+                 std::to_string(renderer::CULL_PATCHES_BINDING)
+             }
+         }});
+    if (!success) {
+        shader.destroy();
+        return std::nullopt;
+    }
+
+    return shader;
+}
+
+std::optional<GpuCuller>
+GpuCuller::create(const std::string &cull_shader_path,
+                  const std::string &scatter_shader_path) {
+    std::optional<Shader> shader = build_shader(cull_shader_path);
+    if (!shader.has_value())
+        return std::nullopt;
+
+    std::optional<Shader> scatter_shader = build_shader(scatter_shader_path);
+    if (!scatter_shader.has_value()) {
+        shader.value().destroy();
+        return std::nullopt;
+    }
+
+    GpuCuller culler;
+    culler.shader = shader.value();
+    culler.scatter_shader = scatter_shader.value();
+
+    culler.groups_capacity = 256 * sizeof(CullGroup);
+    culler.groups = ShaderStorage::create(nullptr, culler.groups_capacity);
+    culler.lod_sizes_capacity = 256 * sizeof(float);
+    culler.lod_sizes =
+        ShaderStorage::create(nullptr, culler.lod_sizes_capacity);
+    culler.spheres_capacity = 64 * sizeof(glm::vec4);
+    culler.spheres = ShaderStorage::create(nullptr, culler.spheres_capacity);
+    culler.patches_capacity = 256 * sizeof(CandidatePatch);
+    culler.patches = ShaderStorage::create(nullptr, culler.patches_capacity);
+
+    return culler;
+}
+
+void GpuCuller::destroy() {
+    shader.destroy();
+    scatter_shader.destroy();
+    groups.destroy();
+    lod_sizes.destroy();
+    spheres.destroy();
+    patches.destroy();
+}
+
+void GpuCuller::cull(GpuScene &scene, const CullPass &pass,
+                     const Frustum &frustum, const IndirectBuffer &commands,
+                     const VertexBuffer &instances) {
+    (void)sync(scene);
+    if (scene.candidates.empty())
+        return;
+
+    shader.bind();
+    for (int32_t i = 0; i < (int32_t)frustum.size(); i++)
+        shader.set_uniform_4f(PLANE_UNIFORMS[i],
+                              glm::vec4(frustum[i].normal, frustum[i].d));
+
+    dispatch(*this, CULL_FRUSTUM, 1.0f, scene, pass, commands, instances);
+}
+
+void GpuCuller::cull(GpuScene &scene, const CullPass &pass,
+                     std::span<const glm::vec4> spheres,
+                     const IndirectBuffer &commands,
+                     const VertexBuffer &instances) {
+    (void)sync(scene);
+    if (scene.candidates.empty())
+        return;
+
+    upload(this->spheres, spheres_capacity, spheres.data(),
+           spheres.size_bytes());
+
+    shader.bind();
+    shader.set_uniform_1i("u_spheres_count", spheres.size());
+    dispatch(*this, CULL_SPHERES, scene.lod_settings.shadow_scale, scene, pass,
+             commands, instances);
+}
+
+} // namespace eng
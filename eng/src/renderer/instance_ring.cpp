@@ -0,0 +1,125 @@
+#include "eng/renderer/instance_ring.hpp"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+namespace eng {
+
+static constexpr GLbitfield RING_MAP_FLAGS =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+/* Region's first instance, counting the identity one in front of them. */
+static uint32_t region_base(const InstanceRing &ring, int32_t region) {
+    return 1 + region * ring.region_capacity;
+}
+
+InstanceRing InstanceRing::create(int32_t region_capacity) {
+    assert(region_capacity > 0 && "Empty instance ring");
+
+    InstanceRing ring;
+    ring.region_capacity = region_capacity;
+
+    uint64_t size =
+        (1 + (uint64_t)REGIONS_COUNT * region_capacity) * sizeof(MeshInstance);
+    ring.buffer = VertexBuffer::create();
+    ring.buffer.bind();
+    GL_CALL(glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, RING_MAP_FLAGS));
+    GL_CALL(ring.mapped = (MeshInstance *)glMapBufferRange(
+                GL_ARRAY_BUFFER, 0, size, RING_MAP_FLAGS));
+    assert(ring.mapped && "Failed to map instance ring");
+
+    MeshInstance identity;
+    identity.transform = glm::mat4(1.0f);
+    ring.mapped[IDENTITY_INSTANCE] = identity;
+
+    return ring;
+}
+
+void InstanceRing::destroy() {
+    for (GLsync &fence : fences) {
+        if (fence) {
+            GL_CALL(glDeleteSync(fence));
+            fence = nullptr;
+        }
+    }
+
+    buffer.bind();
+    GL_CALL(glUnmapBuffer(GL_ARRAY_BUFFER));
+    buffer.destroy();
+    mapped = nullptr;
+}
+
+void InstanceRing::reserve(int32_t count) {
+    if (region_used + count <= region_capacity)
+        return;
+
+    /* Old buffer's regions might still be read by queued draws, deleting
+     * it only drops the name - GL keeps it around until they're done. */
+    int32_t capacity = region_capacity;
+    while (capacity < count)
+        capacity *= 2;
+
+    uint64_t grown = grows + 1;
+    uint64_t stalled = stalls;
+    destroy();
+    *this = create(capacity);
+    grows = grown;
+    stalls = stalled;
+}
+
+uint32_t InstanceRing::push(std::span<const MeshInstance> instances) {
+    uint32_t first = claim(instances.size());
+    memcpy(mapped + first, instances.data(), instances.size_bytes());
+
+    return first;
+}
+
+uint32_t InstanceRing::claim(int32_t count) {
+    assert(region_used + count <= region_capacity &&
+           "Instances don't fit, reserve() first");
+
+    uint32_t first = region_base(*this, region) + region_used;
+    region_used += count;
+
+    return first;
+}
+
+void InstanceRing::next_frame() {
+    GLsync &done = fences[region];
+    if (done) {
+        GL_CALL(glDeleteSync(done));
+    }
+
+    GL_CALL(done = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    region = (region + 1) % REGIONS_COUNT;
+    region_used = 0;
+
+    GLsync &pending = fences[region];
+    if (!pending)
+        return;
+
+    GL_CALL(GLenum status = glClientWaitSync(pending, 0, 0));
+    if (status == GL_TIMEOUT_EXPIRED) {
+        stalls++;
+
+        /* Flushing, or it might never get signaled. */
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        do {
+            GL_CALL(status = glClientWaitSync(pending, flags, 1'000'000));
+            flags = 0;
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+
+    if (status == GL_WAIT_FAILED)
+        fprintf(stderr, "Waiting for instance ring region failed\r\n");
+
+    GL_CALL(glDeleteSync(pending));
+    pending = nullptr;
+}
+
+void InstanceRing::attach(const VertexArray &vao) const {
+    vao.bind_instance_buffer(buffer, 0, sizeof(MeshInstance));
+}
+
+} // namespace eng
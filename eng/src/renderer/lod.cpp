@@ -0,0 +1,107 @@
+#include "eng/renderer/lod.hpp"
+#include "eng/jobs.hpp"
+
+namespace eng::renderer {
+
+float projected_size(const CameraData &camera, const glm::vec3 &center,
+                     float radius) {
+    float dist = glm::distance(glm::vec3(camera.position), center);
+    if (dist <= radius)
+        return 1.0f;
+
+    /* projection[1][1] is cot(fov / 2), the size at distance 1. */
+    return glm::min(radius * camera.projection[1][1] / dist, 1.0f);
+}
+
+int32_t select_lod_level(const Mesh &mesh, int32_t current, float size,
+                         float hysteresis) {
+    int32_t levels = mesh.lods.size();
+    int32_t level = glm::clamp(current, 0, levels);
+
+    while (level < levels &&
+           size < mesh.lods[level].screen_size * (1.0f - hysteresis))
+        level++;
+
+    while (level > 0 &&
+           size > mesh.lods[level - 1].screen_size * (1.0f + hysteresis))
+        level--;
+
+    return level;
+}
+
+static AssetID lod_mesh_id(const Mesh &mesh, AssetID base_id, int32_t level) {
+    return level == 0 ? base_id : mesh.lods[level - 1].mesh_id;
+}
+
+/* Proxies per job - below that selection stays on the calling thread. */
+static constexpr int32_t LOD_JOB_GRAIN = 512;
+
+/* Calls FN with projected size of every culled entity with LodComp. Proxies
+ * are split between job threads, each entity shows up once, so FN only
+ * touches its own LodComp. */
+template <typename Fn>
+static void for_each_lod(Scene &scene, const AssetPack &asset_pack,
+                         const CameraData &camera,
+                         const std::vector<int32_t> &proxies, Fn &&fn) {
+    auto select_range = [&](int32_t first, int32_t last) {
+        for (int32_t i = first; i < last; i++) {
+            const BVHNode &node = scene.spatial_index.nodes[proxies[i]];
+            Entity &ent = scene.entity(node.ent_id);
+            if (!ent.has_component<LodComp>())
+                continue;
+
+            const Mesh &mesh = asset_pack.meshes.at(node.mesh_id);
+            LodComp &lod = ent.get_component<LodComp>();
+            if (mesh.lods.empty()) {
+                lod.level = lod.shadow_level = 0;
+                lod.mesh_id = lod.shadow_mesh_id = node.mesh_id;
+                continue;
+            }
+
+            GlobalTransform &transform = ent.get_component<GlobalTransform>();
+            glm::vec3 half_extent =
+                (mesh.local_bb.max - mesh.local_bb.min) * 0.5f;
+            glm::vec3 local_center = mesh.local_bb.min + half_extent;
+            glm::vec3 center =
+                glm::vec3(transform.to_mat4() * glm::vec4(local_center, 1.0f));
+
+            glm::vec3 scale = glm::abs(transform.scale);
+            float radius = glm::length(half_extent) *
+                           glm::max(scale.x, glm::max(scale.y, scale.z));
+
+            float size = projected_size(camera, center, radius) * lod.bias;
+            fn(mesh, node.mesh_id, lod, size);
+        }
+    };
+
+    jobs::parallel_for(proxies.size(), LOD_JOB_GRAIN, select_range);
+}
+
+void select_lods(Scene &scene, const AssetPack &asset_pack,
+                 const CameraData &camera, const std::vector<int32_t> &proxies,
+                 const LodSettings &settings) {
+    for_each_lod(scene, asset_pack, camera, proxies,
+                 [&](const Mesh &mesh, AssetID base_id, LodComp &lod,
+                     float size) {
+                     lod.level = select_lod_level(mesh, lod.level, size,
+                                                  settings.hysteresis);
+                     lod.mesh_id = lod_mesh_id(mesh, base_id, lod.level);
+                 });
+}
+
+void select_shadow_lods(Scene &scene, const AssetPack &asset_pack,
+                        const CameraData &camera,
+                        const std::vector<int32_t> &proxies,
+                        const LodSettings &settings) {
+    for_each_lod(scene, asset_pack, camera, proxies,
+                 [&](const Mesh &mesh, AssetID base_id, LodComp &lod,
+                     float size) {
+                     lod.shadow_level = select_lod_level(
+                         mesh, lod.shadow_level, size * settings.shadow_scale,
+                         settings.hysteresis);
+                     lod.shadow_mesh_id =
+                         lod_mesh_id(mesh, base_id, lod.shadow_level);
+                 });
+}
+
+} // namespace eng::renderer
@@ -0,0 +1,114 @@
+#include "eng/renderer/material_table.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace eng {
+
+MaterialData pack_material(const Material &material,
+                           const TextureArrays &arrays) {
+    MaterialData data{};
+
+    data.color = material.color;
+    data.tiling_factor = material.tiling_factor;
+    data.texture_offset = material.texture_offset;
+    data.emission_and_ao = glm::vec4(
+        material.emission_color * material.emission_factor, material.ao);
+    data.roughness = material.roughness;
+    data.metallic = material.metallic;
+    data.texture_layers = glm::ivec4(
+        arrays.layer_ref(material.albedo_texture_id),
+        arrays.layer_ref(material.normal_texture_id),
+        arrays.layer_ref(material.orm_texture_id),
+        arrays.layer_ref(material.emission_texture_id));
+    return data;
+}
+
+MaterialRange MaterialTable::sync(const std::map<AssetID, Material> &materials,
+                                  const TextureArrays &arrays) {
+    if (materials.empty())
+        return {};
+
+    AssetID first_changed = INT32_MAX;
+    AssetID last_changed = -1;
+
+    /* New IDs get uploaded whatever they hold. */
+    AssetID ids_count = materials.rbegin()->first + 1;
+    if ((AssetID)data.size() < ids_count) {
+        first_changed = data.size();
+        last_changed = ids_count - 1;
+
+        data.resize(ids_count, pack_material(Material{}, arrays));
+        textures.resize(ids_count, {0, 0, 0, 0});
+        texture_sets.resize(ids_count, 0);
+    }
+
+    /* Removed materials might have been representatives of their sets, forget
+     * their textures so the sets get rebuilt. IDs are walked in order, gaps
+     * up to ID are the removed ones. */
+    bool textures_changed = false;
+    AssetID next_id = 0;
+    auto forget_removed = [&](AssetID until_id) {
+        for (; next_id < until_id; next_id++) {
+            if (textures[next_id] == std::array<AssetID, 4>{0, 0, 0, 0})
+                continue;
+
+            textures[next_id] = {0, 0, 0, 0};
+            texture_sets[next_id] = 0;
+            textures_changed = true;
+        }
+    };
+
+    for (const auto &[id, material] : materials) {
+        forget_removed(id);
+        next_id = id + 1;
+
+        MaterialData packed = pack_material(material, arrays);
+        if (std::memcmp(&packed, &data[id], sizeof(MaterialData)) != 0) {
+            data[id] = packed;
+            first_changed = std::min(first_changed, id);
+            last_changed = std::max(last_changed, id);
+        }
+
+        std::array<AssetID, 4> ids = {
+            material.albedo_texture_id, material.normal_texture_id,
+            material.orm_texture_id, material.emission_texture_id};
+        const glm::ivec4 &layers = packed.texture_layers;
+        if (layers.x >= 0 && layers.y >= 0 && layers.z >= 0 && layers.w >= 0)
+            ids = {0, 0, 0, 0};
+
+        if (textures[id] != ids) {
+            textures[id] = ids;
+            textures_changed = true;
+        }
+    }
+
+    forget_removed(textures.size());
+
+    /* Quadratic, but only once textures change - editing, loading. */
+    if (textures_changed) {
+        for (const auto &[id, material] : materials) {
+            texture_sets[id] = id;
+            if (textures[id] == std::array<AssetID, 4>{0, 0, 0, 0}) {
+                texture_sets[id] = 0;
+                continue;
+            }
+
+            for (const auto &[other_id, other] : materials) {
+                if (other_id == id)
+                    break;
+
+                if (textures[other_id] == textures[id]) {
+                    texture_sets[id] = other_id;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (last_changed < 0)
+        return {};
+
+    return {first_changed, last_changed - first_changed + 1};
+}
+
+} // namespace eng
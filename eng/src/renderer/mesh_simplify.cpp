@@ -0,0 +1,404 @@
+#include "eng/renderer/mesh_simplify.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <string_view>
+#include <unordered_map>
+
+namespace eng {
+
+/* Symmetric 4x4 matrix of a sum of squared distances to planes, upper
+ * triangle only. */
+struct Quadric {
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+};
+
+static Quadric plane_quadric(const glm::vec3 &normal, float dist) {
+    double x = normal.x, y = normal.y, z = normal.z, d = dist;
+    return {x * x, x * y, x * z, x * d,
+            y * y, y * z, y * d,
+            z * z, z * d,
+            d * d};
+}
+
+static Quadric operator+(const Quadric &lhs, const Quadric &rhs) {
+    return {lhs.a2 + rhs.a2, lhs.ab + rhs.ab, lhs.ac + rhs.ac,
+            lhs.ad + rhs.ad, lhs.b2 + rhs.b2, lhs.bc + rhs.bc,
+            lhs.bd + rhs.bd, lhs.c2 + rhs.c2, lhs.cd + rhs.cd,
+            lhs.d2 + rhs.d2};
+}
+
+static double quadric_error(const Quadric &q, const glm::vec3 &p) {
+    double x = p.x, y = p.y, z = p.z;
+    double err = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z +
+                 2.0 * q.ad * x + q.b2 * y * y + 2.0 * q.bc * y * z +
+                 2.0 * q.bd * y + q.c2 * z * z + 2.0 * q.cd * z + q.d2;
+
+    return glm::max(err, 0.0);
+}
+
+static std::string_view bytes_of(const void *data, size_t size) {
+    return std::string_view((const char *)data, size);
+}
+
+/* Half edge collapse on welded positions. A collapse moves position U onto
+ * neighbouring position V, triangles around U switch to V's vertex. */
+struct Simplifier {
+    const std::vector<Vertex> *vertices = nullptr;
+
+    /* Triangles in vertex indices, dead ones stay in place. */
+    std::vector<uint32_t> indices;
+    std::vector<bool> tri_alive;
+    uint32_t source_tris = 0;
+    uint32_t live_tris = 0;
+
+    std::vector<uint32_t> position_of;
+    std::vector<glm::vec3> positions;
+    std::vector<Quadric> quadrics;
+
+    /* Seam and border positions are locked, they never move. */
+    std::vector<bool> locked;
+    std::vector<bool> collapsed;
+    std::vector<std::vector<uint32_t>> position_tris;
+
+    float max_error = 0.0f;
+};
+
+static Simplifier build_simplifier(const VertexData &vertex_data) {
+    const std::vector<Vertex> &vertices = vertex_data.vertices;
+
+    Simplifier simp;
+    simp.vertices = &vertices;
+
+    /* Bit identical vertices are one vertex. */
+    std::vector<uint32_t> canonical(vertices.size());
+    std::unordered_map<std::string_view, uint32_t> unique_vertices;
+    for (uint32_t i = 0; i < vertices.size(); i++)
+        canonical[i] = unique_vertices
+                           .insert({bytes_of(&vertices[i], sizeof(Vertex)), i})
+                           .first->second;
+
+    std::vector<uint32_t> first_vertex;
+    std::unordered_map<std::string_view, uint32_t> position_ids;
+    simp.position_of.resize(vertices.size());
+    for (uint32_t i = 0; i < vertices.size(); i++) {
+        const glm::vec3 &position = vertices[i].position;
+        auto [itr, inserted] = position_ids.insert(
+            {bytes_of(&position, sizeof(glm::vec3)), simp.positions.size()});
+
+        uint32_t pos_id = itr->second;
+        simp.position_of[i] = pos_id;
+        if (inserted) {
+            simp.positions.push_back(position);
+            simp.locked.push_back(false);
+            first_vertex.push_back(canonical[i]);
+        } else if (first_vertex[pos_id] != canonical[i]) {
+            simp.locked[pos_id] = true;
+        }
+    }
+
+    size_t positions_count = simp.positions.size();
+    simp.quadrics.resize(positions_count);
+    simp.collapsed.resize(positions_count, false);
+    simp.position_tris.resize(positions_count);
+
+    std::unordered_map<uint64_t, int32_t> edge_uses;
+    for (size_t i = 0; i + 2 < vertex_data.indices.size(); i += 3) {
+        std::array<uint32_t, 3> tri = {canonical[vertex_data.indices[i]],
+                                       canonical[vertex_data.indices[i + 1]],
+                                       canonical[vertex_data.indices[i + 2]]};
+        std::array<uint32_t, 3> pos = {simp.position_of[tri[0]],
+                                       simp.position_of[tri[1]],
+                                       simp.position_of[tri[2]]};
+
+        /* Zero area in position space, e.g. at UV sphere poles. */
+        if (pos[0] == pos[1] || pos[1] == pos[2] || pos[0] == pos[2])
+            continue;
+
+        uint32_t tri_idx = simp.indices.size() / 3;
+        for (int32_t j = 0; j < 3; j++) {
+            simp.indices.push_back(tri[j]);
+            simp.position_tris[pos[j]].push_back(tri_idx);
+
+            uint32_t lhs = glm::min(pos[j], pos[(j + 1) % 3]);
+            uint32_t rhs = glm::max(pos[j], pos[(j + 1) % 3]);
+            edge_uses[((uint64_t)lhs << 32) | rhs]++;
+        }
+
+        glm::vec3 p0 = simp.positions[pos[0]];
+        glm::vec3 normal = glm::cross(simp.positions[pos[1]] - p0,
+                                      simp.positions[pos[2]] - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normal /= length;
+            Quadric plane = plane_quadric(normal, -glm::dot(normal, p0));
+            for (uint32_t pos_id : pos)
+                simp.quadrics[pos_id] = simp.quadrics[pos_id] + plane;
+        }
+    }
+
+    /* Open borders and non-manifold edges. */
+    for (auto &[edge, uses] : edge_uses) {
+        if (uses != 2) {
+            simp.locked[edge >> 32] = true;
+            simp.locked[edge & UINT32_MAX] = true;
+        }
+    }
+
+    simp.source_tris = simp.indices.size() / 3;
+    simp.live_tris = simp.source_tris;
+    simp.tri_alive.resize(simp.source_tris, true);
+
+    return simp;
+}
+
+static bool tri_has_position(const Simplifier &simp, uint32_t tri,
+                             uint32_t pos_id) {
+    for (int32_t j = 0; j < 3; j++) {
+        if (simp.position_of[simp.indices[tri * 3 + j]] == pos_id)
+            return true;
+    }
+
+    return false;
+}
+
+static void gather_neighbours(const Simplifier &simp, uint32_t pos_id,
+                              std::vector<uint32_t> &out_neighbours) {
+    out_neighbours.clear();
+    for (uint32_t tri : simp.position_tris[pos_id]) {
+        if (!simp.tri_alive[tri])
+            continue;
+
+        for (int32_t j = 0; j < 3; j++) {
+            uint32_t other = simp.position_of[simp.indices[tri * 3 + j]];
+            if (other != pos_id)
+                out_neighbours.push_back(other);
+        }
+    }
+
+    std::sort(out_neighbours.begin(), out_neighbours.end());
+    out_neighbours.erase(
+        std::unique(out_neighbours.begin(), out_neighbours.end()),
+        out_neighbours.end());
+}
+
+/* Vertex of V that replaces U's, or UINT32_MAX if the collapse would break
+ * the topology, fold a triangle over or tear attributes apart. */
+static uint32_t collapse_target(const Simplifier &simp, uint32_t u,
+                                uint32_t v, std::vector<uint32_t> &scratch_u,
+                                std::vector<uint32_t> &scratch_v) {
+    uint32_t target = UINT32_MAX;
+    int32_t shared_tris = 0;
+    for (uint32_t tri : simp.position_tris[u]) {
+        if (!simp.tri_alive[tri])
+            continue;
+
+        const uint32_t *idx = &simp.indices[tri * 3];
+        if (tri_has_position(simp, tri, v)) {
+            for (int32_t j = 0; j < 3; j++) {
+                if (simp.position_of[idx[j]] != v)
+                    continue;
+
+                if (target != UINT32_MAX && target != idx[j])
+                    return UINT32_MAX;
+
+                target = idx[j];
+            }
+
+            shared_tris++;
+            continue;
+        }
+
+        std::array<glm::vec3, 3> before;
+        std::array<glm::vec3, 3> after;
+        for (int32_t j = 0; j < 3; j++) {
+            uint32_t pos_id = simp.position_of[idx[j]];
+            before[j] = after[j] = simp.positions[pos_id];
+            if (pos_id == u)
+                after[j] = simp.positions[v];
+        }
+
+        glm::vec3 n_before =
+            glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 n_after =
+            glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(n_before, n_after) <=
+            0.2f * glm::length(n_before) * glm::length(n_after))
+            return UINT32_MAX;
+    }
+
+    if (shared_tris != 2)
+        return UINT32_MAX;
+
+    /* Link condition - only the two opposite positions are common. */
+    gather_neighbours(simp, u, scratch_u);
+    gather_neighbours(simp, v, scratch_v);
+
+    int32_t common = 0;
+    for (size_t i = 0, j = 0; i < scratch_u.size() && j < scratch_v.size();) {
+        if (scratch_u[i] == scratch_v[j]) {
+            common++;
+            i++;
+            j++;
+        } else if (scratch_u[i] < scratch_v[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+
+    return common == 2 ? target : UINT32_MAX;
+}
+
+static void collapse(Simplifier &simp, uint32_t u, uint32_t v,
+                     uint32_t target) {
+    std::vector<uint32_t> &v_tris = simp.position_tris[v];
+    for (uint32_t tri : simp.position_tris[u]) {
+        if (!simp.tri_alive[tri])
+            continue;
+
+        if (tri_has_position(simp, tri, v)) {
+            simp.tri_alive[tri] = false;
+            simp.live_tris--;
+            continue;
+        }
+
+        for (int32_t j = 0; j < 3; j++) {
+            if (simp.position_of[simp.indices[tri * 3 + j]] == u)
+                simp.indices[tri * 3 + j] = target;
+        }
+
+        v_tris.push_back(tri);
+    }
+
+    std::erase_if(v_tris, [&](uint32_t tri) { return !simp.tri_alive[tri]; });
+    simp.position_tris[u].clear();
+    simp.quadrics[v] = simp.quadrics[v] + simp.quadrics[u];
+    simp.collapsed[u] = true;
+}
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+/* Collapses cheapest edges first, a position is touched at most once per
+ * pass, costs get recomputed between passes. */
+static void simplify_to(Simplifier &simp, uint32_t target_tris) {
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched;
+    std::vector<uint32_t> scratch_u;
+    std::vector<uint32_t> scratch_v;
+
+    while (simp.live_tris > target_tris) {
+        collapses.clear();
+        for (uint32_t tri = 0; tri < simp.source_tris; tri++) {
+            if (!simp.tri_alive[tri])
+                continue;
+
+            for (int32_t j = 0; j < 3; j++) {
+                uint32_t a = simp.position_of[simp.indices[tri * 3 + j]];
+                uint32_t b =
+                    simp.position_of[simp.indices[tri * 3 + (j + 1) % 3]];
+
+                Quadric sum = simp.quadrics[a] + simp.quadrics[b];
+                if (!simp.locked[a])
+                    collapses.push_back(
+                        {quadric_error(sum, simp.positions[b]), a, b});
+                if (!simp.locked[b])
+                    collapses.push_back(
+                        {quadric_error(sum, simp.positions[a]), b, a});
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &lhs, const Collapse &rhs) {
+                      return lhs.cost < rhs.cost;
+                  });
+
+        touched.assign(simp.positions.size(), false);
+        int32_t performed = 0;
+        for (const Collapse &col : collapses) {
+            if (simp.live_tris <= target_tris)
+                break;
+
+            if (touched[col.from] || touched[col.to] ||
+                simp.collapsed[col.from] || simp.collapsed[col.to])
+                continue;
+
+            uint32_t target =
+                collapse_target(simp, col.from, col.to, scratch_u, scratch_v);
+            if (target == UINT32_MAX)
+                continue;
+
+            collapse(simp, col.from, col.to, target);
+            touched[col.from] = touched[col.to] = true;
+            simp.max_error =
+                glm::max(simp.max_error, (float)glm::sqrt(col.cost));
+            performed++;
+        }
+
+        if (performed == 0)
+            break;
+    }
+}
+
+static VertexData live_vertex_data(const Simplifier &simp) {
+    VertexData data;
+    std::unordered_map<uint32_t, uint32_t> remap;
+    for (uint32_t tri = 0; tri < simp.source_tris; tri++) {
+        if (!simp.tri_alive[tri])
+            continue;
+
+        for (int32_t j = 0; j < 3; j++) {
+            uint32_t idx = simp.indices[tri * 3 + j];
+            auto [itr, inserted] = remap.insert({idx, data.vertices.size()});
+            if (inserted)
+                data.vertices.push_back((*simp.vertices)[idx]);
+
+            data.indices.push_back(itr->second);
+        }
+    }
+
+    return data;
+}
+
+std::vector<SimplifiedMesh>
+simplify_lod_chain(const VertexData &vertex_data,
+                   const std::vector<float> &ratios) {
+    assert(std::is_sorted(ratios.rbegin(), ratios.rend()) &&
+           "LOD ratios have to be decreasing");
+
+    Simplifier simp = build_simplifier(vertex_data);
+
+    std::vector<SimplifiedMesh> levels;
+    uint32_t previous_tris = simp.source_tris;
+    for (float ratio : ratios) {
+        simplify_to(simp, (uint32_t)(simp.source_tris * ratio));
+        if (simp.live_tris == previous_tris)
+            continue;
+
+        SimplifiedMesh &level = levels.emplace_back();
+        level.vertex_data = live_vertex_data(simp);
+        level.ratio = (float)simp.live_tris / simp.source_tris;
+        level.error = simp.max_error;
+        previous_tris = simp.live_tris;
+    }
+
+    return levels;
+}
+
+std::future<std::vector<SimplifiedMesh>>
+simplify_lod_chain_async(VertexData vertex_data, std::vector<float> ratios) {
+    return std::async(std::launch::async,
+                      [data = std::move(vertex_data),
+                       ratios = std::move(ratios)]() {
+                          return simplify_lod_chain(data, ratios);
+                      });
+}
+
+} // namespace eng
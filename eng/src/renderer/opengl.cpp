@@ -5,6 +5,7 @@
 #include "stb/stb_image.hpp"
 #include <alloca.h>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
 
 void gl_clear_errors() {
@@ -100,6 +101,49 @@ void IndexBuffer::unbind() const {
     GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
 }
 
+void IndexBuffer::set_data(const uint32_t *data, uint32_t count,
+                           uint32_t offset) const {
+    assert(id != 0 && "Trying to update invalid index buffer");
+
+    /* Named, binding it would attach it to whatever vertex array is bound. */
+    GL_CALL(glNamedBufferSubData(id, (GLintptr)offset * sizeof(uint32_t),
+                                 count * sizeof(uint32_t), data));
+}
+
+IndirectBuffer IndirectBuffer::create() {
+    IndirectBuffer buffer;
+    GL_CALL(glCreateBuffers(1, &buffer.id));
+    assert(buffer.id != 0 && "Couldn't generate indirect buffer");
+
+    return buffer;
+}
+
+void IndirectBuffer::destroy() {
+    assert(id != 0 && "Trying to destroy invalid indirect buffer");
+
+    GL_CALL(glDeleteBuffers(1, &id));
+    id = 0;
+}
+
+void IndirectBuffer::bind() const {
+    assert(id != 0 && "Trying to bind invalid indirect buffer");
+
+    GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id));
+}
+
+void IndirectBuffer::unbind() const {
+    GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+}
+
+void IndirectBuffer::set_commands(const DrawElementsIndirectCommand *commands,
+                                  uint32_t count) {
+    assert(id != 0 && "Trying to update invalid indirect buffer");
+
+    GL_CALL(glNamedBufferData(id, count * sizeof(DrawElementsIndirectCommand),
+                              commands, GL_STREAM_DRAW));
+    commands_count = count;
+}
+
 Shader Shader::create() {
     Shader shader;
     GL_CALL(shader.id = glCreateProgram());
@@ -243,36 +287,38 @@ void Shader::dispatch_compute(const glm::ivec3 &group) {
     GL_CALL(glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT));
 }
 
-std::optional<GLint> Shader::get_uniform_location(const std::string &name) {
+std::optional<GLint> Shader::get_uniform_location(std::string_view name) {
     assert(id != 0 && "Trying to get uniform of invalid shader object");
 
-    if (uniform_cache.contains(name))
-        return uniform_cache[name];
+    auto it = uniform_cache.find(name);
+    if (it != uniform_cache.end())
+        return it->second;
 
-    GL_CALL(GLint loc = glGetUniformLocation(id, name.c_str()));
+    std::string name_str(name);
+    GL_CALL(GLint loc = glGetUniformLocation(id, name_str.c_str()));
     if (loc == -1) {
-        uniform_cache[name] = std::nullopt;
+        uniform_cache[std::move(name_str)] = std::nullopt;
         return std::nullopt;
     }
 
-    uniform_cache[name] = loc;
+    uniform_cache[std::move(name_str)] = loc;
     return loc;
 }
 
-void Shader::set_uniform_1i(const std::string &name, int32_t val) {
+void Shader::set_uniform_1i(std::string_view name, int32_t val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
     if (!loc.has_value()) {
-        fprintf(stderr, "Unable to get location of uniform '%s'\r\n",
-                name.c_str());
+        fprintf(stderr, "Unable to get location of uniform '%.*s'\r\n",
+                (int32_t)name.size(), name.data());
         return;
     }
 
     GL_CALL(glUniform1i(loc.value(), val));
 }
 
-void Shader::try_set_uniform_1i(const std::string &name, int32_t val) {
+void Shader::try_set_uniform_1i(std::string_view name, int32_t val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
@@ -282,20 +328,20 @@ void Shader::try_set_uniform_1i(const std::string &name, int32_t val) {
     GL_CALL(glUniform1i(loc.value(), val));
 }
 
-void Shader::set_uniform_1f(const std::string &name, float val) {
+void Shader::set_uniform_1f(std::string_view name, float val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
     if (!loc.has_value()) {
-        fprintf(stderr, "Unable to get location of uniform '%s'\r\n",
-                name.c_str());
+        fprintf(stderr, "Unable to get location of uniform '%.*s'\r\n",
+                (int32_t)name.size(), name.data());
         return;
     }
 
     GL_CALL(glUniform1f(loc.value(), val));
 }
 
-void Shader::try_set_uniform_1f(const std::string &name, float val) {
+void Shader::try_set_uniform_1f(std::string_view name, float val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
@@ -305,20 +351,20 @@ void Shader::try_set_uniform_1f(const std::string &name, float val) {
     GL_CALL(glUniform1f(loc.value(), val));
 }
 
-void Shader::set_uniform_2f(const std::string &name, const glm::vec2 &val) {
+void Shader::set_uniform_2f(std::string_view name, const glm::vec2 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
     if (!loc.has_value()) {
-        fprintf(stderr, "Unable to get location of uniform '%s'\r\n",
-                name.c_str());
+        fprintf(stderr, "Unable to get location of uniform '%.*s'\r\n",
+                (int32_t)name.size(), name.data());
         return;
     }
 
     GL_CALL(glUniform2f(loc.value(), val.x, val.y));
 }
 
-void Shader::try_set_uniform_2f(const std::string &name, const glm::vec2 &val) {
+void Shader::try_set_uniform_2f(std::string_view name, const glm::vec2 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
@@ -328,20 +374,20 @@ void Shader::try_set_uniform_2f(const std::string &name, const glm::vec2 &val) {
     GL_CALL(glUniform2f(loc.value(), val.x, val.y));
 }
 
-void Shader::set_uniform_3f(const std::string &name, const glm::vec3 &val) {
+void Shader::set_uniform_3f(std::string_view name, const glm::vec3 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
     if (!loc.has_value()) {
-        fprintf(stderr, "Unable to get location of uniform '%s'\r\n",
-                name.c_str());
+        fprintf(stderr, "Unable to get location of uniform '%.*s'\r\n",
+                (int32_t)name.size(), name.data());
         return;
     }
 
     GL_CALL(glUniform3f(loc.value(), val.x, val.y, val.z));
 }
 
-void Shader::try_set_uniform_3f(const std::string &name, const glm::vec3 &val) {
+void Shader::try_set_uniform_3f(std::string_view name, const glm::vec3 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
@@ -351,20 +397,20 @@ void Shader::try_set_uniform_3f(const std::string &name, const glm::vec3 &val) {
     GL_CALL(glUniform3f(loc.value(), val.x, val.y, val.z));
 }
 
-void Shader::set_uniform_4f(const std::string &name, const glm::vec4 &val) {
+void Shader::set_uniform_4f(std::string_view name, const glm::vec4 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
     if (!loc.has_value()) {
-        fprintf(stderr, "Unable to get location of uniform '%s'\r\n",
-                name.c_str());
+        fprintf(stderr, "Unable to get location of uniform '%.*s'\r\n",
+                (int32_t)name.size(), name.data());
         return;
     }
 
     GL_CALL(glUniform4f(loc.value(), val.x, val.y, val.z, val.w));
 }
 
-void Shader::try_set_uniform_4f(const std::string &name, const glm::vec4 &val) {
+void Shader::try_set_uniform_4f(std::string_view name, const glm::vec4 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
@@ -374,20 +420,20 @@ void Shader::try_set_uniform_4f(const std::string &name, const glm::vec4 &val) {
     GL_CALL(glUniform4f(loc.value(), val.x, val.y, val.z, val.w));
 }
 
-void Shader::set_uniform_mat4(const std::string &name, const glm::mat4 &val) {
+void Shader::set_uniform_mat4(std::string_view name, const glm::mat4 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
     std::optional<GLint> loc = get_uniform_location(name);
     if (!loc.has_value()) {
-        fprintf(stderr, "Unable to get location of uniform '%s'\r\n",
-                name.c_str());
+        fprintf(stderr, "Unable to get location of uniform '%.*s'\r\n",
+                (int32_t)name.size(), name.data());
         return;
     }
 
     GL_CALL(glUniformMatrix4fv(loc.value(), 1, GL_FALSE, &val[0][0]));
 }
 
-void Shader::try_set_uniform_mat4(const std::string &name,
+void Shader::try_set_uniform_mat4(std::string_view name,
                                   const glm::mat4 &val) {
     assert(id != 0 && "Trying to set uniform of invalid shader object");
 
@@ -445,9 +491,6 @@ void VertexArray::destroy() {
     if (ibo.id != 0)
         ibo.destroy();
 
-    if (vbo_instanced.id != 0)
-        vbo_instanced.destroy();
-
     GL_CALL(glDeleteVertexArrays(1, &id));
     id = 0;
 }
@@ -500,28 +543,64 @@ void VertexArray::add_vertex_buffer(const VertexBuffer &vbo,
     this->vbo = vbo;
 }
 
-void VertexArray::add_instanced_vertex_buffer(const VertexBuffer &vbo,
-                                              const VertexBufferLayout &layout,
-                                              uint32_t attrib_offset) {
+void VertexArray::add_vertex_layout(const VertexBufferLayout &layout) {
     bind();
-    vbo.bind();
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < layout.elements.size(); i++) {
+        const VertexBufferElement &element = layout.elements[i];
+
+        GL_CALL(glEnableVertexAttribArray(i));
+        GL_CALL(glVertexAttribFormat(i, element.count, element.type,
+                                     element.normalized, offset));
+        GL_CALL(glVertexAttribBinding(i, 0));
+
+        offset +=
+            element.count * VertexBufferElement::get_size_of_type(element.type);
+    }
+}
+
+void VertexArray::attach_buffers(const VertexBuffer &vbo,
+                                 const IndexBuffer &ibo, uint32_t stride) {
+    GL_CALL(glVertexArrayVertexBuffer(id, 0, vbo.id, 0, stride));
+    GL_CALL(glVertexArrayElementBuffer(id, ibo.id));
+
+    this->vbo = vbo;
+    this->ibo = ibo;
+}
+
+void VertexArray::add_instance_layout(const VertexBufferLayout &layout,
+                                      uint32_t attrib_offset) {
+    bind();
+
+    /* All attributes read from one binding point, named after the first of
+     * them. */
+    instance_binding = attrib_offset;
 
     uint32_t len = layout.elements.size() + attrib_offset;
-    size_t offset = 0;
+    uint32_t offset = 0;
     for (int32_t i = attrib_offset; i < len; i++) {
         const VertexBufferElement &element = layout.elements[i - attrib_offset];
 
         GL_CALL(glEnableVertexAttribArray(i));
-        GL_CALL(glVertexAttribPointer(i, element.count, element.type,
-                                      element.normalized, layout.stride,
-                                      (const void *)offset));
-        GL_CALL(glVertexAttribDivisor(i, 1));
+        GL_CALL(glVertexAttribFormat(i, element.count, element.type,
+                                     element.normalized, offset));
+        GL_CALL(glVertexAttribBinding(i, instance_binding));
 
         offset +=
             element.count * VertexBufferElement::get_size_of_type(element.type);
     }
 
-    this->vbo_instanced = vbo;
+    GL_CALL(glVertexBindingDivisor(instance_binding, 1));
+}
+
+void VertexArray::bind_instance_buffer(const VertexBuffer &vbo,
+                                       uint64_t offset,
+                                       uint32_t stride) const {
+    assert(instance_binding != UINT32_MAX && "No instance layout");
+
+    GL_CALL(glVertexArrayVertexBuffer(id, instance_binding, vbo.id,
+                                      (GLintptr)offset, stride));
 }
 
 void VertexArray::bind() const {
@@ -944,6 +1023,9 @@ void Framebuffer::destroy() {
     assert(id != 0 && "Trying to destroy invalid framebuffer object");
 
     GL_CALL(glDeleteFramebuffers(1, &id));
+
+    if (pick_readback.capacity != 0)
+        pick_readback.destroy();
 }
 
 void Framebuffer::bind() const {
@@ -1255,11 +1337,15 @@ void Framebuffer::remove_color_attachment(int32_t index) {
 }
 
 void Framebuffer::fill_color_draw_buffers() {
-    std::vector<GLenum> buffers(color_attachments.size());
+    /* GL guarantees at least 8. Called every pass, so kept off the heap. */
+    std::array<GLenum, 8> buffers;
+    assert(color_attachments.size() <= buffers.size() &&
+           "Too many color attachments");
+
     for (int32_t i = 0; i < color_attachments.size(); i++)
         buffers[i] = GL_COLOR_ATTACHMENT0 + i;
 
-    GL_CALL(glDrawBuffers(buffers.size(), buffers.data()));
+    GL_CALL(glDrawBuffers(color_attachments.size(), buffers.data()));
 }
 
 glm::u8vec4 Framebuffer::pixel_at(const glm::vec2 &coords,
@@ -1274,11 +1360,232 @@ glm::u8vec4 Framebuffer::pixel_at(const glm::vec2 &coords,
     return pixel;
 }
 
+bool Framebuffer::request_pick(const glm::vec2 &coords,
+                               int32_t attachment_idx) {
+    if (pick_readback.capacity == 0)
+        pick_readback = AsyncReadback::create(sizeof(glm::u8vec4));
+
+    bind();
+    GL_CALL(glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment_idx));
+    bool queued = pick_readback.request_pixels(glm::ivec2(coords), {1, 1},
+                                               GL_RGBA, GL_UNSIGNED_BYTE);
+    unbind();
+
+    return queued;
+}
+
+std::optional<glm::u8vec4> Framebuffer::poll_pick() {
+    if (!pick_readback.has_pending())
+        return std::nullopt;
+
+    glm::u8vec4 pixel;
+    if (!pick_readback.poll(&pixel[0]))
+        return std::nullopt;
+
+    return pixel;
+}
+
 bool Framebuffer::is_complete() const {
     GL_CALL(return glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
                    GL_FRAMEBUFFER_COMPLETE);
 }
 
+AsyncReadback AsyncReadback::create(uint32_t max_size) {
+    AsyncReadback readback;
+    readback.capacity = max_size;
+
+    GL_CALL(glGenBuffers(AsyncReadback::RING_SIZE, readback.buffers.data()));
+    for (GLuint buffer : readback.buffers) {
+        GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer));
+        GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, max_size, nullptr,
+                             GL_STREAM_READ));
+    }
+
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    return readback;
+}
+
+void AsyncReadback::destroy() {
+    assert(capacity != 0 && "Trying to destroy invalid async readback");
+
+    for (GLsync &fence : fences) {
+        if (fence != nullptr) {
+            GL_CALL(glDeleteSync(fence));
+            fence = nullptr;
+        }
+    }
+
+    GL_CALL(glDeleteBuffers(RING_SIZE, buffers.data()));
+    buffers = {};
+    head = 0;
+    pending = 0;
+    capacity = 0;
+}
+
+/* Bytes per pixel glReadPixels writes for FORMAT and TYPE. */
+static uint32_t pixel_size(GLenum format, GLenum type) {
+    switch (type) {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+        return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+    case GL_UNSIGNED_INT_24_8:
+        return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8;
+    }
+
+    uint32_t components = 0;
+    switch (format) {
+    case GL_RED:
+    case GL_GREEN:
+    case GL_BLUE:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+    case GL_BGR_INTEGER:
+        components = 3;
+        break;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+    case GL_BGRA_INTEGER:
+        components = 4;
+        break;
+    default:
+        assert(false && "Unsupported readback format");
+    }
+
+    switch (type) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+        return components;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        return components * 2;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+        return components * 4;
+    }
+
+    assert(false && "Unsupported readback type");
+    return 0;
+}
+
+bool AsyncReadback::request_pixels(const glm::ivec2 &coords,
+                                   const glm::ivec2 &size, GLenum format,
+                                   GLenum type) {
+    assert(capacity != 0 && "Trying to read into invalid async readback");
+    assert(size.x > 0 && size.y > 0 && "Empty readback");
+
+    /* Rows start at the pack alignment, the last one isn't padded. */
+    GLint alignment = 4;
+    GL_CALL(glGetIntegerv(GL_PACK_ALIGNMENT, &alignment));
+    uint32_t row_size = size.x * pixel_size(format, type);
+    uint32_t row_stride = (row_size + alignment - 1) / alignment * alignment;
+    uint32_t bytes = row_stride * (size.y - 1) + row_size;
+    assert(bytes <= capacity && "Readback bigger than allocated buffers");
+
+    if (pending == RING_SIZE || bytes > capacity)
+        return false;
+
+    /* PBO bound to the pack target turns the pointer into buffer offset. */
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[head]));
+    GL_CALL(glReadPixels(coords.x, coords.y, size.x, size.y, format, type,
+                         nullptr));
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    GL_CALL(fences[head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    sizes[head] = bytes;
+
+    head = (head + 1) % RING_SIZE;
+    pending++;
+
+    return true;
+}
+
+bool AsyncReadback::request_buffer(GLuint buffer, uint32_t offset,
+                                   uint32_t size) {
+    assert(capacity != 0 && "Trying to read into invalid async readback");
+    assert(size <= capacity && "Readback bigger than allocated buffers");
+
+    if (pending == RING_SIZE)
+        return false;
+
+    GL_CALL(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+    GL_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[head]));
+    GL_CALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                (GLintptr)offset, 0, size));
+    GL_CALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GL_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    GL_CALL(fences[head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    sizes[head] = size;
+
+    head = (head + 1) % RING_SIZE;
+    pending++;
+
+    return true;
+}
+
+bool AsyncReadback::poll(void *dst) {
+    assert(capacity != 0 && "Trying to poll invalid async readback");
+
+    if (pending == 0)
+        return false;
+
+    int32_t oldest = (head - pending + RING_SIZE) % RING_SIZE;
+
+    /* Zero timeout - only checks the status. Flush bit makes sure the fence
+     * actually reaches the GPU, otherwise it could never get signaled. */
+    GLenum status = GL_TIMEOUT_EXPIRED;
+    GL_CALL(status = glClientWaitSync(fences[oldest],
+                                      GL_SYNC_FLUSH_COMMANDS_BIT, 0));
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+        return false;
+
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[oldest]));
+    void *mapped = nullptr;
+    GL_CALL(mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizes[oldest],
+                                      GL_MAP_READ_BIT));
+    if (mapped != nullptr) {
+        std::memcpy(dst, mapped, sizes[oldest]);
+        GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    GL_CALL(glDeleteSync(fences[oldest]));
+    fences[oldest] = nullptr;
+    pending--;
+
+    return mapped != nullptr;
+}
+
 UniformBuffer UniformBuffer::create(const void *data, uint32_t size) {
     UniformBuffer ubo;
     GL_CALL(glGenBuffers(1, &ubo.id));
@@ -0,0 +1,129 @@
+#include "eng/renderer/render_queue.hpp"
+#include <array>
+#include <cassert>
+#include <glm/common.hpp>
+
+namespace eng {
+
+static constexpr int32_t DEPTH_SHIFT = 0;
+static constexpr int32_t KIND_SHIFT = DEPTH_SHIFT + SortKey::DEPTH_BITS;
+static constexpr int32_t MESH_SHIFT = KIND_SHIFT + SortKey::KIND_BITS;
+static constexpr int32_t TEXTURE_SET_SHIFT = MESH_SHIFT + SortKey::MESH_BITS;
+static constexpr int32_t SHADER_SHIFT =
+    TEXTURE_SET_SHIFT + SortKey::TEXTURE_SET_BITS;
+static constexpr int32_t PASS_SHIFT = SHADER_SHIFT + SortKey::SHADER_BITS;
+
+static constexpr uint64_t field_mask(int32_t bits) {
+    return (1ull << bits) - 1;
+}
+
+uint64_t pack_sort_key(const SortKey &key) {
+    assert(key.pass <= field_mask(SortKey::PASS_BITS) &&
+           "Pass doesn't fit into sort key");
+    assert((uint64_t)key.shader_index <= field_mask(SortKey::SHADER_BITS) &&
+           "Shader index doesn't fit into sort key");
+    assert((uint64_t)key.texture_set_index <=
+               field_mask(SortKey::TEXTURE_SET_BITS) &&
+           "Texture set index doesn't fit into sort key");
+    assert((uint64_t)key.mesh_index <= field_mask(SortKey::MESH_BITS) &&
+           "Mesh index doesn't fit into sort key");
+
+    return ((uint64_t)key.pass & field_mask(SortKey::PASS_BITS))
+               << PASS_SHIFT |
+           ((uint64_t)key.shader_index & field_mask(SortKey::SHADER_BITS))
+               << SHADER_SHIFT |
+           ((uint64_t)key.texture_set_index &
+            field_mask(SortKey::TEXTURE_SET_BITS))
+               << TEXTURE_SET_SHIFT |
+           ((uint64_t)key.mesh_index & field_mask(SortKey::MESH_BITS))
+               << MESH_SHIFT |
+           ((uint64_t)key.kind & field_mask(SortKey::KIND_BITS))
+               << KIND_SHIFT |
+           (uint64_t)key.depth << DEPTH_SHIFT;
+}
+
+SortKey unpack_sort_key(uint64_t key) {
+    SortKey fields;
+    fields.pass = (key >> PASS_SHIFT) & field_mask(SortKey::PASS_BITS);
+    fields.shader_index =
+        (key >> SHADER_SHIFT) & field_mask(SortKey::SHADER_BITS);
+    fields.texture_set_index =
+        (key >> TEXTURE_SET_SHIFT) & field_mask(SortKey::TEXTURE_SET_BITS);
+    fields.mesh_index = (key >> MESH_SHIFT) & field_mask(SortKey::MESH_BITS);
+    fields.kind = (RenderItemKind)((key >> KIND_SHIFT) &
+                                   field_mask(SortKey::KIND_BITS));
+    fields.depth = (key >> DEPTH_SHIFT) & field_mask(SortKey::DEPTH_BITS);
+    return fields;
+}
+
+uint16_t quantize_depth(float distance, float far_clip) {
+    float normalized = glm::clamp(distance / far_clip, 0.0f, 1.0f);
+    return (uint16_t)(normalized * field_mask(SortKey::DEPTH_BITS));
+}
+
+void RenderQueue::push(uint64_t key, uint32_t payload, uint32_t source) {
+    RenderItem &item = items.emplace_back();
+    item.key = key;
+    item.payload = payload;
+    item.source = source;
+}
+
+void RenderQueue::clear() {
+    items.clear();
+}
+
+void RenderQueue::reserve(size_t count) {
+    if (count > items.capacity())
+        items.reserve(count + count / 2);
+
+    /* Scratch follows the items, not the exact size sorted last. */
+    if (items.capacity() > scratch.capacity())
+        scratch.reserve(items.capacity());
+}
+
+void RenderQueue::sort() {
+    static constexpr int32_t DIGITS = sizeof(uint64_t);
+    static constexpr int32_t RADIX = 256;
+
+    if (items.size() < 2)
+        return;
+
+    /* Counts of every digit, all gathered in one go. */
+    std::array<std::array<uint32_t, RADIX>, DIGITS> counts{};
+    for (const RenderItem &item : items) {
+        for (int32_t digit = 0; digit < DIGITS; digit++)
+            counts[digit][(item.key >> (digit * 8)) & 0xFF]++;
+    }
+
+    reserve(items.size());
+    scratch.resize(items.size());
+    RenderItem *src = items.data();
+    RenderItem *dst = scratch.data();
+    for (int32_t digit = 0; digit < DIGITS; digit++) {
+        std::array<uint32_t, RADIX> &digit_counts = counts[digit];
+
+        /* Every key has the same byte here, order wouldn't change. */
+        uint8_t any_byte = (src[0].key >> (digit * 8)) & 0xFF;
+        if (digit_counts[any_byte] == items.size())
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t &count : digit_counts) {
+            uint32_t bucket = count;
+            count = offset;
+            offset += bucket;
+        }
+
+        for (size_t i = 0; i < items.size(); i++) {
+            uint8_t byte = (src[i].key >> (digit * 8)) & 0xFF;
+            dst[digit_counts[byte]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != items.data())
+        items.swap(scratch);
+}
+
+} // namespace eng
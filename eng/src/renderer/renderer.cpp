@@ -1,14 +1,25 @@
 #include "eng/renderer/renderer.hpp"
+#include "eng/frame_memory.hpp"
+#include "eng/jobs.hpp"
+#include "eng/renderer/gpu_culling.hpp"
+#include "eng/renderer/instance_ring.hpp"
+#include "eng/renderer/material_table.hpp"
 #include "eng/renderer/opengl.hpp"
 #include "eng/renderer/primitives.hpp"
+#include "eng/renderer/render_queue.hpp"
+#include "eng/renderer/static_batch.hpp"
 #include "eng/scene/assets.hpp"
+#include "eng/scene/bvh.hpp"
 #include "eng/scene/components.hpp"
 #include "GLFW/glfw3.h"
 #include "eng/timer.hpp"
 #include "glm/fwd.hpp"
 #include "glm/gtc/constants.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
+#include <memory_resource>
 #include <random>
 #include <strings.h>
 #include <vector>
@@ -30,9 +41,52 @@ struct GPU {
     int32_t max_geom_invocations = 0;
 };
 
-using MeshGroup = std::unordered_map<AssetID, std::vector<MeshInstance>>;
-using MaterialGroup = std::unordered_map<AssetID, MeshGroup>;
-using ShaderGroup = std::unordered_map<AssetID, MaterialGroup>;
+/* Pass field of sort keys. */
+static constexpr uint32_t SHADOW_PASS = 0;
+static constexpr uint32_t BASE_PASS = 1;
+
+/* Starting size of the instance ring, grows as needed. */
+static constexpr int32_t INITIAL_FRAME_INSTANCES = 16384;
+
+/* Bigger batches are drawn in chunks, so no single draw runs long enough to
+ * trip drivers' watchdogs. */
+static constexpr int32_t MAX_INSTANCES_PER_DRAW = 65536;
+
+/* Starting size of the materials buffer, in materials. */
+static constexpr int32_t MIN_MATERIALS_STORAGE = 64;
+
+/* Visible clusters of a static batch, as a range of static commands. */
+struct StaticDraw {
+    int32_t first = 0;
+    int32_t count = 0;
+
+    /* Base pass only, 0 in shadow passes. */
+    AssetID material_id = 0;
+};
+
+/* Mesh submissions of one job thread, see jobs::thread_index(). Merged
+ * into the pass' queue once it ends, before anything touches GL. Aligned
+ * so neighbours don't share cache lines. */
+struct alignas(64) SubmitBucket {
+    RenderQueue queue;
+    std::vector<MeshInstance> instances;
+    uint32_t index = 0;
+
+    /* Scratch of submit_meshes(). */
+    std::vector<MeshAABB> local_bbs;
+    std::vector<uint8_t> visible;
+
+    /* Instance counters, added to the renderer's when merged. */
+    RenderStats stats;
+};
+
+/* Commands of one texture set, a range of the pass' indirect buffer. */
+struct TextureSetDraws {
+    AssetID shader_id = 0;
+    AssetID texture_set_id = 0;
+    int32_t first = 0;
+    int32_t count = 0;
+};
 
 struct Renderer {
     GPU gpu;
@@ -83,7 +137,43 @@ struct Renderer {
     SoftShadowProps soft_shadow_props;
     SoftShadowProps cached_soft_shadow_props;
 
-    ShaderGroup shader_render_group;
+    /* Shared by both passes, cleared when either begins. Static draws go
+     * straight into the queue, payloads indexing STATIC_DRAWS - instances
+     * come from buckets, their items index the bucket's instances. */
+    RenderQueue render_queue;
+    std::vector<SubmitBucket> buckets;
+    uint32_t pass = SHADOW_PASS;
+
+    /* Assets' indices in sort keys, rebuilt when a pass begins. Texture
+     * sets are material IDs. */
+    SortKeyIndices shader_indices;
+    SortKeyIndices material_indices;
+    SortKeyIndices mesh_indices;
+
+    InstanceRing instance_ring;
+
+    /* Submitted GPU scene of the pass, if any. Commands of its groups go
+     * after the queue's, CULL_GROUPS tell the culler where. */
+    GpuScene *gpu_scene = nullptr;
+    GpuCuller culler;
+    std::vector<CullGroup> cull_groups;
+    std::vector<float> cull_lod_sizes;
+
+    std::vector<StaticDraw> static_draws;
+    std::vector<DrawElementsIndirectCommand> static_commands;
+
+    /* Whole pass' commands, written once it ends. */
+    IndirectBuffer indirect_buffer;
+    std::vector<TextureSetDraws> texture_set_draws;
+
+    /* Parameters of every material, indexed by the instances' material
+     * index. Synced when the base pass begins. */
+    MaterialTable material_table;
+    ShaderStorage materials_storage;
+    int32_t materials_allocated = MIN_MATERIALS_STORAGE;
+
+    /* Extracted once per pass from the active camera. */
+    Frustum camera_frustum;
 };
 
 static Renderer s_renderer{};
@@ -92,6 +182,49 @@ static const CameraData *s_active_camera{};
 static EnvMap *s_envmap{};
 static Framebuffer *s_target_fbo{};
 
+/* Spelled out, building them every frame is pointless allocations. */
+static constexpr std::array<const char *, CASCADES_COUNT>
+    CASCADE_DISTANCE_UNIFORMS = {
+        "u_cascade_distances[0]", "u_cascade_distances[1]",
+        "u_cascade_distances[2]", "u_cascade_distances[3]",
+        "u_cascade_distances[4]"};
+static_assert(CASCADES_COUNT == 5 && "Update CASCADE_DISTANCE_UNIFORMS");
+
+static void reset_queue(uint32_t pass) {
+    s_renderer.pass = pass;
+    s_renderer.render_queue.clear();
+
+    /* Job system might've been restarted with a different thread count. */
+    s_renderer.buckets.resize(jobs::threads_count());
+    for (uint32_t i = 0; i < s_renderer.buckets.size(); i++) {
+        SubmitBucket &bucket = s_renderer.buckets[i];
+        bucket.queue.clear();
+        bucket.instances.clear();
+        bucket.index = i;
+        bucket.stats = {};
+    }
+
+    s_renderer.gpu_scene = nullptr;
+    s_renderer.static_draws.clear();
+    s_renderer.static_commands.clear();
+
+    /* Assets past what fits don't get drawn, rather than breaking the order
+     * of everything else. */
+    bool fits = s_renderer.shader_indices.assign(s_asset_pack->shaders,
+                                                 SortKey::SHADER_BITS);
+    fits &= s_renderer.material_indices.assign(s_asset_pack->materials,
+                                               SortKey::TEXTURE_SET_BITS);
+    fits &= s_renderer.mesh_indices.assign(s_asset_pack->meshes,
+                                           SortKey::MESH_BITS);
+
+    static bool reported = false;
+    if (!fits && !reported)
+        fprintf(stderr, "Too many assets for sort keys, some won't be "
+                        "drawn\r\n");
+    reported = !fits;
+}
+
+
 void opengl_msg_cb(unsigned source, unsigned type, unsigned id,
                    unsigned severity, int length, const char *msg,
                    const void *user_param) {
@@ -159,8 +292,11 @@ static void soft_shadow_random_offset_texture_create() {
     GL_CALL(glBindTexture(GL_TEXTURE_3D, 0));
 }
 
-bool init() {
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+bool init(GLADloadproc gl_loader) {
+    if (gl_loader == nullptr)
+        gl_loader = (GLADloadproc)glfwGetProcAddress;
+
+    if (!gladLoadGLLoader(gl_loader))
         return false;
 
     GPU &gpu_spec = s_renderer.gpu;
@@ -200,6 +336,15 @@ bool init() {
     s_renderer.slots.spot_lights_shadowmaps = gpu_spec.texture_units - 3;
     s_renderer.slots.random_offsets_texture = gpu_spec.texture_units - 4;
 
+    /* 16 units (the minimum) leave room for half of the arrays. */
+    s_renderer.slots.texture_arrays = 8;
+    s_renderer.slots.texture_arrays_count =
+        glm::min(TextureArrays::MAX_ARRAYS,
+                 s_renderer.slots.random_offsets_texture -
+                     s_renderer.slots.texture_arrays);
+    assert(s_renderer.slots.texture_arrays_count > 0 &&
+           "Not enough texture units for texture arrays");
+
     GL_CALL(glEnable(GL_DEBUG_OUTPUT));
     GL_CALL(glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS));
     GL_CALL(glDebugMessageCallback(opengl_msg_cb, nullptr));
@@ -336,6 +481,10 @@ bool init() {
     s_renderer.spot_lights_storage.bind_buffer_range(SPOT_LIGHTS_BINDING, 0,
                                                      size);
 
+    size = MIN_MATERIALS_STORAGE * sizeof(MaterialData);
+    s_renderer.materials_storage = ShaderStorage::create(nullptr, size);
+    s_renderer.materials_storage.bind_buffer_range(MATERIALS_BINDING, 0, size);
+
     size = sizeof(SoftShadowProps);
     s_renderer.soft_shadow_uni_buffer= UniformBuffer::create(nullptr, size);
     s_renderer.soft_shadow_uni_buffer.bind_buffer_range(
@@ -524,6 +673,17 @@ bool init() {
 
     soft_shadow_random_offset_texture_create();
 
+    s_renderer.instance_ring = InstanceRing::create(INITIAL_FRAME_INSTANCES);
+    s_renderer.indirect_buffer = IndirectBuffer::create();
+
+    {
+        std::optional<GpuCuller> culler =
+            GpuCuller::create("resources/shaders/cull_instances.comp",
+                              "resources/shaders/scatter_candidates.comp");
+        assert(culler.has_value() && "Instance culling shader not built");
+        s_renderer.culler = culler.value();
+    }
+
     return true;
 }
 
@@ -532,6 +692,8 @@ void shutdown() {
     s_renderer.dir_lights_storage.destroy();
     s_renderer.point_lights_storage.destroy();
     s_renderer.spot_lights_storage.destroy();
+    s_renderer.materials_storage.destroy();
+    s_renderer.material_table = {};
     s_renderer.soft_shadow_uni_buffer.destroy();
 
     s_renderer.light_culling_shader.destroy();
@@ -556,6 +718,370 @@ void shutdown() {
     s_renderer.bloom_filter.destroy();
     s_renderer.bloom_downsampler.destroy();
     s_renderer.bloom_upsampler.destroy();
+
+    s_renderer.instance_ring.destroy();
+    s_renderer.indirect_buffer.destroy();
+    s_renderer.culler.destroy();
+}
+
+static SubmitBucket &thread_bucket() {
+    int32_t idx = jobs::thread_index();
+    assert(idx >= 0 && idx < (int32_t)s_renderer.buckets.size() &&
+           "Meshes submitted from outside the job system");
+    return s_renderer.buckets[idx];
+}
+
+/* Moves items of every bucket into the pass' queue, ready for sorting.
+ * Instances stay in their buckets. The queue is reserved up front - ranges
+ * inserted into an empty vector would grow it to their exact size. */
+static void merge_buckets() {
+    RenderQueue &queue = s_renderer.render_queue;
+    RenderStats &stats = s_renderer.stats;
+
+    size_t items_count = queue.items.size();
+    for (const SubmitBucket &bucket : s_renderer.buckets)
+        items_count += bucket.queue.items.size();
+
+    queue.reserve(items_count);
+    for (SubmitBucket &bucket : s_renderer.buckets) {
+        queue.items.insert(queue.items.end(), bucket.queue.items.begin(),
+                           bucket.queue.items.end());
+        bucket.queue.clear();
+
+        stats.submitted_instances += bucket.stats.submitted_instances;
+        stats.accepted_instances += bucket.stats.accepted_instances;
+        stats.shadow_meshes_rendered += bucket.stats.shadow_meshes_rendered;
+        bucket.stats = {};
+    }
+}
+
+static const MeshInstance &queued_instance(const RenderItem &item) {
+    return s_renderer.buckets[item.source].instances[item.payload];
+}
+
+/* Number of items from FIRST on that go into the same draw. */
+static size_t run_length(size_t first) {
+    const std::vector<RenderItem> &items = s_renderer.render_queue.items;
+    uint64_t state = items[first].key & SortKey::STATE_MASK;
+
+    size_t last = first + 1;
+    while (last < items.size() &&
+           (items[last].key & SortKey::STATE_MASK) == state)
+        last++;
+
+    return last - first;
+}
+
+/* Group of the pass' GPU scene, see gpu_scene_draws(). */
+struct GpuSceneDraw {
+    uint32_t group = 0;
+    AssetID shader_id = 0;
+    AssetID texture_set_id = 0;
+    AssetID mesh_id = 0;
+    const Mesh *mesh = nullptr;
+    int32_t members = 0;
+};
+
+/* Groups of the pass' GPU scene with members, base pass ones in the order
+ * their shaders and texture sets get bound. Groups whose material or mesh
+ * is gone don't get drawn. */
+static std::pmr::vector<GpuSceneDraw> gpu_scene_draws() {
+    std::pmr::vector<GpuSceneDraw> draws(frame_memory::resource());
+    if (s_renderer.gpu_scene == nullptr)
+        return draws;
+
+    bool base_pass = s_renderer.pass == BASE_PASS;
+    const GpuSceneGroups &groups = base_pass
+                                       ? s_renderer.gpu_scene->groups
+                                       : s_renderer.gpu_scene->shadow_groups;
+    for (uint32_t i = 0; i < groups.groups.size(); i++) {
+        const GpuSceneGroup &group = groups.groups[i];
+        auto mesh = s_asset_pack->meshes.find(group.mesh_id);
+        if (group.members == 0 || mesh == s_asset_pack->meshes.end())
+            continue;
+
+        GpuSceneDraw draw;
+        draw.group = i;
+        draw.mesh_id = group.mesh_id;
+        draw.mesh = &mesh->second;
+        draw.members = group.members;
+        if (base_pass) {
+            auto material = s_asset_pack->materials.find(group.material_id);
+            if (material == s_asset_pack->materials.end() ||
+                !s_asset_pack->shaders.contains(material->second.shader_id))
+                continue;
+
+            draw.shader_id = material->second.shader_id;
+            draw.texture_set_id =
+                s_renderer.material_table.texture_sets[group.material_id];
+        }
+
+        draws.push_back(draw);
+    }
+
+    std::sort(draws.begin(), draws.end(),
+              [](const GpuSceneDraw &lhs, const GpuSceneDraw &rhs) {
+                  return std::tie(lhs.shader_id, lhs.texture_set_id,
+                                  lhs.mesh_id) < std::tie(rhs.shader_id,
+                                                          rhs.texture_set_id,
+                                                          rhs.mesh_id);
+              });
+
+    return draws;
+}
+
+/* Commands of GPU scene's groups, one per LOD level, each with room for all
+ * of the group's members - culling writes the survivors. Fills the pass'
+ * cull groups. Shadow passes have a single texture set, the queue's one. */
+static void push_gpu_scene_draws(
+    std::span<const GpuSceneDraw> draws,
+    std::pmr::vector<DrawElementsIndirectCommand> &commands) {
+    std::vector<TextureSetDraws> &set_draws = s_renderer.texture_set_draws;
+    std::vector<CullGroup> &cull_groups = s_renderer.cull_groups;
+    std::vector<float> &lod_sizes = s_renderer.cull_lod_sizes;
+
+    cull_groups.clear();
+    lod_sizes.clear();
+    if (s_renderer.gpu_scene != nullptr) {
+        const GpuScene &gpu_scene = *s_renderer.gpu_scene;
+        cull_groups.resize(s_renderer.pass == BASE_PASS
+                               ? gpu_scene.groups.groups.size()
+                               : gpu_scene.shadow_groups.groups.size());
+    }
+
+    for (const GpuSceneDraw &draw : draws) {
+        if (set_draws.empty() ||
+            (s_renderer.pass == BASE_PASS &&
+             (set_draws.back().texture_set_id != draw.texture_set_id ||
+              set_draws.back().shader_id != draw.shader_id))) {
+            TextureSetDraws &set = set_draws.emplace_back();
+            set.shader_id = draw.shader_id;
+            set.texture_set_id = draw.texture_set_id;
+            set.first = commands.size();
+        }
+
+        CullGroup &group = cull_groups[draw.group];
+        group.first_command = commands.size();
+        group.levels = draw.mesh->lods.size();
+        group.first_lod_size = lod_sizes.size();
+
+        for (uint32_t level = 0; level <= group.levels; level++) {
+            const Mesh *mesh = draw.mesh;
+            if (level > 0) {
+                const MeshLod &lod = draw.mesh->lods[level - 1];
+                mesh = &s_asset_pack->meshes.at(lod.mesh_id);
+                lod_sizes.push_back(lod.screen_size);
+            }
+
+            DrawElementsIndirectCommand &command = commands.emplace_back();
+            command.count = mesh->geometry.indices_count;
+            command.instance_count = 0;
+            command.first_index = mesh->geometry.first_index;
+            command.base_vertex = mesh->geometry.base_vertex;
+            command.base_instance =
+                s_renderer.instance_ring.claim(draw.members);
+            s_renderer.stats.instanced_draws++;
+        }
+
+        set_draws.back().count = commands.size() - set_draws.back().first;
+    }
+}
+
+/* Sorts the pass' merged queue and walks it once, writing instances to the
+ * instance ring in queue order and turning every run of items needing the
+ * same state into indirect commands - grouped by texture set, in the order
+ * the base pass binds them. GPU scene's commands come last, for culling to
+ * fill. Everything goes into the ring before anything gets drawn, growing
+ * it would lose what was written earlier. */
+static void upload_pass() {
+    RenderQueue &queue = s_renderer.render_queue;
+    queue.sort();
+
+    /* Static draws get one each, to carry their material. */
+    int32_t instances_count = s_renderer.static_draws.size();
+    for (const SubmitBucket &bucket : s_renderer.buckets)
+        instances_count += bucket.instances.size();
+
+    std::pmr::vector<GpuSceneDraw> gpu_draws = gpu_scene_draws();
+    int32_t gpu_room = 0;
+    for (const GpuSceneDraw &draw : gpu_draws)
+        gpu_room += draw.members * (draw.mesh->lods.size() + 1);
+
+    InstanceRing &ring = s_renderer.instance_ring;
+    ring.reserve(instances_count + gpu_room);
+    s_renderer.stats.uploaded_instances += instances_count;
+    s_renderer.stats.instance_ring_capacity = ring.region_capacity;
+
+    std::pmr::vector<DrawElementsIndirectCommand> commands(
+        frame_memory::resource());
+    std::vector<TextureSetDraws> &set_draws = s_renderer.texture_set_draws;
+    set_draws.clear();
+
+    for (size_t first = 0; first < queue.items.size();) {
+        size_t count = run_length(first);
+        std::span<const RenderItem> run(queue.items.data() + first, count);
+        first += count;
+
+        SortKey key = unpack_sort_key(run[0].key);
+        AssetID shader_id = s_renderer.shader_indices.id_at(key.shader_index);
+        AssetID texture_set_id =
+            s_renderer.material_indices.id_at(key.texture_set_index);
+        if (set_draws.empty() ||
+            set_draws.back().texture_set_id != texture_set_id ||
+            set_draws.back().shader_id != shader_id) {
+            TextureSetDraws &draws = set_draws.emplace_back();
+            draws.shader_id = shader_id;
+            draws.texture_set_id = texture_set_id;
+            draws.first = commands.size();
+        }
+
+        if (key.kind == RenderItemKind::STATIC_DRAW) {
+            for (const RenderItem &item : run) {
+                const StaticDraw &draw = s_renderer.static_draws[item.payload];
+
+                /* Batches are baked in world space, the instance only
+                 * carries their material. */
+                uint32_t base_instance = ring.claim(1);
+                MeshInstance &instance = ring.mapped[base_instance];
+                instance.transform = glm::mat4(1.0f);
+                instance.entity_id = 0.0f;
+                instance.material_index = draw.material_id;
+
+                for (int32_t i = 0; i < draw.count; i++) {
+                    DrawElementsIndirectCommand &command =
+                        commands.emplace_back(
+                            s_renderer.static_commands[draw.first + i]);
+                    command.base_instance = base_instance;
+                }
+            }
+
+            set_draws.back().count = commands.size() - set_draws.back().first;
+            continue;
+        }
+
+        const Mesh &mesh = s_asset_pack->meshes.at(
+            s_renderer.mesh_indices.id_at(key.mesh_index));
+        const GeometryRange &geometry = mesh.geometry;
+
+        uint32_t base_instance = ring.claim(count);
+        MeshInstance *dst = ring.mapped + base_instance;
+        for (size_t i = 0; i < count; i++)
+            dst[i] = queued_instance(run[i]);
+
+        for (size_t chunk = 0; chunk < count;
+             chunk += MAX_INSTANCES_PER_DRAW) {
+            uint32_t chunk_count =
+                glm::min(count - chunk, (size_t)MAX_INSTANCES_PER_DRAW);
+
+            DrawElementsIndirectCommand &command = commands.emplace_back();
+            command.count = geometry.indices_count;
+            command.instance_count = chunk_count;
+            command.first_index = geometry.first_index;
+            command.base_vertex = geometry.base_vertex;
+            command.base_instance = base_instance + chunk;
+            s_renderer.stats.instanced_draws++;
+        }
+
+        set_draws.back().count = commands.size() - set_draws.back().first;
+    }
+
+    push_gpu_scene_draws(gpu_draws, commands);
+
+    s_renderer.indirect_buffer.set_commands(commands.data(), commands.size());
+    s_renderer.stats.draw_commands += commands.size();
+}
+
+/* Uploads what changed in the pass' GPU scene, and points culling at the
+ * commands upload_pass() left for it. */
+static CullPass prepare_gpu_cull() {
+    GpuScene &gpu_scene = *s_renderer.gpu_scene;
+    s_renderer.stats.gpu_cull_candidates += gpu_scene.candidates.size();
+    s_renderer.stats.patched_candidates += s_renderer.culler.sync(gpu_scene);
+
+    CullPass pass;
+    pass.groups = s_renderer.cull_groups;
+    pass.lod_sizes = s_renderer.cull_lod_sizes;
+    pass.camera_position = glm::vec3(s_active_camera->position);
+    pass.projection_scale = s_active_camera->projection[1][1];
+
+    return pass;
+}
+
+/* Everything is drawn from the asset pack's geometry pool, with instances
+ * from the ring. */
+static void bind_pass_geometry() {
+    const VertexArray &vao = s_asset_pack->geometry.vao;
+    s_renderer.instance_ring.attach(vao);
+    vao.bind();
+    s_renderer.indirect_buffer.bind();
+}
+
+/* COUNT commands of the indirect buffer, starting at FIRST. */
+static void multi_draw(const Shader &shader, int32_t first, int32_t count) {
+    shader.bind();
+
+    GL_CALL(glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        (const void *)(first * sizeof(DrawElementsIndirectCommand)), count,
+        0));
+}
+
+static void multi_draw_pass(const Shader &shader) {
+    multi_draw(shader, 0, s_renderer.indirect_buffer.commands_count);
+}
+
+/* Parameters come from the materials buffer, only textures get bound. Set 0
+ * is materials with all of them in texture arrays, bound for the whole pass. */
+static void bind_texture_set(AssetID texture_set_id) {
+    if (texture_set_id == 0)
+        return;
+
+    const std::array<AssetID, 4> &tex_ids =
+        s_renderer.material_table.textures[texture_set_id];
+    std::array<int32_t, 4> tex_bindings = {
+        s_renderer.slots.albedo, s_renderer.slots.normal,
+        s_renderer.slots.orm, s_renderer.slots.emission_map};
+
+    for (int32_t i = 0; i < tex_ids.size(); i++) {
+        Texture &tex = s_asset_pack->textures.at(tex_ids[i]);
+        tex.bind(tex_bindings[i]);
+    }
+}
+
+/* Materials are edited in place, so they're compared every frame - only
+ * what changed gets uploaded. Runs before submission, which reads texture
+ * sets from job threads. Textures get packed first, materials carry their
+ * layers. */
+static void sync_materials() {
+    TextureArrays &arrays = s_asset_pack->texture_arrays;
+    (void)arrays.sync(s_asset_pack->textures);
+
+    MaterialTable &table = s_renderer.material_table;
+    MaterialRange changed = table.sync(s_asset_pack->materials, arrays);
+
+    int32_t needed = table.data.size();
+    if (needed > s_renderer.materials_allocated) {
+        while (s_renderer.materials_allocated < needed)
+            s_renderer.materials_allocated *= 2;
+
+        uint32_t size = s_renderer.materials_allocated * sizeof(MaterialData);
+        s_renderer.materials_storage.bind();
+        s_renderer.materials_storage.realloc(size);
+        s_renderer.materials_storage.bind_buffer_range(MATERIALS_BINDING, 0,
+                                                       size);
+
+        /* Reallocated buffer starts out empty. */
+        changed = {0, needed};
+    }
+
+    if (changed.count == 0)
+        return;
+
+    s_renderer.materials_storage.set_data(
+        table.data.data() + changed.first,
+        changed.count * sizeof(MaterialData),
+        changed.first * sizeof(MaterialData));
+    s_renderer.stats.uploaded_materials += changed.count;
 }
 
 void scene_begin(const CameraData &camera, AssetPack &asset_pack,
@@ -563,6 +1089,7 @@ void scene_begin(const CameraData &camera, AssetPack &asset_pack,
     s_asset_pack = &asset_pack;
     s_active_camera = &camera;
     s_target_fbo = &target_fbo;
+    s_renderer.camera_frustum = extract_frustum_planes(camera.view_projection);
 
     assert(s_asset_pack && "Empty asset pack object");
 
@@ -570,18 +1097,8 @@ void scene_begin(const CameraData &camera, AssetPack &asset_pack,
     s_renderer.point_lights.clear();
     s_renderer.spot_lights.clear();
 
-    for (auto &[shader_id, shader_group] : s_renderer.shader_render_group) {
-        for (auto &[mat_id, mat_group] : shader_group) {
-            for (auto &[mesh_id, instances] : mat_group)
-                instances.clear();
-
-            mat_group.clear();
-        }
-
-        shader_group.clear();
-    }
-
-    s_renderer.shader_render_group.clear();
+    reset_queue(BASE_PASS);
+    sync_materials();
 
     s_renderer.camera_uni_buffer.bind();
     s_renderer.camera_uni_buffer.set_data(&camera, sizeof(CameraData));
@@ -633,17 +1150,18 @@ void scene_end() {
     GL_CALL(glDrawBuffer(GL_NONE));
     GL_CALL(glDepthFunc(GL_LESS));
 
-    for (auto &[shader_id, material_group] : s_renderer.shader_render_group) {
-        for (auto &[mat_id, mesh_group] : material_group) {
-            for (auto &[mesh_id, instances] : mesh_group) {
-                Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-                mesh.vao.vbo_instanced.set_data(
-                    instances.data(), instances.size() * sizeof(MeshInstance));
-                draw_elements_instanced(s_renderer.depth_pass_shader, mesh.vao,
-                                        instances.size());
-            }
-        }
-    }
+    /* Prepass and base pass draw the same instances, with the same
+     * commands. */
+    merge_buckets();
+    upload_pass();
+    if (s_renderer.gpu_scene != nullptr)
+        s_renderer.culler.cull(*s_renderer.gpu_scene, prepare_gpu_cull(),
+                               s_renderer.camera_frustum,
+                               s_renderer.indirect_buffer,
+                               s_renderer.instance_ring.buffer);
+
+    bind_pass_geometry();
+    multi_draw_pass(s_renderer.depth_pass_shader);
 
     int32_t count = s_renderer.dir_lights.size();
     s_renderer.dir_lights_allocated = try_realloc_light_storage(
@@ -720,53 +1238,33 @@ void scene_end() {
     s_envmap->prefilter_map.bind(s_renderer.slots.prefilter_map);
     s_renderer.brdf_map.bind(s_renderer.slots.brdf_lut);
 
-    for (auto &[shader_id, material_group] : s_renderer.shader_render_group) {
-        Shader &curr_shader = s_asset_pack->shaders.at(shader_id);
-        curr_shader.bind();
-
-        for (int32_t i = 0; i < CASCADES_COUNT; i++)
-            curr_shader.try_set_uniform_1f("u_cascade_distances[" +
-                                               std::to_string(i) + "]",
-                                           cascade_distances[i]);
-
-        for (auto &[mat_id, mesh_group] : material_group) {
-            Material &mat = s_asset_pack->materials.at(mat_id);
-            curr_shader.try_set_uniform_4f("u_material.color", mat.color);
-            curr_shader.try_set_uniform_2f("u_material.tiling_factor",
-                                           mat.tiling_factor);
-            curr_shader.try_set_uniform_2f("u_material.texture_offset",
-                                           mat.texture_offset);
-            curr_shader.try_set_uniform_4f(
-                "u_material.emission_and_ao",
-                glm::vec4(mat.emission_color * mat.emission_factor, mat.ao));
-            curr_shader.try_set_uniform_1f("u_material.roughness",
-                                           mat.roughness);
-            curr_shader.try_set_uniform_1f("u_material.metallic", mat.metallic);
-
-            std::array<AssetID, 4> tex_ids = {
-                mat.albedo_texture_id, mat.normal_texture_id,
-                mat.orm_texture_id, mat.emission_texture_id};
-            std::array<int32_t, 4> tex_bindings = {
-                s_renderer.slots.albedo, s_renderer.slots.normal,
-                s_renderer.slots.orm, s_renderer.slots.emission_map};
-
-            for (int32_t i = 0; i < tex_ids.size(); i++) {
-                Texture &tex = s_asset_pack->textures.at(tex_ids[i]);
-                tex.bind(tex_bindings[i]);
-            }
-
-            for (auto &[mesh_id, instances] : mesh_group) {
-                Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-                mesh.vao.vbo_instanced.set_data(
-                    instances.data(), instances.size() * sizeof(MeshInstance));
-                draw_elements_instanced(curr_shader, mesh.vao,
-                                        instances.size());
-                s_renderer.stats.draw_calls++;
-            }
+    /* Packed textures are bound once, the rest per draw, so one multi-draw
+     * per texture set. Draws come grouped by shader. */
+    s_asset_pack->texture_arrays.bind(s_renderer.slots.texture_arrays);
+    bind_pass_geometry();
+    AssetID curr_shader_id = 0;
+    Shader *curr_shader = nullptr;
+    for (const TextureSetDraws &draws : s_renderer.texture_set_draws) {
+        if (draws.shader_id != curr_shader_id) {
+            curr_shader_id = draws.shader_id;
+            curr_shader = &s_asset_pack->shaders.at(curr_shader_id);
+            curr_shader->bind();
+
+            for (int32_t i = 0; i < CASCADES_COUNT; i++)
+                curr_shader->try_set_uniform_1f(CASCADE_DISTANCE_UNIFORMS[i],
+                                                cascade_distances[i]);
         }
+
+        bind_texture_set(draws.texture_set_id);
+        multi_draw(*curr_shader, draws.first, draws.count);
+        s_renderer.stats.draw_calls++;
     }
 
     GL_CALL(glDepthFunc(GL_LESS));
+
+    /* Base pass is the last one to use this frame's instances. */
+    s_renderer.instance_ring.next_frame();
+
     GL_CALL(glFinish());
     t.stop();
     s_renderer.stats.base_pass_ms += t.elapsed_time_ms();
@@ -775,23 +1273,13 @@ void scene_end() {
 void shadow_pass_begin(const CameraData &camera, AssetPack &asset_pack) {
     s_asset_pack = &asset_pack;
     s_active_camera = &camera;
+    s_renderer.camera_frustum = extract_frustum_planes(camera.view_projection);
 
     s_renderer.dir_lights.clear();
     s_renderer.point_lights.clear();
     s_renderer.spot_lights.clear();
 
-    for (auto &[shader_id, shader_group] : s_renderer.shader_render_group) {
-        for (auto &[mat_id, mat_group] : shader_group) {
-            for (auto &[mesh_id, instances] : mat_group)
-                instances.clear();
-
-            mat_group.clear();
-        }
-
-        shader_group.clear();
-    }
-
-    s_renderer.shader_render_group.clear();
+    reset_queue(SHADOW_PASS);
 }
 
 static void try_change_shadow_layers(Framebuffer &fbo,
@@ -806,7 +1294,10 @@ static void try_change_shadow_layers(Framebuffer &fbo,
 }
 
 void shadow_pass_end() {
-    if (s_renderer.shader_render_group.empty() ||
+    merge_buckets();
+    bool gpu_candidates = s_renderer.gpu_scene != nullptr &&
+                          !s_renderer.gpu_scene->candidates.empty();
+    if ((s_renderer.render_queue.items.empty() && !gpu_candidates) ||
         (s_renderer.dir_lights.empty() && s_renderer.point_lights.empty() &&
          s_renderer.spot_lights.empty()))
         return;
@@ -861,19 +1352,24 @@ void shadow_pass_end() {
                              s_renderer.spot_lights_allocated);
 
 
-    assert(s_renderer.shader_render_group.size() == 1 &&
-           "More than 1 shader submitted for shadow pass");
+    /* Uploaded once, shared by all three shadow map kinds. */
+    upload_pass();
+    assert(s_renderer.texture_set_draws.size() <= 1 &&
+           "More than 1 texture set submitted for shadow pass");
 
-    MaterialGroup &material_group = s_renderer.shader_render_group[0];
-    assert(material_group.size() == 1 &&
-           "More than 1 material submitted for shadow pass");
+    /* Same ranges submit_shadow_mesh() tests against. */
+    std::pmr::vector<glm::vec4> light_ranges(frame_memory::resource());
+    for (const PointLightData &pl : s_renderer.point_lights)
+        light_ranges.push_back(pl.position_and_radius);
 
-    MeshGroup &mesh_group = material_group[0];
-    for (auto &[mesh_id, instances] : mesh_group) {
-        Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-        mesh.vao.vbo_instanced.set_data(
-            instances.data(), instances.size() * sizeof(MeshInstance));
-    }
+    for (const SpotLightData &sl : s_renderer.spot_lights)
+        light_ranges.push_back(glm::vec4(glm::vec3(sl.pos_and_cutoff),
+                                         sl.color_and_distance.w));
+
+    if (s_renderer.gpu_scene != nullptr)
+        s_renderer.culler.cull(*s_renderer.gpu_scene, prepare_gpu_cull(),
+                               light_ranges, s_renderer.indirect_buffer,
+                               s_renderer.instance_ring.buffer);
 
     s_renderer.shadow_fbo.bind();
     GL_CALL(glDrawBuffer(GL_NONE));
@@ -882,17 +1378,9 @@ void shadow_pass_end() {
     s_renderer.shadow_fbo.draw_to_depth_attachment(0);
     GL_CALL(glClear(GL_DEPTH_BUFFER_BIT));
 
-    if (!s_renderer.dir_lights.empty()) {
-        s_renderer.dirlight_shadow_shader.bind();
-        for (auto &[mesh_id, instances] : mesh_group) {
-            if (instances.empty())
-                continue;
-
-            Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-            draw_elements_instanced(s_renderer.dirlight_shadow_shader, mesh.vao,
-                                    instances.size());
-        }
-    }
+    bind_pass_geometry();
+    if (!s_renderer.dir_lights.empty())
+        multi_draw_pass(s_renderer.dirlight_shadow_shader);
 
     s_renderer.shadow_fbo.draw_to_depth_attachment(1);
     GL_CALL(glClear(GL_DEPTH_BUFFER_BIT));
@@ -907,14 +1395,7 @@ void shadow_pass_end() {
             s_renderer.pointlight_shadow_shader.set_uniform_1i(
                 "u_offset", pass * s_renderer.gpu.max_geom_invocations);
 
-            for (auto &[mesh_id, instances] : mesh_group) {
-                if (instances.empty())
-                    continue;
-
-                Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-                draw_elements_instanced(s_renderer.pointlight_shadow_shader,
-                                        mesh.vao, instances.size());
-            }
+            multi_draw_pass(s_renderer.pointlight_shadow_shader);
         }
     }
 
@@ -931,14 +1412,7 @@ void shadow_pass_end() {
             s_renderer.spotlight_shadow_shader.set_uniform_1i(
                 "u_offset", pass * s_renderer.gpu.max_geom_invocations);
 
-            for (auto &[mesh_id, instances] : mesh_group) {
-                if (instances.empty())
-                    continue;
-
-                Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-                draw_elements_instanced(s_renderer.spotlight_shadow_shader,
-                                        mesh.vao, instances.size());
-            }
+            multi_draw_pass(s_renderer.spotlight_shadow_shader);
         }
     }
 
@@ -949,130 +1423,104 @@ void shadow_pass_end() {
     s_renderer.stats.shadow_pass_ms += t.elapsed_time_ms();
 }
 
-static MeshAABB world_space_bb(Mesh &mesh, const glm::mat4 &transform) {
-    glm::vec3 world_min( FLT_MAX);
-    glm::vec3 world_max(-FLT_MAX);
-
-    MeshAABB &local = mesh.local_bb;
-
-    std::array<glm::vec3, 8> corners = {
-        glm::vec3{local.min.x, local.min.y, local.min.z},
-        glm::vec3{local.max.x, local.min.y, local.min.z},
-        glm::vec3{local.min.x, local.max.y, local.min.z},
-        glm::vec3{local.max.x, local.max.y, local.min.z},
-        glm::vec3{local.min.x, local.min.y, local.max.z},
-        glm::vec3{local.max.x, local.min.y, local.max.z},
-        glm::vec3{local.min.x, local.max.y, local.max.z},
-        glm::vec3{local.max.x, local.max.y, local.max.z}
-    };
-
-    for (int32_t i = 0; i < corners.size(); i++) {
-        glm::vec3 w = glm::vec3(transform * glm::vec4(corners[i], 1.0f));
-        world_min = glm::min(world_min, w);
-        world_max = glm::max(world_max, w);
+/* Shadow passes queue everything with texture set 0 and have no single view
+ * to sort by depth for. */
+static void queue_instance(SubmitBucket &bucket, const glm::mat4 &transform,
+                           AssetID mesh_id, AssetID material_id,
+                           int32_t ent_id) {
+    SortKey key;
+    key.pass = s_renderer.pass;
+    key.mesh_index = s_renderer.mesh_indices.index_of(mesh_id);
+    if (s_renderer.pass == BASE_PASS) {
+        AssetID shader_id = s_asset_pack->materials.at(material_id).shader_id;
+        key.shader_index = s_renderer.shader_indices.index_of(shader_id);
+        key.texture_set_index = s_renderer.material_indices.index_of(
+            s_renderer.material_table.texture_sets[material_id]);
+
+        float distance = glm::distance(glm::vec3(s_active_camera->position),
+                                       glm::vec3(transform[3]));
+        key.depth = quantize_depth(distance, s_active_camera->far_clip);
     }
 
-    return {world_min, world_max};
+    if (key.mesh_index < 0 || key.shader_index < 0 ||
+        key.texture_set_index < 0)
+        return;
+
+    bucket.queue.push(pack_sort_key(key), bucket.instances.size(),
+                      bucket.index);
+
+    MeshInstance &instance = bucket.instances.emplace_back();
+    instance.transform = transform;
+    instance.entity_id = ent_id;
+    instance.material_index = material_id;
 }
 
-struct Plane {
-    glm::vec3 normal;
-    float d;
-};
+static void push_mesh_instance(SubmitBucket &bucket,
+                               const glm::mat4 &transform, AssetID mesh_id,
+                               AssetID material_id, int32_t ent_id) {
+    bucket.stats.accepted_instances++;
+    queue_instance(bucket, transform, mesh_id, material_id, ent_id);
+}
 
-std::array<Plane, 6> extract_frustm_planes(const glm::mat4 &mat) {
-    std::array<Plane, 6> planes;
-
-    // Left
-    planes[0].normal.x = mat[0][3] + mat[0][0];
-    planes[0].normal.y = mat[1][3] + mat[1][0];
-    planes[0].normal.z = mat[2][3] + mat[2][0];
-    planes[0].d        = mat[3][3] + mat[3][0];
-
-    // Right
-    planes[1].normal.x = mat[0][3] - mat[0][0];
-    planes[1].normal.y = mat[1][3] - mat[1][0];
-    planes[1].normal.z = mat[2][3] - mat[2][0];
-    planes[1].d        = mat[3][3] - mat[3][0];
-
-    // Bottom
-    planes[2].normal.x = mat[0][3] + mat[0][1];
-    planes[2].normal.y = mat[1][3] + mat[1][1];
-    planes[2].normal.z = mat[2][3] + mat[2][1];
-    planes[2].d        = mat[3][3] + mat[3][1];
-
-    // Top
-    planes[3].normal.x = mat[0][3] - mat[0][1];
-    planes[3].normal.y = mat[1][3] - mat[1][1];
-    planes[3].normal.z = mat[2][3] - mat[2][1];
-    planes[3].d        = mat[3][3] - mat[3][1];
-
-    // Near
-    planes[4].normal.x = mat[0][3] + mat[0][2];
-    planes[4].normal.y = mat[1][3] + mat[1][2];
-    planes[4].normal.z = mat[2][3] + mat[2][2];
-    planes[4].d        = mat[3][3] + mat[3][2];
-
-    // Far
-    planes[5].normal.x = mat[0][3] - mat[0][2];
-    planes[5].normal.y = mat[1][3] - mat[1][2];
-    planes[5].normal.z = mat[2][3] - mat[2][2];
-    planes[5].d        = mat[3][3] - mat[3][2];
-
-    for (int i = 0; i < 6; i++) {
-        float inv_len = 1.0f / glm::length(planes[i].normal);
-        planes[i].normal *= inv_len;
-        planes[i].d *= inv_len;
+void submit_meshes(std::span<const glm::mat4> transforms,
+                   std::span<const AssetID> mesh_ids,
+                   std::span<const AssetID> material_ids,
+                   std::span<const int32_t> ent_ids) {
+    assert(transforms.size() == mesh_ids.size() &&
+           transforms.size() == material_ids.size() &&
+           transforms.size() == ent_ids.size() &&
+           "Spans of different lengths");
+
+    SubmitBucket &bucket = thread_bucket();
+    int32_t count = transforms.size();
+    bucket.stats.submitted_instances += count;
+
+    bucket.local_bbs.resize(count);
+    for (int32_t i = 0; i < count; i++)
+        bucket.local_bbs[i] = s_asset_pack->meshes.at(mesh_ids[i]).local_bb;
+
+    bucket.visible.resize(count);
+    cull_aabbs(transforms, bucket.local_bbs, s_renderer.camera_frustum,
+               bucket.visible);
+
+    for (int32_t i = 0; i < count; i++) {
+        if (bucket.visible[i])
+            push_mesh_instance(bucket, transforms[i], mesh_ids[i],
+                               material_ids[i], ent_ids[i]);
     }
-
-    return planes;
 }
 
 void submit_mesh(const glm::mat4 &transform, AssetID mesh_id,
                  AssetID material_id, int32_t ent_id) {
-    s_renderer.stats.submitted_instances++;
-
-    Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-    MeshAABB world_bb = world_space_bb(mesh, transform);
-
-    std::array<Plane, 6> camera_planes =
-        extract_frustm_planes(s_active_camera->view_projection);
-    for (int32_t i = 0; i < camera_planes.size(); i++) {
-        glm::vec3 n = camera_planes[i].normal;
-        float d = camera_planes[i].d;
-
-        glm::vec3 pos = world_bb.min;
-        if (n.x >= 0)   pos.x = world_bb.max.x;
-        if (n.y >= 0)   pos.y = world_bb.max.y;
-        if (n.z >= 0)   pos.z = world_bb.max.z;
-
-        if (glm::dot(n, pos) + d < 0.0f)
-            return;
-    }
-
-    s_renderer.stats.accepted_instances++;
+    submit_meshes({&transform, 1}, {&mesh_id, 1}, {&material_id, 1},
+                  {&ent_id, 1});
+}
 
-    Material &mat = s_asset_pack->materials.at(material_id);
-    MaterialGroup &mat_grp = s_renderer.shader_render_group[mat.shader_id];
-    MeshGroup &mesh_grp = mat_grp[material_id];
-    std::vector<MeshInstance> &instances = mesh_grp[mesh_id];
+void submit_visible_mesh(const glm::mat4 &transform, AssetID mesh_id,
+                         AssetID material_id, int32_t ent_id) {
+    SubmitBucket &bucket = thread_bucket();
+    bucket.stats.submitted_instances++;
+    push_mesh_instance(bucket, transform, mesh_id, material_id, ent_id);
+}
 
-    MeshInstance &instance = instances.emplace_back();
-    instance.transform = transform;
-    instance.entity_id = ent_id;
+void submit_gpu_scene(GpuScene &gpu_scene) {
+    assert(s_renderer.gpu_scene == nullptr &&
+           "GPU scene already submitted in this pass");
+    s_renderer.gpu_scene = &gpu_scene;
 }
 
-static std::vector<glm::vec4>
+static std::array<glm::vec4, 8>
 frustrum_corners_world_space(const glm::mat4 &proj_view) {
     glm::mat4 inv = glm::inverse(proj_view);
-    std::vector<glm::vec4> corners;
+    std::array<glm::vec4, 8> corners;
 
+    int32_t idx = 0;
     for (int32_t x = 0; x < 2; x++) {
         for (int32_t y = 0; y < 2; y++) {
             for (int32_t z = 0; z < 2; z++) {
                 glm::vec4 pt = inv * glm::vec4(2.0f * x - 1.0f, 2.0f * y - 1.0f,
                                                2.0f * z - 1.0f, 1.0f);
-                corners.push_back(pt / pt.w);
+                corners[idx++] = pt / pt.w;
             }
         }
     }
@@ -1082,16 +1530,12 @@ frustrum_corners_world_space(const glm::mat4 &proj_view) {
 
 void submit_shadow_mesh(const glm::mat4 &transform, AssetID mesh_id) {
     Mesh &mesh = s_asset_pack->meshes.at(mesh_id);
-    MeshAABB world_bb = world_space_bb(mesh, transform);
+    MeshAABB world_bb = transform_aabb(mesh.local_bb, transform);
 
     bool visible_to_any = false;
     for (const PointLightData &pl : s_renderer.point_lights) {
         glm::vec3 position = glm::vec3(pl.position_and_radius);
-        glm::vec3 closest = glm::clamp(position, world_bb.min, world_bb.max);
-
-        float dist2 = glm::length2(position - closest);
-        float radius = pl.position_and_radius.w;
-        if (dist2 <= radius * radius) {
+        if (aabb_vs_sphere(world_bb, position, pl.position_and_radius.w)) {
             visible_to_any = true;
             break;
         }
@@ -1100,12 +1544,7 @@ void submit_shadow_mesh(const glm::mat4 &transform, AssetID mesh_id) {
     if (!visible_to_any) {
         for (const SpotLightData &sl : s_renderer.spot_lights) {
             glm::vec3 position = glm::vec3(sl.pos_and_cutoff);
-            glm::vec3 closest =
-                glm::clamp(position, world_bb.min, world_bb.max);
-
-            float dist2 = glm::length2(position - closest);
-            float radius = sl.color_and_distance.w;
-            if (dist2 <= radius * radius) {
+            if (aabb_vs_sphere(world_bb, position, sl.color_and_distance.w)) {
                 visible_to_any = true;
                 break;
             }
@@ -1115,17 +1554,120 @@ void submit_shadow_mesh(const glm::mat4 &transform, AssetID mesh_id) {
     if (!visible_to_any)
         return;
 
-    s_renderer.stats.shadow_meshes_rendered++;
+    submit_visible_shadow_mesh(transform, mesh_id);
+}
+
+void submit_visible_shadow_mesh(const glm::mat4 &transform, AssetID mesh_id) {
+    SubmitBucket &bucket = thread_bucket();
+    bucket.stats.shadow_meshes_rendered++;
+    queue_instance(bucket, transform, mesh_id, 0, 0);
+}
 
-    /* Only one shader in use at a time in shadow passes. */
-    MaterialGroup &mat_grp = s_renderer.shader_render_group[0];
-    MeshGroup &mesh_grp = mat_grp[0];
-    std::vector<MeshInstance> &instances = mesh_grp[mesh_id];
 
-    MeshInstance &instance = instances.emplace_back();
-    instance.transform = transform;
+/* Queues clusters of the batch passing IS_VISIBLE, adjacent ones merged
+ * into a single range. Goes with the batch's material in base passes, and
+ * with texture set 0 in shadow passes, same as instances there. */
+template <typename Fn>
+static void push_static_draw(const StaticBatch &batch, Fn &&is_visible) {
+    /* Batches are rebaked a frame late, their material might be gone. */
+    auto material = s_asset_pack->materials.find(batch.material_id);
+    if (material == s_asset_pack->materials.end())
+        return;
+
+    SortKey key;
+    key.pass = s_renderer.pass;
+    key.kind = RenderItemKind::STATIC_DRAW;
+    if (s_renderer.pass == BASE_PASS) {
+        key.shader_index =
+            s_renderer.shader_indices.index_of(material->second.shader_id);
+        key.texture_set_index = s_renderer.material_indices.index_of(
+            s_renderer.material_table.texture_sets[batch.material_id]);
+        if (key.shader_index < 0 || key.texture_set_index < 0)
+            return;
+    }
+
+    const GeometryRange &geometry = batch.mesh.geometry;
+
+    StaticDraw draw;
+    draw.first = s_renderer.static_commands.size();
+
+    uint32_t range_end = UINT32_MAX;
+    for (const StaticCluster &cluster : batch.clusters) {
+        s_renderer.stats.submitted_static_clusters++;
+        if (!is_visible(cluster.bb))
+            continue;
+
+        s_renderer.stats.accepted_static_clusters++;
+        if (cluster.first_index == range_end) {
+            s_renderer.static_commands.back().count += cluster.indices_count;
+        } else {
+            /* Already in world space, base instance is picked once the
+             * pass is uploaded. */
+            DrawElementsIndirectCommand &command =
+                s_renderer.static_commands.emplace_back();
+            command.count = cluster.indices_count;
+            command.instance_count = 1;
+            command.first_index = geometry.first_index + cluster.first_index;
+            command.base_vertex = geometry.base_vertex;
+            draw.count++;
+        }
+
+        range_end = cluster.first_index + cluster.indices_count;
+    }
+
+    if (draw.count == 0)
+        return;
+
+    if (s_renderer.pass == BASE_PASS)
+        draw.material_id = batch.material_id;
+
+    s_renderer.render_queue.push(pack_sort_key(key),
+                                 s_renderer.static_draws.size());
+    s_renderer.static_draws.push_back(draw);
+}
+
+void submit_static_batches(const StaticBatches &static_batches) {
+    const Frustum &frustum = s_renderer.camera_frustum;
+    for (const StaticBatch &batch : static_batches.batches) {
+        if (!aabb_vs_frustum(batch.bb, frustum)) {
+            s_renderer.stats.submitted_static_clusters +=
+                batch.clusters.size();
+            continue;
+        }
+
+        push_static_draw(batch, [&](const MeshAABB &bb) {
+            return aabb_vs_frustum(bb, frustum);
+        });
+    }
 }
 
+void submit_static_shadow_batches(const StaticBatches &static_batches) {
+    auto in_light_range = [](const MeshAABB &bb) {
+        for (const PointLightData &pl : s_renderer.point_lights) {
+            glm::vec3 position = glm::vec3(pl.position_and_radius);
+            if (aabb_vs_sphere(bb, position, pl.position_and_radius.w))
+                return true;
+        }
+
+        for (const SpotLightData &sl : s_renderer.spot_lights) {
+            glm::vec3 position = glm::vec3(sl.pos_and_cutoff);
+            if (aabb_vs_sphere(bb, position, sl.color_and_distance.w))
+                return true;
+        }
+
+        return false;
+    };
+
+    for (const StaticBatch &batch : static_batches.batches) {
+        if (!in_light_range(batch.bb)) {
+            s_renderer.stats.submitted_static_clusters +=
+                batch.clusters.size();
+            continue;
+        }
+
+        push_static_draw(batch, in_light_range);
+    }
+}
 
 void submit_dir_light(const glm::vec3 &rotation, const DirLight &light) {
     if (s_renderer.dir_lights.size() >= MAX_DIR_LIGHTS)
@@ -1157,7 +1699,7 @@ void submit_dir_light(const glm::vec3 &rotation, const DirLight &light) {
                                           s_active_camera->viewport.x /
                                               s_active_camera->viewport.y,
                                           near_planes[i], far_planes[i]);
-        std::vector<glm::vec4> view_corners =
+        std::array<glm::vec4, 8> view_corners =
             frustrum_corners_world_space(proj * s_active_camera->view);
 
         glm::vec3 center(0.0f);
@@ -1205,14 +1747,8 @@ void submit_point_light(const glm::vec3 &position, const PointLight &light) {
 
     s_renderer.stats.submitted_point_lights++;
 
-    std::array<Plane, 6> camera_planes =
-        extract_frustm_planes(s_active_camera->view_projection);
-    for (int32_t i = 0; i < camera_planes.size(); i++) {
-        Plane &plane = camera_planes[i];
-        float dist = glm::dot(plane.normal, position) + plane.d + light.radius;
-        if (dist <= 0.0f)
-            return;
-    }
+    if (!sphere_vs_frustum(position, light.radius, s_renderer.camera_frustum))
+        return;
 
     s_renderer.stats.accepted_point_lights++;
 
@@ -1246,15 +1782,9 @@ void submit_spot_light(const GlobalTransform &transform,
 
     s_renderer.stats.submitted_spot_lights++;
 
-    std::array<Plane, 6> camera_planes =
-        extract_frustm_planes(s_active_camera->view_projection);
-    for (int32_t i = 0; i < camera_planes.size(); i++) {
-        Plane &plane = camera_planes[i];
-        float dist = glm::dot(plane.normal, transform.position) + plane.d +
-                     light.distance;
-        if (dist <= 0.0f)
-            return;
-    }
+    if (!sphere_vs_frustum(transform.position, light.distance,
+                           s_renderer.camera_frustum))
+        return;
 
     s_renderer.stats.accepted_spot_lights++;
 
@@ -1463,12 +1993,13 @@ void draw_elements(const Shader &shader, const VertexArray &vao) {
 }
 
 void draw_elements_instanced(const Shader &shader, const VertexArray &vao,
-                             uint32_t instances_count) {
+                             uint32_t instances_count, uint32_t base_instance) {
     vao.bind();
     shader.bind();
 
-    GL_CALL(glDrawElementsInstanced(GL_TRIANGLES, vao.ibo.indices_count,
-                                    GL_UNSIGNED_INT, nullptr, instances_count));
+    GL_CALL(glDrawElementsInstancedBaseInstance(
+        GL_TRIANGLES, vao.ibo.indices_count, GL_UNSIGNED_INT, nullptr,
+        instances_count, base_instance));
 }
 
 } // namespace eng::Renderer
@@ -0,0 +1,159 @@
+#include "eng/renderer/scene_submission.hpp"
+#include "eng/frame_memory.hpp"
+#include "eng/jobs.hpp"
+#include <algorithm>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+namespace eng::renderer {
+
+/* Proxies per job - below that filtering stays on the calling thread. */
+static constexpr int32_t CULL_JOB_GRAIN = 1024;
+static constexpr int32_t SUBMIT_JOB_GRAIN = 1024;
+
+/* Keeps order. DROP runs on job threads, so it only gets to read. */
+template <typename Pred>
+static void remove_proxies_if(Scene &scene, std::vector<int32_t> &proxies,
+                              Pred &&drop) {
+    std::pmr::vector<uint8_t> keep(proxies.size(), frame_memory::resource());
+    jobs::parallel_for(proxies.size(), CULL_JOB_GRAIN,
+                       [&](int32_t first, int32_t last) {
+                           for (int32_t i = first; i < last; i++) {
+                               const BVHNode &node =
+                                   scene.spatial_index.nodes[proxies[i]];
+                               keep[i] = !drop(scene.entity(node.ent_id));
+                           }
+                       });
+
+    int32_t kept = 0;
+    for (int32_t i = 0; i < (int32_t)proxies.size(); i++) {
+        if (keep[i])
+            proxies[kept++] = proxies[i];
+    }
+
+    proxies.resize(kept);
+}
+
+/* Static meshes go through their batches. */
+static bool not_drawn(Entity &ent) {
+    return !ent.has_component<MaterialComp>() || ent.has_component<Static>();
+}
+
+/* Lights themselves don't cast shadows either. */
+static bool not_shadow_caster(Entity &ent) {
+    return not_drawn(ent) || ent.has_component<PointLight>() ||
+           ent.has_component<DirLight>() || ent.has_component<SpotLight>();
+}
+
+void cull_shadow_casters(Scene &scene, const Frustum &frustum,
+                         std::vector<int32_t> &out_proxies) {
+    out_proxies.clear();
+
+    std::pmr::memory_resource *memory = frame_memory::resource();
+    ecs::RegistryView rview =
+        scene.registry.view<GlobalTransform, PointLight>(memory);
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        GlobalTransform &transform = rview.get<GlobalTransform>(entry);
+        PointLight &light = rview.get<PointLight>(entry);
+
+        if (sphere_vs_frustum(transform.position, light.radius, frustum))
+            scene.spatial_index.query_sphere(transform.position, light.radius,
+                                             out_proxies);
+    }
+
+    rview = scene.registry.view<GlobalTransform, SpotLight>(memory);
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        GlobalTransform &transform = rview.get<GlobalTransform>(entry);
+        SpotLight &light = rview.get<SpotLight>(entry);
+
+        if (sphere_vs_frustum(transform.position, light.distance, frustum)) {
+            glm::vec3 dir = glm::toMat3(glm::quat(transform.rotation)) *
+                            glm::vec3(0.0f, 0.0f, -1.0f);
+            scene.spatial_index.query_cone(transform.position, dir,
+                                           glm::radians(light.cutoff),
+                                           light.distance, out_proxies);
+        }
+    }
+
+    /* Lights overlap, so the same mesh might've been found many times. */
+    std::sort(out_proxies.begin(), out_proxies.end());
+    out_proxies.erase(std::unique(out_proxies.begin(), out_proxies.end()),
+                      out_proxies.end());
+
+    remove_proxies_if(scene, out_proxies, not_shadow_caster);
+}
+
+void cull_visible_meshes(Scene &scene, const Frustum &frustum,
+                         std::vector<int32_t> &out_proxies) {
+    out_proxies.clear();
+    scene.spatial_index.query_frustum(frustum, out_proxies);
+
+    remove_proxies_if(scene, out_proxies, not_drawn);
+}
+
+void submit_scene_lights(Scene &scene) {
+    std::pmr::memory_resource *memory = frame_memory::resource();
+    ecs::RegistryView rview =
+        scene.registry.view<GlobalTransform, DirLight>(memory);
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        GlobalTransform &transform = rview.get<GlobalTransform>(entry);
+        submit_dir_light(transform.rotation, rview.get<DirLight>(entry));
+    }
+
+    rview = scene.registry.view<GlobalTransform, PointLight>(memory);
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        GlobalTransform &transform = rview.get<GlobalTransform>(entry);
+        submit_point_light(transform.position, rview.get<PointLight>(entry));
+    }
+
+    rview = scene.registry.view<GlobalTransform, SpotLight>(memory);
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        GlobalTransform &transform = rview.get<GlobalTransform>(entry);
+        submit_spot_light(transform, rview.get<SpotLight>(entry));
+    }
+}
+
+/* Calls SUBMIT(entity, mesh) for every proxy, with LOD levels picked by
+ * select_lods() or select_shadow_lods(). Proxies are split between job
+ * threads, each submitting into its own bucket - SUBMIT only gets to read
+ * the scene. */
+template <typename Fn>
+static void submit_proxies(Scene &scene, const std::vector<int32_t> &proxies,
+                           bool shadow, Fn &&submit) {
+    auto submit_range = [&](int32_t first, int32_t last) {
+        for (int32_t i = first; i < last; i++) {
+            const BVHNode &node = scene.spatial_index.nodes[proxies[i]];
+            Entity &ent = scene.entity(node.ent_id);
+
+            AssetID mesh_id = node.mesh_id;
+            if (ent.has_component<LodComp>()) {
+                LodComp &lod = ent.get_component<LodComp>();
+                AssetID lod_mesh_id =
+                    shadow ? lod.shadow_mesh_id : lod.mesh_id;
+                mesh_id = lod_mesh_id != 0 ? lod_mesh_id : mesh_id;
+            }
+
+            submit(ent, mesh_id);
+        }
+    };
+
+    jobs::parallel_for(proxies.size(), SUBMIT_JOB_GRAIN, submit_range);
+}
+
+void submit_shadow_casters(Scene &scene, const std::vector<int32_t> &proxies) {
+    submit_proxies(scene, proxies, true, [](Entity &ent, AssetID mesh_id) {
+        GlobalTransform &transform = ent.get_component<GlobalTransform>();
+        submit_visible_shadow_mesh(transform.to_mat4(), mesh_id);
+    });
+}
+
+void submit_visible_meshes(Scene &scene, const std::vector<int32_t> &proxies) {
+    submit_proxies(scene, proxies, false, [](Entity &ent, AssetID mesh_id) {
+        GlobalTransform &transform = ent.get_component<GlobalTransform>();
+        MaterialComp &mat = ent.get_component<MaterialComp>();
+        submit_visible_mesh(transform.to_mat4(), mesh_id, mat.id, ent.handle);
+    });
+}
+
+} // namespace eng::renderer
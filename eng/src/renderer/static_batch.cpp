@@ -0,0 +1,113 @@
+#include "eng/renderer/static_batch.hpp"
+#include "eng/scene/bvh.hpp"
+#include <cfloat>
+#include <map>
+#include <unordered_map>
+
+namespace eng {
+
+static void append_transformed(VertexData &data,
+                               const std::vector<Vertex> &vertices,
+                               const std::vector<uint32_t> &indices,
+                               const glm::mat4 &transform) {
+    glm::mat3 basis = glm::mat3(transform);
+    glm::mat3 normal_mat = glm::transpose(glm::inverse(basis));
+    uint32_t base = data.vertices.size();
+
+    for (Vertex v : vertices) {
+        v.position = glm::vec3(transform * glm::vec4(v.position, 1.0f));
+        v.normal = glm::normalize(normal_mat * v.normal);
+        v.tangent = glm::normalize(basis * v.tangent);
+        v.bitangent = glm::normalize(basis * v.bitangent);
+        data.vertices.push_back(v);
+    }
+
+    for (uint32_t idx : indices)
+        data.indices.push_back(base + idx);
+}
+
+static MeshAABB merge_bb(const MeshAABB &lhs, const MeshAABB &rhs) {
+    return {glm::min(lhs.min, rhs.min), glm::max(lhs.max, rhs.max)};
+}
+
+StaticBatches StaticBatches::bake(Scene &scene, AssetPack &asset_pack,
+                                  float cluster_size) {
+    assert(cluster_size > 0.0f && "Cluster size has to be positive");
+
+    /* Material -> cell -> entities. Ordered, so the same scene always
+     * bakes the same way. */
+    std::map<AssetID, std::map<std::pair<int32_t, int32_t>,
+                               std::vector<ecs::EntityID>>>
+        groups;
+
+    StaticBatches static_batches;
+    ecs::RegistryView rview =
+        scene.registry.view<Static, GlobalTransform, MeshComp, MaterialComp>();
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        glm::vec3 position = rview.get<GlobalTransform>(entry).position;
+        AssetID material_id = rview.get<MaterialComp>(entry).id;
+
+        std::pair<int32_t, int32_t> cell = {
+            (int32_t)glm::floor(position.x / cluster_size),
+            (int32_t)glm::floor(position.z / cluster_size)};
+        groups[material_id][cell].push_back(entry.entity_id);
+        static_batches.baked_entities++;
+    }
+
+    std::unordered_map<AssetID, std::vector<Vertex>> source_vertices;
+    for (auto &[material_id, cells] : groups) {
+        StaticBatch batch;
+        batch.material_id = material_id;
+
+        VertexData data;
+        for (auto &[cell, ent_ids] : cells) {
+            StaticCluster cluster;
+            cluster.first_index = data.indices.size();
+            cluster.bb = {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+
+            for (ecs::EntityID ent_id : ent_ids) {
+                Entity &ent = scene.entity(ent_id);
+                AssetID mesh_id = ent.get_component<MeshComp>().id;
+                glm::mat4 transform =
+                    ent.get_component<GlobalTransform>().to_mat4();
+
+                const Mesh &mesh = asset_pack.meshes.at(mesh_id);
+                auto itr = source_vertices.find(mesh_id);
+                if (itr == source_vertices.end()) {
+                    VertexData source =
+                        read_vertex_data(mesh, asset_pack.geometry);
+                    itr = source_vertices
+                              .insert({mesh_id, std::move(source.vertices)})
+                              .first;
+                }
+
+                append_transformed(data, itr->second, mesh.indices, transform);
+                cluster.bb = merge_bb(cluster.bb,
+                                      transform_aabb(mesh.local_bb, transform));
+            }
+
+            cluster.indices_count = data.indices.size() - cluster.first_index;
+            batch.clusters.push_back(cluster);
+        }
+
+        batch.mesh = create_mesh(std::move(data), asset_pack.geometry);
+        batch.mesh.name = "Static batch";
+        batch.mesh.positions = {};
+        batch.mesh.indices = {};
+        batch.bb = batch.mesh.local_bb;
+
+        static_batches.batches.push_back(std::move(batch));
+    }
+
+    return static_batches;
+}
+
+void StaticBatches::destroy(GeometryPool &geometry) {
+    for (StaticBatch &batch : batches)
+        geometry.free(batch.mesh.geometry);
+
+    batches.clear();
+    baked_entities = 0;
+}
+
+} // namespace eng
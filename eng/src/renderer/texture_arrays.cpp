@@ -0,0 +1,198 @@
+#include "eng/renderer/texture_arrays.hpp"
+
+namespace eng {
+
+static bool same_spec(const TextureSpec &lhs, const TextureSpec &rhs) {
+    return lhs.format == rhs.format && lhs.size == rhs.size &&
+           lhs.mips == rhs.mips && lhs.min_filter == rhs.min_filter &&
+           lhs.mag_filter == rhs.mag_filter && lhs.wrap == rhs.wrap;
+}
+
+/* Single channel textures get theirs spread over RGB when loaded. */
+static std::array<GLint, 4> swizzle_of(const Texture &texture) {
+    std::array<GLint, 4> swizzle;
+    texture.bind();
+    GL_CALL(glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA,
+                                swizzle.data()));
+    texture.unbind();
+    return swizzle;
+}
+
+static GLuint create_array(const TextureArrays::Array &array,
+                           int32_t capacity) {
+    GLuint id = 0;
+    GL_CALL(glGenTextures(1, &id));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, id));
+
+    const TextureSpec &spec = array.spec;
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                            spec.min_filter));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                            spec.mag_filter));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, spec.wrap));
+    GL_CALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, spec.wrap));
+    GL_CALL(glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA,
+                             array.swizzle.data()));
+
+    GLenum internal = format_details(spec.format).internal_format;
+    GL_CALL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, spec.mips, internal,
+                           spec.size.x, spec.size.y, capacity));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    return id;
+}
+
+/* LAYERS_COUNT layers from SRC_LAYER of SRC on, every mip, to DST_LAYER of
+ * DST on. Plain 2D textures are one layer deep. */
+static void copy_layers(GLuint src, GLenum src_target, int32_t src_layer,
+                        GLuint dst, int32_t dst_layer, int32_t layers_count,
+                        const TextureSpec &spec) {
+    for (int32_t mip = 0; mip < spec.mips; mip++) {
+        int32_t width = glm::max(spec.size.x >> mip, 1);
+        int32_t height = glm::max(spec.size.y >> mip, 1);
+        GL_CALL(glCopyImageSubData(src, src_target, mip, 0, 0, src_layer, dst,
+                                   GL_TEXTURE_2D_ARRAY, mip, 0, 0, dst_layer,
+                                   width, height, layers_count));
+    }
+}
+
+/* Doubles ARRAY's layers, moving what's there. Draws still reading the old
+ * one keep it alive until they're done. */
+static bool grow(TextureArrays::Array &array) {
+    GLint max_layers = 0;
+    GL_CALL(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers));
+    max_layers = glm::min(max_layers, TextureArrays::MAX_LAYERS);
+    if (array.capacity >= max_layers)
+        return false;
+
+    int32_t capacity = glm::min(glm::max(array.capacity * 2, 1), max_layers);
+    GLuint id = create_array(array, capacity);
+    if (array.id != 0) {
+        copy_layers(array.id, GL_TEXTURE_2D_ARRAY, 0, id, 0, array.capacity,
+                    array.spec);
+        GL_CALL(glDeleteTextures(1, &array.id));
+    }
+
+    array.id = id;
+    array.capacity = capacity;
+    return true;
+}
+
+/* Layer for TEXTURE in a matching array, a new one if there's room for it.
+ * Negative array if it fits nowhere. */
+static TextureLayer allocate_layer(TextureArrays &arrays,
+                                   const Texture &texture) {
+    std::array<GLint, 4> swizzle = swizzle_of(texture);
+
+    int32_t idx = 0;
+    while (idx < arrays.arrays_count &&
+           !(same_spec(arrays.arrays[idx].spec, texture.spec) &&
+             arrays.arrays[idx].swizzle == swizzle))
+        idx++;
+
+    if (idx == arrays.max_arrays)
+        return {};
+
+    TextureArrays::Array &array = arrays.arrays[idx];
+    if (idx == arrays.arrays_count) {
+        array = {};
+        array.spec = texture.spec;
+        array.swizzle = swizzle;
+        arrays.arrays_count++;
+    }
+
+    if (!array.free_layers.empty()) {
+        int32_t layer = array.free_layers.back();
+        array.free_layers.pop_back();
+        return {idx, layer};
+    }
+
+    if (array.used == array.capacity) {
+        if (!grow(array))
+            return {};
+
+        arrays.grows++;
+    }
+
+    return {idx, array.used++};
+}
+
+static void free_layer(TextureArrays &arrays, const TextureLayer &where) {
+    if (where.array >= 0)
+        arrays.arrays[where.array].free_layers.push_back(where.layer);
+}
+
+void TextureArrays::destroy() {
+    for (int32_t i = 0; i < arrays_count; i++) {
+        if (arrays[i].id != 0) {
+            GL_CALL(glDeleteTextures(1, &arrays[i].id));
+        }
+    }
+
+    arrays_count = 0;
+    packed.clear();
+}
+
+bool TextureArrays::sync(const std::map<AssetID, Texture> &textures) {
+    bool moved = false;
+
+    for (auto it = packed.begin(); it != packed.end();) {
+        auto texture = textures.find(it->first);
+        if (texture != textures.end() &&
+            texture->second.id == it->second.texture_id &&
+            same_spec(texture->second.spec, it->second.spec)) {
+            it++;
+            continue;
+        }
+
+        free_layer(*this, it->second.where);
+        it = packed.erase(it);
+        moved = true;
+    }
+
+    for (const auto &[id, texture] : textures) {
+        if (packed.contains(id))
+            continue;
+
+        Packed &entry = packed[id];
+        entry.texture_id = texture.id;
+        entry.spec = texture.spec;
+        moved = true;
+
+        if (texture.id == 0 || texture.spec.size.x <= 0 ||
+            texture.spec.size.y <= 0)
+            continue;
+
+        entry.where = allocate_layer(*this, texture);
+        if (entry.where.array < 0)
+            continue;
+
+        const Array &array = arrays[entry.where.array];
+        copy_layers(texture.id, GL_TEXTURE_2D, 0, array.id, entry.where.layer,
+                    1, texture.spec);
+    }
+
+    return moved;
+}
+
+void TextureArrays::bind(int32_t first_slot) const {
+    for (int32_t i = 0; i < arrays_count; i++) {
+        GL_CALL(glActiveTexture(GL_TEXTURE0 + first_slot + i));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[i].id));
+    }
+}
+
+TextureLayer TextureArrays::layer_of(AssetID texture_id) const {
+    auto it = packed.find(texture_id);
+    return it != packed.end() ? it->second.where : TextureLayer{};
+}
+
+int32_t TextureArrays::layer_ref(AssetID texture_id) const {
+    TextureLayer where = layer_of(texture_id);
+    if (where.array < 0)
+        return -1;
+
+    return where.array << 16 | where.layer;
+}
+
+} // namespace eng
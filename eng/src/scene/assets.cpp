@@ -1,4 +1,5 @@
 #include "eng/scene/assets.hpp"
+#include "eng/renderer/mesh_simplify.hpp"
 #include "eng/renderer/opengl.hpp"
 #include "eng/renderer/primitives.hpp"
 #include "eng/renderer/renderer.hpp"
@@ -19,63 +20,66 @@ MeshAABB mesh_bb(std::span<Vertex> vertices) {
     return bb;
 }
 
-Mesh create_mesh(VertexData vertex_data) {
+Mesh create_mesh(VertexData vertex_data, GeometryPool &geometry) {
     Mesh mesh{};
     auto &[vertices, indices] = vertex_data;
 
-    mesh.vao = VertexArray::create();
-    mesh.vao.bind();
-
-    VertexBuffer vbo = VertexBuffer::create();
-    vbo.allocate(vertices.data(), vertices.size() * sizeof(Vertex),
-                 vertices.size());
+    mesh.geometry = geometry.allocate(vertex_data);
+    mesh.local_bb = mesh_bb(vertices);
 
-    VertexBufferLayout layout;
-    layout.push_float(3); // 0 - position
-    layout.push_float(3); // 1 - normal
-    layout.push_float(3); // 2 - tangent
-    layout.push_float(3); // 3 - bitangent
-    layout.push_float(2); // 4 - texture uv
+    mesh.positions.reserve(vertices.size());
+    for (const Vertex &v : vertices)
+        mesh.positions.push_back(v.position);
 
-    IndexBuffer ibo = IndexBuffer::create();
-    ibo.allocate(indices.data(), indices.size());
-    mesh.vao.add_buffers(vbo, ibo, layout);
+    mesh.indices = std::move(indices);
 
-    layout.clear();
-    layout.push_float(4); // 5 - transform
-    layout.push_float(4); // 6 - transform
-    layout.push_float(4); // 7 - transform
-    layout.push_float(4); // 8 - transform
-    layout.push_float(1); // 9 - entity id
+    return mesh;
+}
 
-    vbo = VertexBuffer::create();
-    vbo.allocate(nullptr, renderer::MAX_MESH_INSTANCES * sizeof(MeshInstance));
-    mesh.vao.add_instanced_vertex_buffer(vbo, layout, 5);
-    mesh.vao.unbind();
+VertexData read_vertex_data(const Mesh &mesh, const GeometryPool &geometry) {
+    VertexData data;
+    data.vertices = geometry.read_vertices(mesh.geometry);
+    data.indices = mesh.indices;
 
-    mesh.local_bb = mesh_bb(vertices);
+    return data;
+}
 
-    return mesh;
+static_assert(TextureArrays::MAX_ARRAYS == 8 &&
+              "Update texture arrays count in shaders");
+
+/* Texture array samplers of a bound SHADER, to their consecutive units.
+ * Ones past arrays count share the last unit - never sampled, but samplers
+ * of different types can't share one. */
+static void set_texture_array_slots(Shader &shader) {
+    renderer::TextureSlots slots = renderer::texture_slots();
+    for (int32_t i = 0; i < TextureArrays::MAX_ARRAYS; i++) {
+        int32_t slot = glm::min(i, slots.texture_arrays_count - 1);
+        shader.set_uniform_1i("u_texture_arrays[" + std::to_string(i) + "]",
+                              slots.texture_arrays + slot);
+    }
 }
 
 AssetPack AssetPack::create(const std::string &pack_name) {
     AssetPack pack{};
     pack.name = pack_name;
+    pack.texture_arrays.max_arrays =
+        renderer::texture_slots().texture_arrays_count;
+    pack.geometry = GeometryPool::create();
 
     {
-        Mesh quad_mesh = create_mesh(quad_vertex_data());
+        Mesh quad_mesh = create_mesh(quad_vertex_data(), pack.geometry);
         quad_mesh.name = "Quad";
         (void)pack.add_mesh(quad_mesh);
     }
 
     {
-        Mesh cube_mesh = create_mesh(cube_vertex_data());
+        Mesh cube_mesh = create_mesh(cube_vertex_data(), pack.geometry);
         cube_mesh.name = "Cube";
         (void)pack.add_mesh(cube_mesh);
     }
 
     {
-        Mesh sphere_mesh = create_mesh(uv_sphere_vertex_data());
+        Mesh sphere_mesh = create_mesh(uv_sphere_vertex_data(), pack.geometry);
         sphere_mesh.name = "Sphere";
         (void)pack.add_mesh(sphere_mesh);
     }
@@ -171,6 +175,14 @@ AssetPack AssetPack::create(const std::string &pack_name) {
             {
                 "${SOFT_SHADOW_PROPS_BINDING}",
                 std::to_string(renderer::SOFT_SHADOW_PROPS_BINDING)
+            },
+            {
+                "${MATERIALS_BINDING}",
+                std::to_string(renderer::MATERIALS_BINDING)
+            },
+            {
+                "${MAX_TEXTURE_ARRAYS}",
+                std::to_string(TextureArrays::MAX_ARRAYS)
             }
         };
 
@@ -205,6 +217,7 @@ AssetPack AssetPack::create(const std::string &pack_name) {
         base_shader.bind();
         for (int32_t i = 0; i < unis.size(); i++)
             base_shader.set_uniform_1i(unis[i], tex_slots[i]);
+        set_texture_array_slots(base_shader);
 
         (void)pack.add_shader(base_shader);
     }
@@ -222,12 +235,23 @@ AssetPack AssetPack::create(const std::string &pack_name) {
             }
         };
         spec.fragment_shader.path = "resources/shaders/flat.frag";
+        spec.fragment_shader.replacements = {
+            {
+                "${MATERIALS_BINDING}",
+                std::to_string(renderer::MATERIALS_BINDING)
+            },
+            {
+                "${MAX_TEXTURE_ARRAYS}",
+                std::to_string(TextureArrays::MAX_ARRAYS)
+            }
+        };
 
         assert(flat_shader.build(spec) && "Default shaders not found");
 
         flat_shader.bind();
         flat_shader.set_uniform_1i("u_albedo",
                                    renderer::texture_slots().albedo);
+        set_texture_array_slots(flat_shader);
 
         (void)pack.add_shader(flat_shader);
     }
@@ -236,9 +260,6 @@ AssetPack AssetPack::create(const std::string &pack_name) {
 }
 
 void AssetPack::destroy() {
-    for (auto &[mesh_id, mesh] : meshes)
-        mesh.vao.destroy();
-
     for (auto &[tex_id, texture] : textures)
         texture.destroy();
 
@@ -252,6 +273,8 @@ void AssetPack::destroy() {
     for (auto &[shader_id, shader] : shaders)
         shader.destroy();
 
+    texture_arrays.destroy();
+    geometry.destroy();
     meshes.clear();
 }
 
@@ -264,9 +287,51 @@ AssetID AssetPack::add_mesh(Mesh mesh) {
 
     Mesh &new_mesh = meshes[id];
     new_mesh = mesh;
+    generation++;
     return id;
 }
 
+void AssetPack::set_lod_chain(AssetID mesh_id,
+                              const std::vector<SimplifiedMesh> &levels,
+                              float max_screen_error) {
+    assert(meshes.contains(mesh_id) && "No such mesh");
+
+    /* Freed first, so new levels can take their place in the pool. */
+    for (const MeshLod &lod : meshes.at(mesh_id).lods) {
+        auto old_level = meshes.find(lod.mesh_id);
+        if (old_level == meshes.end())
+            continue;
+
+        geometry.free(old_level->second.geometry);
+        meshes.erase(old_level);
+    }
+
+    std::vector<MeshLod> lods;
+    for (size_t i = 0; i < levels.size(); i++) {
+        Mesh lod_mesh = create_mesh(levels[i].vertex_data, geometry);
+        lod_mesh.name = meshes.at(mesh_id).name + " LOD" +
+                        std::to_string(i + 1);
+
+        MeshLod &lod = lods.emplace_back();
+        lod.mesh_id = add_mesh(lod_mesh);
+        lod.error = levels[i].error;
+    }
+
+    /* Projected error is projected bounding sphere size scaled by
+     * error / radius, see renderer::projected_size(). */
+    Mesh &mesh = meshes.at(mesh_id);
+    float radius = glm::length(mesh.local_bb.max - mesh.local_bb.min) * 0.5f;
+    for (MeshLod &lod : lods) {
+        lod.screen_size = 1.0f;
+        if (lod.error > 0.0f)
+            lod.screen_size =
+                glm::min(max_screen_error * radius / lod.error, 1.0f);
+    }
+
+    mesh.lods = std::move(lods);
+    generation++;
+}
+
 AssetID AssetPack::add_texture(Texture &texture) {
     AssetID id = 0;
     if (textures.empty())
@@ -276,6 +341,7 @@ AssetID AssetPack::add_texture(Texture &texture) {
 
     Texture &new_texture = textures[id];
     new_texture = texture;
+    generation++;
     return id;
 }
 
@@ -292,6 +358,7 @@ AssetID AssetPack::add_env_map(EnvMap &env_map) {
     new_env_map.irradiance_map = env_map.irradiance_map;
     new_env_map.prefilter_map = env_map.prefilter_map;
 
+    generation++;
     return id;
 }
 
@@ -304,6 +371,7 @@ AssetID AssetPack::add_material(Material &material) {
 
     Material &new_material = materials[id];
     new_material = material;
+    generation++;
     return id;
 }
 
@@ -316,6 +384,7 @@ AssetID AssetPack::add_shader(Shader &shader) {
 
     Shader &new_shader = shaders[id];
     new_shader = shader;
+    generation++;
     return id;
 }
 
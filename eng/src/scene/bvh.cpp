@@ -0,0 +1,710 @@
+#include "eng/scene/bvh.hpp"
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
+
+namespace eng {
+
+Frustum extract_frustum_planes(const glm::mat4 &mat) {
+    Frustum planes;
+
+    // Left
+    planes[0].normal.x = mat[0][3] + mat[0][0];
+    planes[0].normal.y = mat[1][3] + mat[1][0];
+    planes[0].normal.z = mat[2][3] + mat[2][0];
+    planes[0].d        = mat[3][3] + mat[3][0];
+
+    // Right
+    planes[1].normal.x = mat[0][3] - mat[0][0];
+    planes[1].normal.y = mat[1][3] - mat[1][0];
+    planes[1].normal.z = mat[2][3] - mat[2][0];
+    planes[1].d        = mat[3][3] - mat[3][0];
+
+    // Bottom
+    planes[2].normal.x = mat[0][3] + mat[0][1];
+    planes[2].normal.y = mat[1][3] + mat[1][1];
+    planes[2].normal.z = mat[2][3] + mat[2][1];
+    planes[2].d        = mat[3][3] + mat[3][1];
+
+    // Top
+    planes[3].normal.x = mat[0][3] - mat[0][1];
+    planes[3].normal.y = mat[1][3] - mat[1][1];
+    planes[3].normal.z = mat[2][3] - mat[2][1];
+    planes[3].d        = mat[3][3] - mat[3][1];
+
+    // Near
+    planes[4].normal.x = mat[0][3] + mat[0][2];
+    planes[4].normal.y = mat[1][3] + mat[1][2];
+    planes[4].normal.z = mat[2][3] + mat[2][2];
+    planes[4].d        = mat[3][3] + mat[3][2];
+
+    // Far
+    planes[5].normal.x = mat[0][3] - mat[0][2];
+    planes[5].normal.y = mat[1][3] - mat[1][2];
+    planes[5].normal.z = mat[2][3] - mat[2][2];
+    planes[5].d        = mat[3][3] - mat[3][2];
+
+    for (int i = 0; i < 6; i++) {
+        float inv_len = 1.0f / glm::length(planes[i].normal);
+        planes[i].normal *= inv_len;
+        planes[i].d *= inv_len;
+    }
+
+    return planes;
+}
+
+MeshAABB transform_aabb(const MeshAABB &local, const glm::mat4 &transform) {
+    /* Transforming center and extents (with absolute values of the rotation
+     * part) instead of all 8 corners. Summed in the same order as
+     * cull_aabbs() does, so both agree to the bit. */
+    glm::vec3 center = (local.min + local.max) * 0.5f;
+    glm::vec3 extents = (local.max - local.min) * 0.5f;
+
+    glm::vec3 world_center = glm::vec3(transform[3]);
+    glm::vec3 world_extents(0.0f);
+    for (int32_t col = 0; col < 3; col++) {
+        glm::vec3 axis = glm::vec3(transform[col]);
+        world_center += axis * center[col];
+        world_extents += glm::abs(axis) * extents[col];
+    }
+
+    return {world_center - world_extents, world_center + world_extents};
+}
+
+bool sphere_vs_frustum(const glm::vec3 &center, float radius,
+                       const Frustum &frustum) {
+    for (const Plane &plane : frustum) {
+        if (glm::dot(plane.normal, center) + plane.d + radius <= 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+static MeshAABB aabb_union(const MeshAABB &a, const MeshAABB &b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+static float aabb_area(const MeshAABB &bb) {
+    glm::vec3 d = bb.max - bb.min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool aabb_contains(const MeshAABB &outer, const MeshAABB &inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+           outer.min.z <= inner.min.z && inner.max.x <= outer.max.x &&
+           inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+bool aabb_vs_frustum(const MeshAABB &bb, const Frustum &frustum) {
+    for (const Plane &plane : frustum) {
+        glm::vec3 pos = bb.min;
+        if (plane.normal.x >= 0) pos.x = bb.max.x;
+        if (plane.normal.y >= 0) pos.y = bb.max.y;
+        if (plane.normal.z >= 0) pos.z = bb.max.z;
+
+        if (glm::dot(plane.normal, pos) + plane.d < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+#if defined(__SSE2__)
+/* Planes with every component broadcast to all 4 lanes. */
+struct WideFrustum {
+    __m128 nx[6];
+    __m128 ny[6];
+    __m128 nz[6];
+    __m128 d[6];
+    std::array<bool, 6> nx_positive;
+    std::array<bool, 6> ny_positive;
+    std::array<bool, 6> nz_positive;
+};
+
+static WideFrustum widen(const Frustum &frustum) {
+    WideFrustum wide;
+    for (int32_t i = 0; i < 6; i++) {
+        const Plane &plane = frustum[i];
+        wide.nx[i] = _mm_set1_ps(plane.normal.x);
+        wide.ny[i] = _mm_set1_ps(plane.normal.y);
+        wide.nz[i] = _mm_set1_ps(plane.normal.z);
+        wide.d[i] = _mm_set1_ps(plane.d);
+        wide.nx_positive[i] = plane.normal.x >= 0;
+        wide.ny_positive[i] = plane.normal.y >= 0;
+        wide.nz_positive[i] = plane.normal.z >= 0;
+    }
+
+    return wide;
+}
+
+/* Lanes hold 4 boxes, one each. Returns a mask of culled ones. Same steps
+ * as transform_aabb() and aabb_vs_frustum(), in the same order. */
+static int32_t cull_4_aabbs(const glm::mat4 *transforms,
+                            const MeshAABB *local_bbs,
+                            const WideFrustum &frustum) {
+    /* Columns of 4 matrices transposed, so M[COL][ROW] holds that element
+     * of every matrix. Bottom row isn't needed. */
+    __m128 m[4][4];
+    for (int32_t col = 0; col < 4; col++) {
+        __m128 r0 = _mm_loadu_ps(&transforms[0][col].x);
+        __m128 r1 = _mm_loadu_ps(&transforms[1][col].x);
+        __m128 r2 = _mm_loadu_ps(&transforms[2][col].x);
+        __m128 r3 = _mm_loadu_ps(&transforms[3][col].x);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        m[col][0] = r0;
+        m[col][1] = r1;
+        m[col][2] = r2;
+        m[col][3] = r3;
+    }
+
+    __m128 center[3];
+    __m128 extents[3];
+    __m128 half = _mm_set1_ps(0.5f);
+    for (int32_t axis = 0; axis < 3; axis++) {
+        __m128 min = _mm_setr_ps(
+            local_bbs[0].min[axis], local_bbs[1].min[axis],
+            local_bbs[2].min[axis], local_bbs[3].min[axis]);
+        __m128 max = _mm_setr_ps(
+            local_bbs[0].max[axis], local_bbs[1].max[axis],
+            local_bbs[2].max[axis], local_bbs[3].max[axis]);
+
+        center[axis] = _mm_mul_ps(_mm_add_ps(min, max), half);
+        extents[axis] = _mm_mul_ps(_mm_sub_ps(max, min), half);
+    }
+
+    __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 bb_min[3];
+    __m128 bb_max[3];
+    for (int32_t row = 0; row < 3; row++) {
+        __m128 world_center = m[3][row];
+        __m128 world_extents = _mm_setzero_ps();
+        for (int32_t col = 0; col < 3; col++) {
+            world_center = _mm_add_ps(world_center,
+                                      _mm_mul_ps(m[col][row], center[col]));
+
+            __m128 abs = _mm_andnot_ps(sign_mask, m[col][row]);
+            world_extents = _mm_add_ps(world_extents,
+                                       _mm_mul_ps(abs, extents[col]));
+        }
+
+        bb_min[row] = _mm_sub_ps(world_center, world_extents);
+        bb_max[row] = _mm_add_ps(world_center, world_extents);
+    }
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 culled = _mm_setzero_ps();
+    for (int32_t i = 0; i < 6; i++) {
+        __m128 px = frustum.nx_positive[i] ? bb_max[0] : bb_min[0];
+        __m128 py = frustum.ny_positive[i] ? bb_max[1] : bb_min[1];
+        __m128 pz = frustum.nz_positive[i] ? bb_max[2] : bb_min[2];
+
+        __m128 dist = _mm_mul_ps(frustum.nx[i], px);
+        dist = _mm_add_ps(dist, _mm_mul_ps(frustum.ny[i], py));
+        dist = _mm_add_ps(dist, _mm_mul_ps(frustum.nz[i], pz));
+        dist = _mm_add_ps(dist, frustum.d[i]);
+
+        culled = _mm_or_ps(culled, _mm_cmplt_ps(dist, zero));
+        if (_mm_movemask_ps(culled) == 0xF)
+            break;
+    }
+
+    return _mm_movemask_ps(culled);
+}
+#endif
+
+void cull_aabbs(std::span<const glm::mat4> transforms,
+                std::span<const MeshAABB> local_bbs, const Frustum &frustum,
+                std::span<uint8_t> out_visible) {
+    assert(transforms.size() == local_bbs.size() &&
+           transforms.size() == out_visible.size() &&
+           "Every box needs a transform and a result");
+
+    size_t first = 0;
+
+#if defined(__SSE2__)
+    WideFrustum wide = widen(frustum);
+    for (; first + 4 <= transforms.size(); first += 4) {
+        int32_t culled = cull_4_aabbs(&transforms[first], &local_bbs[first],
+                                      wide);
+        for (int32_t lane = 0; lane < 4; lane++)
+            out_visible[first + lane] = !((culled >> lane) & 1);
+    }
+#endif
+
+    for (size_t i = first; i < transforms.size(); i++) {
+        MeshAABB bb = transform_aabb(local_bbs[i], transforms[i]);
+        out_visible[i] = aabb_vs_frustum(bb, frustum);
+    }
+}
+
+bool aabb_vs_sphere(const MeshAABB &bb, const glm::vec3 &center,
+                    float radius) {
+    glm::vec3 closest = glm::clamp(center, bb.min, bb.max);
+    glm::vec3 diff = center - closest;
+
+    return glm::dot(diff, diff) <= radius * radius;
+}
+
+bool aabb_vs_cone(const MeshAABB &bb, const glm::vec3 &apex,
+                  const glm::vec3 &dir, float half_angle, float range) {
+    if (!aabb_vs_sphere(bb, apex, range))
+        return false;
+
+    glm::vec3 center = (bb.min + bb.max) * 0.5f;
+    float radius = glm::length(bb.max - center);
+
+    glm::vec3 v = center - apex;
+    float v_len2 = glm::dot(v, v);
+    float v_proj = glm::dot(v, dir);
+    float perp = glm::sqrt(glm::max(v_len2 - v_proj * v_proj, 0.0f));
+
+    float closest_dist =
+        glm::cos(half_angle) * perp - v_proj * glm::sin(half_angle);
+
+    bool outside_angle = closest_dist > radius;
+    bool behind = v_proj < -radius;
+
+    return !outside_angle && !behind;
+}
+
+float aabb_vs_ray(const MeshAABB &bb, const glm::vec3 &origin,
+                  const glm::vec3 &inv_dir, float max_dist) {
+    glm::vec3 t1 = (bb.min - origin) * inv_dir;
+    glm::vec3 t2 = (bb.max - origin) * inv_dir;
+
+    glm::vec3 tmin = glm::min(t1, t2);
+    glm::vec3 tmax = glm::max(t1, t2);
+
+    float enter = glm::max(glm::max(tmin.x, tmin.y), glm::max(tmin.z, 0.0f));
+    float exit = glm::min(glm::min(tmax.x, tmax.y), tmax.z);
+
+    if (exit < enter || enter > max_dist)
+        return -1.0f;
+
+    return enter;
+}
+
+float ray_vs_triangle(const Ray &ray, const glm::vec3 &v0,
+                      const glm::vec3 &v1, const glm::vec3 &v2) {
+    constexpr float EPSILON = 1e-7f;
+
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(ray.dir, edge2);
+    float det = glm::dot(edge1, p);
+    if (glm::abs(det) < EPSILON)
+        return -1.0f;
+
+    float inv_det = 1.0f / det;
+    glm::vec3 s = ray.origin - v0;
+    float u = glm::dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+        return -1.0f;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.dir, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+        return -1.0f;
+
+    return glm::dot(edge2, q) * inv_det;
+}
+
+DynamicBVH DynamicBVH::create(float fat_margin) {
+    DynamicBVH bvh;
+    bvh.margin = fat_margin;
+
+    return bvh;
+}
+
+void DynamicBVH::destroy() {
+    nodes.clear();
+    root = NULL_NODE;
+    free_list = NULL_NODE;
+    leaves = 0;
+}
+
+static int32_t allocate_node(DynamicBVH &bvh) {
+    if (bvh.free_list == DynamicBVH::NULL_NODE) {
+        bvh.nodes.emplace_back();
+        return bvh.nodes.size() - 1;
+    }
+
+    int32_t idx = bvh.free_list;
+    bvh.free_list = bvh.nodes[idx].parent;
+    bvh.nodes[idx] = BVHNode{};
+
+    return idx;
+}
+
+static void free_node(DynamicBVH &bvh, int32_t idx) {
+    BVHNode &node = bvh.nodes[idx];
+    node.parent = bvh.free_list;
+    node.left = DynamicBVH::NULL_NODE;
+    node.right = DynamicBVH::NULL_NODE;
+    node.height = -1;
+    bvh.free_list = idx;
+}
+
+static void replace_child(DynamicBVH &bvh, int32_t parent, int32_t old_child,
+                          int32_t new_child) {
+    if (parent == DynamicBVH::NULL_NODE) {
+        bvh.root = new_child;
+        return;
+    }
+
+    BVHNode &node = bvh.nodes[parent];
+    if (node.left == old_child)
+        node.left = new_child;
+    else
+        node.right = new_child;
+}
+
+/* AVL-like rotation - promotes the taller grandchild if subtree heights
+ * differ by more than one. Returns index of the new subtree root. */
+static int32_t balance(DynamicBVH &bvh, int32_t ia) {
+    BVHNode &a = bvh.nodes[ia];
+    if (a.is_leaf() || a.height < 2)
+        return ia;
+
+    int32_t ib = a.left;
+    int32_t ic = a.right;
+    BVHNode &b = bvh.nodes[ib];
+    BVHNode &c = bvh.nodes[ic];
+
+    int32_t diff = c.height - b.height;
+    if (diff > 1) {
+        int32_t i_f = c.left;
+        int32_t ig = c.right;
+        BVHNode &f = bvh.nodes[i_f];
+        BVHNode &g = bvh.nodes[ig];
+
+        c.left = ia;
+        c.parent = a.parent;
+        a.parent = ic;
+        replace_child(bvh, c.parent, ia, ic);
+
+        if (f.height > g.height) {
+            c.right = i_f;
+            a.right = ig;
+            g.parent = ia;
+            a.bb = aabb_union(b.bb, g.bb);
+            c.bb = aabb_union(a.bb, f.bb);
+            a.height = 1 + glm::max(b.height, g.height);
+            c.height = 1 + glm::max(a.height, f.height);
+        } else {
+            c.right = ig;
+            a.right = i_f;
+            f.parent = ia;
+            a.bb = aabb_union(b.bb, f.bb);
+            c.bb = aabb_union(a.bb, g.bb);
+            a.height = 1 + glm::max(b.height, f.height);
+            c.height = 1 + glm::max(a.height, g.height);
+        }
+
+        return ic;
+    }
+
+    if (diff < -1) {
+        int32_t id = b.left;
+        int32_t ie = b.right;
+        BVHNode &d = bvh.nodes[id];
+        BVHNode &e = bvh.nodes[ie];
+
+        b.left = ia;
+        b.parent = a.parent;
+        a.parent = ib;
+        replace_child(bvh, b.parent, ia, ib);
+
+        if (d.height > e.height) {
+            b.right = id;
+            a.left = ie;
+            e.parent = ia;
+            a.bb = aabb_union(c.bb, e.bb);
+            b.bb = aabb_union(a.bb, d.bb);
+            a.height = 1 + glm::max(c.height, e.height);
+            b.height = 1 + glm::max(a.height, d.height);
+        } else {
+            b.right = ie;
+            a.left = id;
+            d.parent = ia;
+            a.bb = aabb_union(c.bb, d.bb);
+            b.bb = aabb_union(a.bb, e.bb);
+            a.height = 1 + glm::max(c.height, d.height);
+            b.height = 1 + glm::max(a.height, e.height);
+        }
+
+        return ib;
+    }
+
+    return ia;
+}
+
+static void refit_upwards(DynamicBVH &bvh, int32_t idx) {
+    while (idx != DynamicBVH::NULL_NODE) {
+        idx = balance(bvh, idx);
+
+        BVHNode &node = bvh.nodes[idx];
+        const BVHNode &left = bvh.nodes[node.left];
+        const BVHNode &right = bvh.nodes[node.right];
+        node.height = 1 + glm::max(left.height, right.height);
+        node.bb = aabb_union(left.bb, right.bb);
+
+        idx = node.parent;
+    }
+}
+
+static void insert_leaf(DynamicBVH &bvh, int32_t leaf) {
+    if (bvh.root == DynamicBVH::NULL_NODE) {
+        bvh.root = leaf;
+        bvh.nodes[leaf].parent = DynamicBVH::NULL_NODE;
+        return;
+    }
+
+    /* Descend to the sibling that's cheapest to pair with, using surface
+     * area of the nodes that would have to grow as the cost. */
+    MeshAABB leaf_bb = bvh.nodes[leaf].bb;
+    int32_t idx = bvh.root;
+    while (!bvh.nodes[idx].is_leaf()) {
+        const BVHNode &node = bvh.nodes[idx];
+        float area = aabb_area(node.bb);
+        float combined_area = aabb_area(aabb_union(node.bb, leaf_bb));
+
+        float cost = 2.0f * combined_area;
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        auto descend_cost = [&](int32_t child_idx) {
+            const BVHNode &child = bvh.nodes[child_idx];
+            float new_area = aabb_area(aabb_union(child.bb, leaf_bb));
+            if (child.is_leaf())
+                return new_area + inheritance_cost;
+
+            return new_area - aabb_area(child.bb) + inheritance_cost;
+        };
+
+        float cost_left = descend_cost(node.left);
+        float cost_right = descend_cost(node.right);
+        if (cost < cost_left && cost < cost_right)
+            break;
+
+        idx = (cost_left < cost_right ? node.left : node.right);
+    }
+
+    int32_t sibling = idx;
+    int32_t old_parent = bvh.nodes[sibling].parent;
+
+    int32_t new_parent = allocate_node(bvh);
+    BVHNode &parent = bvh.nodes[new_parent];
+    parent.parent = old_parent;
+    parent.bb = aabb_union(leaf_bb, bvh.nodes[sibling].bb);
+    parent.height = bvh.nodes[sibling].height + 1;
+    parent.left = sibling;
+    parent.right = leaf;
+
+    replace_child(bvh, old_parent, sibling, new_parent);
+    bvh.nodes[sibling].parent = new_parent;
+    bvh.nodes[leaf].parent = new_parent;
+
+    refit_upwards(bvh, new_parent);
+}
+
+static void remove_leaf(DynamicBVH &bvh, int32_t leaf) {
+    if (leaf == bvh.root) {
+        bvh.root = DynamicBVH::NULL_NODE;
+        return;
+    }
+
+    int32_t parent = bvh.nodes[leaf].parent;
+    int32_t grand_parent = bvh.nodes[parent].parent;
+    int32_t sibling = (bvh.nodes[parent].left == leaf
+                           ? bvh.nodes[parent].right
+                           : bvh.nodes[parent].left);
+
+    replace_child(bvh, grand_parent, parent, sibling);
+    bvh.nodes[sibling].parent = grand_parent;
+    free_node(bvh, parent);
+
+    refit_upwards(bvh, grand_parent);
+}
+
+int32_t DynamicBVH::insert(const MeshAABB &bb, ecs::EntityID ent_id,
+                           AssetID mesh_id) {
+    int32_t proxy = allocate_node(*this);
+    BVHNode &node = nodes[proxy];
+    node.bb = {bb.min - glm::vec3(margin), bb.max + glm::vec3(margin)};
+    node.height = 0;
+    node.ent_id = ent_id;
+    node.mesh_id = mesh_id;
+
+    insert_leaf(*this, proxy);
+    leaves++;
+
+    return proxy;
+}
+
+void DynamicBVH::remove(int32_t proxy) {
+    assert(proxy >= 0 && proxy < nodes.size() && nodes[proxy].is_leaf() &&
+           nodes[proxy].height == 0 && "Invalid BVH proxy");
+
+    remove_leaf(*this, proxy);
+    free_node(*this, proxy);
+    leaves--;
+}
+
+bool DynamicBVH::move(int32_t proxy, const MeshAABB &bb) {
+    assert(proxy >= 0 && proxy < nodes.size() && nodes[proxy].is_leaf() &&
+           nodes[proxy].height == 0 && "Invalid BVH proxy");
+
+    MeshAABB fat_bb = {bb.min - glm::vec3(margin), bb.max + glm::vec3(margin)};
+    const MeshAABB &old_bb = nodes[proxy].bb;
+
+    /* Still fits and the old box isn't way too big (e.g. after the mesh
+     * changed to a smaller one). */
+    glm::vec3 slack = (old_bb.max - old_bb.min) - (fat_bb.max - fat_bb.min);
+    float max_slack = glm::max(glm::max(slack.x, slack.y), slack.z);
+    bool too_big = max_slack > 4.0f * margin;
+    if (aabb_contains(old_bb, bb) && !too_big)
+        return false;
+
+    remove_leaf(*this, proxy);
+    nodes[proxy].bb = fat_bb;
+    insert_leaf(*this, proxy);
+
+    return true;
+}
+
+static void collect_leaves(const DynamicBVH &bvh, int32_t subtree_root,
+                           std::vector<int32_t> &out_proxies) {
+    std::array<int32_t, DynamicBVH::MAX_QUERY_DEPTH> stack;
+    int32_t top = 0;
+    stack[top++] = subtree_root;
+
+    while (top > 0) {
+        int32_t idx = stack[--top];
+        const BVHNode &node = bvh.nodes[idx];
+        if (node.is_leaf()) {
+            out_proxies.push_back(idx);
+            continue;
+        }
+
+        assert(top + 2 <= DynamicBVH::MAX_QUERY_DEPTH &&
+               "BVH query stack overflow");
+        stack[top++] = node.right;
+        stack[top++] = node.left;
+    }
+}
+
+void DynamicBVH::query_frustum(const Frustum &frustum,
+                               std::vector<int32_t> &out_proxies) const {
+    if (root == NULL_NODE)
+        return;
+
+    /* Each entry carries a mask of planes the node still straddles - once
+     * a node is fully inside a plane, its children skip that test, and once
+     * it's inside all of them whole subtree is accepted without tests. */
+    constexpr uint8_t ALL_PLANES = 0b111111;
+    std::array<std::pair<int32_t, uint8_t>, MAX_QUERY_DEPTH> stack;
+    int32_t top = 0;
+    stack[top++] = {root, ALL_PLANES};
+
+    while (top > 0) {
+        auto [idx, mask] = stack[--top];
+        const BVHNode &node = nodes[idx];
+
+        bool outside = false;
+        for (int32_t i = 0; i < frustum.size(); i++) {
+            if (!(mask & (1 << i)))
+                continue;
+
+            const Plane &plane = frustum[i];
+            glm::vec3 pos = node.bb.min;
+            glm::vec3 neg = node.bb.max;
+            for (int32_t axis = 0; axis < 3; axis++) {
+                if (plane.normal[axis] >= 0.0f) {
+                    pos[axis] = node.bb.max[axis];
+                    neg[axis] = node.bb.min[axis];
+                }
+            }
+
+            if (glm::dot(plane.normal, pos) + plane.d < 0.0f) {
+                outside = true;
+                break;
+            }
+
+            if (glm::dot(plane.normal, neg) + plane.d >= 0.0f)
+                mask &= ~(1 << i);
+        }
+
+        if (outside)
+            continue;
+
+        if (mask == 0) {
+            collect_leaves(*this, idx, out_proxies);
+            continue;
+        }
+
+        if (node.is_leaf()) {
+            out_proxies.push_back(idx);
+            continue;
+        }
+
+        assert(top + 2 <= MAX_QUERY_DEPTH && "BVH query stack overflow");
+        stack[top++] = {node.right, mask};
+        stack[top++] = {node.left, mask};
+    }
+}
+
+template <typename Test>
+static void query_overlaps(const DynamicBVH &bvh, Test &&test,
+                           std::vector<int32_t> &out_proxies) {
+    if (bvh.root == DynamicBVH::NULL_NODE)
+        return;
+
+    std::array<int32_t, DynamicBVH::MAX_QUERY_DEPTH> stack;
+    int32_t top = 0;
+    stack[top++] = bvh.root;
+
+    while (top > 0) {
+        int32_t idx = stack[--top];
+        const BVHNode &node = bvh.nodes[idx];
+        if (!test(node.bb))
+            continue;
+
+        if (node.is_leaf()) {
+            out_proxies.push_back(idx);
+            continue;
+        }
+
+        assert(top + 2 <= DynamicBVH::MAX_QUERY_DEPTH &&
+               "BVH query stack overflow");
+        stack[top++] = node.right;
+        stack[top++] = node.left;
+    }
+}
+
+void DynamicBVH::query_sphere(const glm::vec3 &center, float radius,
+                              std::vector<int32_t> &out_proxies) const {
+    query_overlaps(
+        *this,
+        [&](const MeshAABB &bb) { return aabb_vs_sphere(bb, center, radius); },
+        out_proxies);
+}
+
+void DynamicBVH::query_cone(const glm::vec3 &apex, const glm::vec3 &dir,
+                            float half_angle, float range,
+                            std::vector<int32_t> &out_proxies) const {
+    query_overlaps(
+        *this,
+        [&](const MeshAABB &bb) {
+            return aabb_vs_cone(bb, apex, dir, half_angle, range);
+        },
+        out_proxies);
+}
+
+int32_t DynamicBVH::height() const {
+    return (root == NULL_NODE ? 0 : nodes[root].height);
+}
+
+} // namespace eng
@@ -0,0 +1,40 @@
+#include "eng/scene/prefab.hpp"
+
+namespace eng {
+
+Prefab Prefab::create(Scene &scene, ecs::EntityID root_id) {
+    assert(scene.contains(root_id) && "Entity does not exist in this scene");
+
+    Prefab prefab;
+    prefab.registry = ecs::Registry::create();
+    prefab.name = scene.entity(root_id).get_component<Name>().name;
+
+    /* Pairs of scene entity and its parent's node index. */
+    std::vector<std::pair<ecs::EntityID, int32_t>> stack = {{root_id, -1}};
+    while (!stack.empty()) {
+        auto [ent_id, parent] = stack.back();
+        stack.pop_back();
+
+        PrefabNode node;
+        node.parent = parent;
+        node.ent_id = prefab.registry.copy_from(scene.registry, ent_id);
+
+        int32_t node_idx = prefab.nodes.size();
+        prefab.nodes.push_back(node);
+
+        const Entity &ent = scene.entity(ent_id);
+        for (auto itr = ent.children_ids.rbegin();
+             itr != ent.children_ids.rend(); itr++)
+            stack.push_back({*itr, node_idx});
+    }
+
+    return prefab;
+}
+
+void Prefab::destroy() {
+    name.clear();
+    nodes.clear();
+    registry.destroy();
+}
+
+} // namespace eng
@@ -1,6 +1,10 @@
 #include "eng/scene/scene.hpp"
+#include "eng/frame_memory.hpp"
+#include "eng/jobs.hpp"
 #include "eng/random_utils.hpp"
 #include "eng/scene/components.hpp"
+#include "eng/scene/prefab.hpp"
+#include "glm/gtc/quaternion.hpp"
 #include <algorithm>
 
 namespace eng {
@@ -8,6 +12,7 @@ namespace eng {
 Scene Scene::create(const std::string &name) {
     Scene scene;
     scene.registry = ecs::Registry::create();
+    scene.spatial_index = DynamicBVH::create();
     scene.name = name;
 
     return scene;
@@ -17,218 +22,524 @@ void Scene::destroy() {
     name.clear();
     registry.destroy();
     entities.clear();
+    free_slots.clear();
+    id_to_index.clear();
+    root_ids.clear();
+    traversal_order.clear();
+    hierarchy_dirty = false;
+    spatial_index.destroy();
+    id_to_proxy.clear();
+    moved_ids.clear();
+    mesh_changed_ids.clear();
+}
+
+static void insert_entity_record(Scene &scene, const Entity &ent) {
+    int32_t slot = 0;
+    if (!scene.free_slots.empty()) {
+        slot = scene.free_slots.back();
+        scene.free_slots.pop_back();
+        scene.entities[slot] = ent;
+    } else {
+        slot = scene.entities.size();
+        scene.entities.push_back(ent);
+    }
+
+    if (scene.id_to_index.size() <= ent.handle)
+        scene.id_to_index.resize(ent.handle + 1, -1);
+
+    scene.id_to_index[ent.handle] = slot;
 }
 
 Entity Scene::spawn_entity(const std::string &name) {
     Entity ent;
     ent.owning_reg = &registry;
+    ent.mesh_changed_ids = &mesh_changed_ids;
     ent.handle = registry.create_entity();
     ent.add_component<Name>().name = name;
     ent.add_component<Transform>();
     ent.add_component<GlobalTransform>();
 
-    entities.push_back(ent);
-    id_to_index[ent.handle] = entities.size() - 1;
+    insert_entity_record(*this, ent);
+    root_ids.push_back(ent.handle);
+    hierarchy_dirty = true;
 
     return ent;
 }
 
+Entity &Scene::entity(ecs::EntityID ent_id) {
+    assert(contains(ent_id) && "Entity does not exist in this scene");
+
+    return entities[id_to_index[ent_id]];
+}
+
+bool Scene::contains(ecs::EntityID ent_id) const {
+    return ent_id < id_to_index.size() && id_to_index[ent_id] != -1;
+}
+
 static void remove_relation(Scene &scene, ecs::EntityID parent_id,
                             ecs::EntityID child_id) {
-    int32_t parent_idx = scene.id_to_index[parent_id];
-    Entity &parent = scene.entities[parent_idx];
+    Entity &parent = scene.entity(parent_id);
 
     auto child_itr = std::find(parent.children_ids.begin(),
                                parent.children_ids.end(), child_id);
     parent.children_ids.erase(child_itr);
 
-    int32_t child_idx = scene.id_to_index[child_id];
-    scene.entities[child_idx].parent_id = std::nullopt;
+    scene.entity(child_id).parent_id = std::nullopt;
 }
 
 static void remove_entity_tree_records(Scene &scene, ecs::EntityID root_id) {
     int32_t root_idx = scene.id_to_index[root_id];
     Entity &root = scene.entities[root_idx];
 
-    scene.id_to_index.erase(root_id);
-    scene.registry.destroy_entity(root_id);
     for (ecs::EntityID child_id : root.children_ids)
         remove_entity_tree_records(scene, child_id);
-}
 
-static int32_t related_entities_count(Scene &scene, ecs::EntityID root_id) {
-    assert(scene.id_to_index.contains(root_id) &&
-           "Root does not exist in this scene");
+    if (root_id < scene.id_to_proxy.size() &&
+        scene.id_to_proxy[root_id] != DynamicBVH::NULL_NODE) {
+        scene.spatial_index.remove(scene.id_to_proxy[root_id]);
+        scene.id_to_proxy[root_id] = DynamicBVH::NULL_NODE;
+    }
 
-    int32_t root_idx = scene.id_to_index[root_id];
-    Entity &root = scene.entities[root_idx];
+    /* For whatever else follows meshes, see GpuScene. */
+    if (root.has_component<MeshComp>())
+        root.mesh_changed();
 
-    int32_t count = 1; // Account for itself
-    for (ecs::EntityID child_id : root.children_ids)
-        count += related_entities_count(scene, child_id);
+    scene.registry.destroy_entity(root_id);
+    scene.id_to_index[root_id] = -1;
 
-    return count;
+    root = Entity{};
+    scene.free_slots.push_back(root_idx);
 }
 
-static Entity &build_duplicate_children(Scene &scene, Entity &root) {
-    Entity &new_ent = scene.entities.emplace_back();
+static ecs::EntityID build_duplicate_children(Scene &scene,
+                                              ecs::EntityID root_id) {
+    ecs::EntityID new_id = scene.registry.duplicate(root_id);
+
+    Entity new_ent;
     new_ent.owning_reg = &scene.registry;
-    new_ent.handle = scene.registry.duplicate(root.handle);
+    new_ent.mesh_changed_ids = &scene.mesh_changed_ids;
+    new_ent.handle = new_id;
+    if (scene.registry.has_component<MeshComp>(new_id))
+        new_ent.mesh_changed();
+
+    insert_entity_record(scene, new_ent);
+
+    /* Copy, because spawning children might grow the entities vector. */
+    std::vector<ecs::EntityID> children_ids =
+        scene.entity(root_id).children_ids;
+    for (ecs::EntityID child_id : children_ids) {
+        ecs::EntityID new_child_id = build_duplicate_children(scene, child_id);
+        scene.entity(new_child_id).parent_id = new_id;
+        scene.entity(new_id).children_ids.push_back(new_child_id);
+    }
 
-    int32_t new_ent_idx = scene.entities.size() - 1;
-    scene.id_to_index[new_ent.handle] = new_ent_idx;
+    return new_id;
+}
 
-    for (ecs::EntityID child_id : root.children_ids) {
-        Entity dummy_child = scene.entities[scene.id_to_index[child_id]];
-        Entity &new_child = build_duplicate_children(scene, dummy_child);
-        new_ent = scene.entities[new_ent_idx];
-        scene.link_relation(new_ent, new_child);
+Entity &Scene::duplicate(Entity ent) {
+    assert(contains(ent.handle) && "Entity does not exist in this scene");
+
+    ecs::EntityID new_root_id = build_duplicate_children(*this, ent.handle);
+    hierarchy_dirty = true;
+
+    /* Duplicated subtree keeps the same local transforms, so attaching it
+     * to the original's parent puts it exactly where the original is. */
+    std::optional<ecs::EntityID> parent_id = entity(ent.handle).parent_id;
+    if (parent_id.has_value()) {
+        Entity &parent = entity(parent_id.value());
+        parent.children_ids.insert(parent.children_ids.begin(), new_root_id);
+        entity(new_root_id).parent_id = parent_id;
+    } else {
+        root_ids.push_back(new_root_id);
     }
 
-    return scene.entities[new_ent_idx];
+    return entity(new_root_id);
 }
 
-Entity &Scene::duplicate(Entity ent) {
-    Entity &new_root = build_duplicate_children(*this, ent);
-    ecs::EntityID new_root_id = new_root.handle;
+void Scene::destroy_entity(ecs::EntityID ent_id) {
+    assert(contains(ent_id) && "Entity does not exist in this scene");
+
+    Entity &ent = entity(ent_id);
     if (ent.parent_id.has_value()) {
-        Entity &parent = entities[id_to_index[ent.parent_id.value()]];
-        link_relation(parent, new_root);
+        remove_relation(*this, ent.parent_id.value(), ent.handle);
+    } else {
+        auto root_itr = std::find(root_ids.begin(), root_ids.end(), ent_id);
+        root_ids.erase(root_itr);
     }
 
-    return entities[id_to_index[new_root_id]];
+    remove_entity_tree_records(*this, ent_id);
+    hierarchy_dirty = true;
 }
 
-void Scene::destroy_entity(ecs::EntityID ent_id) {
-    assert(id_to_index.contains(ent_id) &&
-           "Entity does not exist in this scene");
+std::vector<ecs::EntityID> Scene::merge(Scene &&staging) {
+    std::vector<ecs::EntityID> id_map =
+        registry.merge(std::move(staging.registry));
 
-    int32_t ent_idx = id_to_index[ent_id];
-    Entity &ent = entities[ent_idx];
+    for (const Entity &src : staging.entities) {
+        if (src.owning_reg == nullptr)
+            continue;
 
-    if (ent.parent_id.has_value())
-        remove_relation(*this, ent.parent_id.value(), ent.handle);
+        Entity ent;
+        ent.handle = id_map[src.handle];
+        ent.owning_reg = &registry;
+        ent.mesh_changed_ids = &mesh_changed_ids;
+        if (registry.has_component<MeshComp>(ent.handle))
+            ent.mesh_changed();
+        if (src.parent_id.has_value())
+            ent.parent_id = id_map[src.parent_id.value()];
+
+        ent.children_ids.reserve(src.children_ids.size());
+        for (ecs::EntityID child_id : src.children_ids)
+            ent.children_ids.push_back(id_map[child_id]);
 
-    int32_t entities_removed = related_entities_count(*this, ent.handle);
-    remove_entity_tree_records(*this, ent.handle);
+        insert_entity_record(*this, ent);
+    }
+
+    for (ecs::EntityID root_id : staging.root_ids)
+        root_ids.push_back(id_map[root_id]);
+
+    hierarchy_dirty = true;
+    staging.destroy();
+
+    return id_map;
+}
+
+std::vector<ecs::EntityID> Scene::instantiate(Prefab &prefab, uint32_t count,
+                                              const Transform *transforms) {
+    assert(!prefab.nodes.empty() && "Instantiating empty prefab");
+
+    std::vector<ecs::EntityID> id_map =
+        registry.instantiate(prefab.registry, count);
+    size_t stride = prefab.registry.entity_id_counter;
+
+    std::vector<ecs::EntityID> new_root_ids(count);
+    entities.reserve(entities.size() + prefab.nodes.size() * count);
+    root_ids.reserve(root_ids.size() + count);
+    for (uint32_t copy = 0; copy < count; copy++) {
+        const ecs::EntityID *copy_ids = id_map.data() + copy * stride;
+
+        /* Nodes are in depth-first order, so appending children keeps
+         * their original order. */
+        for (const PrefabNode &node : prefab.nodes) {
+            Entity ent;
+            ent.handle = copy_ids[node.ent_id];
+            ent.owning_reg = &registry;
+            ent.mesh_changed_ids = &mesh_changed_ids;
+            if (registry.has_component<MeshComp>(ent.handle))
+                ent.mesh_changed();
+            insert_entity_record(*this, ent);
+
+            if (node.parent == -1)
+                continue;
+
+            ecs::EntityID parent_id =
+                copy_ids[prefab.nodes[node.parent].ent_id];
+            entity(ent.handle).parent_id = parent_id;
+            entity(parent_id).children_ids.push_back(ent.handle);
+        }
 
-    auto ent_it = entities.begin() + ent_idx;
-    entities.erase(ent_it, ent_it + entities_removed);
+        ecs::EntityID root_id = copy_ids[prefab.nodes[0].ent_id];
+        new_root_ids[copy] = root_id;
+        root_ids.push_back(root_id);
 
-    for (int32_t i = 0; i < entities.size(); i++) {
-        Entity &ent = entities[i];
-        id_to_index[ent.handle] = i;
+        if (transforms != nullptr)
+            registry.get_component<Transform>(root_id) = transforms[copy];
     }
+
+    hierarchy_dirty = true;
+    return new_root_ids;
 }
 
 void Scene::link_relation(Entity parent, Entity child) {
     assert(parent.handle != child.handle && "Linking entity to itself");
-    assert(id_to_index.contains(parent.handle) &&
-           "Parent does not exist in this scene");
-    assert(id_to_index.contains(child.handle) &&
-           "Child does not exist in this scene");
-
-    if (child.parent_id.value_or(-1) == parent.handle)
-        return;
+    assert(contains(parent.handle) && "Parent does not exist in this scene");
+    assert(contains(child.handle) && "Child does not exist in this scene");
 
-    int32_t parent_idx = id_to_index[parent.handle];
-    Entity &rparent = entities[parent_idx];
+    Entity &rparent = entity(parent.handle);
+    Entity &rchild = entity(child.handle);
 
-    int32_t child_idx = id_to_index[child.handle];
-    Entity &rchild = entities[child_idx];
+    if (rchild.parent_id.value_or(-1) == rparent.handle)
+        return;
 
-    if (rchild.parent_id.has_value())
+    if (rchild.parent_id.has_value()) {
         remove_relation(*this, rchild.parent_id.value(), rchild.handle);
+    } else {
+        auto root_itr =
+            std::find(root_ids.begin(), root_ids.end(), rchild.handle);
+        root_ids.erase(root_itr);
+    }
 
     rparent.children_ids.insert(rparent.children_ids.begin(), rchild.handle);
     rchild.parent_id = rparent.handle;
+    hierarchy_dirty = true;
 
-    int32_t new_child_idx = parent_idx + 1;
-    int32_t child_subtree_size = related_entities_count(*this, rchild.handle);
+    /* Only the new child's local transform is affected - the rest of its
+     * subtree stays relative to unchanged parents. */
+    GlobalTransform &pgt = rparent.get_component<GlobalTransform>();
+    glm::mat4 parent_inv = glm::inverse(pgt.to_mat4());
 
-    int32_t first{};
-    int32_t mid{};
-    int32_t last{};
-    if (parent_idx < child_idx) {
-        first = new_child_idx;
-        mid = child_idx;
-        last = mid + child_subtree_size;
-    } else {
-        first = child_idx;
-        mid = first + child_subtree_size;
-        last = new_child_idx;
-    }
+    GlobalTransform &cgt = rchild.get_component<GlobalTransform>();
+    glm::mat4 adjusted_child_local = parent_inv * cgt.to_mat4();
+
+    Transform &ct = rchild.get_component<Transform>();
+    transform_decompose(adjusted_child_local, ct.position, ct.rotation,
+                        ct.scale);
+}
+
+bool Scene::is_ascendant_of(Entity &child, Entity &ascendant) {
+    assert(contains(child.handle) && "Child does not exist in this scene");
+    assert(contains(ascendant.handle) &&
+           "Ascendant does not exist in this scene");
 
-    std::rotate(entities.begin() + first, entities.begin() + mid,
-                entities.begin() + last);
+    std::optional<ecs::EntityID> parent_id = entity(child.handle).parent_id;
+    while (parent_id.has_value()) {
+        if (parent_id.value() == ascendant.handle)
+            return true;
 
-    for (int32_t i = first; i < last; i++) {
-        Entity &ent = entities[i];
-        id_to_index[ent.handle] = i;
+        parent_id = entity(parent_id.value()).parent_id;
     }
 
-    new_child_idx = id_to_index[child.handle];
+    return false;
+}
 
-    for (int32_t i = new_child_idx; i < new_child_idx + child_subtree_size; i++) {
-        Entity &local_child = entities[i];
-        assert(local_child.parent_id.has_value() &&
-               "Child in a subtree should have a parent");
+bool Scene::is_descendant_of(Entity &parent, Entity &descendant) {
+    return is_ascendant_of(descendant, parent);
+}
 
-        int32_t local_parent_idx = id_to_index[local_child.parent_id.value()];
-        Entity &local_parent = entities[local_parent_idx];
+const std::vector<int32_t> &Scene::hierarchy_order() {
+    if (!hierarchy_dirty)
+        return traversal_order;
 
-        GlobalTransform &pgt = local_parent.get_component<GlobalTransform>();
-        glm::mat4 parent_inv = glm::inverse(pgt.to_mat4());
+    traversal_order.clear();
+    traversal_order.reserve(entities.size() - free_slots.size());
 
-        GlobalTransform &cgt = local_child.get_component<GlobalTransform>();
-        glm::mat4 adjusted_child_local = parent_inv * cgt.to_mat4();
+    std::vector<ecs::EntityID> stack(root_ids.rbegin(), root_ids.rend());
+    while (!stack.empty()) {
+        ecs::EntityID ent_id = stack.back();
+        stack.pop_back();
 
-        Transform &ct = local_child.get_component<Transform>();
-        transform_decompose(adjusted_child_local, ct.position, ct.rotation,
-                            ct.scale);
+        int32_t idx = id_to_index[ent_id];
+        traversal_order.push_back(idx);
+
+        const Entity &ent = entities[idx];
+        stack.insert(stack.end(), ent.children_ids.rbegin(),
+                     ent.children_ids.rend());
     }
+
+    hierarchy_dirty = false;
+    return traversal_order;
 }
 
-bool Scene::is_ascendant_of(Entity &child, Entity &ascendant) {
-    assert(id_to_index.contains(child.handle) &&
-           "Child does not exist in this scene");
-    assert(id_to_index.contains(ascendant.handle) &&
-           "Ascendant does not exist in this scene");
+static GlobalTransform interpolate(const PreviousTransform &prev,
+                                   const Transform &curr, float alpha) {
+    if (prev.position == curr.position && prev.rotation == curr.rotation &&
+        prev.scale == curr.scale) {
+        return {curr.position, curr.rotation, curr.scale};
+    }
 
-    Entity ent = child;
-    while (ent.parent_id.has_value()) {
-        ecs::EntityID ent_p_id = ent.parent_id.value();
-        if (ent_p_id == ascendant.handle)
-            return true;
+    GlobalTransform result;
+    result.position = glm::mix(prev.position, curr.position, alpha);
+    result.scale = glm::mix(prev.scale, curr.scale, alpha);
 
-        ent = entities[id_to_index[ent_p_id]];
+    /* Lerping euler angles would take the long way around. */
+    glm::quat rotation = glm::slerp(glm::quat(prev.rotation),
+                                    glm::quat(curr.rotation), alpha);
+    result.rotation = glm::eulerAngles(rotation);
+
+    return result;
+}
+
+/* True if the global transform changed. */
+static bool update_global_transform(Scene &scene, int32_t idx, float alpha) {
+    Entity &ent = scene.entities[idx];
+    Transform &t = ent.get_component<Transform>();
+    GlobalTransform &gt = ent.get_component<GlobalTransform>();
+
+    GlobalTransform new_gt;
+    if (alpha < 1.0f && ent.has_component<PreviousTransform>()) {
+        new_gt = interpolate(ent.get_component<PreviousTransform>(), t, alpha);
+    } else {
+        new_gt.position = t.position;
+        new_gt.rotation = t.rotation;
+        new_gt.scale = t.scale;
+    }
+
+    if (ent.parent_id.has_value()) {
+        Entity &parent = scene.entity(ent.parent_id.value());
+
+        GlobalTransform &pgt = parent.get_component<GlobalTransform>();
+        glm::mat4 new_t = pgt.to_mat4() * new_gt.to_mat4();
+        transform_decompose(new_t, new_gt.position, new_gt.rotation,
+                            new_gt.scale);
+    }
+
+    if (new_gt.position != gt.position || new_gt.rotation != gt.rotation ||
+        new_gt.scale != gt.scale) {
+        gt = new_gt;
+        return true;
     }
 
     return false;
 }
 
-bool Scene::is_descendant_of(Entity &parent, Entity &descendant) {
-    return is_ascendant_of(descendant, parent);
+/* Below that waking up workers costs more than it saves. */
+static constexpr int32_t PARALLEL_TRANSFORMS_MIN = 4096;
+
+void Scene::update_global_transforms(float alpha) {
+    const std::vector<int32_t> &order = hierarchy_order();
+    int32_t count = order.size();
+    if (count < PARALLEL_TRANSFORMS_MIN || jobs::threads_count() == 1) {
+        for (int32_t idx : order) {
+            if (update_global_transform(*this, idx, alpha))
+                moved_ids.push_back(entities[idx].handle);
+        }
+
+        return;
+    }
+
+    /* Subtrees of roots are contiguous in depth-first order and don't depend
+     * on each other, so ranges can only start at roots. */
+    std::pmr::memory_resource *memory = frame_memory::resource();
+    int32_t step = count / (jobs::threads_count() * 4) + 1;
+    std::pmr::vector<int32_t> starts(1, 0, memory);
+    for (int32_t i = step; i < count; i += step) {
+        while (i < count && entities[order[i]].parent_id.has_value())
+            i++;
+
+        if (i < count)
+            starts.push_back(i);
+    }
+
+    /* Each range writes moved ids into its own slice, merged in order
+     * afterwards, same as a serial pass would fill them. */
+    int32_t ranges = starts.size();
+    std::pmr::vector<ecs::EntityID> moved(count, memory);
+    std::pmr::vector<int32_t> moved_counts(ranges, memory);
+    jobs::parallel_for(ranges, 1, [&](int32_t first, int32_t last) {
+        for (int32_t range = first; range < last; range++) {
+            int32_t end = range + 1 < ranges ? starts[range + 1] : count;
+            int32_t &moved_count = moved_counts[range];
+            for (int32_t i = starts[range]; i < end; i++) {
+                if (update_global_transform(*this, order[i], alpha))
+                    moved[starts[range] + moved_count++] =
+                        entities[order[i]].handle;
+            }
+        }
+    });
+
+    for (int32_t range = 0; range < ranges; range++) {
+        auto slice = moved.begin() + starts[range];
+        moved_ids.insert(moved_ids.end(), slice, slice + moved_counts[range]);
+    }
 }
 
-void Scene::update_global_transforms() {
-    for (int32_t i = 0; i < entities.size(); i++) {
-        Entity &ent = entities[i];
-        Transform &t = ent.get_component<Transform>();
-        GlobalTransform &gt = ent.get_component<GlobalTransform>();
-        gt.position = t.position;
-        gt.rotation = t.rotation;
-        gt.scale = t.scale;
+void Scene::store_previous_transforms() {
+    ecs::RegistryView rview =
+        registry.view<Transform, PreviousTransform>(frame_memory::resource());
+    for (ecs::RegistryView::Entry &entry : rview.entity_entries) {
+        const Transform &t = rview.get<Transform>(entry);
+        PreviousTransform &prev = rview.get<PreviousTransform>(entry);
+        prev.position = t.position;
+        prev.rotation = t.rotation;
+        prev.scale = t.scale;
+    }
+}
+
+void Scene::update_spatial_index(const AssetPack &asset_pack) {
+    /* New meshes, swaps and removals. Index only follows them, so entities
+     * are looked up one by one. */
+    for (ecs::EntityID ent_id : mesh_changed_ids) {
+        if (!contains(ent_id))
+            continue;
+
+        if (id_to_proxy.size() <= ent_id)
+            id_to_proxy.resize(ent_id + 1, DynamicBVH::NULL_NODE);
+
+        int32_t &proxy = id_to_proxy[ent_id];
+        Entity &ent = entity(ent_id);
+        if (!ent.has_component<MeshComp>()) {
+            if (proxy != DynamicBVH::NULL_NODE) {
+                spatial_index.remove(proxy);
+                proxy = DynamicBVH::NULL_NODE;
+            }
+
+            continue;
+        }
 
-        if (ent.parent_id.has_value()) {
-            int32_t parent_index = id_to_index[ent.parent_id.value()];
-            Entity &parent = entities[parent_index];
+        AssetID mesh_id = ent.get_component<MeshComp>().id;
+        if (proxy == DynamicBVH::NULL_NODE) {
+            const MeshAABB &local_bb = asset_pack.meshes.at(mesh_id).local_bb;
+            glm::mat4 transform =
+                ent.get_component<GlobalTransform>().to_mat4();
+            proxy = spatial_index.insert(transform_aabb(local_bb, transform),
+                                         ent_id, mesh_id);
+            continue;
+        }
 
-            GlobalTransform &pgt = parent.get_component<GlobalTransform>();
-            glm::mat4 new_t = pgt.to_mat4() * gt.to_mat4();
-            transform_decompose(new_t, gt.position, gt.rotation, gt.scale);
+        BVHNode &node = spatial_index.nodes[proxy];
+        if (node.mesh_id != mesh_id) {
+            node.mesh_id = mesh_id;
+            moved_ids.push_back(ent_id);
         }
     }
+
+    mesh_changed_ids.clear();
+
+    for (ecs::EntityID ent_id : moved_ids) {
+        if (ent_id >= id_to_proxy.size() ||
+            id_to_proxy[ent_id] == DynamicBVH::NULL_NODE)
+            continue;
+
+        int32_t proxy = id_to_proxy[ent_id];
+        AssetID mesh_id = spatial_index.nodes[proxy].mesh_id;
+        const MeshAABB &local_bb = asset_pack.meshes.at(mesh_id).local_bb;
+
+        Entity &ent = entity(ent_id);
+        glm::mat4 transform = ent.get_component<GlobalTransform>().to_mat4();
+        spatial_index.move(proxy, transform_aabb(local_bb, transform));
+    }
+
+    moved_ids.clear();
+}
+
+std::optional<RayHit> Scene::raycast(const Ray &ray,
+                                     const AssetPack &asset_pack,
+                                     float max_dist) {
+    glm::vec3 dir = glm::normalize(ray.dir);
+    std::optional<RayHit> closest;
+
+    spatial_index.query_ray(
+        ray.origin, dir, max_dist, [&](int32_t proxy, float) {
+            const BVHNode &node = spatial_index.nodes[proxy];
+            const Mesh &mesh = asset_pack.meshes.at(node.mesh_id);
+
+            glm::mat4 transform =
+                registry.get_component<GlobalTransform>(node.ent_id).to_mat4();
+
+            /* Affine transform keeps ray parameter intact, so distances
+             * found in local space are world space ones as well. */
+            glm::mat4 inv = glm::inverse(transform);
+            Ray local_ray;
+            local_ray.origin = glm::vec3(inv * glm::vec4(ray.origin, 1.0f));
+            local_ray.dir = glm::vec3(inv * glm::vec4(dir, 0.0f));
+
+            for (int32_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                float dist = ray_vs_triangle(
+                    local_ray, mesh.positions[mesh.indices[i]],
+                    mesh.positions[mesh.indices[i + 1]],
+                    mesh.positions[mesh.indices[i + 2]]);
+
+                if (dist >= 0.0f && dist < max_dist) {
+                    max_dist = dist;
+                    closest = RayHit{node.ent_id, ray.origin + dir * dist,
+                                     dist};
+                }
+            }
+
+            return max_dist;
+        });
+
+    return closest;
 }
 
 } // namespace eng
@@ -0,0 +1,582 @@
+#include "eng/scene/scene_file.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace eng {
+
+static constexpr uint64_t SECTION_ALIGNMENT = 16;
+static constexpr uint32_t COMPONENT_SETS = 1 << 7;
+
+/* Component bits files of VERSION can have. */
+static uint32_t version_components(uint32_t version) {
+    if (version == 1)
+        return SCENE_FILE_STATIC - 1;
+
+    return COMPONENT_SETS - 1;
+}
+
+static uint64_t aligned(uint64_t size) {
+    return (size + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+/* Calls FN with std::type_identity of every optional component in the set,
+ * in the order their columns are stored. */
+template <typename Fn>
+static void for_each_optional_component(uint32_t components, Fn &&fn) {
+    if (components & SCENE_FILE_MESH)
+        fn(std::type_identity<MeshComp>{});
+    if (components & SCENE_FILE_MATERIAL)
+        fn(std::type_identity<MaterialComp>{});
+    if (components & SCENE_FILE_POINT_LIGHT)
+        fn(std::type_identity<PointLight>{});
+    if (components & SCENE_FILE_DIR_LIGHT)
+        fn(std::type_identity<DirLight>{});
+    if (components & SCENE_FILE_SPOT_LIGHT)
+        fn(std::type_identity<SpotLight>{});
+    if (components & SCENE_FILE_STATIC)
+        fn(std::type_identity<Static>{});
+    if (components & SCENE_FILE_LOD)
+        fn(std::type_identity<LodComp>{});
+}
+
+template <typename Fn>
+static void for_each_column(uint32_t components, Fn &&fn) {
+    fn(std::type_identity<Transform>{});
+    fn(std::type_identity<GlobalTransform>{});
+    for_each_optional_component(components, fn);
+}
+
+static uint64_t columns_size(uint32_t components, uint32_t entities_count) {
+    uint64_t size = 0;
+    for_each_column(components, [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        size += aligned((uint64_t)entities_count * sizeof(T));
+    });
+
+    return size;
+}
+
+static uint32_t file_components(Scene &scene, ecs::EntityID ent_id) {
+    ecs::Registry &reg = scene.registry;
+
+    uint32_t components = 0;
+    if (reg.has_component<MeshComp>(ent_id))
+        components |= SCENE_FILE_MESH;
+    if (reg.has_component<MaterialComp>(ent_id))
+        components |= SCENE_FILE_MATERIAL;
+    if (reg.has_component<PointLight>(ent_id))
+        components |= SCENE_FILE_POINT_LIGHT;
+    if (reg.has_component<DirLight>(ent_id))
+        components |= SCENE_FILE_DIR_LIGHT;
+    if (reg.has_component<SpotLight>(ent_id))
+        components |= SCENE_FILE_SPOT_LIGHT;
+    if (reg.has_component<Static>(ent_id))
+        components |= SCENE_FILE_STATIC;
+    if (reg.has_component<LodComp>(ent_id))
+        components |= SCENE_FILE_LOD;
+
+    return components;
+}
+
+static SceneFileSection append_section(std::vector<uint8_t> &file,
+                                       const void *data, uint64_t size) {
+    SceneFileSection section;
+    section.offset = file.size();
+    section.size = size;
+
+    file.resize(section.offset + aligned(size), 0);
+    if (size != 0)
+        std::memcpy(file.data() + section.offset, data, size);
+
+    return section;
+}
+
+struct AssetRefs {
+    std::vector<SceneFileAssetRef> refs;
+    std::map<std::pair<SceneFileAssetType, AssetID>, uint32_t> indices;
+};
+
+template <typename T>
+static uint32_t asset_ref(AssetRefs &refs, std::string &names,
+                          const std::map<AssetID, T> &assets,
+                          SceneFileAssetType type, AssetID id) {
+    auto [itr, inserted] =
+        refs.indices.insert(std::make_pair(std::make_pair(type, id), 0));
+    if (!inserted)
+        return itr->second;
+
+    SceneFileAssetRef ref;
+    ref.type = type;
+    ref.id = id;
+    ref.name_offset = names.size();
+
+    auto asset_itr = assets.find(id);
+    if (asset_itr != assets.end())
+        names += asset_itr->second.name;
+
+    ref.name_size = names.size() - ref.name_offset;
+
+    itr->second = refs.refs.size();
+    refs.refs.push_back(ref);
+
+    return itr->second;
+}
+
+/* Same traversal as Scene::hierarchy_order(), limited to given subtrees. */
+static std::vector<int32_t>
+subtrees_order(Scene &scene, const std::vector<ecs::EntityID> &root_ids) {
+    std::vector<int32_t> order;
+    std::vector<ecs::EntityID> stack(root_ids.rbegin(), root_ids.rend());
+    while (!stack.empty()) {
+        ecs::EntityID ent_id = stack.back();
+        stack.pop_back();
+
+        int32_t idx = scene.id_to_index[ent_id];
+        order.push_back(idx);
+
+        const Entity &ent = scene.entities[idx];
+        stack.insert(stack.end(), ent.children_ids.rbegin(),
+                     ent.children_ids.rend());
+    }
+
+    return order;
+}
+
+bool save_scene(Scene &scene, const AssetPack &asset_pack,
+                const std::string &path) {
+    return save_subtrees(scene, asset_pack, scene.root_ids, path);
+}
+
+bool save_subtrees(Scene &scene, const AssetPack &asset_pack,
+                   const std::vector<ecs::EntityID> &root_ids,
+                   const std::string &path) {
+    std::vector<int32_t> order = subtrees_order(scene, root_ids);
+    uint32_t entities_count = order.size();
+
+    /* Entities with the same component set go next to each other, so each
+     * group loads straight into one archetype. */
+    std::array<int32_t, COMPONENT_SETS> set_to_group;
+    set_to_group.fill(-1);
+
+    std::vector<SceneFileGroup> groups;
+    std::vector<uint32_t> dfs_groups(entities_count);
+    for (uint32_t i = 0; i < entities_count; i++) {
+        ecs::EntityID ent_id = scene.entities[order[i]].handle;
+        uint32_t components = file_components(scene, ent_id);
+
+        if (set_to_group[components] == -1) {
+            set_to_group[components] = groups.size();
+            groups.emplace_back().components = components;
+        }
+
+        dfs_groups[i] = set_to_group[components];
+        groups[dfs_groups[i]].entities_count++;
+    }
+
+    uint32_t first_entity = 0;
+    for (SceneFileGroup &group : groups) {
+        group.first_entity = first_entity;
+        first_entity += group.entities_count;
+    }
+
+    std::vector<SceneFileEntity> file_entities(entities_count);
+    std::vector<uint32_t> group_cursors(groups.size(), 0);
+    std::vector<uint32_t> dfs_to_file(entities_count);
+    std::vector<ecs::EntityID> file_ids(entities_count);
+    std::vector<uint32_t> id_to_file(scene.id_to_index.size(),
+                                     SCENE_FILE_NO_PARENT);
+    for (uint32_t i = 0; i < entities_count; i++) {
+        uint32_t group_idx = dfs_groups[i];
+        uint32_t file_idx =
+            groups[group_idx].first_entity + group_cursors[group_idx]++;
+
+        ecs::EntityID ent_id = scene.entities[order[i]].handle;
+        dfs_to_file[i] = file_idx;
+        file_entities[file_idx].group = group_idx;
+        file_ids[file_idx] = ent_id;
+        id_to_file[ent_id] = file_idx;
+    }
+
+    std::string names = scene.name;
+    for (uint32_t i = 0; i < entities_count; i++) {
+        Entity &ent = scene.entity(file_ids[i]);
+        const std::string &name = ent.get_component<Name>().name;
+
+        SceneFileEntity &file_ent = file_entities[i];
+        file_ent.name_offset = names.size();
+        file_ent.name_size = name.size();
+        if (ent.parent_id.has_value())
+            file_ent.parent = id_to_file[ent.parent_id.value()];
+
+        names += name;
+    }
+
+    AssetRefs refs;
+    std::vector<uint8_t> columns;
+    for (SceneFileGroup &group : groups) {
+        uint64_t group_offset = columns.size();
+
+        for_each_column(group.components, [&](auto tag) {
+            using T = typename decltype(tag)::type;
+            static_assert(std::is_trivially_copyable_v<T>,
+                          "Scene file columns are copied as raw memory");
+
+            uint64_t column_offset = columns.size();
+            columns.resize(column_offset +
+                               aligned(group.entities_count * sizeof(T)),
+                           0);
+
+            T *column = (T *)(columns.data() + column_offset);
+            for (uint32_t i = 0; i < group.entities_count; i++) {
+                ecs::EntityID ent_id = file_ids[group.first_entity + i];
+                column[i] = scene.registry.get_component<T>(ent_id);
+
+                if constexpr (std::is_same_v<T, MeshComp>)
+                    column[i].id =
+                        asset_ref(refs, names, asset_pack.meshes,
+                                  SceneFileAssetType::MESH, column[i].id);
+                else if constexpr (std::is_same_v<T, MaterialComp>)
+                    column[i].id =
+                        asset_ref(refs, names, asset_pack.materials,
+                                  SceneFileAssetType::MATERIAL, column[i].id);
+            }
+        });
+
+        group.columns.offset = group_offset;
+        group.columns.size = columns.size() - group_offset;
+    }
+
+    SceneFileHeader header;
+    std::memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+    header.entities_count = entities_count;
+    header.groups_count = groups.size();
+    header.assets_count = refs.refs.size();
+    header.name_offset = 0;
+    header.name_size = scene.name.size();
+
+    std::vector<uint8_t> file(aligned(sizeof(SceneFileHeader)), 0);
+    header.names = append_section(file, names.data(), names.size());
+    header.entities =
+        append_section(file, file_entities.data(),
+                       file_entities.size() * sizeof(SceneFileEntity));
+    header.order = append_section(file, dfs_to_file.data(),
+                                  dfs_to_file.size() * sizeof(uint32_t));
+    header.assets =
+        append_section(file, refs.refs.data(),
+                       refs.refs.size() * sizeof(SceneFileAssetRef));
+
+    /* Column offsets are relative to the columns blob until now. */
+    uint64_t groups_offset = aligned(file.size());
+    uint64_t columns_offset =
+        groups_offset + aligned(groups.size() * sizeof(SceneFileGroup));
+    for (SceneFileGroup &group : groups)
+        group.columns.offset += columns_offset;
+
+    header.groups = append_section(file, groups.data(),
+                                   groups.size() * sizeof(SceneFileGroup));
+    (void)append_section(file, columns.data(), columns.size());
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    FILE *out = fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        fprintf(stderr, "Failed to open scene file '%s' for writing\r\n",
+                path.c_str());
+        return false;
+    }
+
+    size_t written = fwrite(file.data(), 1, file.size(), out);
+    fclose(out);
+    if (written != file.size()) {
+        fprintf(stderr, "Failed to write scene file '%s'\r\n", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static bool section_valid(const SceneFileSection &section, uint64_t file_size,
+                          uint64_t expected_size) {
+    return section.offset % SECTION_ALIGNMENT == 0 &&
+           section.size == expected_size && section.offset <= file_size &&
+           section.size <= file_size - section.offset;
+}
+
+/* Checks everything the loader relies on, so a corrupted or truncated file
+ * gets rejected before the scene is touched. */
+static bool scene_file_valid(const uint8_t *data, uint64_t size) {
+    if (size < sizeof(SceneFileHeader))
+        return false;
+
+    const SceneFileHeader &header = *(const SceneFileHeader *)data;
+    if (std::memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic)) != 0)
+        return false;
+
+    if (header.version < SCENE_FILE_MIN_VERSION ||
+        header.version > SCENE_FILE_VERSION)
+        return false;
+
+    uint32_t known_components = version_components(header.version);
+
+    uint64_t count = header.entities_count;
+    const SceneFileSection &names = header.names;
+    if (!section_valid(names, size, names.size) ||
+        !section_valid(header.entities, size,
+                       count * sizeof(SceneFileEntity)) ||
+        !section_valid(header.order, size, count * sizeof(uint32_t)) ||
+        !section_valid(header.assets, size,
+                       header.assets_count * sizeof(SceneFileAssetRef)) ||
+        !section_valid(header.groups, size,
+                       header.groups_count * sizeof(SceneFileGroup)))
+        return false;
+
+    if ((uint64_t)header.name_offset + header.name_size > names.size)
+        return false;
+
+    const SceneFileAssetRef *assets =
+        (const SceneFileAssetRef *)(data + header.assets.offset);
+    for (uint32_t i = 0; i < header.assets_count; i++) {
+        if ((uint64_t)assets[i].name_offset + assets[i].name_size > names.size)
+            return false;
+    }
+
+    const SceneFileGroup *groups =
+        (const SceneFileGroup *)(data + header.groups.offset);
+    uint64_t grouped = 0;
+    for (uint32_t i = 0; i < header.groups_count; i++) {
+        const SceneFileGroup &group = groups[i];
+        if ((group.components & ~known_components) != 0 ||
+            group.first_entity != grouped ||
+            !section_valid(group.columns, size,
+                           columns_size(group.components,
+                                        group.entities_count)))
+            return false;
+
+        grouped += group.entities_count;
+    }
+
+    if (grouped != count)
+        return false;
+
+    const SceneFileEntity *entities =
+        (const SceneFileEntity *)(data + header.entities.offset);
+    for (uint32_t i = 0; i < count; i++) {
+        const SceneFileEntity &ent = entities[i];
+        if ((uint64_t)ent.name_offset + ent.name_size > names.size ||
+            ent.group >= header.groups_count)
+            return false;
+    }
+
+    /* Every entity exactly once, parents before children. */
+    const uint32_t *order = (const uint32_t *)(data + header.order.offset);
+    std::vector<bool> visited(count, false);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t idx = order[i];
+        if (idx >= count || visited[idx])
+            return false;
+
+        uint32_t parent = entities[idx].parent;
+        if (parent != SCENE_FILE_NO_PARENT &&
+            (parent >= count || !visited[parent]))
+            return false;
+
+        visited[idx] = true;
+    }
+
+    return true;
+}
+
+template <typename T>
+static AssetID resolve_asset(const std::map<AssetID, T> &assets,
+                             std::string_view name, AssetID saved_id,
+                             AssetID fallback_id) {
+    for (auto &[id, asset] : assets) {
+        if (asset.name == name)
+            return id;
+    }
+
+    if (assets.contains(saved_id))
+        return saved_id;
+
+    fprintf(stderr, "Scene references missing asset '%.*s'\r\n",
+            (int32_t)name.size(), name.data());
+    return fallback_id;
+}
+
+static void load_mapped(Scene &scene, const AssetPack &asset_pack,
+                        const uint8_t *data) {
+    const SceneFileHeader &header = *(const SceneFileHeader *)data;
+    const char *names = (const char *)(data + header.names.offset);
+    const SceneFileEntity *entities =
+        (const SceneFileEntity *)(data + header.entities.offset);
+    const uint32_t *order = (const uint32_t *)(data + header.order.offset);
+    const SceneFileAssetRef *assets =
+        (const SceneFileAssetRef *)(data + header.assets.offset);
+    const SceneFileGroup *groups =
+        (const SceneFileGroup *)(data + header.groups.offset);
+
+    scene.name.assign(names + header.name_offset, header.name_size);
+
+    /* Fixup table - file asset indices to IDs in this asset pack. */
+    std::vector<AssetID> asset_ids(header.assets_count);
+    for (uint32_t i = 0; i < header.assets_count; i++) {
+        const SceneFileAssetRef &ref = assets[i];
+        std::string_view name(names + ref.name_offset, ref.name_size);
+
+        if (ref.type == SceneFileAssetType::MESH)
+            asset_ids[i] = resolve_asset(asset_pack.meshes, name, ref.id,
+                                         AssetPack::CUBE_ID);
+        else
+            asset_ids[i] =
+                resolve_asset(asset_pack.materials, name, ref.id,
+                              AssetPack::DEFAULT_BASE_MATERIAL);
+    }
+
+    auto fixup_asset = [&](AssetID file_idx, AssetID fallback_id) {
+        if (file_idx < 0 || file_idx >= (AssetID)asset_ids.size())
+            return fallback_id;
+
+        return asset_ids[file_idx];
+    };
+
+    ecs::Registry &reg = scene.registry;
+    ecs::Archetype &base_atype =
+        reg.extended<GlobalTransform>(reg.extended<Transform>(
+            reg.extended<Name>(reg.empty_archetype())));
+
+    uint32_t entities_count = header.entities_count;
+    std::vector<ecs::EntityID> file_to_id(entities_count);
+    ecs::EntityID max_id = 0;
+    for (uint32_t group_idx = 0; group_idx < header.groups_count;
+         group_idx++) {
+        const SceneFileGroup &group = groups[group_idx];
+        if (group.entities_count == 0)
+            continue;
+
+        ecs::Archetype *atype = &base_atype;
+        for_each_optional_component(group.components, [&](auto tag) {
+            using T = typename decltype(tag)::type;
+            atype = &reg.extended<T>(*atype);
+        });
+
+        ecs::EntityID first_id =
+            reg.create_entities(*atype, group.entities_count);
+        size_t first_row = reg.entity_index.at(first_id).row;
+
+        const uint8_t *column_data = data + group.columns.offset;
+        for_each_column(group.components, [&](auto tag) {
+            using T = typename decltype(tag)::type;
+
+            size_t column_idx = atype->column_index.at(typeid(T).hash_code());
+            T *column =
+                atype->components[column_idx]->as_vec<T>().storage.data() +
+                first_row;
+
+            std::memcpy(column, column_data, group.entities_count * sizeof(T));
+            column_data += aligned(group.entities_count * sizeof(T));
+
+            if constexpr (std::is_same_v<T, MeshComp>) {
+                for (uint32_t i = 0; i < group.entities_count; i++)
+                    column[i].id =
+                        fixup_asset(column[i].id, AssetPack::CUBE_ID);
+            } else if constexpr (std::is_same_v<T, MaterialComp>) {
+                for (uint32_t i = 0; i < group.entities_count; i++)
+                    column[i].id = fixup_asset(
+                        column[i].id, AssetPack::DEFAULT_BASE_MATERIAL);
+            } else if constexpr (std::is_same_v<T, LodComp>) {
+                /* Only the bias is kept, selection starts over. */
+                for (uint32_t i = 0; i < group.entities_count; i++)
+                    column[i] = LodComp{.bias = column[i].bias};
+            }
+        });
+
+        size_t name_column = atype->column_index.at(typeid(Name).hash_code());
+        Name *name =
+            atype->components[name_column]->as_vec<Name>().storage.data() +
+            first_row;
+        for (uint32_t i = 0; i < group.entities_count; i++) {
+            const SceneFileEntity &ent = entities[group.first_entity + i];
+            name[i].name.assign(names + ent.name_offset, ent.name_size);
+            file_to_id[group.first_entity + i] = first_id + i;
+        }
+
+        max_id = std::max(max_id, first_id + group.entities_count - 1);
+    }
+
+    /* Slots follow hierarchy order, so it's known upfront. */
+    scene.entities.resize(entities_count);
+    scene.id_to_index.resize(max_id + 1, -1);
+    scene.traversal_order.resize(entities_count);
+    for (uint32_t i = 0; i < entities_count; i++) {
+        uint32_t file_idx = order[i];
+        ecs::EntityID ent_id = file_to_id[file_idx];
+
+        Entity &ent = scene.entities[i];
+        ent.handle = ent_id;
+        ent.owning_reg = &reg;
+        ent.mesh_changed_ids = &scene.mesh_changed_ids;
+        if (reg.has_component<MeshComp>(ent_id))
+            ent.mesh_changed();
+
+        uint32_t parent = entities[file_idx].parent;
+        if (parent != SCENE_FILE_NO_PARENT) {
+            ent.parent_id = file_to_id[parent];
+            scene.entity(file_to_id[parent]).children_ids.push_back(ent_id);
+        } else {
+            scene.root_ids.push_back(ent_id);
+        }
+
+        scene.id_to_index[ent_id] = i;
+        scene.traversal_order[i] = i;
+    }
+
+    scene.hierarchy_dirty = false;
+}
+
+bool load_scene(Scene &scene, const AssetPack &asset_pack,
+                const std::string &path) {
+    assert(scene.entities.empty() && "Loading into non-empty scene");
+
+    int32_t fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to open scene file '%s'\r\n", path.c_str());
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        fprintf(stderr, "Failed to read scene file '%s'\r\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    uint64_t size = file_stat.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Failed to map scene file '%s'\r\n", path.c_str());
+        return false;
+    }
+
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const uint8_t *data = (const uint8_t *)mapped;
+    bool valid = scene_file_valid(data, size);
+    if (valid)
+        load_mapped(scene, asset_pack, data);
+    else
+        fprintf(stderr, "Invalid scene file '%s'\r\n", path.c_str());
+
+    munmap(mapped, size);
+    return valid;
+}
+
+} // namespace eng
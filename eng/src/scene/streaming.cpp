@@ -0,0 +1,425 @@
+#include "eng/scene/streaming.hpp"
+#include "eng/scene/scene_file.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace eng {
+
+uint64_t cell_key(const glm::ivec2 &coords) {
+    return ((uint64_t)(uint32_t)coords.x << 32) | (uint32_t)coords.y;
+}
+
+glm::ivec2 cell_coords(const glm::vec3 &position, float cell_size) {
+    glm::vec2 position_xz = glm::vec2(position.x, position.z);
+    return glm::ivec2(glm::floor(position_xz / cell_size));
+}
+
+static std::string cell_path(const std::string &dir, const glm::ivec2 &coords) {
+    std::string filename = "cell_" + std::to_string(coords.x) + "_" +
+                           std::to_string(coords.y) + ".scene";
+
+    return (std::filesystem::path(dir) / filename).string();
+}
+
+static bool parse_cell_filename(const std::string &filename,
+                                glm::ivec2 &coords) {
+    int32_t consumed = 0;
+    int32_t matched = sscanf(filename.c_str(), "cell_%d_%d.scene%n",
+                             &coords.x, &coords.y, &consumed);
+
+    return matched == 2 && consumed == (int32_t)filename.size();
+}
+
+/* Distance from the point to the closest point of the cell. */
+static float cell_distance(const glm::ivec2 &coords, const glm::vec2 &point,
+                           float cell_size) {
+    glm::vec2 min = glm::vec2(coords) * cell_size;
+    glm::vec2 closest = glm::clamp(point, min, min + cell_size);
+
+    return glm::distance(point, closest);
+}
+
+bool save_scene_cells(Scene &scene, const AssetPack &asset_pack,
+                      const std::string &dir, float cell_size) {
+    assert(cell_size > 0.0f && "Cell size has to be positive");
+
+    std::error_code err;
+    std::filesystem::create_directories(dir, err);
+    if (err) {
+        fprintf(stderr, "Failed to create cells directory '%s'\r\n",
+                dir.c_str());
+        return false;
+    }
+
+    for (const auto &file : std::filesystem::directory_iterator(dir)) {
+        glm::ivec2 coords;
+        if (parse_cell_filename(file.path().filename().string(), coords))
+            std::filesystem::remove(file.path());
+    }
+
+    std::unordered_map<uint64_t, StreamedCell> cells;
+    for (ecs::EntityID root_id : scene.root_ids) {
+        Entity &root = scene.entity(root_id);
+        glm::vec3 position = root.get_component<GlobalTransform>().position;
+        glm::ivec2 coords = cell_coords(position, cell_size);
+
+        StreamedCell &cell = cells[cell_key(coords)];
+        cell.coords = coords;
+        cell.root_ids.push_back(root_id);
+    }
+
+    for (auto &[key, cell] : cells) {
+        if (!save_subtrees(scene, asset_pack, cell.root_ids,
+                           cell_path(dir, cell.coords)))
+            return false;
+    }
+
+    return true;
+}
+
+static void cell_worker(CellLoader &loader) {
+    while (true) {
+        CellRequest request;
+        {
+            std::unique_lock<std::mutex> lock(loader.mutex);
+            loader.has_requests.wait(lock, [&]() {
+                return loader.quit || !loader.requests.empty();
+            });
+
+            if (loader.quit)
+                return;
+
+            request = std::move(loader.requests.front());
+            loader.requests.pop_front();
+        }
+
+        LoadedCell cell;
+        cell.coords = request.coords;
+        cell.assets = request.assets;
+        cell.staging = std::make_unique<Scene>(Scene::create("staging"));
+        if (!load_scene(*cell.staging, *request.assets, request.path)) {
+            cell.staging->destroy();
+            cell.staging.reset();
+        }
+
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        loader.loaded.push_back(std::move(cell));
+    }
+}
+
+CellStreamer CellStreamer::create(const CellStreamingSpec &spec) {
+    assert(spec.cell_size > 0.0f && "Cell size has to be positive");
+    assert(spec.unload_radius >= spec.load_radius &&
+           "Cells would get evicted right after loading");
+    assert(spec.workers_count > 0 && "Streaming needs at least one worker");
+
+    CellStreamer streamer;
+    streamer.spec = spec;
+
+    std::error_code err;
+    if (std::filesystem::is_directory(spec.dir, err)) {
+        for (const auto &file : std::filesystem::directory_iterator(spec.dir)) {
+            glm::ivec2 coords;
+            if (parse_cell_filename(file.path().filename().string(), coords))
+                streamer.available_cells[cell_key(coords)] = coords;
+        }
+    } else {
+        fprintf(stderr, "No cells directory '%s'\r\n", spec.dir.c_str());
+    }
+
+    streamer.loader = std::make_unique<CellLoader>();
+    for (int32_t i = 0; i < spec.workers_count; i++)
+        streamer.loader->workers.emplace_back(cell_worker,
+                                              std::ref(*streamer.loader));
+
+    return streamer;
+}
+
+void CellStreamer::destroy() {
+    assert(loader && "Trying to destroy invalid cell streamer");
+
+    {
+        std::lock_guard<std::mutex> lock(loader->mutex);
+        loader->quit = true;
+    }
+
+    loader->has_requests.notify_all();
+    for (std::thread &worker : loader->workers)
+        worker.join();
+
+    for (LoadedCell &cell : loader->loaded) {
+        if (cell.staging)
+            cell.staging->destroy();
+    }
+
+    loader.reset();
+    available_cells.clear();
+    cells.clear();
+    assets_snapshot.reset();
+}
+
+/* Live ID of the asset that was ID in SNAPSHOT - found by name, like
+ * loading does. FALLBACK_ID if it's gone. */
+template <typename T>
+static AssetID live_asset_id(const std::map<AssetID, T> &snapshot,
+                             const std::map<AssetID, T> &live, AssetID id,
+                             AssetID fallback_id) {
+    auto named = snapshot.find(id);
+    if (named != snapshot.end()) {
+        for (auto &[live_id, asset] : live) {
+            if (asset.name == named->second.name)
+                return live_id;
+        }
+    }
+
+    return live.contains(id) ? id : fallback_id;
+}
+
+/* Assets changed while the cell was loading, IDs resolved against the old
+ * snapshot could be dangling by now. */
+static void refresh_asset_ids(Scene &staging, const AssetPack &snapshot,
+                              const AssetPack &asset_pack) {
+    ecs::RegistryView meshes = staging.registry.view<MeshComp>();
+    for (ecs::RegistryView::Entry &entry : meshes.entity_entries) {
+        MeshComp &comp = meshes.get<MeshComp>(entry);
+        comp.id = live_asset_id(snapshot.meshes, asset_pack.meshes, comp.id,
+                                AssetPack::CUBE_ID);
+    }
+
+    ecs::RegistryView materials = staging.registry.view<MaterialComp>();
+    for (ecs::RegistryView::Entry &entry : materials.entity_entries) {
+        MaterialComp &comp = materials.get<MaterialComp>(entry);
+        comp.id =
+            live_asset_id(snapshot.materials, asset_pack.materials, comp.id,
+                          AssetPack::DEFAULT_BASE_MATERIAL);
+    }
+}
+
+/* Staging entities land in the live scene with one column append per
+ * archetype. Appends new roots to OUT_ROOT_IDS. */
+static void merge_cell(Scene &scene, Scene &staging,
+                       std::vector<ecs::EntityID> &out_root_ids) {
+    std::vector<ecs::EntityID> staging_roots = staging.root_ids;
+    std::vector<ecs::EntityID> id_map = scene.merge(std::move(staging));
+
+    for (ecs::EntityID root_id : staging_roots)
+        out_root_ids.push_back(id_map[root_id]);
+}
+
+static void evict_cell(Scene &scene, StreamedCell &cell) {
+    /* Some might've been deleted by hand in the meantime. */
+    for (ecs::EntityID root_id : cell.root_ids) {
+        if (scene.contains(root_id))
+            scene.destroy_entity(root_id);
+    }
+
+    cell.root_ids.clear();
+}
+
+/* Returns true if the request didn't reach any worker yet and got dropped. */
+static bool cancel_request(CellLoader &loader, const glm::ivec2 &coords) {
+    std::lock_guard<std::mutex> lock(loader.mutex);
+
+    auto itr = std::find_if(
+        loader.requests.begin(), loader.requests.end(),
+        [&](const CellRequest &request) { return request.coords == coords; });
+    if (itr == loader.requests.end())
+        return false;
+
+    loader.requests.erase(itr);
+    return true;
+}
+
+static std::shared_ptr<const AssetPack>
+asset_names_snapshot(const AssetPack &asset_pack) {
+    std::shared_ptr<AssetPack> snapshot = std::make_shared<AssetPack>();
+    for (auto &[id, mesh] : asset_pack.meshes)
+        snapshot->meshes[id].name = mesh.name;
+
+    for (auto &[id, material] : asset_pack.materials)
+        snapshot->materials[id].name = material.name;
+
+    snapshot->generation = asset_pack.generation;
+    return snapshot;
+}
+
+void CellStreamer::update(Scene &scene, const AssetPack &asset_pack,
+                          const glm::vec3 &focus) {
+    glm::vec2 focus_xz = glm::vec2(focus.x, focus.z);
+
+    int32_t evictions = 0;
+    for (auto itr = cells.begin(); itr != cells.end();) {
+        StreamedCell &cell = itr->second;
+        if (cell_distance(cell.coords, focus_xz, spec.cell_size) <=
+            spec.unload_radius) {
+            itr++;
+            continue;
+        }
+
+        if (cell.state == CellState::LOADING) {
+            if (cancel_request(*loader, cell.coords)) {
+                itr = cells.erase(itr);
+                continue;
+            }
+
+            /* Already being loaded, gets dropped when it's done. */
+            cell.state = CellState::CANCELLED;
+        } else if (cell.state == CellState::RESIDENT &&
+                   evictions < spec.max_evictions_per_update) {
+            evict_cell(scene, cell);
+            evictions++;
+
+            itr = cells.erase(itr);
+            continue;
+        }
+
+        itr++;
+    }
+
+    std::vector<LoadedCell> finished;
+    {
+        std::lock_guard<std::mutex> lock(loader->mutex);
+        finished.swap(loader->loaded);
+    }
+
+    int32_t merges = 0;
+    std::vector<LoadedCell> postponed;
+    for (LoadedCell &loaded : finished) {
+        StreamedCell &cell = cells.at(cell_key(loaded.coords));
+        if (cell.state == CellState::CANCELLED) {
+            if (loaded.staging)
+                loaded.staging->destroy();
+
+            cells.erase(cell_key(loaded.coords));
+            continue;
+        }
+
+        if (merges == spec.max_merges_per_update) {
+            postponed.push_back(std::move(loaded));
+            continue;
+        }
+
+        /* Failed cells stay resident, empty, so they aren't retried every
+         * frame. */
+        if (loaded.staging) {
+            if (loaded.assets->generation != asset_pack.generation)
+                refresh_asset_ids(*loaded.staging, *loaded.assets, asset_pack);
+
+            merge_cell(scene, *loaded.staging, cell.root_ids);
+        }
+
+        cell.state = CellState::RESIDENT;
+        merges++;
+    }
+
+    if (!postponed.empty()) {
+        std::lock_guard<std::mutex> lock(loader->mutex);
+        loader->loaded.insert(loader->loaded.begin(),
+                              std::make_move_iterator(postponed.begin()),
+                              std::make_move_iterator(postponed.end()));
+    }
+
+    /* Missing cells in range, nearest first. */
+    glm::vec3 reach = glm::vec3(spec.load_radius);
+    glm::ivec2 min = cell_coords(focus - reach, spec.cell_size);
+    glm::ivec2 max = cell_coords(focus + reach, spec.cell_size);
+
+    std::vector<std::pair<float, glm::ivec2>> candidates;
+    for (int32_t z = min.y; z <= max.y; z++) {
+        for (int32_t x = min.x; x <= max.x; x++) {
+            glm::ivec2 coords = glm::ivec2(x, z);
+            uint64_t key = cell_key(coords);
+            if (!available_cells.contains(key))
+                continue;
+
+            float dist = cell_distance(coords, focus_xz, spec.cell_size);
+            if (dist > spec.load_radius)
+                continue;
+
+            auto cell_itr = cells.find(key);
+            if (cell_itr == cells.end()) {
+                candidates.push_back(std::make_pair(dist, coords));
+                continue;
+            }
+
+            /* Came back in range before it finished loading. */
+            if (cell_itr->second.state == CellState::CANCELLED)
+                cell_itr->second.state = CellState::LOADING;
+        }
+    }
+
+    if (candidates.empty())
+        return;
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto &lhs, const auto &rhs) {
+                  return lhs.first < rhs.first;
+              });
+
+    if (!assets_snapshot ||
+        assets_snapshot->generation != asset_pack.generation)
+        assets_snapshot = asset_names_snapshot(asset_pack);
+
+    {
+        std::lock_guard<std::mutex> lock(loader->mutex);
+        for (auto &[dist, coords] : candidates) {
+            if (cells.size() >= (size_t)spec.max_resident_cells)
+                break;
+
+            StreamedCell &cell = cells[cell_key(coords)];
+            cell.coords = coords;
+            cell.state = CellState::LOADING;
+
+            CellRequest request;
+            request.coords = coords;
+            request.path = cell_path(spec.dir, coords);
+            request.assets = assets_snapshot;
+            loader->requests.push_back(std::move(request));
+        }
+    }
+
+    loader->has_requests.notify_all();
+}
+
+void CellStreamer::evict_all(Scene &scene) {
+    for (auto itr = cells.begin(); itr != cells.end();) {
+        StreamedCell &cell = itr->second;
+        if (cell.state == CellState::RESIDENT) {
+            evict_cell(scene, cell);
+            itr = cells.erase(itr);
+            continue;
+        }
+
+        if (cell.state == CellState::LOADING &&
+            cancel_request(*loader, cell.coords)) {
+            itr = cells.erase(itr);
+            continue;
+        }
+
+        cell.state = CellState::CANCELLED;
+        itr++;
+    }
+}
+
+int32_t CellStreamer::resident_count() const {
+    int32_t count = 0;
+    for (auto &[key, cell] : cells) {
+        if (cell.state == CellState::RESIDENT)
+            count++;
+    }
+
+    return count;
+}
+
+bool CellStreamer::has_pending() const {
+    for (auto &[key, cell] : cells) {
+        if (cell.state != CellState::RESIDENT)
+            return true;
+    }
+
+    return false;
+}
+
+} // namespace eng
@@ -0,0 +1,118 @@
+#include "eng/scene/stress_scene.hpp"
+#include <random>
+
+namespace eng {
+
+std::vector<ecs::EntityID> generate_stress_scene(Scene &scene,
+                                                 AssetPack &asset_pack,
+                                                 const StressSceneSpec &spec) {
+    assert(spec.hierarchy_depth > 0 && "Hierarchy needs at least roots");
+    assert(spec.meshes_count > 0 && spec.materials_count > 0 &&
+           "Stress scene needs meshes and materials");
+    assert(!asset_pack.meshes.empty() && "No meshes in the asset pack");
+
+    std::mt19937 rng(spec.seed);
+    std::uniform_real_distribution<float> position_dist(-spec.extent * 0.5f,
+                                                        spec.extent * 0.5f);
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+
+    std::vector<AssetID> mesh_ids;
+    for (auto &[id, mesh] : asset_pack.meshes) {
+        if (mesh_ids.size() == (size_t)spec.meshes_count)
+            break;
+
+        mesh_ids.push_back(id);
+    }
+
+    std::vector<AssetID> material_ids;
+    for (int32_t i = 0; i < spec.materials_count; i++) {
+        Material material;
+        material.name = "Stress material " + std::to_string(i);
+        material.color = glm::vec4(unit_dist(rng), unit_dist(rng),
+                                   unit_dist(rng), 1.0f);
+        material.roughness = unit_dist(rng);
+        material_ids.push_back(asset_pack.add_material(material));
+    }
+
+    /* Trees are built level by level, nodes of the current level wait in
+     * LEVEL for their children. */
+    std::vector<ecs::EntityID> root_ids;
+    std::vector<ecs::EntityID> level;
+    std::vector<ecs::EntityID> next_level;
+    uint32_t spawned = 0;
+    while (spawned < spec.entities_count) {
+        bool is_static = unit_dist(rng) < spec.static_ratio;
+        level.clear();
+        for (int32_t depth = 0;
+             depth < spec.hierarchy_depth && spawned < spec.entities_count;
+             depth++) {
+            int32_t nodes_count = depth == 0 ? 1 : spec.children_per_node;
+            int32_t parents_count = depth == 0 ? 1 : level.size();
+
+            next_level.clear();
+            for (int32_t parent = 0; parent < parents_count; parent++) {
+                for (int32_t i = 0;
+                     i < nodes_count && spawned < spec.entities_count; i++) {
+                    Entity ent = scene.spawn_entity("stress");
+                    Transform &transform = ent.get_component<Transform>();
+                    if (depth == 0) {
+                        transform.position = {position_dist(rng), 0.0f,
+                                              position_dist(rng)};
+                        transform.rotation.y = unit_dist(rng) * 6.28f;
+                        root_ids.push_back(ent.handle);
+                    } else {
+                        transform.position = {i * 2.0f - 1.0f, 1.5f, 0.0f};
+                        transform.scale = glm::vec3(0.75f);
+                        scene.link_relation(scene.entity(level[parent]), ent);
+                    }
+
+                    if (is_static)
+                        ent.add_component<Static>();
+                    if (spec.lods)
+                        ent.add_component<LodComp>();
+
+                    ent.add_component<MeshComp>().id =
+                        mesh_ids[spawned % mesh_ids.size()];
+                    ent.add_component<MaterialComp>().id =
+                        material_ids[rng() % material_ids.size()];
+
+                    next_level.push_back(ent.handle);
+                    spawned++;
+                }
+            }
+
+            level.swap(next_level);
+        }
+    }
+
+    for (int32_t i = 0; i < spec.point_lights_count; i++) {
+        Entity ent = scene.spawn_entity("stress point light");
+        ent.get_component<Transform>().position = {position_dist(rng), 3.0f,
+                                                   position_dist(rng)};
+
+        PointLight &light = ent.add_component<PointLight>();
+        light.color = glm::vec3(unit_dist(rng), unit_dist(rng), 1.0f);
+        light.radius = 4.0f + unit_dist(rng) * 8.0f;
+    }
+
+    for (int32_t i = 0; i < spec.spot_lights_count; i++) {
+        Entity ent = scene.spawn_entity("stress spot light");
+        Transform &transform = ent.get_component<Transform>();
+        transform.position = {position_dist(rng), 8.0f, position_dist(rng)};
+        transform.rotation.x = -1.2f;
+
+        SpotLight &light = ent.add_component<SpotLight>();
+        light.distance = 16.0f;
+        light.cutoff = 25.0f;
+    }
+
+    for (int32_t i = 0; i < spec.dir_lights_count; i++) {
+        Entity ent = scene.spawn_entity("stress dir light");
+        ent.get_component<Transform>().rotation = {-0.8f, i * 0.5f, 0.0f};
+        ent.add_component<DirLight>().intensity = 0.5f;
+    }
+
+    return root_ids;
+}
+
+} // namespace eng
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/renderer/opengl.hpp"
+
+using namespace eng;
+
+using AsyncReadbackTest = GLTest;
+
+TEST_F(AsyncReadbackTest, CopiesOnlyRequestedPixels) {
+    std::array<glm::u8vec4, 16> texels;
+    for (int32_t i = 0; i < texels.size(); i++)
+        texels[i] = glm::u8vec4(i, i * 2, i * 3, 255);
+
+    GLuint texture = 0;
+    GL_CALL(glGenTextures(1, &texture));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, texels.data()));
+
+    GLuint fbo = 0;
+    GL_CALL(glGenFramebuffers(1, &fbo));
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, texture, 0));
+    GL_CALL(glReadBuffer(GL_COLOR_ATTACHMENT0));
+
+    /* 2x3 RGB, rows of 6 bytes padded to 8 - 22 bytes out of 64. */
+    AsyncReadback readback = AsyncReadback::create(64);
+    ASSERT_TRUE(readback.request_pixels({1, 1}, {2, 3}, GL_RGB,
+                                        GL_UNSIGNED_BYTE));
+    ASSERT_EQ(readback.sizes[0], 22);
+
+    GL_CALL(glFinish());
+    std::array<uint8_t, 64> dst;
+    dst.fill(0xAB);
+    /* Fence is signaled after glFinish(), bounded in case polling breaks. */
+    int32_t polls = 0;
+    while (!readback.poll(dst.data())) {
+        if (++polls == 100)
+            FAIL() << "Readback never completed";
+    }
+
+    for (int32_t y = 0; y < 3; y++) {
+        for (int32_t x = 0; x < 2; x++) {
+            const glm::u8vec4 &texel = texels[(y + 1) * 4 + x + 1];
+            for (int32_t c = 0; c < 3; c++)
+                ASSERT_EQ(dst[y * 8 + x * 3 + c], texel[c]);
+        }
+    }
+
+    for (int32_t i = 22; i < dst.size(); i++)
+        ASSERT_EQ(dst[i], 0xAB);
+
+    ASSERT_EQ(glGetError(), GL_NO_ERROR);
+
+    readback.destroy();
+    GL_CALL(glDeleteFramebuffers(1, &fbo));
+    GL_CALL(glDeleteTextures(1, &texture));
+}
@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+
+#include "eng/renderer/primitives.hpp"
+#include "eng/scene/bvh.hpp"
+#include "eng/scene/scene.hpp"
+#include <algorithm>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <random>
+
+using namespace eng;
+
+static std::vector<MeshAABB> random_boxes(int32_t count) {
+    std::default_random_engine eng{42};
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    std::vector<MeshAABB> boxes;
+    for (int32_t i = 0; i < count; i++) {
+        glm::vec3 min = {pos(eng), pos(eng), pos(eng)};
+        glm::vec3 max = min + glm::vec3(size(eng), size(eng), size(eng));
+        boxes.push_back({min, max});
+    }
+
+    return boxes;
+}
+
+static std::vector<ecs::EntityID> proxies_to_ids(
+    const DynamicBVH &bvh, const std::vector<int32_t> &proxies) {
+    std::vector<ecs::EntityID> ids;
+    for (int32_t proxy : proxies)
+        ids.push_back(bvh.nodes[proxy].ent_id);
+
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+TEST(DynamicBVH, StaysBalanced) {
+    DynamicBVH bvh = DynamicBVH::create();
+    std::vector<MeshAABB> boxes = random_boxes(4096);
+    for (int32_t i = 0; i < boxes.size(); i++)
+        (void)bvh.insert(boxes[i], i, 1);
+
+    ASSERT_EQ(bvh.leaves_count(), 4096);
+    ASSERT_LE(bvh.height(), 24) << "Tree height should stay logarithmic";
+
+    bvh.destroy();
+}
+
+TEST(DynamicBVH, FrustumQueryMatchesBruteForce) {
+    DynamicBVH bvh = DynamicBVH::create(0.0f);
+    std::vector<MeshAABB> boxes = random_boxes(2000);
+    for (int32_t i = 0; i < boxes.size(); i++)
+        (void)bvh.insert(boxes[i], i, 1);
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 80.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.5f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = extract_frustum_planes(proj * view);
+
+    std::vector<int32_t> proxies;
+    bvh.query_frustum(frustum, proxies);
+    std::vector<ecs::EntityID> found = proxies_to_ids(bvh, proxies);
+
+    std::vector<ecs::EntityID> expected;
+    for (int32_t i = 0; i < boxes.size(); i++) {
+        if (aabb_vs_frustum(boxes[i], frustum))
+            expected.push_back(i);
+    }
+
+    ASSERT_FALSE(expected.empty());
+    ASSERT_EQ(found, expected);
+
+    bvh.destroy();
+}
+
+TEST(DynamicBVH, BatchedCullingMatchesScalar) {
+    std::default_random_engine eng{7};
+    std::uniform_real_distribution<float> pos(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+    std::uniform_real_distribution<float> scale(0.2f, 4.0f);
+
+    /* Not a multiple of 4, so the scalar tail runs too. */
+    std::vector<MeshAABB> local_bbs = random_boxes(1003);
+    std::vector<glm::mat4> transforms;
+    for (MeshAABB &bb : local_bbs) {
+        glm::vec3 center = (bb.min + bb.max) * 0.5f;
+        bb.min -= center;
+        bb.max -= center;
+
+        glm::mat4 transform =
+            glm::translate(glm::mat4(1.0f), {pos(eng), pos(eng), pos(eng)});
+        transform = glm::rotate(transform, angle(eng),
+                                glm::normalize(glm::vec3(1.0f, 0.5f, 0.2f)));
+        transforms.push_back(glm::scale(transform, glm::vec3(scale(eng))));
+    }
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 80.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.5f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = extract_frustum_planes(proj * view);
+
+    std::vector<uint8_t> visible(local_bbs.size());
+    cull_aabbs(transforms, local_bbs, frustum, visible);
+
+    int32_t visible_count = 0;
+    for (int32_t i = 0; i < local_bbs.size(); i++) {
+        MeshAABB world_bb = transform_aabb(local_bbs[i], transforms[i]);
+        ASSERT_EQ(visible[i], aabb_vs_frustum(world_bb, frustum));
+        visible_count += visible[i];
+    }
+
+    ASSERT_GT(visible_count, 0);
+    ASSERT_LT(visible_count, local_bbs.size());
+}
+
+TEST(DynamicBVH, SphereAndConeQueries) {
+    DynamicBVH bvh = DynamicBVH::create(0.0f);
+    std::vector<MeshAABB> boxes = random_boxes(2000);
+    for (int32_t i = 0; i < boxes.size(); i++)
+        (void)bvh.insert(boxes[i], i, 1);
+
+    glm::vec3 center = {10.0f, -5.0f, 3.0f};
+    std::vector<int32_t> proxies;
+    bvh.query_sphere(center, 30.0f, proxies);
+    std::vector<ecs::EntityID> found = proxies_to_ids(bvh, proxies);
+
+    std::vector<ecs::EntityID> expected;
+    for (int32_t i = 0; i < boxes.size(); i++) {
+        if (aabb_vs_sphere(boxes[i], center, 30.0f))
+            expected.push_back(i);
+    }
+
+    ASSERT_EQ(found, expected);
+
+    /* Cone is narrower than its range sphere and must keep everything the
+     * cone really touches. */
+    glm::vec3 dir = glm::normalize(glm::vec3(1.0f, 0.0f, 0.0f));
+    proxies.clear();
+    bvh.query_cone(center, dir, glm::radians(20.0f), 30.0f, proxies);
+    ASSERT_LT(proxies.size(), found.size());
+
+    for (int32_t i = 0; i < boxes.size(); i++) {
+        glm::vec3 box_center = (boxes[i].min + boxes[i].max) * 0.5f;
+        glm::vec3 to_box = box_center - center;
+        float dist = glm::length(to_box);
+        if (dist > 30.0f || dist < 0.001f)
+            continue;
+
+        float cos_angle = glm::dot(to_box / dist, dir);
+        if (cos_angle > glm::cos(glm::radians(20.0f))) {
+            std::vector<ecs::EntityID> ids = proxies_to_ids(bvh, proxies);
+            ASSERT_TRUE(std::binary_search(ids.begin(), ids.end(), i))
+                << "Box inside the cone was culled";
+        }
+    }
+
+    bvh.destroy();
+}
+
+TEST(DynamicBVH, RayFindsClosestBox) {
+    DynamicBVH bvh = DynamicBVH::create(0.0f);
+    (void)bvh.insert({{4.0f, -1.0f, -1.0f}, {5.0f, 1.0f, 1.0f}}, 1, 1);
+    (void)bvh.insert({{2.0f, -1.0f, -1.0f}, {3.0f, 1.0f, 1.0f}}, 2, 1);
+    (void)bvh.insert({{2.0f, 5.0f, -1.0f}, {3.0f, 6.0f, 1.0f}}, 3, 1);
+
+    ecs::EntityID closest = 0;
+    bvh.query_ray(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 100.0f,
+                  [&](int32_t proxy, float dist) {
+                      closest = bvh.nodes[proxy].ent_id;
+                      return dist;
+                  });
+
+    ASSERT_EQ(closest, 2);
+
+    bvh.destroy();
+}
+
+TEST(DynamicBVH, MoveAndRemove) {
+    DynamicBVH bvh = DynamicBVH::create(0.5f);
+    int32_t proxy = bvh.insert({glm::vec3(0.0f), glm::vec3(1.0f)}, 7, 1);
+    (void)bvh.insert({glm::vec3(10.0f), glm::vec3(11.0f)}, 8, 1);
+
+    ASSERT_FALSE(bvh.move(proxy, {glm::vec3(0.2f), glm::vec3(1.2f)}))
+        << "Small move should fit in the fattened box";
+    ASSERT_TRUE(bvh.move(proxy, {glm::vec3(20.0f), glm::vec3(21.0f)}));
+
+    std::vector<int32_t> proxies;
+    bvh.query_sphere(glm::vec3(20.5f), 1.0f, proxies);
+    ASSERT_EQ(proxies.size(), 1);
+    ASSERT_EQ(bvh.nodes[proxies[0]].ent_id, 7);
+
+    bvh.remove(proxy);
+    proxies.clear();
+    bvh.query_sphere(glm::vec3(20.5f), 1.0f, proxies);
+    ASSERT_TRUE(proxies.empty());
+    ASSERT_EQ(bvh.leaves_count(), 1);
+
+    bvh.destroy();
+}
+
+TEST(DynamicBVH, SceneKeepsIndexInSync) {
+    AssetPack pack;
+    pack.meshes[1].local_bb = {glm::vec3(-1.0f), glm::vec3(1.0f)};
+
+    Scene scene = Scene::create("test");
+    Entity parent = scene.spawn_entity("parent");
+    Entity child = scene.spawn_entity("child");
+    child.add_component<MeshComp>().id = 1;
+    scene.link_relation(parent, child);
+
+    scene.update_global_transforms();
+    scene.update_spatial_index(pack);
+    ASSERT_EQ(scene.spatial_index.leaves_count(), 1);
+
+    /* Moving the parent moves child's bounds. */
+    parent.get_component<Transform>().position = {50.0f, 0.0f, 0.0f};
+    scene.update_global_transforms();
+    scene.update_spatial_index(pack);
+
+    std::vector<int32_t> proxies;
+    scene.spatial_index.query_sphere({50.0f, 0.0f, 0.0f}, 0.5f, proxies);
+    ASSERT_EQ(proxies.size(), 1);
+    ASSERT_EQ(scene.spatial_index.nodes[proxies[0]].ent_id, child.handle);
+
+    child.remove_component<MeshComp>();
+    scene.update_spatial_index(pack);
+    ASSERT_EQ(scene.spatial_index.leaves_count(), 0);
+
+    child.add_component<MeshComp>().id = 1;
+    scene.update_spatial_index(pack);
+    ASSERT_EQ(scene.spatial_index.leaves_count(), 1);
+
+    scene.destroy_entity(parent.handle);
+    ASSERT_EQ(scene.spatial_index.leaves_count(), 0);
+
+    scene.destroy();
+}
+
+TEST(DynamicBVH, SceneIndexFollowsMeshEvents) {
+    AssetPack pack;
+    pack.meshes[1].local_bb = {glm::vec3(-1.0f), glm::vec3(1.0f)};
+    pack.meshes[2].local_bb = {glm::vec3(-4.0f), glm::vec3(4.0f)};
+
+    Scene scene = Scene::create("test");
+    Entity ent = scene.spawn_entity("ent");
+    ent.add_component<MeshComp>().id = 1;
+    Entity &copy = scene.duplicate(ent);
+    ecs::EntityID copy_id = copy.handle;
+
+    scene.update_global_transforms();
+    scene.update_spatial_index(pack);
+    ASSERT_EQ(scene.spatial_index.leaves_count(), 2);
+    ASSERT_TRUE(scene.mesh_changed_ids.empty());
+
+    /* In place swaps are picked up only once recorded. */
+    int32_t proxy = scene.id_to_proxy[ent.handle];
+    ent.get_component<MeshComp>().id = 2;
+    scene.update_spatial_index(pack);
+    ASSERT_EQ(scene.spatial_index.nodes[proxy].mesh_id, 1);
+
+    ent.mesh_changed();
+    scene.update_spatial_index(pack);
+    proxy = scene.id_to_proxy[ent.handle];
+    ASSERT_EQ(scene.spatial_index.nodes[proxy].mesh_id, 2);
+    ASSERT_GE(scene.spatial_index.nodes[proxy].bb.max.x, 4.0f);
+
+    /* Stale events of destroyed entities are skipped. */
+    scene.entity(copy_id).remove_component<MeshComp>();
+    scene.destroy_entity(copy_id);
+    scene.update_spatial_index(pack);
+    ASSERT_EQ(scene.spatial_index.leaves_count(), 1);
+
+    scene.destroy();
+}
+
+TEST(DynamicBVH, RayTriangle) {
+    Ray ray = {{0.25f, 0.25f, 5.0f}, {0.0f, 0.0f, -1.0f}};
+    glm::vec3 v0 = {0.0f, 0.0f, 0.0f};
+    glm::vec3 v1 = {1.0f, 0.0f, 0.0f};
+    glm::vec3 v2 = {0.0f, 1.0f, 0.0f};
+
+    EXPECT_NEAR(ray_vs_triangle(ray, v0, v1, v2), 5.0f, 0.0001f);
+
+    ray.origin = {0.75f, 0.75f, 5.0f};
+    EXPECT_LT(ray_vs_triangle(ray, v0, v1, v2), 0.0f);
+}
+
+TEST(DynamicBVH, SceneRaycastHitsClosestTriangle) {
+    VertexData cube = cube_vertex_data();
+
+    AssetPack pack;
+    Mesh &mesh = pack.meshes[1];
+    mesh.local_bb = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+    for (const Vertex &v : cube.vertices)
+        mesh.positions.push_back(v.position);
+    mesh.indices = cube.indices;
+
+    Scene scene = Scene::create("test");
+    Entity near = scene.spawn_entity("near");
+    near.add_component<MeshComp>().id = 1;
+    near.get_component<Transform>().position = {0.0f, 0.0f, -5.0f};
+
+    Entity far = scene.spawn_entity("far");
+    far.add_component<MeshComp>().id = 1;
+    far.get_component<Transform>().position = {0.0f, 0.0f, -10.0f};
+    far.get_component<Transform>().scale = glm::vec3(4.0f);
+
+    scene.update_global_transforms();
+    scene.update_spatial_index(pack);
+
+    Ray ray = {glm::vec3(0.0f), {0.0f, 0.0f, -1.0f}};
+    std::optional<RayHit> hit = scene.raycast(ray, pack);
+    ASSERT_TRUE(hit.has_value());
+    ASSERT_EQ(hit.value().ent_id, near.handle);
+    EXPECT_NEAR(hit.value().distance, 4.5f, 0.0001f);
+    EXPECT_NEAR(hit.value().point.z, -4.5f, 0.0001f);
+
+    /* Misses the small cube, hits the scaled one. */
+    ray.origin = {1.5f, 0.0f, 0.0f};
+    hit = scene.raycast(ray, pack);
+    ASSERT_TRUE(hit.has_value());
+    ASSERT_EQ(hit.value().ent_id, far.handle);
+    EXPECT_NEAR(hit.value().distance, 8.0f, 0.0001f);
+
+    ray.origin = {10.0f, 0.0f, 0.0f};
+    ASSERT_FALSE(scene.raycast(ray, pack).has_value());
+
+    scene.destroy();
+}
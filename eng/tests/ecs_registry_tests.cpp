@@ -139,6 +139,47 @@ TEST(Registry, SharingArchetype) {
     reg.destroy();
 }
 
+TEST(Registry, MergeStaging) {
+    Registry reg = Registry::create();
+    EntityID live = reg.create_entity();
+    reg.add_component<int>(live) = 1;
+
+    Registry staging = Registry::create();
+    EntityID s1 = staging.create_entity();
+    EntityID s2 = staging.create_entity();
+    EntityID s3 = staging.create_entity();
+    EntityID s4 = staging.create_entity();
+
+    staging.add_component<int>(s1) = 10;
+    staging.add_component<float>(s1) = 10.0f;
+    staging.add_component<int>(s2) = 20;
+    staging.add_component<char>(s3) = 'c';
+
+    std::vector<EntityID> ids = reg.merge(std::move(staging));
+    ASSERT_EQ(ids.size(), s4 + 1);
+    ASSERT_EQ(ids[0], 0) << "IDs not used in staging should map to zero";
+    ASSERT_NE(ids[s1], live) << "Merged entities should get fresh IDs";
+
+    ASSERT_EQ(reg.get_component<int>(live), 1)
+        << "Live entity's data should stay intact";
+    ASSERT_EQ(reg.get_component<int>(ids[s1]), 10);
+    ASSERT_EQ(reg.get_component<float>(ids[s1]), 10.0f);
+    ASSERT_EQ(reg.get_component<int>(ids[s2]), 20);
+    ASSERT_EQ(reg.get_component<char>(ids[s3]), 'c')
+        << "Archetype missing in live registry should get created";
+    ASSERT_FALSE(reg.has_component<int>(ids[s4]));
+
+    /* Merged entities should behave like ones created here. */
+    reg.destroy_entity(live);
+    reg.add_component<char>(ids[s2]) = 'x';
+    reg.remove_component<float>(ids[s1]);
+    ASSERT_EQ(reg.get_component<int>(ids[s1]), 10);
+    ASSERT_EQ(reg.get_component<int>(ids[s2]), 20);
+    ASSERT_EQ(reg.get_component<char>(ids[s2]), 'x');
+
+    reg.destroy();
+}
+
 TEST(RegistryView, SingleComponentSameArchetype) {
     constexpr int expected[] = {1, 2, 3};
 
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "eng/fixed_timestep.hpp"
+#include "eng/scene/components.hpp"
+#include "eng/scene/scene.hpp"
+
+using namespace eng;
+
+TEST(FixedTimestep, AccumulatesFrameTime) {
+    FixedTimestep timestep = FixedTimestep::create(50);
+    ASSERT_FLOAT_EQ(timestep.tick_duration(), 0.02f);
+
+    /* Frames faster than ticks - most of them don't tick at all. */
+    int32_t ticks = 0;
+    for (int32_t i = 0; i < 100; i++)
+        ticks += timestep.advance(0.005f);
+
+    ASSERT_NEAR(ticks, 25, 1);
+    ASSERT_EQ(timestep.total_ticks, ticks);
+    ASSERT_GE(timestep.alpha(), 0.0f);
+    ASSERT_LT(timestep.alpha(), 1.0f);
+
+    /* Slow frame catches up. */
+    ASSERT_EQ(timestep.advance(0.1f), 5);
+    ASSERT_EQ(timestep.dropped_ticks, 0);
+}
+
+TEST(FixedTimestep, DropsBacklogPastMaxTicks) {
+    FixedTimestep timestep = FixedTimestep::create(100, 4);
+
+    ASSERT_EQ(timestep.advance(0.105f), 4);
+    ASSERT_EQ(timestep.dropped_ticks, 6);
+    ASSERT_LT(timestep.accumulator, timestep.tick_duration());
+
+    /* Back to normal afterwards. */
+    ASSERT_EQ(timestep.advance(0.01f), 1);
+    ASSERT_EQ(timestep.dropped_ticks, 6);
+}
+
+TEST(FixedTimestep, ChangingTickrateKeepsFraction) {
+    FixedTimestep timestep = FixedTimestep::create(10);
+    ASSERT_EQ(timestep.advance(0.05f), 0);
+    ASSERT_NEAR(timestep.alpha(), 0.5f, 0.0001f);
+
+    timestep.set_tickrate(20);
+    ASSERT_NEAR(timestep.alpha(), 0.5f, 0.0001f);
+    ASSERT_EQ(timestep.advance(0.025f), 1);
+}
+
+TEST(FixedTimestep, AlphaStaysBelowOneWhenRounding) {
+    FixedTimestep timestep = FixedTimestep::create(3);
+    timestep.accumulator = std::nextafter(1.0 / 3.0, 0.0);
+
+    ASSERT_LT(timestep.alpha(), 1.0f);
+    ASSERT_GT(timestep.alpha(), 0.99f);
+}
+
+TEST(FixedTimestep, InterpolatesTransforms) {
+    Scene scene = Scene::create("test");
+    Entity smooth = scene.spawn_entity("smooth");
+    Entity snappy = scene.spawn_entity("snappy");
+    smooth.add_component<PreviousTransform>();
+
+    /* One tick worth of movement. */
+    scene.store_previous_transforms();
+    smooth.get_component<Transform>().position = {10.0f, 0.0f, 0.0f};
+    smooth.get_component<Transform>().rotation = {0.0f, 1.0f, 0.0f};
+    snappy.get_component<Transform>().position = {10.0f, 0.0f, 0.0f};
+
+    scene.update_global_transforms(0.25f);
+    GlobalTransform gt = smooth.get_component<GlobalTransform>();
+    ASSERT_NEAR(gt.position.x, 2.5f, 0.0001f);
+    ASSERT_NEAR(gt.rotation.y, 0.25f, 0.0001f);
+    ASSERT_NEAR(snappy.get_component<GlobalTransform>().position.x, 10.0f,
+                0.0001f);
+
+    scene.update_global_transforms(1.0f);
+    ASSERT_NEAR(smooth.get_component<GlobalTransform>().position.x, 10.0f,
+                0.0001f);
+
+    /* Next tick without movement - nothing left to blend. */
+    scene.store_previous_transforms();
+    scene.moved_ids.clear();
+    scene.update_global_transforms(0.5f);
+    ASSERT_NEAR(smooth.get_component<GlobalTransform>().position.x, 10.0f,
+                0.0001f);
+    ASSERT_TRUE(scene.moved_ids.empty());
+
+    scene.destroy();
+}
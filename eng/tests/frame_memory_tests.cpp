@@ -0,0 +1,306 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/containers/linear_arena.hpp"
+#include "eng/frame_memory.hpp"
+#include "eng/jobs.hpp"
+#include "eng/renderer/camera.hpp"
+#include "eng/renderer/lod.hpp"
+#include "eng/renderer/renderer.hpp"
+#include "eng/renderer/scene_submission.hpp"
+#include "eng/renderer/static_batch.hpp"
+#include "eng/scene/stress_scene.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+
+using namespace eng;
+
+/* Replaced for the whole test binary, only counting. */
+static std::atomic<int64_t> s_heap_allocs = 0;
+
+void *operator new(size_t size) {
+    s_heap_allocs++;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t size) noexcept { std::free(ptr); }
+
+TEST(LinearArena, AlignsAndGrowsAfterOverflow) {
+    cont::LinearArena arena = cont::LinearArena::create(256);
+
+    void *a = arena.allocate(3, 1);
+    void *b = arena.allocate(16, 64);
+    ASSERT_NE(a, b);
+    ASSERT_EQ((uintptr_t)b % 64, 0);
+    ASSERT_TRUE(arena.overflow_blocks.empty());
+
+    /* Doesn't fit, gets its own block until the reset. */
+    void *big = arena.allocate(1024, 16);
+    ASSERT_EQ((uintptr_t)big % 16, 0);
+    ASSERT_EQ(arena.overflow_blocks.size(), 1);
+    memset(big, 0xAB, 1024);
+
+    arena.reset();
+    ASSERT_TRUE(arena.overflow_blocks.empty());
+    ASSERT_GE(arena.capacity, 1024 + 3 + 16);
+    ASSERT_EQ(arena.used(), 0);
+
+    /* Same workload fits in one block now. */
+    (void)arena.allocate(3, 1);
+    (void)arena.allocate(16, 64);
+    (void)arena.allocate(1024, 16);
+    ASSERT_TRUE(arena.overflow_blocks.empty());
+
+    arena.destroy();
+}
+
+TEST(FrameMemory, PreviousFrameStaysValid) {
+    /* Not initialized - plain heap. */
+    ASSERT_EQ(frame_memory::resource(), std::pmr::get_default_resource());
+
+    frame_memory::init(1024);
+
+    frame_memory::next_frame();
+    std::pmr::vector<int32_t> first(64, 7, frame_memory::resource());
+    ASSERT_TRUE(frame_memory::is_frame_resource(frame_memory::resource()));
+
+    frame_memory::next_frame();
+    std::pmr::vector<int32_t> second(64, 9, frame_memory::resource());
+    ASSERT_NE(first.data(), second.data());
+    for (int32_t value : first)
+        ASSERT_EQ(value, 7);
+
+    /* Two frames later the first arena gets reused. */
+    frame_memory::next_frame();
+    std::pmr::vector<int32_t> third(64, 11, frame_memory::resource());
+    ASSERT_EQ(third.data(), first.data());
+    for (int32_t value : second)
+        ASSERT_EQ(value, 9);
+
+    frame_memory::shutdown();
+    ASSERT_EQ(frame_memory::resource(), std::pmr::get_default_resource());
+}
+
+TEST(FrameMemory, SteadyStateFrameDoesNotAllocate) {
+    AssetPack pack;
+    for (AssetID id = 1; id <= 3; id++)
+        pack.meshes[id].local_bb = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+
+    /* Big enough for parallel transforms. */
+    StressSceneSpec spec;
+    spec.entities_count = 6000;
+    spec.point_lights_count = 16;
+    spec.spot_lights_count = 16;
+    spec.lods = true;
+
+    Scene scene = Scene::create("frame memory");
+    std::vector<ecs::EntityID> roots =
+        generate_stress_scene(scene, pack, spec);
+
+    SpectatorCamera camera;
+    camera.position = glm::vec3(0.0f, 40.0f, spec.extent * 0.5f);
+    camera.pitch = 25.0f;
+    camera.far_clip = spec.extent * 2.0f;
+    renderer::CameraData camera_data = camera.render_data();
+    Frustum frustum = extract_frustum_planes(camera_data.view_projection);
+
+    jobs::init({.threads = 4});
+    frame_memory::init(4096);
+
+    std::vector<int32_t> shadow_proxies;
+    std::vector<int32_t> visible_proxies;
+    int64_t allocs = 0;
+    for (int32_t frame = 0; frame < 8; frame++) {
+        int64_t allocs_before = s_heap_allocs.load();
+        frame_memory::next_frame();
+
+        for (int32_t i = 0; i < (int32_t)roots.size(); i += 4) {
+            Entity &root = scene.entity(roots[i]);
+            root.get_component<Transform>().position.y = (float)frame;
+        }
+
+        scene.update_global_transforms();
+        scene.update_spatial_index(pack);
+        renderer::cull_shadow_casters(scene, frustum, shadow_proxies);
+        renderer::cull_visible_meshes(scene, frustum, visible_proxies);
+        renderer::select_lods(scene, pack, camera_data, visible_proxies);
+        renderer::select_shadow_lods(scene, pack, camera_data,
+                                     shadow_proxies);
+
+        /* First frames grow the arenas and containers kept across frames. */
+        if (frame >= 2)
+            allocs += s_heap_allocs.load() - allocs_before;
+    }
+
+    ASSERT_FALSE(visible_proxies.empty());
+    ASSERT_EQ(allocs, 0);
+
+    /* Tiny arenas had to grow to fit a frame. */
+    ASSERT_GT(frame_memory::stats().capacity, 4096);
+
+    frame_memory::shutdown();
+    jobs::shutdown();
+    scene.destroy();
+}
+
+/* Renderer and default assets load shaders relative to the editor's
+ * directory. Renderer goes away before the context does. */
+struct FrameMemoryRenderTest : GLTest {
+    void SetUp() override {
+        GLTest::SetUp();
+        if (IsSkipped() || HasFatalFailure())
+            return;
+
+        /* Some of the editor's shaders are GLSL 4.60. */
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major * 10 + minor < 46)
+            GTEST_SKIP() << "Renderer needs OpenGL 4.6";
+
+        previous_dir = std::filesystem::current_path();
+        std::filesystem::current_path(ENG_SHADERS_DIR "/../..");
+        ASSERT_TRUE(renderer::init(HeadlessContext::get_proc_address));
+        renderer_initialized = true;
+    }
+
+    void TearDown() override {
+        if (renderer_initialized)
+            renderer::shutdown();
+        if (!previous_dir.empty())
+            std::filesystem::current_path(previous_dir);
+
+        GLTest::TearDown();
+    }
+
+    std::filesystem::path previous_dir;
+    bool renderer_initialized = false;
+};
+
+static Framebuffer create_target(const glm::ivec2 &size) {
+    Framebuffer fbo = Framebuffer::create();
+    fbo.add_depth_attachment({.type = DepthAttachmentType::DEPTH_STENCIL,
+                              .tex_type = TextureType::TEX_2D,
+                              .size = size});
+
+    ColorAttachmentSpec spec;
+    spec.type = TextureType::TEX_2D;
+    spec.format = TextureFormat::RGBA16F;
+    spec.wrap = GL_CLAMP_TO_EDGE;
+    spec.min_filter = spec.mag_filter = GL_NEAREST;
+    spec.size = size;
+    spec.gen_minmaps = false;
+    fbo.add_color_attachment(spec);
+
+    spec.format = TextureFormat::RGBA8;
+    fbo.add_color_attachment(spec);
+
+    fbo.draw_to_depth_attachment(0);
+    fbo.draw_to_color_attachment(0, 0);
+    return fbo;
+}
+
+/* Same frame, carried on through submission, bucket merge, sort and
+ * upload of both passes. */
+TEST_F(FrameMemoryRenderTest, SteadyStateRenderedFrameDoesNotAllocate) {
+    jobs::init({.threads = 4});
+    frame_memory::init(4096);
+
+    AssetPack pack = AssetPack::create("frame memory");
+    Framebuffer target_fbo = create_target({64, 64});
+    ASSERT_TRUE(target_fbo.is_complete());
+
+    TextureSpec envmap_spec;
+    envmap_spec.format = TextureFormat::RGBA16F;
+    envmap_spec.size = {64, 32};
+    envmap_spec.min_filter = envmap_spec.mag_filter = GL_LINEAR;
+    envmap_spec.wrap = GL_REPEAT;
+    envmap_spec.gen_mipmaps = false;
+    EnvMap envmap =
+        renderer::create_envmap(Texture::create_storage(envmap_spec));
+    AssetID envmap_id = pack.add_env_map(envmap);
+    renderer::use_envmap(pack.env_maps.at(envmap_id));
+
+    StressSceneSpec spec;
+    spec.entities_count = 500;
+    spec.point_lights_count = 8;
+    spec.spot_lights_count = 4;
+    spec.static_ratio = 0.5f;
+    spec.lods = true;
+
+    Scene scene = Scene::create("frame memory");
+    std::vector<ecs::EntityID> roots =
+        generate_stress_scene(scene, pack, spec);
+    std::erase_if(roots, [&](ecs::EntityID root_id) {
+        return scene.entity(root_id).has_component<Static>();
+    });
+
+    scene.update_global_transforms();
+    StaticBatches static_batches = StaticBatches::bake(scene, pack);
+
+    SpectatorCamera camera;
+    camera.position = glm::vec3(0.0f, 40.0f, spec.extent * 0.5f);
+    camera.pitch = 25.0f;
+    camera.viewport = {64, 64};
+    camera.far_clip = spec.extent * 2.0f;
+    renderer::CameraData camera_data = camera.render_data();
+    Frustum frustum = extract_frustum_planes(camera_data.view_projection);
+
+    std::vector<int32_t> shadow_proxies;
+    std::vector<int32_t> visible_proxies;
+    int64_t allocs = 0;
+    for (int32_t frame = 0; frame < 4; frame++) {
+        int64_t allocs_before = s_heap_allocs.load();
+        frame_memory::next_frame();
+        renderer::reset_stats();
+
+        for (int32_t i = 0; i < (int32_t)roots.size(); i += 4) {
+            Entity &root = scene.entity(roots[i]);
+            root.get_component<Transform>().position.y = (float)frame;
+        }
+
+        scene.update_global_transforms();
+        scene.update_spatial_index(pack);
+        renderer::cull_shadow_casters(scene, frustum, shadow_proxies);
+        renderer::cull_visible_meshes(scene, frustum, visible_proxies);
+
+        renderer::shadow_pass_begin(camera_data, pack);
+        renderer::submit_scene_lights(scene);
+        renderer::select_shadow_lods(scene, pack, camera_data,
+                                     shadow_proxies);
+        renderer::submit_shadow_casters(scene, shadow_proxies);
+        renderer::submit_static_shadow_batches(static_batches);
+        renderer::shadow_pass_end();
+
+        renderer::scene_begin(camera_data, pack, target_fbo);
+        renderer::submit_scene_lights(scene);
+        renderer::select_lods(scene, pack, camera_data, visible_proxies);
+        renderer::submit_visible_meshes(scene, visible_proxies);
+        renderer::submit_static_batches(static_batches);
+        renderer::scene_end();
+
+        if (frame >= 2)
+            allocs += s_heap_allocs.load() - allocs_before;
+    }
+
+    ASSERT_GT(renderer::stats().submitted_instances, 0);
+    ASSERT_GT(renderer::stats().draw_commands, 0);
+    ASSERT_EQ(allocs, 0);
+
+    scene.destroy();
+    static_batches.destroy(pack.geometry);
+    target_fbo.destroy();
+    pack.destroy();
+    frame_memory::shutdown();
+    jobs::shutdown();
+}
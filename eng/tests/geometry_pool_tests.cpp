@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/containers/range_allocator.hpp"
+#include "eng/renderer/geometry_pool.hpp"
+#include "eng/renderer/mesh_simplify.hpp"
+#include "eng/scene/assets.hpp"
+
+using namespace eng;
+
+using GeometryPoolTest = GLTest;
+
+TEST(RangeAllocator, FirstFitAndMergesFreed) {
+    cont::RangeAllocator ranges = cont::RangeAllocator::create(100);
+
+    ASSERT_EQ(ranges.allocate(30), 0);
+    ASSERT_EQ(ranges.allocate(30), 30);
+    ASSERT_EQ(ranges.allocate(30), 60);
+    ASSERT_FALSE(ranges.allocate(20).has_value());
+    ASSERT_EQ(ranges.used, 90);
+
+    /* Hole in the middle gets reused first. */
+    ranges.free(30, 30);
+    ASSERT_EQ(ranges.allocate(10), 30);
+
+    /* Neighbours merge back into one range. */
+    ranges.free(0, 30);
+    ranges.free(30, 10);
+    ranges.free(60, 30);
+    ASSERT_EQ(ranges.free_ranges.size(), 1);
+    ASSERT_EQ(ranges.free_ranges[0].count, 100);
+    ASSERT_EQ(ranges.used, 0);
+
+    /* Growing extends the free range at the end. */
+    ASSERT_EQ(ranges.allocate(80), 0);
+    ranges.grow(200);
+    ASSERT_EQ(ranges.free_ranges.size(), 1);
+    ASSERT_EQ(ranges.allocate(120), 80);
+}
+
+TEST_F(GeometryPoolTest, SharesBuffersAndGrows) {
+    /* Fits one cube, barely. */
+    VertexData cube = cube_vertex_data();
+    GeometryPool pool =
+        GeometryPool::create(cube.vertices.size(), cube.indices.size());
+
+    GeometryRange first = pool.allocate(cube);
+    ASSERT_EQ(first.base_vertex, 0);
+    ASSERT_EQ(first.first_index, 0);
+    ASSERT_EQ(pool.grows, 0);
+
+    VertexData quad = quad_vertex_data();
+    GeometryRange second = pool.allocate(quad);
+    ASSERT_EQ(second.base_vertex, cube.vertices.size());
+    ASSERT_EQ(second.first_index, cube.indices.size());
+    ASSERT_EQ(pool.grows, 2);
+    GLuint grown_vbo = pool.vao.vbo.id;
+
+    /* Moved along when growing. */
+    std::vector<Vertex> cube_vertices = pool.read_vertices(first);
+    ASSERT_EQ(cube_vertices.size(), cube.vertices.size());
+    for (size_t i = 0; i < cube_vertices.size(); i++)
+        ASSERT_EQ(cube_vertices[i].position, cube.vertices[i].position);
+
+    /* Indices stay relative to the mesh's own vertices. */
+    std::vector<uint32_t> quad_indices(quad.indices.size());
+    GL_CALL(glGetNamedBufferSubData(
+        pool.vao.ibo.id, second.first_index * sizeof(uint32_t),
+        quad_indices.size() * sizeof(uint32_t), quad_indices.data()));
+    ASSERT_EQ(quad_indices, quad.indices);
+
+    /* Freed space gets reused, no more growing. */
+    pool.free(first);
+    GeometryRange third = pool.allocate(quad);
+    ASSERT_EQ(third.base_vertex, 0);
+    ASSERT_EQ(third.first_index, 0);
+    ASSERT_EQ(pool.vao.vbo.id, grown_vbo);
+
+    pool.destroy();
+}
+
+TEST_F(GeometryPoolTest, LodChainReplacesOldLevels) {
+    AssetPack pack;
+    pack.geometry = GeometryPool::create(64, 64);
+    VertexData cube = cube_vertex_data();
+    AssetID cube_id = pack.add_mesh(create_mesh(cube, pack.geometry));
+    uint32_t cube_vertices = pack.geometry.vertices.used;
+
+    SimplifiedMesh level;
+    level.vertex_data = quad_vertex_data();
+    level.error = 0.1f;
+    pack.set_lod_chain(cube_id, {level, level});
+    ASSERT_EQ(pack.meshes.size(), 3);
+
+    /* Regenerating doesn't pile up levels. */
+    pack.set_lod_chain(cube_id, {level});
+    ASSERT_EQ(pack.meshes.size(), 2);
+    ASSERT_EQ(pack.meshes.at(cube_id).lods.size(), 1);
+    ASSERT_TRUE(pack.meshes.contains(pack.meshes.at(cube_id).lods[0].mesh_id));
+    ASSERT_EQ(pack.geometry.vertices.used,
+              cube_vertices + level.vertex_data.vertices.size());
+
+    pack.set_lod_chain(cube_id, {});
+    ASSERT_EQ(pack.meshes.size(), 1);
+    ASSERT_EQ(pack.geometry.vertices.used, cube_vertices);
+
+    pack.geometry.destroy();
+}
@@ -0,0 +1,29 @@
+#ifndef GL_TEST_HPP
+#define GL_TEST_HPP
+
+#include <gtest/gtest.h>
+
+#include "eng/headless_context.hpp"
+#include <glad/glad.h>
+
+/* Fixture for tests that need OpenGL, skipped where there's no headless
+ * context. Context goes away in TearDown(), failed assertions included. */
+struct GLTest : testing::Test {
+    void SetUp() override {
+        context = eng::HeadlessContext::create();
+        if (!context.has_value())
+            GTEST_SKIP() << "No headless OpenGL context available";
+
+        ASSERT_TRUE(gladLoadGLLoader(
+            (GLADloadproc)eng::HeadlessContext::get_proc_address));
+    }
+
+    void TearDown() override {
+        if (context.has_value())
+            context.value().destroy();
+    }
+
+    std::optional<eng::HeadlessContext> context;
+};
+
+#endif
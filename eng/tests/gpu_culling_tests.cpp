@@ -0,0 +1,319 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/renderer/gpu_culling.hpp"
+#include <algorithm>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <map>
+#include <random>
+
+using namespace eng;
+
+using GpuCullerTest = GLTest;
+
+/* Room left in front, so survivors have to land at commands' bases. */
+static constexpr uint32_t FIRST_INSTANCE = 5;
+
+static constexpr AssetID PLAIN_MESH_ID = 2;
+
+/* Cube gets two LOD levels, the other mesh none. */
+static AssetPack lod_asset_pack() {
+    AssetPack pack;
+    pack.meshes[AssetPack::CUBE_ID].local_bb = {glm::vec3(-0.5f, -1.0f, -0.5f),
+                                                glm::vec3(0.5f, 1.0f, 0.5f)};
+    pack.meshes[AssetPack::CUBE_ID].lods = {{20, 0.1f}, {21, 0.03f}};
+    pack.meshes[PLAIN_MESH_ID].local_bb = {glm::vec3(-1.0f), glm::vec3(1.0f)};
+    pack.meshes[20].local_bb = pack.meshes[AssetPack::CUBE_ID].local_bb;
+    pack.meshes[21].local_bb = pack.meshes[AssetPack::CUBE_ID].local_bb;
+
+    return pack;
+}
+
+/* Every 4th entity has LodComp, every 7th is a light - drawn, but not
+ * casting shadows - and every 11th is Static, left out altogether. */
+static void spawn_meshes(Scene &scene, std::default_random_engine &eng,
+                         int32_t count) {
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+    std::uniform_real_distribution<float> scale(0.2f, 4.0f);
+
+    for (int32_t i = 0; i < count; i++) {
+        Entity ent = scene.spawn_entity("mesh");
+        Transform &transform = ent.get_component<Transform>();
+        transform.position = {pos(eng), pos(eng), pos(eng)};
+        transform.rotation = {angle(eng), angle(eng), 0.0f};
+        transform.scale = {scale(eng), scale(eng), 1.0f};
+
+        ent.add_component<MeshComp>().id =
+            i % 2 ? AssetPack::CUBE_ID : PLAIN_MESH_ID;
+        ent.add_component<MaterialComp>().id = i % 3 + 1;
+
+        if (i % 4 == 0)
+            ent.add_component<LodComp>();
+        if (i % 7 == 0)
+            ent.add_component<PointLight>();
+        if (i % 11 == 0)
+            ent.add_component<Static>();
+    }
+}
+
+/* Material, mesh and LOD level every surviving entity got drawn with. */
+using Culled = std::map<int32_t, std::tuple<AssetID, AssetID, int32_t>>;
+
+struct CullTarget {
+    std::vector<CullGroup> groups;
+    std::vector<float> lod_sizes;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    /* Group and level of every command. */
+    std::vector<std::pair<uint32_t, int32_t>> command_levels;
+
+    IndirectBuffer commands_buffer;
+    VertexBuffer instances;
+};
+
+/* Lays out commands of every group the way the renderer does, one per LOD
+ * level with room for all of the group's members. */
+static CullTarget make_target(const GpuSceneGroups &groups,
+                              const AssetPack &pack) {
+    CullTarget target;
+    target.groups.resize(groups.groups.size());
+
+    uint32_t base = FIRST_INSTANCE;
+    for (uint32_t i = 0; i < groups.groups.size(); i++) {
+        const GpuSceneGroup &scene_group = groups.groups[i];
+        if (scene_group.members == 0)
+            continue;
+
+        const Mesh &mesh = pack.meshes.at(scene_group.mesh_id);
+        CullGroup &group = target.groups[i];
+        group.first_command = target.commands.size();
+        group.levels = mesh.lods.size();
+        group.first_lod_size = target.lod_sizes.size();
+
+        for (int32_t level = 0; level <= (int32_t)group.levels; level++) {
+            if (level > 0)
+                target.lod_sizes.push_back(mesh.lods[level - 1].screen_size);
+
+            DrawElementsIndirectCommand &command =
+                target.commands.emplace_back();
+            command.count = 36;
+            command.base_instance = base;
+            base += scene_group.members;
+
+            target.command_levels.push_back({i, level});
+        }
+    }
+
+    target.commands_buffer = IndirectBuffer::create();
+    target.commands_buffer.set_commands(target.commands.data(),
+                                        target.commands.size());
+
+    std::vector<MeshInstance> zeroed(base);
+    target.instances = VertexBuffer::create();
+    target.instances.allocate(zeroed.data(),
+                              zeroed.size() * sizeof(MeshInstance));
+
+    return target;
+}
+
+static CullPass make_pass(const CullTarget &target,
+                          const renderer::CameraData &camera) {
+    CullPass pass;
+    pass.groups = target.groups;
+    pass.lod_sizes = target.lod_sizes;
+    pass.camera_position = glm::vec3(camera.position);
+    pass.projection_scale = camera.projection[1][1];
+
+    return pass;
+}
+
+static Culled gpu_results(CullTarget &target, const GpuSceneGroups &groups) {
+    std::vector<DrawElementsIndirectCommand> commands(target.commands.size());
+    GL_CALL(glGetNamedBufferSubData(
+        target.commands_buffer.id, 0,
+        commands.size() * sizeof(DrawElementsIndirectCommand),
+        commands.data()));
+
+    Culled culled;
+    for (size_t i = 0; i < commands.size(); i++) {
+        std::vector<MeshInstance> survivors(commands[i].instance_count);
+        GL_CALL(glGetNamedBufferSubData(
+            target.instances.id,
+            commands[i].base_instance * sizeof(MeshInstance),
+            survivors.size() * sizeof(MeshInstance), survivors.data()));
+
+        auto [group_idx, level] = target.command_levels[i];
+        const GpuSceneGroup &group = groups.groups[group_idx];
+        for (const MeshInstance &instance : survivors) {
+            bool inserted =
+                culled
+                    .try_emplace((int32_t)instance.entity_id, group.material_id,
+                                 group.mesh_id, level)
+                    .second;
+            EXPECT_TRUE(inserted) << "Drawn twice";
+        }
+    }
+
+    target.commands_buffer.destroy();
+    target.instances.destroy();
+    return culled;
+}
+
+/* Same tests and LOD selection on the CPU. Hysteresis is off, so levels
+ * don't depend on previous frames. SHADOWS picks with the shadow scale and
+ * skips lights. */
+template <typename Fn>
+static Culled cpu_cull(Scene &scene, const AssetPack &pack,
+                       const renderer::CameraData &camera, bool shadows,
+                       Fn &&is_visible) {
+    renderer::LodSettings settings;
+    Culled culled;
+    for (Entity &ent : scene.entities) {
+        if (ent.owning_reg == nullptr || !ent.has_component<MeshComp>() ||
+            ent.has_component<Static>())
+            continue;
+        if (shadows && ent.has_component<PointLight>())
+            continue;
+
+        AssetID mesh_id = ent.get_component<MeshComp>().id;
+        const Mesh &mesh = pack.meshes.at(mesh_id);
+        GlobalTransform &transform = ent.get_component<GlobalTransform>();
+        MeshAABB bb = transform_aabb(mesh.local_bb, transform.to_mat4());
+        if (!is_visible(bb))
+            continue;
+
+        int32_t level = 0;
+        if (ent.has_component<LodComp>()) {
+            glm::vec3 half_extent =
+                (mesh.local_bb.max - mesh.local_bb.min) * 0.5f;
+            glm::vec3 center = glm::vec3(
+                transform.to_mat4() *
+                glm::vec4(mesh.local_bb.min + half_extent, 1.0f));
+
+            glm::vec3 scale = glm::abs(transform.scale);
+            float radius = glm::length(half_extent) *
+                           glm::max(scale.x, glm::max(scale.y, scale.z));
+            float size = renderer::projected_size(camera, center, radius) *
+                         ent.get_component<LodComp>().bias *
+                         (shadows ? settings.shadow_scale : 1.0f);
+            level = renderer::select_lod_level(mesh, 0, size, 0.0f);
+        }
+
+        AssetID material_id =
+            shadows ? 0 : ent.get_component<MaterialComp>().id;
+        culled[ent.handle] = {material_id, mesh_id, level};
+    }
+
+    return culled;
+}
+
+TEST_F(GpuCullerTest, MatchesCpuCullingAndFollowsScene) {
+    std::optional<GpuCuller> culler =
+        GpuCuller::create(ENG_SHADERS_DIR "/cull_instances.comp",
+                          ENG_SHADERS_DIR "/scatter_candidates.comp");
+    if (!culler.has_value())
+        GTEST_SKIP() << "Culling shaders not available";
+
+    AssetPack pack = lod_asset_pack();
+    Scene scene = Scene::create("culled");
+    std::default_random_engine eng{42};
+    spawn_meshes(scene, eng, 3000);
+
+    GpuScene gpu_scene = GpuScene::create();
+    gpu_scene.lod_settings.hysteresis = 0.0f;
+
+    renderer::CameraData camera{};
+    camera.projection =
+        glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 120.0f);
+    camera.view = glm::lookAt(glm::vec3(0.0f, 10.0f, 60.0f), glm::vec3(0.0f),
+                              glm::vec3(0.0f, 1.0f, 0.0f));
+    camera.view_projection = camera.projection * camera.view;
+    camera.position = glm::vec4(0.0f, 10.0f, 60.0f, 1.0f);
+    Frustum frustum = extract_frustum_planes(camera.view_projection);
+
+    std::vector<glm::vec4> spheres = {
+        glm::vec4(10.0f, 0.0f, 0.0f, 25.0f),
+        glm::vec4(-60.0f, 40.0f, 20.0f, 15.0f)};
+
+    auto check = [&]() {
+        CullTarget target = make_target(gpu_scene.groups, pack);
+        culler.value().cull(gpu_scene, make_pass(target, camera), frustum,
+                            target.commands_buffer, target.instances);
+
+        Culled expected =
+            cpu_cull(scene, pack, camera, false, [&](const MeshAABB &bb) {
+                return aabb_vs_frustum(bb, frustum);
+            });
+        ASSERT_GT(expected.size(), 100u);
+        ASSERT_LT(expected.size(), gpu_scene.candidates.size() / 2);
+        ASSERT_TRUE(std::any_of(expected.begin(), expected.end(),
+                                [](const auto &entry) {
+                                    return std::get<2>(entry.second) > 0;
+                                }));
+        ASSERT_EQ(gpu_results(target, gpu_scene.groups), expected);
+
+        target = make_target(gpu_scene.shadow_groups, pack);
+        culler.value().cull(gpu_scene, make_pass(target, camera), spheres,
+                            target.commands_buffer, target.instances);
+
+        expected =
+            cpu_cull(scene, pack, camera, true, [&](const MeshAABB &bb) {
+                return std::any_of(spheres.begin(), spheres.end(),
+                                   [&](const glm::vec4 &sphere) {
+                                       return aabb_vs_sphere(
+                                           bb, glm::vec3(sphere), sphere.w);
+                                   });
+            });
+        ASSERT_FALSE(expected.empty());
+        ASSERT_EQ(gpu_results(target, gpu_scene.shadow_groups), expected);
+    };
+
+    scene.update_global_transforms();
+    gpu_scene.update(scene, pack);
+    scene.update_spatial_index(pack);
+
+    /* Static entities stay out, first upload grows the storage. */
+    ASSERT_EQ(gpu_scene.candidates.size(), 3000 - 3000 / 11 - 1);
+    ASSERT_EQ(culler.value().sync(gpu_scene),
+              (int32_t)gpu_scene.candidates.size());
+    ASSERT_EQ(culler.value().sync(gpu_scene), 0);
+    ASSERT_NO_FATAL_FAILURE(check());
+
+    /* Some move, some are gone, some swap materials, some get added. */
+    std::vector<ecs::EntityID> ids;
+    for (Entity &ent : scene.entities) {
+        if (ent.owning_reg != nullptr && ent.has_component<MeshComp>() &&
+            !ent.has_component<Static>())
+            ids.push_back(ent.handle);
+    }
+
+    std::shuffle(ids.begin(), ids.end(), eng);
+    for (int32_t i = 0; i < 100; i++)
+        scene.entity(ids[i]).get_component<Transform>().position.x += 30.0f;
+    for (int32_t i = 100; i < 130; i++) {
+        Entity &ent = scene.entity(ids[i]);
+        ent.get_component<MaterialComp>().id = 9;
+        ent.mesh_changed();
+    }
+    for (int32_t i = 130; i < 180; i++)
+        scene.destroy_entity(ids[i]);
+    spawn_meshes(scene, eng, 20);
+
+    scene.update_global_transforms();
+    gpu_scene.update(scene, pack);
+    scene.update_spatial_index(pack);
+
+    /* Only what changed goes to the GPU, removals move the last slots. */
+    int32_t patched = culler.value().sync(gpu_scene);
+    ASSERT_GT(patched, 130);
+    ASSERT_LE(patched, 100 + 30 + 50 + 20);
+    ASSERT_NO_FATAL_FAILURE(check());
+
+    ASSERT_TRUE(gpu_scene.groups.ids.contains({9, AssetPack::CUBE_ID}));
+    gpu_scene.destroy();
+    scene.destroy();
+    culler.value().destroy();
+}
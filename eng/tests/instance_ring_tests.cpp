@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/renderer/instance_ring.hpp"
+
+using namespace eng;
+
+using InstanceRingTest = GLTest;
+
+static std::vector<MeshInstance> instances_with_ids(int32_t first,
+                                                    int32_t count) {
+    std::vector<MeshInstance> instances(count);
+    for (int32_t i = 0; i < count; i++)
+        instances[i].entity_id = first + i;
+
+    return instances;
+}
+
+TEST_F(InstanceRingTest, FramesTakeTurnsInRegions) {
+    InstanceRing ring = InstanceRing::create(8);
+
+    /* Identity one in front, regions after it. */
+    ASSERT_EQ(ring.push(instances_with_ids(1, 5)), 1);
+    ASSERT_EQ(ring.push(instances_with_ids(6, 3)), 6);
+
+    ring.next_frame();
+    ASSERT_EQ(ring.push(instances_with_ids(20, 2)), 9);
+    ring.next_frame();
+    ASSERT_EQ(ring.push(instances_with_ids(30, 2)), 17);
+
+    /* Back to the first region, once the GPU is done with it. */
+    ring.next_frame();
+    ASSERT_EQ(ring.push(instances_with_ids(40, 2)), 1);
+
+    /* Written straight to the buffer. */
+    std::vector<MeshInstance> gpu_side(1 + 3 * 8);
+    ring.buffer.bind();
+    GL_CALL(glGetBufferSubData(GL_ARRAY_BUFFER, 0,
+                               gpu_side.size() * sizeof(MeshInstance),
+                               gpu_side.data()));
+
+    ASSERT_EQ(gpu_side[0].transform, glm::mat4(1.0f));
+    ASSERT_EQ(gpu_side[1].entity_id, 40.0f);
+    ASSERT_EQ(gpu_side[8].entity_id, 8.0f);
+    ASSERT_EQ(gpu_side[9].entity_id, 20.0f);
+    ASSERT_EQ(gpu_side[18].entity_id, 31.0f);
+
+    ring.destroy();
+}
+
+TEST_F(InstanceRingTest, GrowsToFitAPass) {
+    InstanceRing ring = InstanceRing::create(256);
+    ring.reserve(200);
+    ASSERT_EQ(ring.push(instances_with_ids(0, 200)), 1);
+    ASSERT_EQ(ring.grows, 0);
+
+    /* Thousands of copies, way past the starting size. */
+    ring.reserve(5000);
+    ASSERT_EQ(ring.grows, 1);
+    ASSERT_GE(ring.region_capacity, 5000);
+    ASSERT_EQ(ring.push(instances_with_ids(0, 5000)), 1);
+
+    std::vector<MeshInstance> gpu_side(5001);
+    ring.buffer.bind();
+    GL_CALL(glGetBufferSubData(GL_ARRAY_BUFFER, 0,
+                               gpu_side.size() * sizeof(MeshInstance),
+                               gpu_side.data()));
+    ASSERT_EQ(gpu_side[0].transform, glm::mat4(1.0f));
+    ASSERT_EQ(gpu_side[5000].entity_id, 4999.0f);
+
+    ring.next_frame();
+    ring.reserve(5000);
+    ASSERT_EQ(ring.grows, 1);
+
+    ring.destroy();
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include "eng/jobs.hpp"
+#include "eng/scene/components.hpp"
+#include "eng/scene/scene.hpp"
+#include <thread>
+
+using namespace eng;
+
+TEST(Jobs, ParallelForCoversEveryIndexOnce) {
+    jobs::init({.threads = 4});
+    ASSERT_EQ(jobs::threads_count(), 4);
+
+    std::vector<std::atomic<int32_t>> hits(10000);
+    jobs::parallel_for(hits.size(), 0, [&](int32_t first, int32_t last) {
+        for (int32_t i = first; i < last; i++)
+            hits[i]++;
+    });
+
+    for (std::atomic<int32_t> &hit : hits)
+        ASSERT_EQ(hit.load(), 1);
+
+    ASSERT_EQ(jobs::thread_index(), 0);
+    std::vector<int32_t> indices(hits.size(), -1);
+    jobs::parallel_for(indices.size(), 0, [&](int32_t first, int32_t last) {
+        for (int32_t i = first; i < last; i++)
+            indices[i] = jobs::thread_index();
+    });
+
+    for (int32_t idx : indices) {
+        ASSERT_GE(idx, 0);
+        ASSERT_LT(idx, jobs::threads_count());
+    }
+
+    /* Nested, from inside a job. */
+    std::atomic<int32_t> sum = 0;
+    jobs::parallel_for(8, 1, [&](int32_t first, int32_t last) {
+        jobs::parallel_for(100, 10, [&](int32_t first, int32_t last) {
+            sum += last - first;
+        });
+    });
+    ASSERT_EQ(sum.load(), 800);
+
+    jobs::shutdown();
+}
+
+TEST(Jobs, DependenciesRunInOrder) {
+    jobs::init({.threads = 3});
+
+    std::atomic<int32_t> first_done = 0;
+    std::atomic<bool> ordered = true;
+
+    jobs::Counter first;
+    jobs::Counter second;
+    for (int32_t i = 0; i < 16; i++) {
+        jobs::run(
+            [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                first_done++;
+            },
+            &first);
+    }
+
+    for (int32_t i = 0; i < 4; i++) {
+        jobs::run_after(
+            first,
+            [&]() {
+                if (first_done.load() != 16)
+                    ordered = false;
+            },
+            &second);
+    }
+
+    jobs::wait(second);
+    ASSERT_TRUE(first.done());
+    ASSERT_TRUE(ordered.load());
+
+    /* Dependency already done - runs right away. */
+    jobs::Counter third;
+    std::atomic<bool> ran = false;
+    jobs::run_after(first, [&]() { ran = true; }, &third);
+    jobs::wait(third);
+    ASSERT_TRUE(ran.load());
+
+    jobs::shutdown();
+}
+
+TEST(Jobs, SingleThreadIsDeterministic) {
+    /* Not initialized behaves the same as one thread. */
+    ASSERT_EQ(jobs::threads_count(), 1);
+
+    jobs::init({.threads = 1});
+    ASSERT_EQ(jobs::threads_count(), 1);
+
+    std::vector<int32_t> order;
+    jobs::Counter counter;
+    for (int32_t i = 0; i < 5; i++)
+        jobs::run([&order, i]() { order.push_back(i); }, &counter);
+
+    jobs::parallel_for(3, 1, [&](int32_t first, int32_t last) {
+        order.push_back(10 + first);
+    });
+
+    jobs::wait(counter);
+    ASSERT_EQ(order, std::vector<int32_t>({0, 1, 2, 3, 4, 10, 11, 12}));
+
+    jobs::shutdown();
+}
+
+TEST(Jobs, AvailableCpus) {
+    int32_t cpus = jobs::available_cpus();
+    ASSERT_GE(cpus, 1);
+    ASSERT_LE(cpus, std::max<int32_t>(std::thread::hardware_concurrency(), 1));
+}
+
+TEST(Jobs, ParallelTransformsMatchSerial) {
+    Scene scene = Scene::create("test");
+    for (int32_t i = 0; i < 3000; i++) {
+        Entity root = scene.spawn_entity("root");
+        Entity child = scene.spawn_entity("child");
+        Entity grandchild = scene.spawn_entity("grandchild");
+        scene.link_relation(root, child);
+        scene.link_relation(child, grandchild);
+
+        root.get_component<Transform>().position = {(float)i, 0.0f, 0.0f};
+        child.get_component<Transform>().position = {0.0f, 1.0f, 0.0f};
+        grandchild.get_component<Transform>().position = {0.0f, 0.0f, 1.0f};
+    }
+
+    scene.update_global_transforms();
+    std::vector<ecs::EntityID> serial_moved = scene.moved_ids;
+    std::vector<GlobalTransform> serial;
+    for (Entity &ent : scene.entities)
+        serial.push_back(ent.get_component<GlobalTransform>());
+
+    /* Reset and redo on 4 threads. */
+    for (Entity &ent : scene.entities)
+        ent.get_component<GlobalTransform>() = GlobalTransform{};
+    scene.moved_ids.clear();
+
+    jobs::init({.threads = 4});
+    scene.update_global_transforms();
+    jobs::shutdown();
+
+    ASSERT_EQ(scene.moved_ids, serial_moved);
+    for (int32_t i = 0; i < (int32_t)scene.entities.size(); i++) {
+        GlobalTransform &gt =
+            scene.entities[i].get_component<GlobalTransform>();
+        ASSERT_EQ(gt.position, serial[i].position);
+    }
+
+    scene.destroy();
+}
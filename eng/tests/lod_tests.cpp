@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include "eng/renderer/lod.hpp"
+#include "eng/renderer/scene_submission.hpp"
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+using namespace eng;
+
+TEST(Lod, SwitchesWithHysteresis) {
+    Mesh mesh;
+    mesh.lods = {{10, 0.5f}, {11, 0.2f}};
+
+    ASSERT_EQ(renderer::select_lod_level(mesh, 0, 1.0f, 0.1f), 0);
+    ASSERT_EQ(renderer::select_lod_level(mesh, 0, 0.1f, 0.1f), 2);
+
+    /* Just under the threshold isn't enough to switch. */
+    ASSERT_EQ(renderer::select_lod_level(mesh, 0, 0.47f, 0.1f), 0);
+    ASSERT_EQ(renderer::select_lod_level(mesh, 0, 0.44f, 0.1f), 1);
+
+    /* Same the other way. */
+    ASSERT_EQ(renderer::select_lod_level(mesh, 1, 0.53f, 0.1f), 1);
+    ASSERT_EQ(renderer::select_lod_level(mesh, 1, 0.56f, 0.1f), 0);
+    ASSERT_EQ(renderer::select_lod_level(mesh, 2, 0.21f, 0.1f), 2);
+    ASSERT_EQ(renderer::select_lod_level(mesh, 2, 1.0f, 0.1f), 0);
+
+    /* No chain, always full detail. */
+    ASSERT_EQ(renderer::select_lod_level(Mesh{}, 3, 0.0f, 0.1f), 0);
+}
+
+TEST(Lod, SelectsColorAndShadowLevelsSeparately) {
+    AssetPack pack;
+    pack.meshes[AssetPack::CUBE_ID].local_bb = {glm::vec3(-0.5f),
+                                                glm::vec3(0.5f)};
+    pack.meshes[AssetPack::CUBE_ID].lods = {{20, 0.3f}};
+    pack.meshes[20].local_bb = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+
+    Scene scene = Scene::create("lods");
+    Entity ent = scene.spawn_entity("lod");
+    ent.get_component<Transform>().position = {0.0f, 0.0f, -2.0f};
+    ent.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    ent.add_component<MaterialComp>();
+    ent.add_component<LodComp>();
+    ecs::EntityID ent_id = ent.handle;
+
+    /* 90 degrees vertical FOV, size is radius over distance. */
+    renderer::CameraData camera{};
+    camera.projection =
+        glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f);
+    camera.view = glm::mat4(1.0f);
+    camera.view_projection = camera.projection;
+    camera.position = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    Frustum frustum = extract_frustum_planes(camera.view_projection);
+
+    renderer::LodSettings settings;
+    settings.hysteresis = 0.1f;
+    settings.shadow_scale = 0.5f;
+
+    auto select = [&]() {
+        scene.update_global_transforms();
+        scene.update_spatial_index(pack);
+
+        std::vector<int32_t> proxies;
+        renderer::cull_visible_meshes(scene, frustum, proxies);
+        ASSERT_EQ(proxies.size(), 1);
+
+        renderer::select_lods(scene, pack, camera, proxies, settings);
+        renderer::select_shadow_lods(scene, pack, camera, proxies, settings);
+    };
+
+    /* Size ~0.43 - full detail for color, shadows already coarse. */
+    select();
+    LodComp lod = scene.entity(ent_id).get_component<LodComp>();
+    ASSERT_EQ(lod.level, 0);
+    ASSERT_EQ(lod.mesh_id, AssetPack::CUBE_ID);
+    ASSERT_EQ(lod.shadow_level, 1);
+    ASSERT_EQ(lod.shadow_mesh_id, 20);
+
+    scene.entity(ent_id).get_component<Transform>().position.z = -10.0f;
+    select();
+    lod = scene.entity(ent_id).get_component<LodComp>();
+    ASSERT_EQ(lod.level, 1);
+    ASSERT_EQ(lod.mesh_id, 20);
+
+    /* Far less detail for lower bias. */
+    scene.entity(ent_id).get_component<Transform>().position.z = -2.0f;
+    scene.entity(ent_id).get_component<LodComp>().bias = 0.1f;
+    select();
+    ASSERT_EQ(scene.entity(ent_id).get_component<LodComp>().level, 1);
+
+    scene.destroy();
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "eng/renderer/material_table.hpp"
+
+using namespace eng;
+
+static std::map<AssetID, Material> three_materials() {
+    std::map<AssetID, Material> materials;
+    materials[1] = Material{};
+    materials[2] = Material{};
+    materials[2].color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    materials[3] = Material{};
+    materials[3].albedo_texture_id = 5;
+    return materials;
+}
+
+TEST(MaterialTable, UploadsOnlyChanges) {
+    std::map<AssetID, Material> materials = three_materials();
+
+    TextureArrays arrays;
+    MaterialTable table;
+    MaterialRange changed = table.sync(materials, arrays);
+    ASSERT_EQ(changed.first, 0);
+    ASSERT_EQ(changed.count, 4);
+    ASSERT_EQ(table.data[2].color, materials[2].color);
+
+    changed = table.sync(materials, arrays);
+    ASSERT_EQ(changed.count, 0);
+
+    /* Edited in place, the way the editor does it. */
+    materials[2].roughness = 0.25f;
+    changed = table.sync(materials, arrays);
+    ASSERT_EQ(changed.first, 2);
+    ASSERT_EQ(changed.count, 1);
+    ASSERT_EQ(table.data[2].roughness, 0.25f);
+
+    materials[5] = Material{};
+    changed = table.sync(materials, arrays);
+    ASSERT_EQ(changed.first, 4);
+    ASSERT_EQ(changed.count, 2);
+}
+
+TEST(MaterialTable, GroupsMaterialsByTextures) {
+    std::map<AssetID, Material> materials = three_materials();
+
+    TextureArrays arrays;
+    MaterialTable table;
+    (void)table.sync(materials, arrays);
+
+    /* Different colors, same textures. */
+    ASSERT_EQ(table.texture_sets[1], 1);
+    ASSERT_EQ(table.texture_sets[2], 1);
+    ASSERT_EQ(table.texture_sets[3], 3);
+
+    materials[1].normal_texture_id = 7;
+    (void)table.sync(materials, arrays);
+    ASSERT_EQ(table.texture_sets[1], 1);
+    ASSERT_EQ(table.texture_sets[2], 2);
+    ASSERT_EQ(table.texture_sets[3], 3);
+}
+
+TEST(MaterialTable, RegroupsAfterRepresentativeIsRemoved) {
+    std::map<AssetID, Material> materials = three_materials();
+    materials[4] = materials[3];
+    materials[4].color = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+
+    TextureArrays arrays;
+    MaterialTable table;
+    (void)table.sync(materials, arrays);
+    ASSERT_EQ(table.texture_sets[4], 3);
+
+    /* Nothing else about the remaining ones changes. */
+    materials.erase(3);
+    (void)table.sync(materials, arrays);
+    ASSERT_EQ(table.texture_sets[4], 4);
+    ASSERT_EQ(table.texture_sets[3], 0);
+}
+
+TEST(MaterialTable, PackedTexturesNeedNoBinds) {
+    std::map<AssetID, Material> materials = three_materials();
+
+    /* Packed by hand, no GL needed for layer refs. */
+    TextureArrays arrays;
+    arrays.packed[1].where = {0, 3};
+    arrays.packed[2].where = {1, 0};
+
+    MaterialTable table;
+    (void)table.sync(materials, arrays);
+    ASSERT_EQ(table.data[1].texture_layers, glm::ivec4(3, 1 << 16, 3, 3));
+    ASSERT_EQ(table.texture_sets[1], 0);
+    ASSERT_EQ(table.texture_sets[2], 0);
+
+    /* Albedo 5 isn't packed, so it still gets bound. */
+    ASSERT_EQ(table.data[3].texture_layers.x, -1);
+    ASSERT_EQ(table.texture_sets[3], 3);
+}
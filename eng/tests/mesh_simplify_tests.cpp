@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "eng/renderer/mesh_simplify.hpp"
+#include <cstring>
+
+using namespace eng;
+
+static bool same_vertex(const Vertex &lhs, const Vertex &rhs) {
+    return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+}
+
+static bool contains_vertex(const VertexData &data, const Vertex &vertex) {
+    for (const Vertex &v : data.vertices) {
+        if (same_vertex(v, vertex))
+            return true;
+    }
+
+    return false;
+}
+
+/* Flat N x N quads grid on the XZ plane, open on all sides. */
+static VertexData grid_vertex_data(int32_t n) {
+    VertexData data;
+    for (int32_t z = 0; z <= n; z++) {
+        for (int32_t x = 0; x <= n; x++) {
+            Vertex v{};
+            v.position = {(float)x, 0.0f, (float)z};
+            v.normal = {0.0f, 1.0f, 0.0f};
+            v.texture_uv = {(float)x / n, (float)z / n};
+            data.vertices.push_back(v);
+        }
+    }
+
+    for (int32_t z = 0; z < n; z++) {
+        for (int32_t x = 0; x < n; x++) {
+            uint32_t i = z * (n + 1) + x;
+            data.indices.insert(data.indices.end(),
+                                {i, i + n + 1, i + 1, i + 1, i + n + 1,
+                                 i + n + 2});
+        }
+    }
+
+    return data;
+}
+
+TEST(MeshSimplify, ReducesSphereKeepingSeams) {
+    VertexData sphere = uv_sphere_vertex_data();
+    std::vector<SimplifiedMesh> levels =
+        simplify_lod_chain(sphere, {0.5f, 0.25f, 0.125f, 0.0625f});
+    ASSERT_GE(levels.size(), 3);
+
+    size_t previous_indices = sphere.indices.size();
+    float previous_error = 0.0f;
+    for (const SimplifiedMesh &level : levels) {
+        ASSERT_LT(level.vertex_data.indices.size(), previous_indices);
+        ASSERT_EQ(level.vertex_data.indices.size() % 3, 0);
+        ASSERT_GE(level.error, previous_error);
+        ASSERT_LT(level.error, 0.5f);
+
+        /* Vertices are picked, never made up. */
+        for (const Vertex &v : level.vertex_data.vertices)
+            ASSERT_TRUE(contains_vertex(sphere, v));
+
+        previous_indices = level.vertex_data.indices.size();
+        previous_error = level.error;
+    }
+
+    ASSERT_NEAR(levels[0].ratio, 0.5f, 0.05f);
+    ASSERT_GT(levels[0].error, 0.0f);
+
+    /* UV seam - first and last slice of every stack share positions. */
+    const VertexData &coarsest = levels.back().vertex_data;
+    for (int32_t stack = 1; stack < 48; stack++) {
+        ASSERT_TRUE(contains_vertex(coarsest, sphere.vertices[stack * 49]));
+        ASSERT_TRUE(
+            contains_vertex(coarsest, sphere.vertices[stack * 49 + 48]));
+    }
+}
+
+TEST(MeshSimplify, KeepsBordersOfFlatGrid) {
+    VertexData grid = grid_vertex_data(8);
+    std::vector<SimplifiedMesh> levels = simplify_lod_chain(grid, {0.5f});
+    ASSERT_EQ(levels.size(), 1);
+    ASSERT_LE(levels[0].ratio, 0.5f);
+
+    /* Collapses within the plane are free. */
+    ASSERT_NEAR(levels[0].error, 0.0f, 0.0001f);
+
+    for (const Vertex &v : grid.vertices) {
+        bool border = v.position.x == 0.0f || v.position.x == 8.0f ||
+                      v.position.z == 0.0f || v.position.z == 8.0f;
+        if (border) {
+            ASSERT_TRUE(contains_vertex(levels[0].vertex_data, v));
+        }
+    }
+
+    /* Nothing left to collapse - the level gets dropped. */
+    std::vector<SimplifiedMesh> borders_only =
+        simplify_lod_chain(grid, {0.01f, 0.001f});
+    ASSERT_EQ(borders_only.size(), 1);
+}
+
+TEST(MeshSimplify, NothingToCollapseOnCube) {
+    /* Every corner is split by normals - all seams, no levels. */
+    std::vector<SimplifiedMesh> levels =
+        simplify_lod_chain(cube_vertex_data(), {0.5f});
+    ASSERT_TRUE(levels.empty());
+}
+
+TEST(MeshSimplify, AsyncMatchesSync) {
+    VertexData sphere = uv_sphere_vertex_data();
+    std::vector<SimplifiedMesh> sync = simplify_lod_chain(sphere, {0.3f});
+
+    std::future<std::vector<SimplifiedMesh>> pending =
+        simplify_lod_chain_async(sphere, {0.3f});
+    std::vector<SimplifiedMesh> async = pending.get();
+
+    ASSERT_EQ(async.size(), sync.size());
+    ASSERT_EQ(async[0].vertex_data.indices, sync[0].vertex_data.indices);
+    ASSERT_EQ(async[0].error, sync[0].error);
+}
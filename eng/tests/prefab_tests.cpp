@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include "eng/scene/prefab.hpp"
+
+using namespace eng;
+
+TEST(Prefab, InstantiatesHierarchy) {
+    Scene scene = Scene::create("test");
+    Entity tree = scene.spawn_entity("tree");
+    Entity trunk = scene.spawn_entity("trunk");
+    Entity crown = scene.spawn_entity("crown");
+    Entity leaf = scene.spawn_entity("leaf");
+
+    trunk.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    crown.add_component<MeshComp>().id = AssetPack::SPHERE_ID;
+    crown.add_component<MaterialComp>().id = 7;
+    leaf.add_component<PointLight>().radius = 2.0f;
+
+    /* Children get prepended, so crown ends up before trunk. */
+    scene.link_relation(tree, trunk);
+    scene.link_relation(tree, crown);
+    scene.link_relation(crown, leaf);
+    crown.get_component<Transform>().position = {0.0f, 3.0f, 0.0f};
+
+    Prefab prefab = Prefab::create(scene, tree.handle);
+    ASSERT_EQ(prefab.name, "tree");
+    ASSERT_EQ(prefab.nodes.size(), 4);
+    ASSERT_EQ(prefab.nodes[0].parent, -1);
+
+    /* Prefab doesn't follow later edits. */
+    scene.destroy_entity(tree.handle);
+
+    std::vector<Transform> transforms(3);
+    for (int32_t i = 0; i < 3; i++)
+        transforms[i].position = {i * 10.0f, 0.0f, 0.0f};
+
+    std::vector<ecs::EntityID> roots =
+        scene.instantiate(prefab, 3, transforms.data());
+    ASSERT_EQ(roots.size(), 3);
+    ASSERT_EQ(scene.root_ids, roots);
+    ASSERT_EQ(scene.entities.size() - scene.free_slots.size(), 12);
+
+    scene.update_global_transforms();
+    for (int32_t i = 0; i < 3; i++) {
+        Entity &root = scene.entity(roots[i]);
+        ASSERT_EQ(root.get_component<Name>().name, "tree");
+        ASSERT_FALSE(root.parent_id.has_value());
+        ASSERT_EQ(root.children_ids.size(), 2);
+
+        Entity &icrown = scene.entity(root.children_ids[0]);
+        Entity &itrunk = scene.entity(root.children_ids[1]);
+        ASSERT_EQ(icrown.get_component<Name>().name, "crown");
+        ASSERT_EQ(itrunk.get_component<Name>().name, "trunk");
+        ASSERT_EQ(icrown.parent_id.value(), root.handle);
+        ASSERT_EQ(itrunk.get_component<MeshComp>().id, AssetPack::CUBE_ID);
+        ASSERT_EQ(icrown.get_component<MaterialComp>().id, 7);
+
+        ASSERT_EQ(icrown.children_ids.size(), 1);
+        Entity &ileaf = scene.entity(icrown.children_ids[0]);
+        ASSERT_EQ(ileaf.get_component<PointLight>().radius, 2.0f);
+        ASSERT_EQ(ileaf.get_component<GlobalTransform>().position,
+                  glm::vec3(i * 10.0f, 3.0f, 0.0f));
+    }
+
+    /* Copies are independent of each other. */
+    scene.entity(roots[0]).get_component<Transform>().position.y = 5.0f;
+    scene.destroy_entity(roots[1]);
+    scene.update_global_transforms();
+
+    Entity &last = scene.entity(roots[2]);
+    ASSERT_EQ(last.get_component<GlobalTransform>().position,
+              glm::vec3(20.0f, 0.0f, 0.0f));
+    ASSERT_EQ(scene.entities.size() - scene.free_slots.size(), 8);
+    ASSERT_EQ(scene.hierarchy_order().size(), 8);
+
+    prefab.destroy();
+    scene.destroy();
+}
+
+TEST(Prefab, KeepsPrefabTransformByDefault) {
+    Scene scene = Scene::create("test");
+    Entity crate = scene.spawn_entity("crate");
+    crate.get_component<Transform>().position = {1.0f, 2.0f, 3.0f};
+    crate.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+
+    Prefab prefab = Prefab::create(scene, crate.handle);
+    std::vector<ecs::EntityID> roots = scene.instantiate(prefab, 2);
+    scene.update_global_transforms();
+
+    for (ecs::EntityID root_id : roots) {
+        Entity &root = scene.entity(root_id);
+        ASSERT_NE(root_id, crate.handle);
+        ASSERT_EQ(root.get_component<GlobalTransform>().position,
+                  glm::vec3(1.0f, 2.0f, 3.0f));
+    }
+
+    ASSERT_TRUE(scene.instantiate(prefab, 0).empty());
+
+    prefab.destroy();
+    scene.destroy();
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include "eng/renderer/render_queue.hpp"
+#include <algorithm>
+#include <random>
+
+using namespace eng;
+
+TEST(RenderQueue, PacksKeyFields) {
+    SortKey key;
+    key.pass = 1;
+    key.shader_index = 3;
+    key.texture_set_index = 40000;
+    key.mesh_index = 200000;
+    key.kind = RenderItemKind::STATIC_DRAW;
+    key.depth = quantize_depth(50.0f, 100.0f);
+
+    SortKey unpacked = unpack_sort_key(pack_sort_key(key));
+    ASSERT_EQ(unpacked.pass, key.pass);
+    ASSERT_EQ(unpacked.shader_index, key.shader_index);
+    ASSERT_EQ(unpacked.texture_set_index, key.texture_set_index);
+    ASSERT_EQ(unpacked.mesh_index, key.mesh_index);
+    ASSERT_EQ(unpacked.kind, key.kind);
+    ASSERT_EQ(unpacked.depth, key.depth);
+
+    /* State outweighs depth, depth clamps to the far end. */
+    SortKey near_key = key;
+    near_key.depth = quantize_depth(0.0f, 100.0f);
+    SortKey far_key = key;
+    far_key.mesh_index--;
+    far_key.depth = quantize_depth(1000.0f, 100.0f);
+    ASSERT_EQ(far_key.depth, UINT16_MAX);
+    ASSERT_LT(pack_sort_key(near_key), pack_sort_key(key));
+    ASSERT_LT(pack_sort_key(far_key), pack_sort_key(near_key));
+}
+
+TEST(RenderQueue, SortsStable) {
+    std::default_random_engine eng{7};
+    std::uniform_int_distribution<AssetID> texture_set(1, 20);
+    std::uniform_int_distribution<AssetID> mesh(1, 50);
+    std::uniform_real_distribution<float> distance(0.0f, 150.0f);
+
+    /* Same pass and shader everywhere, their bytes get skipped. */
+    RenderQueue queue;
+    for (uint32_t i = 0; i < 20000; i++) {
+        SortKey key;
+        key.pass = 1;
+        key.shader_index = 1;
+        key.texture_set_index = texture_set(eng);
+        key.mesh_index = mesh(eng);
+        key.depth = quantize_depth(distance(eng), 100.0f);
+        queue.push(pack_sort_key(key), i);
+    }
+
+    std::vector<RenderItem> expected = queue.items;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const RenderItem &lhs, const RenderItem &rhs) {
+                         return lhs.key < rhs.key;
+                     });
+
+    queue.sort();
+    ASSERT_EQ(queue.items.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(queue.items[i].key, expected[i].key);
+        ASSERT_EQ(queue.items[i].payload, expected[i].payload);
+    }
+
+    /* Reused without leftovers. */
+    queue.clear();
+    queue.push(2, 0);
+    queue.push(1, 1);
+    queue.sort();
+    ASSERT_EQ(queue.items.size(), 2);
+    ASSERT_EQ(queue.items[0].payload, 1);
+}
+
+TEST(RenderQueue, KeepsCapacityWhileCountCreepsUp) {
+    RenderQueue queue;
+    queue.reserve(1000);
+    size_t items_capacity = queue.items.capacity();
+    size_t scratch_capacity = queue.scratch.capacity();
+    ASSERT_GE(items_capacity, 1000);
+    ASSERT_GE(scratch_capacity, items_capacity);
+
+    /* A few more items every frame, sorting swaps the vectors around. */
+    for (uint32_t count = 1000; count < 1200; count += 10) {
+        queue.clear();
+        queue.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+            queue.push((count - i) * 997ull, i);
+        queue.sort();
+
+        ASSERT_EQ(queue.items.capacity() + queue.scratch.capacity(),
+                  items_capacity + scratch_capacity);
+    }
+}
+
+TEST(RenderQueue, IndexesAssetsDensely) {
+    /* IDs left behind by lots of creating and deleting. */
+    std::map<AssetID, Mesh> meshes;
+    meshes[1] = Mesh{};
+    meshes[300000] = Mesh{};
+    meshes[5000000] = Mesh{};
+
+    SortKeyIndices indices;
+    ASSERT_TRUE(indices.assign(meshes, SortKey::MESH_BITS));
+    ASSERT_EQ(indices.index_of(0), 0);
+    ASSERT_EQ(indices.index_of(1), 1);
+    ASSERT_EQ(indices.index_of(300000), 2);
+    ASSERT_EQ(indices.index_of(5000000), 3);
+    ASSERT_EQ(indices.index_of(2), -1);
+    ASSERT_EQ(indices.index_of(6000000), -1);
+    ASSERT_EQ(indices.id_at(3), 5000000);
+
+    SortKey key;
+    key.mesh_index = indices.index_of(5000000);
+    key.texture_set_index = 7;
+    SortKey unpacked = unpack_sort_key(pack_sort_key(key));
+    ASSERT_EQ(indices.id_at(unpacked.mesh_index), 5000000);
+    ASSERT_EQ(unpacked.texture_set_index, 7);
+
+    /* Past what fits, the rest get no index. */
+    ASSERT_FALSE(indices.assign(meshes, 1));
+    ASSERT_EQ(indices.index_of(1), 1);
+    ASSERT_EQ(indices.index_of(300000), -1);
+    ASSERT_EQ(indices.index_of(5000000), -1);
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include "eng/scene/scene_file.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace eng;
+
+static std::string temp_scene_path(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static uint32_t file_version(const std::string &path) {
+    SceneFileHeader header;
+    std::ifstream file(path, std::ios::binary);
+    file.read((char *)&header, sizeof(header));
+    return header.version;
+}
+
+static void set_file_version(const std::string &path, uint32_t version) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offsetof(SceneFileHeader, version));
+    file.write((const char *)&version, sizeof(version));
+}
+
+TEST(SceneFile, RoundTrip) {
+    AssetPack pack;
+    pack.meshes[AssetPack::CUBE_ID].name = "Cube";
+    pack.meshes[AssetPack::SPHERE_ID].name = "Sphere";
+    pack.materials[AssetPack::DEFAULT_BASE_MATERIAL].name = "Base material";
+    pack.materials[5].name = "Custom";
+
+    Scene scene = Scene::create("saved");
+    Entity root = scene.spawn_entity("root");
+    Entity child_a = scene.spawn_entity("child_a");
+    Entity child_b = scene.spawn_entity("child_b");
+    Entity grandchild = scene.spawn_entity("grandchild");
+    Entity light = scene.spawn_entity("light");
+
+    root.get_component<Transform>().position = {1.0f, 2.0f, 3.0f};
+    child_a.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    child_a.add_component<MaterialComp>().id = 5;
+    child_a.add_component<Static>();
+    child_a.add_component<LodComp>() = {.bias = 0.5f, .level = 2};
+    child_b.add_component<MeshComp>().id = AssetPack::SPHERE_ID;
+    grandchild.add_component<SpotLight>().cutoff = 30.0f;
+    light.add_component<PointLight>().radius = 12.0f;
+    light.add_component<DirLight>().intensity = 3.0f;
+
+    /* Children get prepended, so B ends up before A. */
+    scene.link_relation(root, child_a);
+    scene.link_relation(root, child_b);
+    scene.link_relation(child_b, grandchild);
+    child_b.get_component<Transform>().scale = glm::vec3(2.0f);
+    scene.update_global_transforms();
+
+    std::string path = temp_scene_path("eng_round_trip.scene");
+    ASSERT_TRUE(save_scene(scene, pack, path));
+    ASSERT_EQ(file_version(path), SCENE_FILE_VERSION);
+
+    /* Same assets under different IDs get matched by name. */
+    AssetPack other_pack;
+    other_pack.meshes[AssetPack::CUBE_ID].name = "Cube";
+    other_pack.meshes[AssetPack::SPHERE_ID].name = "Sphere";
+    other_pack.materials[AssetPack::DEFAULT_BASE_MATERIAL].name =
+        "Base material";
+    other_pack.materials[9].name = "Custom";
+
+    Scene loaded = Scene::create("empty");
+    ASSERT_TRUE(load_scene(loaded, other_pack, path));
+    std::remove(path.c_str());
+
+    ASSERT_EQ(loaded.name, "saved");
+    ASSERT_EQ(loaded.entities.size(), 5);
+    ASSERT_EQ(loaded.root_ids.size(), 2);
+
+    Entity &lroot = loaded.entity(loaded.root_ids[0]);
+    Entity &llight = loaded.entity(loaded.root_ids[1]);
+    ASSERT_EQ(lroot.get_component<Name>().name, "root");
+    ASSERT_EQ(llight.get_component<Name>().name, "light");
+    ASSERT_EQ(lroot.get_component<Transform>().position,
+              glm::vec3(1.0f, 2.0f, 3.0f));
+
+    ASSERT_EQ(lroot.children_ids.size(), 2);
+    Entity &lchild_b = loaded.entity(lroot.children_ids[0]);
+    Entity &lchild_a = loaded.entity(lroot.children_ids[1]);
+    ASSERT_EQ(lchild_b.get_component<Name>().name, "child_b");
+    ASSERT_EQ(lchild_a.get_component<Name>().name, "child_a");
+    ASSERT_EQ(lchild_a.parent_id.value(), lroot.handle);
+
+    ASSERT_EQ(lchild_a.get_component<MeshComp>().id, AssetPack::CUBE_ID);
+    ASSERT_EQ(lchild_a.get_component<MaterialComp>().id, 9);
+    ASSERT_TRUE(lchild_a.has_component<Static>());
+    ASSERT_FALSE(lchild_b.has_component<Static>());
+    ASSERT_EQ(lchild_a.get_component<LodComp>().bias, 0.5f);
+    ASSERT_EQ(lchild_a.get_component<LodComp>().level, 0);
+    ASSERT_EQ(lchild_b.get_component<MeshComp>().id, AssetPack::SPHERE_ID);
+    ASSERT_FALSE(lchild_b.has_component<MaterialComp>());
+    ASSERT_EQ(lchild_b.get_component<GlobalTransform>().scale,
+              glm::vec3(2.0f));
+
+    ASSERT_EQ(lchild_b.children_ids.size(), 1);
+    Entity &lgrandchild = loaded.entity(lchild_b.children_ids[0]);
+    ASSERT_EQ(lgrandchild.get_component<Name>().name, "grandchild");
+    ASSERT_EQ(lgrandchild.get_component<SpotLight>().cutoff, 30.0f);
+    ASSERT_EQ(lgrandchild.get_component<GlobalTransform>().position,
+              glm::vec3(1.0f, 2.0f, 3.0f));
+
+    ASSERT_EQ(llight.get_component<PointLight>().radius, 12.0f);
+    ASSERT_EQ(llight.get_component<DirLight>().intensity, 3.0f);
+
+    /* Loaded scene behaves like one built in code. */
+    const std::vector<int32_t> &order = loaded.hierarchy_order();
+    ASSERT_EQ(loaded.entities[order[0]].handle, lroot.handle);
+    ASSERT_EQ(loaded.entities[order[4]].handle, llight.handle);
+
+    /* Spawning might move records around, keep just the IDs. */
+    ecs::EntityID child_b_id = lchild_b.handle;
+    ecs::EntityID grandchild_id = lgrandchild.handle;
+
+    Entity spawned = loaded.spawn_entity("spawned");
+    spawned.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    loaded.destroy_entity(child_b_id);
+    ASSERT_EQ(loaded.entities.size() - loaded.free_slots.size(), 4);
+    ASSERT_FALSE(loaded.contains(grandchild_id));
+
+    scene.destroy();
+    loaded.destroy();
+}
+
+TEST(SceneFile, RejectsInvalidFiles) {
+    AssetPack pack;
+    Scene scene = Scene::create("test");
+    ASSERT_FALSE(load_scene(scene, pack, temp_scene_path("eng_missing")));
+
+    Entity ent = scene.spawn_entity("ent");
+    ent.add_component<PointLight>();
+
+    std::string path = temp_scene_path("eng_truncated.scene");
+    ASSERT_TRUE(save_scene(scene, pack, path));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+
+    Scene loaded = Scene::create("empty");
+    ASSERT_FALSE(load_scene(loaded, pack, path));
+    ASSERT_TRUE(loaded.entities.empty());
+
+    FILE *file = fopen(path.c_str(), "wb");
+    fputs("definitely not a scene file, but long enough to have a header "
+          "and then some more bytes to get past the size check",
+          file);
+    fclose(file);
+
+    ASSERT_FALSE(load_scene(loaded, pack, path));
+    ASSERT_TRUE(loaded.entities.empty());
+    std::remove(path.c_str());
+
+    scene.destroy();
+    loaded.destroy();
+}
+
+TEST(SceneFile, LoadsOlderVersions) {
+    AssetPack pack;
+    pack.meshes[AssetPack::CUBE_ID].name = "Cube";
+
+    Scene scene = Scene::create("old");
+    Entity ent = scene.spawn_entity("ent");
+    ent.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    ent.add_component<PointLight>().radius = 4.0f;
+
+    /* Nothing version 1 didn't have, so it's a valid version 1 file. */
+    std::string path = temp_scene_path("eng_old_version.scene");
+    ASSERT_TRUE(save_scene(scene, pack, path));
+    set_file_version(path, 1);
+
+    Scene loaded = Scene::create("empty");
+    ASSERT_TRUE(load_scene(loaded, pack, path));
+    ASSERT_EQ(loaded.entities.size(), 1);
+    ASSERT_EQ(loaded.entities[0].get_component<PointLight>().radius, 4.0f);
+    loaded.destroy();
+
+    /* Static didn't exist back then. */
+    scene.entity(ent.handle).add_component<Static>();
+    ASSERT_TRUE(save_scene(scene, pack, path));
+    set_file_version(path, 1);
+
+    loaded = Scene::create("empty");
+    ASSERT_FALSE(load_scene(loaded, pack, path));
+    ASSERT_TRUE(loaded.entities.empty());
+
+    set_file_version(path, SCENE_FILE_VERSION + 1);
+    ASSERT_FALSE(load_scene(loaded, pack, path));
+    std::remove(path.c_str());
+
+    scene.destroy();
+    loaded.destroy();
+}
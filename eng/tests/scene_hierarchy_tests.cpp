@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include "eng/scene/scene.hpp"
+
+using namespace eng;
+
+TEST(SceneHierarchy, SpawnedEntitiesAreRoots) {
+    Scene scene = Scene::create("test");
+    Entity e1 = scene.spawn_entity("e1");
+    Entity e2 = scene.spawn_entity("e2");
+
+    ASSERT_TRUE(scene.contains(e1.handle));
+    ASSERT_TRUE(scene.contains(e2.handle));
+    ASSERT_EQ(scene.root_ids.size(), 2);
+    ASSERT_EQ(scene.entity(e2.handle).get_component<Name>().name, "e2");
+
+    scene.destroy();
+}
+
+TEST(SceneHierarchy, LinkingDoesNotMoveEntities) {
+    Scene scene = Scene::create("test");
+    Entity a = scene.spawn_entity("a");
+    Entity b = scene.spawn_entity("b");
+    Entity c = scene.spawn_entity("c");
+
+    int32_t a_idx = scene.id_to_index[a.handle];
+    int32_t b_idx = scene.id_to_index[b.handle];
+    int32_t c_idx = scene.id_to_index[c.handle];
+
+    scene.link_relation(c, a);
+    scene.link_relation(a, b);
+
+    ASSERT_EQ(scene.id_to_index[a.handle], a_idx);
+    ASSERT_EQ(scene.id_to_index[b.handle], b_idx);
+    ASSERT_EQ(scene.id_to_index[c.handle], c_idx);
+
+    ASSERT_EQ(scene.root_ids.size(), 1);
+    ASSERT_EQ(scene.root_ids[0], c.handle);
+    ASSERT_EQ(scene.entity(b.handle).parent_id.value(), a.handle);
+    ASSERT_EQ(scene.entity(a.handle).parent_id.value(), c.handle);
+    ASSERT_TRUE(scene.is_ascendant_of(scene.entity(b.handle),
+                                      scene.entity(c.handle)));
+
+    scene.destroy();
+}
+
+TEST(SceneHierarchy, ParentsComeFirstInHierarchyOrder) {
+    Scene scene = Scene::create("test");
+    Entity child = scene.spawn_entity("child");
+    Entity grandchild = scene.spawn_entity("grandchild");
+    Entity root = scene.spawn_entity("root");
+
+    scene.link_relation(child, grandchild);
+    scene.link_relation(root, child);
+
+    const std::vector<int32_t> &order = scene.hierarchy_order();
+    ASSERT_EQ(order.size(), 3);
+    ASSERT_EQ(order[0], scene.id_to_index[root.handle]);
+    ASSERT_EQ(order[1], scene.id_to_index[child.handle]);
+    ASSERT_EQ(order[2], scene.id_to_index[grandchild.handle]);
+
+    scene.destroy();
+}
+
+TEST(SceneHierarchy, DestroyFreesWholeSubtree) {
+    Scene scene = Scene::create("test");
+    Entity root = scene.spawn_entity("root");
+    Entity child = scene.spawn_entity("child");
+    Entity grandchild = scene.spawn_entity("grandchild");
+    Entity other = scene.spawn_entity("other");
+
+    scene.link_relation(root, child);
+    scene.link_relation(child, grandchild);
+
+    int32_t other_idx = scene.id_to_index[other.handle];
+    scene.destroy_entity(child.handle);
+
+    ASSERT_TRUE(scene.contains(root.handle));
+    ASSERT_FALSE(scene.contains(child.handle));
+    ASSERT_FALSE(scene.contains(grandchild.handle));
+    ASSERT_TRUE(scene.entity(root.handle).children_ids.empty());
+    ASSERT_EQ(scene.id_to_index[other.handle], other_idx);
+    ASSERT_EQ(scene.hierarchy_order().size(), 2);
+
+    /* Freed slots get reused. */
+    size_t slots = scene.entities.size();
+    (void)scene.spawn_entity("new1");
+    (void)scene.spawn_entity("new2");
+    ASSERT_EQ(scene.entities.size(), slots);
+
+    scene.destroy();
+}
+
+TEST(SceneHierarchy, GlobalTransformsFollowParents) {
+    Scene scene = Scene::create("test");
+    Entity parent = scene.spawn_entity("parent");
+    Entity child = scene.spawn_entity("child");
+
+    parent.get_component<Transform>().position = {1.0f, 2.0f, 3.0f};
+    child.get_component<Transform>().position = {1.0f, 0.0f, 0.0f};
+    scene.update_global_transforms();
+
+    /* Linking keeps child's world position. */
+    scene.link_relation(parent, child);
+    scene.update_global_transforms();
+
+    glm::vec3 pos = child.get_component<GlobalTransform>().position;
+    EXPECT_NEAR(pos.x, 1.0f, 0.0001f);
+    EXPECT_NEAR(pos.y, 0.0f, 0.0001f);
+    EXPECT_NEAR(pos.z, 0.0f, 0.0001f);
+
+    parent.get_component<Transform>().position = {2.0f, 2.0f, 3.0f};
+    scene.update_global_transforms();
+
+    pos = child.get_component<GlobalTransform>().position;
+    EXPECT_NEAR(pos.x, 2.0f, 0.0001f);
+    EXPECT_NEAR(pos.y, 0.0f, 0.0001f);
+    EXPECT_NEAR(pos.z, 0.0f, 0.0001f);
+
+    scene.destroy();
+}
+
+TEST(SceneHierarchy, DuplicateCopiesSubtree) {
+    Scene scene = Scene::create("test");
+    Entity parent = scene.spawn_entity("parent");
+    Entity root = scene.spawn_entity("root");
+    Entity child = scene.spawn_entity("child");
+
+    scene.link_relation(parent, root);
+    scene.link_relation(root, child);
+
+    Entity &copy = scene.duplicate(scene.entity(root.handle));
+    ecs::EntityID copy_id = copy.handle;
+
+    ASSERT_NE(copy_id, root.handle);
+    ASSERT_EQ(scene.entity(copy_id).parent_id.value(), parent.handle);
+    ASSERT_EQ(scene.entity(copy_id).children_ids.size(), 1);
+    ASSERT_EQ(scene.entity(parent.handle).children_ids.size(), 2);
+
+    ecs::EntityID copy_child_id = scene.entity(copy_id).children_ids[0];
+    ASSERT_NE(copy_child_id, child.handle);
+    ASSERT_EQ(scene.entity(copy_child_id).get_component<Name>().name, "child");
+    ASSERT_EQ(scene.hierarchy_order().size(), 5);
+
+    scene.destroy();
+}
+
+TEST(SceneHierarchy, MergeKeepsHierarchy) {
+    Scene scene = Scene::create("live");
+    Entity live = scene.spawn_entity("live");
+
+    Scene staging = Scene::create("staging");
+    Entity parent = staging.spawn_entity("parent");
+    Entity child = staging.spawn_entity("child");
+    child.add_component<MeshComp>().id = 3;
+    staging.link_relation(parent, child);
+
+    ecs::EntityID parent_id = parent.handle;
+    ecs::EntityID child_id = child.handle;
+    std::vector<ecs::EntityID> ids = scene.merge(std::move(staging));
+
+    ASSERT_EQ(scene.root_ids.size(), 2);
+    ASSERT_EQ(scene.root_ids[0], live.handle);
+    ASSERT_EQ(scene.root_ids[1], ids[parent_id]);
+
+    Entity &mparent = scene.entity(ids[parent_id]);
+    Entity &mchild = scene.entity(ids[child_id]);
+    ASSERT_EQ(mparent.get_component<Name>().name, "parent");
+    ASSERT_EQ(mparent.children_ids.size(), 1);
+    ASSERT_EQ(mparent.children_ids[0], mchild.handle);
+    ASSERT_EQ(mchild.parent_id.value(), mparent.handle);
+    ASSERT_EQ(mchild.get_component<MeshComp>().id, 3);
+
+    const std::vector<int32_t> &order = scene.hierarchy_order();
+    ASSERT_EQ(order.size(), 3);
+    ASSERT_EQ(scene.entities[order[2]].handle, mchild.handle);
+
+    scene.destroy_entity(ids[parent_id]);
+    ASSERT_FALSE(scene.contains(ids[child_id]));
+    ASSERT_TRUE(scene.contains(live.handle));
+
+    scene.destroy();
+}
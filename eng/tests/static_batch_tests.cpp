@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/renderer/opengl.hpp"
+#include "eng/renderer/scene_submission.hpp"
+#include "eng/renderer/static_batch.hpp"
+#include <glm/ext/matrix_clip_space.hpp>
+
+using namespace eng;
+
+using StaticBatchesTest = GLTest;
+
+TEST_F(StaticBatchesTest, BakesPerMaterialAndCell) {
+    AssetPack pack;
+    pack.geometry = GeometryPool::create();
+    Mesh cube = create_mesh(cube_vertex_data(), pack.geometry);
+    uint32_t cube_indices = cube.indices.size();
+    pack.meshes[AssetPack::CUBE_ID] = cube;
+
+    /* Two materials, the first one spread over two cells. */
+    Scene scene = Scene::create("static");
+    std::array<glm::vec3, 4> positions = {
+        glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(3.0f, 0.0f, 1.0f),
+        glm::vec3(40.0f, 0.0f, 1.0f), glm::vec3(1.0f, 5.0f, 1.0f)};
+    std::array<AssetID, 4> materials = {1, 1, 1, 2};
+    for (int32_t i = 0; i < 4; i++) {
+        Entity ent = scene.spawn_entity("static");
+        ent.get_component<Transform>().position = positions[i];
+        ent.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+        ent.add_component<MaterialComp>().id = materials[i];
+        ent.add_component<Static>();
+    }
+
+    /* Dynamic ones stay out of batches. */
+    Entity dynamic = scene.spawn_entity("dynamic");
+    dynamic.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+    dynamic.add_component<MaterialComp>().id = 1;
+
+    scene.update_global_transforms();
+    scene.update_spatial_index(pack);
+
+    StaticBatches batches = StaticBatches::bake(scene, pack);
+    ASSERT_EQ(batches.baked_entities, 4);
+    ASSERT_EQ(batches.batches.size(), 2);
+
+    StaticBatch &first = batches.batches[0];
+    ASSERT_EQ(first.material_id, 1);
+    ASSERT_EQ(first.clusters.size(), 2);
+    ASSERT_EQ(first.clusters[0].first_index, 0);
+    ASSERT_EQ(first.clusters[0].indices_count, cube_indices * 2);
+    ASSERT_EQ(first.clusters[1].first_index, cube_indices * 2);
+    ASSERT_EQ(first.clusters[1].indices_count, cube_indices);
+    ASSERT_EQ(first.mesh.geometry.indices_count, cube_indices * 3);
+
+    /* Geometry is in world space. */
+    ASSERT_NEAR(first.clusters[0].bb.min.x, 0.5f, 0.001f);
+    ASSERT_NEAR(first.clusters[0].bb.max.x, 3.5f, 0.001f);
+    ASSERT_NEAR(first.clusters[1].bb.min.x, 39.5f, 0.001f);
+    ASSERT_NEAR(first.bb.max.x, 40.5f, 0.001f);
+
+    StaticBatch &second = batches.batches[1];
+    ASSERT_EQ(second.material_id, 2);
+    ASSERT_EQ(second.clusters.size(), 1);
+    ASSERT_NEAR(second.bb.min.y, 4.5f, 0.001f);
+
+    /* Per-entity path only sees the dynamic one. */
+    Frustum frustum = extract_frustum_planes(
+        glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, -100.0f, 100.0f));
+    std::vector<int32_t> proxies;
+    renderer::cull_visible_meshes(scene, frustum, proxies);
+    ASSERT_EQ(proxies.size(), 1);
+
+    batches.destroy(pack.geometry);
+    ASSERT_TRUE(batches.batches.empty());
+
+    /* Only the cube is left in the pool. */
+    ASSERT_EQ(pack.geometry.indices.used, cube_indices);
+
+    pack.geometry.destroy();
+    scene.destroy();
+}
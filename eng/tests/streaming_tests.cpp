@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include "eng/scene/streaming.hpp"
+#include "eng/scene/scene_file.hpp"
+#include <chrono>
+#include <filesystem>
+
+using namespace eng;
+
+static void update_until_idle(CellStreamer &streamer, Scene &scene,
+                              const AssetPack &pack, const glm::vec3 &focus) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    do {
+        streamer.update(scene, pack, focus);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (streamer.has_pending() &&
+             std::chrono::steady_clock::now() < deadline);
+
+    streamer.update(scene, pack, focus);
+}
+
+TEST(CellStreaming, LoadsAndEvictsAroundFocus) {
+    AssetPack pack;
+    pack.meshes[AssetPack::CUBE_ID].name = "Cube";
+
+    /* 8x8 grid of cells, 10 units wide, one root with a child in each. */
+    Scene world = Scene::create("world");
+    for (int32_t z = 0; z < 8; z++) {
+        for (int32_t x = 0; x < 8; x++) {
+            Entity root = world.spawn_entity("root");
+            root.get_component<Transform>().position = {x * 10.0f + 5.0f, 0.0f,
+                                                        z * 10.0f + 5.0f};
+            root.add_component<MeshComp>().id = AssetPack::CUBE_ID;
+
+            Entity child = world.spawn_entity("child");
+            world.link_relation(root, child);
+        }
+    }
+
+    world.update_global_transforms();
+
+    std::string dir =
+        (std::filesystem::temp_directory_path() / "eng_cells").string();
+    ASSERT_TRUE(save_scene_cells(world, pack, dir, 10.0f));
+
+    CellStreamingSpec spec;
+    spec.dir = dir;
+    spec.cell_size = 10.0f;
+    spec.load_radius = 4.0f;
+    spec.unload_radius = 8.0f;
+    spec.max_merges_per_update = 4;
+    spec.max_evictions_per_update = 16;
+
+    CellStreamer streamer = CellStreamer::create(spec);
+    ASSERT_EQ(streamer.available_cells.size(), 64);
+
+    /* Center of a cell - only that one is in range. */
+    Scene scene = Scene::create("live");
+    update_until_idle(streamer, scene, pack, {15.0f, 0.0f, 15.0f});
+    ASSERT_EQ(streamer.resident_count(), 1);
+    ASSERT_EQ(scene.root_ids.size(), 1);
+    ASSERT_EQ(scene.entity(scene.root_ids[0]).children_ids.size(), 1);
+    ASSERT_TRUE(scene.entity(scene.root_ids[0]).has_component<MeshComp>());
+
+    /* Corner of four cells. */
+    update_until_idle(streamer, scene, pack, {20.0f, 0.0f, 20.0f});
+    ASSERT_EQ(streamer.resident_count(), 4);
+    ASSERT_EQ(scene.root_ids.size(), 4);
+
+    /* Far away, everything from before gets evicted. */
+    update_until_idle(streamer, scene, pack, {75.0f, 0.0f, 75.0f});
+    ASSERT_EQ(streamer.resident_count(), 1);
+    ASSERT_EQ(scene.root_ids.size(), 1);
+    ASSERT_EQ(scene.entities.size() - scene.free_slots.size(), 2);
+
+    glm::vec3 position =
+        scene.entity(scene.root_ids[0]).get_component<Transform>().position;
+    ASSERT_EQ(position, glm::vec3(75.0f, 0.0f, 75.0f));
+
+    streamer.evict_all(scene);
+    ASSERT_TRUE(scene.root_ids.empty());
+
+    streamer.destroy();
+    std::filesystem::remove_all(dir);
+    world.destroy();
+    scene.destroy();
+}
+
+TEST(CellStreaming, RespectsResidentLimit) {
+    AssetPack pack;
+    Scene world = Scene::create("world");
+    for (int32_t x = 0; x < 10; x++) {
+        Entity ent = world.spawn_entity("ent");
+        ent.get_component<Transform>().position = {x * 1.0f + 0.5f, 0.0f,
+                                                   0.5f};
+    }
+
+    world.update_global_transforms();
+
+    std::string dir =
+        (std::filesystem::temp_directory_path() / "eng_cells_limit").string();
+    ASSERT_TRUE(save_scene_cells(world, pack, dir, 1.0f));
+
+    CellStreamingSpec spec;
+    spec.dir = dir;
+    spec.cell_size = 1.0f;
+    spec.load_radius = 100.0f;
+    spec.unload_radius = 100.0f;
+    spec.max_resident_cells = 3;
+
+    CellStreamer streamer = CellStreamer::create(spec);
+    Scene scene = Scene::create("live");
+    update_until_idle(streamer, scene, pack, {0.5f, 0.0f, 0.5f});
+
+    /* Nearest ones win. */
+    ASSERT_EQ(streamer.resident_count(), 3);
+    ASSERT_EQ(scene.root_ids.size(), 3);
+    for (ecs::EntityID root_id : scene.root_ids) {
+        Entity &root = scene.entity(root_id);
+        ASSERT_LT(root.get_component<Transform>().position.x, 3.0f);
+    }
+
+    streamer.destroy();
+    std::filesystem::remove_all(dir);
+    world.destroy();
+    scene.destroy();
+}
+
+TEST(CellStreaming, ResolvesAssetsChangedSinceLastRequest) {
+    AssetPack pack;
+    pack.materials[AssetPack::DEFAULT_BASE_MATERIAL].name = "Base material";
+    pack.materials[5].name = "Custom";
+
+    /* One entity per cell, far enough apart to be requested separately. */
+    Scene world = Scene::create("world");
+    for (int32_t x = 0; x < 2; x++) {
+        Entity ent = world.spawn_entity("ent");
+        ent.get_component<Transform>().position = {x * 50.0f + 5.0f, 0.0f,
+                                                   5.0f};
+        ent.add_component<MaterialComp>().id = 5;
+    }
+
+    world.update_global_transforms();
+
+    std::string dir =
+        (std::filesystem::temp_directory_path() / "eng_cells_assets").string();
+    ASSERT_TRUE(save_scene_cells(world, pack, dir, 10.0f));
+
+    CellStreamingSpec spec;
+    spec.dir = dir;
+    spec.cell_size = 10.0f;
+    spec.load_radius = 4.0f;
+    spec.unload_radius = 100.0f;
+
+    CellStreamer streamer = CellStreamer::create(spec);
+    Scene scene = Scene::create("live");
+    update_until_idle(streamer, scene, pack, {5.0f, 0.0f, 5.0f});
+    ASSERT_EQ(scene.root_ids.size(), 1);
+
+    /* Deleted and recreated - same count, different ID. */
+    pack.materials.erase(5);
+    pack.generation++;
+    Material custom;
+    custom.name = "Custom";
+    AssetID custom_id = pack.add_material(custom);
+    ASSERT_NE(custom_id, 5);
+
+    update_until_idle(streamer, scene, pack, {55.0f, 0.0f, 5.0f});
+    ASSERT_EQ(scene.root_ids.size(), 2);
+    Entity &streamed = scene.entity(scene.root_ids.back());
+    ASSERT_EQ(streamed.get_component<Transform>().position.x, 55.0f);
+    ASSERT_EQ(streamed.get_component<MaterialComp>().id, custom_id);
+
+    streamer.destroy();
+    std::filesystem::remove_all(dir);
+    world.destroy();
+    scene.destroy();
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "eng/renderer/scene_submission.hpp"
+#include "eng/scene/stress_scene.hpp"
+
+using namespace eng;
+
+static AssetPack bounds_only_pack() {
+    AssetPack pack;
+    for (AssetID id = 1; id <= 3; id++)
+        pack.meshes[id].local_bb = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+
+    return pack;
+}
+
+TEST(StressScene, FollowsSpec) {
+    AssetPack pack = bounds_only_pack();
+
+    StressSceneSpec spec;
+    spec.entities_count = 100;
+    spec.hierarchy_depth = 3;
+    spec.children_per_node = 2;
+    spec.materials_count = 4;
+    spec.point_lights_count = 5;
+    spec.spot_lights_count = 3;
+    spec.dir_lights_count = 2;
+
+    Scene scene = Scene::create("stress");
+    std::vector<ecs::EntityID> roots =
+        generate_stress_scene(scene, pack, spec);
+
+    /* Trees of 1 + 2 + 4, the last one cut short. */
+    ASSERT_EQ(roots.size(), 15);
+    ASSERT_EQ(scene.entities.size(), 110);
+    ASSERT_EQ(scene.root_ids.size(), 25);
+    ASSERT_EQ(pack.materials.size(), 4);
+
+    Entity &root = scene.entity(roots[0]);
+    ASSERT_EQ(root.children_ids.size(), 2);
+    Entity &child = scene.entity(root.children_ids[0]);
+    ASSERT_EQ(child.children_ids.size(), 2);
+    ASSERT_TRUE(scene.entity(child.children_ids[0]).children_ids.empty());
+    ASSERT_TRUE(child.has_component<MeshComp>());
+    ASSERT_TRUE(pack.materials.contains(
+        child.get_component<MaterialComp>().id));
+
+    int32_t point_lights = 0;
+    int32_t spot_lights = 0;
+    int32_t dir_lights = 0;
+    for (ecs::EntityID root_id : scene.root_ids) {
+        Entity &ent = scene.entity(root_id);
+        point_lights += ent.has_component<PointLight>();
+        spot_lights += ent.has_component<SpotLight>();
+        dir_lights += ent.has_component<DirLight>();
+    }
+
+    ASSERT_EQ(point_lights, 5);
+    ASSERT_EQ(spot_lights, 3);
+    ASSERT_EQ(dir_lights, 2);
+
+    /* Same spec, same scene. */
+    Scene other = Scene::create("other");
+    AssetPack other_pack = bounds_only_pack();
+    std::vector<ecs::EntityID> other_roots =
+        generate_stress_scene(other, other_pack, spec);
+    ASSERT_EQ(other.entity(other_roots[7]).get_component<Transform>().position,
+              scene.entity(roots[7]).get_component<Transform>().position);
+
+    scene.destroy();
+    other.destroy();
+}
+
+TEST(StressScene, CullsWithoutRenderer) {
+    AssetPack pack = bounds_only_pack();
+
+    StressSceneSpec spec;
+    spec.entities_count = 500;
+    spec.extent = 100.0f;
+    spec.spot_lights_count = 0;
+
+    Scene scene = Scene::create("stress");
+    (void)generate_stress_scene(scene, pack, spec);
+    scene.update_global_transforms();
+    scene.update_spatial_index(pack);
+
+    /* Everything is in front of the camera. */
+    glm::mat4 view_proj =
+        glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f) *
+        glm::lookAt(glm::vec3(0.0f, 300.0f, 0.0f), glm::vec3(0.0f),
+                    glm::vec3(0.0f, 0.0f, -1.0f));
+    Frustum frustum = extract_frustum_planes(view_proj);
+
+    std::vector<int32_t> proxies;
+    renderer::cull_visible_meshes(scene, frustum, proxies);
+    ASSERT_EQ(proxies.size(), 500);
+
+    renderer::cull_shadow_casters(scene, frustum, proxies);
+    ASSERT_FALSE(proxies.empty());
+    ASSERT_LT(proxies.size(), 500);
+    ASSERT_TRUE(std::is_sorted(proxies.begin(), proxies.end()));
+
+    /* Camera turned away. */
+    view_proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f) *
+                glm::lookAt(glm::vec3(0.0f, 300.0f, 0.0f),
+                            glm::vec3(0.0f, 600.0f, 0.0f),
+                            glm::vec3(0.0f, 0.0f, -1.0f));
+    renderer::cull_visible_meshes(scene, extract_frustum_planes(view_proj),
+                                  proxies);
+    ASSERT_TRUE(proxies.empty());
+
+    scene.destroy();
+}
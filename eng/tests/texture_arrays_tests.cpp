@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include "gl_test.hpp"
+
+#include "eng/renderer/texture_arrays.hpp"
+
+using namespace eng;
+
+using TextureArraysTest = GLTest;
+
+static TextureSpec rgba_spec(int32_t size) {
+    TextureSpec spec;
+    spec.format = TextureFormat::RGBA8;
+    spec.size = {size, size};
+    spec.min_filter = GL_NEAREST;
+    spec.mag_filter = GL_NEAREST;
+    spec.wrap = GL_REPEAT;
+    return spec;
+}
+
+static Texture solid_texture(const TextureSpec &spec, uint32_t color) {
+    std::vector<uint32_t> texels(spec.size.x * spec.size.y, color);
+    return Texture::create(texels.data(), spec);
+}
+
+static uint32_t first_texel(const TextureArrays &arrays, TextureLayer where) {
+    const TextureArrays::Array &array = arrays.arrays[where.array];
+    std::vector<uint32_t> texels(array.spec.size.x * array.spec.size.y *
+                                 array.capacity);
+    GL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, array.id));
+    GL_CALL(glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                          texels.data()));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+    return texels[where.layer * array.spec.size.x * array.spec.size.y];
+}
+
+TEST_F(TextureArraysTest, PacksTexturesBySpec) {
+    std::map<AssetID, Texture> textures;
+    textures[1] = solid_texture(rgba_spec(4), 0xFF0000FF);
+    textures[2] = solid_texture(rgba_spec(4), 0xFF00FF00);
+    textures[3] = solid_texture(rgba_spec(4), 0xFFFF0000);
+    textures[4] = solid_texture(rgba_spec(8), 0xFFFFFFFF);
+
+    TextureArrays arrays;
+    ASSERT_TRUE(arrays.sync(textures));
+    ASSERT_FALSE(arrays.sync(textures));
+    ASSERT_EQ(arrays.arrays_count, 2);
+
+    /* Same spec, one array, layers grown into. */
+    ASSERT_EQ(arrays.layer_of(1).array, 0);
+    ASSERT_EQ(arrays.layer_of(3).array, 0);
+    ASSERT_EQ(arrays.layer_of(3).layer, 2);
+    ASSERT_EQ(arrays.layer_ref(4), 1 << 16);
+    ASSERT_EQ(arrays.layer_ref(5), -1);
+    ASSERT_GT(arrays.grows, 0);
+
+    ASSERT_EQ(first_texel(arrays, arrays.layer_of(1)), 0xFF0000FF);
+    ASSERT_EQ(first_texel(arrays, arrays.layer_of(2)), 0xFF00FF00);
+    ASSERT_EQ(first_texel(arrays, arrays.layer_of(3)), 0xFFFF0000);
+
+    /* Edited in place - repacked, its old layer goes to the next one. */
+    TextureSpec clamped = rgba_spec(4);
+    clamped.wrap = GL_CLAMP_TO_EDGE;
+    textures[1].change_params(clamped);
+    textures[5] = solid_texture(rgba_spec(4), 0xFF00FFFF);
+    ASSERT_TRUE(arrays.sync(textures));
+    ASSERT_EQ(arrays.arrays_count, 3);
+    ASSERT_EQ(arrays.layer_of(1).array, 2);
+    ASSERT_EQ(arrays.layer_of(5).array, 0);
+    ASSERT_EQ(arrays.layer_of(5).layer, 0);
+    ASSERT_EQ(first_texel(arrays, arrays.layer_of(5)), 0xFF00FFFF);
+    ASSERT_EQ(first_texel(arrays, arrays.layer_of(1)), 0xFF0000FF);
+
+    textures[2].destroy();
+    textures.erase(2);
+    ASSERT_TRUE(arrays.sync(textures));
+    ASSERT_EQ(arrays.layer_ref(2), -1);
+    ASSERT_EQ(arrays.arrays[0].free_layers.size(), 1);
+
+    /* No units left for another array - stays unpacked. */
+    arrays.max_arrays = arrays.arrays_count;
+    textures[6] = solid_texture(rgba_spec(16), 0xFFFFFFFF);
+    arrays.sync(textures);
+    ASSERT_EQ(arrays.layer_ref(6), -1);
+    ASSERT_EQ(arrays.arrays_count, 3);
+
+    ASSERT_EQ(glGetError(), GL_NO_ERROR);
+
+    arrays.destroy();
+    for (auto &[id, texture] : textures)
+        texture.destroy();
+}